@@ -32,9 +32,28 @@ include_directories(${RX_CORE_EXTERNAL_LIBS}/glm)
 ##########################################################################################################
 include_directories(${RX_CORE_CPP}/Time)
 
+# Count the calls to operator new on the render thread(s), see AllocationCounter.h
+option(RENDERINGX_COUNT_ALLOCATIONS "Replace the global operator new to verify the render loop does not allocate" OFF)
+if(RENDERINGX_COUNT_ALLOCATIONS)
+    add_definitions(-DRENDERINGX_COUNT_ALLOCATIONS)
+endif()
+
+# Count the draw calls, state changes, uniform uploads and upload bytes per frame and subsystem, see GLInstrumentation.hpp
+option(RENDERINGX_GL_INSTRUMENTATION "Count the OpenGL calls of RenderingXCore per frame and write them as trace counters" OFF)
+if(RENDERINGX_GL_INSTRUMENTATION)
+    add_definitions(-DRENDERINGX_GL_INSTRUMENTATION)
+endif()
+
 include_directories(${RX_CORE_CPP}/SuperSync)
+include_directories(${RX_CORE_CPP}/Threading)
 add_library(Extensions SHARED
         ${RX_CORE_CPP}/SuperSync/Extensions.cpp
+        ${RX_CORE_CPP}/SuperSync/ThreadPlacement.cpp
+        ${RX_CORE_CPP}/SuperSync/FramePacer.cpp
+        ${RX_CORE_CPP}/SuperSync/FrameTimestampsTracker.cpp
+        ${RX_CORE_CPP}/SuperSync/AllocationCounter.cpp
+        ${RX_CORE_CPP}/Threading/TaskScheduler.cpp
+        ${RX_CORE_CPP}/Threading/SecondaryRenderScheduler.cpp
         )
 target_link_libraries( Extensions ${log-lib} android EGL GLESv2)
 
@@ -69,6 +88,7 @@ add_library( GLPrograms SHARED
         ${RX_CORE_CPP}/GLPrograms/GLProgramText.cpp
         ${RX_CORE_CPP}/GLPrograms/GLProgramTexture.cpp
         ${RX_CORE_CPP}/GLPrograms/GLProgramLine.cpp
+        ${RX_CORE_CPP}/GLPrograms/ProgramBinaryCache.cpp
         ${RX_CORE_CPP}/GLPrograms/ProjTex/GLPTextureProj.cpp
         ${RX_CORE_CPP}/GLPrograms/ProjTex/GLPTextureProj2.cpp
         )
@@ -78,6 +98,8 @@ target_link_libraries( GLPrograms ${log-lib} android GLESv2 gvr-lib Extensions V
 include_directories(${RX_CORE_CPP}/SuperSync)
 add_library( SuperSync SHARED
         ${RX_CORE_CPP}/SuperSync/VSYNC.cpp
-        ${RX_CORE_CPP}/SuperSync/FBRManager.cpp)
-target_link_libraries( SuperSync ${log-lib} android log EGL GLESv2 Extensions GLPrograms)
+        ${RX_CORE_CPP}/SuperSync/VSYNCSource.cpp
+        ${RX_CORE_CPP}/SuperSync/FBRManager.cpp
+        ${RX_CORE_CPP}/SuperSync/FrameTimingTelemetry.cpp)
+target_link_libraries( SuperSync ${log-lib} android log dl EGL GLESv2 Extensions GLPrograms)
 #
\ No newline at end of file
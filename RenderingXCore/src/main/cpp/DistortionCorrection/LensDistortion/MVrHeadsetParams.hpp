@@ -8,6 +8,7 @@
 #include <vector>
 #include <array>
 #include <sstream>
+#include <cassert>
 #include <NDKJavaClassMember.hpp>
 
 // Links to java MVrHeadsetParams
@@ -6,6 +6,7 @@
 #define CARDBOARD_MPOLYNOMIALRADIALDISTORTION_H
 
 #include <array>
+#include <string>
 #include <vector>
 
 //Based on @cardboard/PolynomialRadialDistortion
@@ -12,6 +12,7 @@
 #include <vector>
 #include <sys/stat.h>
 #include <GLHelper.hpp>
+#include <GLInstrumentation.hpp>
 
 #include <glm/glm.hpp>
 #include <glm/mat4x4.hpp>
@@ -231,19 +232,19 @@ public:
      * @param leftEye true if uniforms should be updated for rendering the left eye, false for right eye
      */
     static void updateUnDistortionUniforms(const bool leftEye, const UnDistortionUniformHandles& undistortionHandles, const DataUnDistortion& dataUnDistortion) {
-        glUniform1f(undistortionHandles.uPolynomialRadialInverse_maxRadSq,dataUnDistortion.radialDistortionCoefficients.maxRadSquared);
-        glUniform1fv(undistortionHandles.uPolynomialRadialInverse_coefficients,N_RADIAL_UNDISTORTION_COEFICIENTS,dataUnDistortion.radialDistortionCoefficients.kN.data());
+        GLInstrumentation::uniform1f(undistortionHandles.uPolynomialRadialInverse_maxRadSq,dataUnDistortion.radialDistortionCoefficients.maxRadSquared);
+        GLInstrumentation::uniform1fv(undistortionHandles.uPolynomialRadialInverse_coefficients,N_RADIAL_UNDISTORTION_COEFICIENTS,dataUnDistortion.radialDistortionCoefficients.kN.data());
         const int IDX= leftEye ? 0 : 1;
         //update screen params
-        glUniform1f(undistortionHandles.uScreenParams_w,dataUnDistortion.screen_params[IDX].width);
-        glUniform1f(undistortionHandles.uScreenParams_h,dataUnDistortion.screen_params[IDX].height);
-        glUniform1f(undistortionHandles.uScreenParams_x_off,dataUnDistortion.screen_params[IDX].x_eye_offset);
-        glUniform1f(undistortionHandles.uScreenParams_y_off,dataUnDistortion.screen_params[IDX].y_eye_offset);
+        GLInstrumentation::uniform1f(undistortionHandles.uScreenParams_w,dataUnDistortion.screen_params[IDX].width);
+        GLInstrumentation::uniform1f(undistortionHandles.uScreenParams_h,dataUnDistortion.screen_params[IDX].height);
+        GLInstrumentation::uniform1f(undistortionHandles.uScreenParams_x_off,dataUnDistortion.screen_params[IDX].x_eye_offset);
+        GLInstrumentation::uniform1f(undistortionHandles.uScreenParams_y_off,dataUnDistortion.screen_params[IDX].y_eye_offset);
         //same for texture params
-        glUniform1f(undistortionHandles.uTextureParams_w,dataUnDistortion.texture_params[IDX].width);
-        glUniform1f(undistortionHandles.uTextureParams_h,dataUnDistortion.texture_params[IDX].height);
-        glUniform1f(undistortionHandles.uTextureParams_x_off,dataUnDistortion.texture_params[IDX].x_eye_offset);
-        glUniform1f(undistortionHandles.uTextureParams_y_off,dataUnDistortion.texture_params[IDX].y_eye_offset);
+        GLInstrumentation::uniform1f(undistortionHandles.uTextureParams_w,dataUnDistortion.texture_params[IDX].width);
+        GLInstrumentation::uniform1f(undistortionHandles.uTextureParams_h,dataUnDistortion.texture_params[IDX].height);
+        GLInstrumentation::uniform1f(undistortionHandles.uTextureParams_x_off,dataUnDistortion.texture_params[IDX].x_eye_offset);
+        GLInstrumentation::uniform1f(undistortionHandles.uTextureParams_y_off,dataUnDistortion.texture_params[IDX].y_eye_offset);
     }
 };
 
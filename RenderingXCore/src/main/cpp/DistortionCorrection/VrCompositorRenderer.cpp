@@ -6,30 +6,39 @@
 #include <Sphere/SphereBuilder.hpp>
 #include <ATraceCompbat.hpp>
 #include <ColoredGeometry.hpp>
+#include <MeshOptimizer.hpp>
+#include <ProgramBinaryCache.h>
+#include <AllocationCounter.h>
+#include <TaskScheduler.h>
 #include "VrCompositorRenderer.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 VrCompositorRenderer::VrCompositorRenderer(JNIEnv* env,jobject androidContext,gvr::GvrApi *gvr_api,const bool ENABLE_VDDC,const bool ENABLE_DEBUG1,const bool ENABLE_VIGNETTE):
+        VrCompositorRenderer(createFromJava2(env,androidContext),gvr_api,ENABLE_VDDC,ENABLE_DEBUG1,ENABLE_VIGNETTE){
+}
+
+VrCompositorRenderer::VrCompositorRenderer(const MVrHeadsetParams& headsetParams,gvr::GvrApi *gvr_api,const bool ENABLE_VDDC,const bool ENABLE_DEBUG1,const bool ENABLE_VIGNETTE):
         ENABLE_DEBUG(ENABLE_DEBUG1),
         ENABLE_VIGNETTE(ENABLE_VIGNETTE),
         gvr_api(gvr_api),
         ENABLE_VDDC(ENABLE_VDDC){
-    const MVrHeadsetParams deviceParams=createFromJava2(env,androidContext);
-    updateHeadsetParams(deviceParams);
+    updateHeadsetParams(headsetParams);
 }
 
 void VrCompositorRenderer::initializeGL() {
+    initializeGLTime=std::chrono::steady_clock::now();
+    // The texture programs are created on demand, see getGLProgramTexture()
     mGLProgramVC2D=std::make_unique<GLProgramVC2D>();
-    mGLProgramTexture2D=std::make_unique<GLProgramTexture>(false, true);
-    mGLProgramTextureExt2D=std::make_unique<GLProgramTextureExt>(false,true,false);
-    mGLProgramTextureVDDC=std::make_unique<GLProgramTexture>(true);
-    mGLProgramTextureExtVDDC=std::make_unique<GLProgramTextureExt>(true, false);
     const TrueColor occlusionMeshColor=ENABLE_DEBUG ? TrueColor2::RED : TrueColor2::BLACK;
-    CardboardViewportOcclusion::uploadOcclusionMeshLeftRight(*this, occlusionMeshColor, mOcclusionMesh);
+    CardboardViewportOcclusion::uploadOcclusionMeshLeftRight(*this, occlusionMeshColor, mColoredMeshArena, mOcclusionMesh);
     //
-    solidRectangleBlack.setData(
+    solidRectangleBlack=mColoredMeshArena.add(
             ColoredGeometry::makeTessellatedColoredRect(10, {0,0,0}, {2,2}, TrueColor2::BLACK));
-    solidRectangleYellow.setData(
+    solidRectangleYellow=mColoredMeshArena.add(
             ColoredGeometry::makeTessellatedColoredRect(10, {0,0,0}, {2,2}, TrueColor2::YELLOW));
+    MLOGD<<mColoredMeshArena.getStats().toString();
 }
 
 void VrCompositorRenderer::updateLatestHeadSpaceFromStartSpaceRotation() {
@@ -87,14 +96,25 @@ void VrCompositorRenderer::updateHeadsetParams(const MVrHeadsetParams &mDP) {
 
     //Find the maximum value we can use to create a inverse polynomial distortion that
     //never has a deviation higher from x in the range [0..maxRangeInverse]
-    float maxRangeInverse=1.0f;
+    //The range grows in steps of 0.01 as long as the fit for the current range is good enough.
+    //Each fit is independent of the others, so all candidates are fitted on the TaskScheduler workers
+    std::vector<float> candidates={1.0f};
     for(float i=1.0f;i<=2.0f;i+=0.01f){
-        const auto inverse=PolynomialRadialInverse(mDistortion, maxRangeInverse, VDDC::N_RADIAL_UNDISTORTION_COEFICIENTS);
-        const float maxDeviation=PolynomialRadialInverse::calculateMaxDeviation(mDistortion,inverse,maxRangeInverse);
-        if(maxDeviation<=0.001f){
-            maxRangeInverse=i;
+        candidates.push_back(i);
+    }
+    std::vector<char> fitIsGoodEnough(candidates.size());
+    TaskScheduler::instance().parallelFor(candidates.size()-1,[this,&candidates,&fitIsGoodEnough](const size_t begin,const size_t end){
+        for(size_t k=begin;k<end;k++){
+            const auto inverse=PolynomialRadialInverse(mDistortion, candidates[k], VDDC::N_RADIAL_UNDISTORTION_COEFICIENTS);
+            const float maxDeviation=PolynomialRadialInverse::calculateMaxDeviation(mDistortion,inverse,candidates[k]);
+            fitIsGoodEnough[k]=maxDeviation<=0.001f;
         }
+    });
+    size_t maxRangeIdx=0;
+    while(maxRangeIdx<candidates.size()-1 && fitIsGoodEnough[maxRangeIdx]){
+        maxRangeIdx++;
     }
+    const float maxRangeInverse=candidates[maxRangeIdx];
     MLOGD<<"Max value used for getApproximateInverseDistortion()"<<maxRangeInverse;
     mInverse=PolynomialRadialInverse(mDistortion, maxRangeInverse, VDDC::N_RADIAL_UNDISTORTION_COEFICIENTS);
     MLOGD<<"Inverse is:"<<mInverse.toStringX();
@@ -128,6 +148,7 @@ void VrCompositorRenderer::updateHeadsetParams(const MVrHeadsetParams &mDP) {
     }else{
         mDataUnDistortion=VDDC::DataUnDistortion{{mInverse},screen_params,texture_params};
     }
+    updateVisibleArea();
 }
 
 void VrCompositorRenderer::addLayer(const TexturedStereoMeshData &meshData,VrContentProvider vrContentProvider,HEAD_TRACKING headTracking) {
@@ -139,12 +160,76 @@ void VrCompositorRenderer::addLayer(const TexturedStereoMeshData &meshData,VrCon
         vrLayer.meshLeftAndRightEye=nullptr;
         vrLayer.optionalLeftEyeDistortedMesh=std::make_unique<TexturedGLMeshBuffer>(distortedMeshData1);
         vrLayer.optionalRightEyeDistortedMesh=std::make_unique<TexturedGLMeshBuffer>(distortedMeshData2);
+        // The distorted vertices are already in NDC, so the screen space bounds never change
+        int eyeIdx=0;
+        for(const auto* distortedMeshData:{&distortedMeshData1,&distortedMeshData2}){
+            glm::vec2 min(std::numeric_limits<float>::max()),max(std::numeric_limits<float>::lowest());
+            for(const auto& vertex:distortedMeshData->vertices){
+                min=glm::min(min,glm::vec2(vertex.x,vertex.y));
+                max=glm::max(max,glm::vec2(vertex.x,vertex.y));
+            }
+            vrLayer.screenBounds[eyeIdx]=ndcBoundsToViewport(eyeIdx,min,max);
+            eyeIdx++;
+        }
     }else{
-        vrLayer.meshLeftAndRightEye=std::make_unique<TexturedStereoGLMeshBuffer>(meshData);
+        // Transforming all vertices each frame would be too expensive. The bounding box corners plus a
+        // subset of the vertices is enough, since the result is enlarged by a margin anyways
+        glm::vec3 min(std::numeric_limits<float>::max()),max(std::numeric_limits<float>::lowest());
+        for(const auto& vertex:meshData.vertices){
+            min=glm::min(min,glm::vec3(vertex.x,vertex.y,vertex.z));
+            max=glm::max(max,glm::vec3(vertex.x,vertex.y,vertex.z));
+        }
+        for(int i=0;i<8;i++){
+            vrLayer.boundsSamplePoints.emplace_back(i&1 ? max.x : min.x,i&2 ? max.y : min.y,i&4 ? max.z : min.z);
+        }
+        constexpr size_t MAX_N_VERTEX_SAMPLES=56;
+        const size_t stride=std::max((size_t)1,meshData.vertices.size()/MAX_N_VERTEX_SAMPLES);
+        for(size_t i=0;i<meshData.vertices.size();i+=stride){
+            const auto& vertex=meshData.vertices[i];
+            vrLayer.boundsSamplePoints.emplace_back(vertex.x,vertex.y,vertex.z);
+        }
+        // V.D.D.C makes each vertex shader invocation expensive
+        MeshOptimizer::Report report;
+        const auto optimizedMeshData=MeshOptimizer::optimize(meshData,&report);
+        MLOGD<<report.toString();
+        if(useCompactVertexFormat && Extensions::GL_HALF_FLOAT_VERTEX_ATTRIBUTE_TYPE!=0){
+            VertexFormat::ConversionError error;
+            const auto compactMeshData=MeshOptimizer::narrowIndices<GLushort>(
+                    TexturedStereoVertexHelper::convertFormat<CompactTexturedStereoVertex>(optimizedMeshData,error));
+            // Relative to the size of the layer, 1/1000 is less than a pixel at the resolution of the eye viewports
+            const float extent=std::max(glm::length(min),glm::length(max));
+            if(compactMeshData && error.isAcceptable(extent*0.001f)){
+                vrLayer.compactMeshLeftAndRightEye=std::make_unique<CompactTexturedStereoGLMeshBuffer>(*compactMeshData);
+            }else{
+                MLOGD<<"Not using compact vertex format "<<error.toString();
+            }
+        }
+        if(vrLayer.compactMeshLeftAndRightEye==nullptr){
+            vrLayer.meshLeftAndRightEye=std::make_unique<TexturedStereoGLMeshBuffer>(optimizedMeshData);
+        }
     }
     vrLayer.contentProvider=vrContentProvider;
     vrLayer.headTracking=headTracking;
     mVrLayerList.push_back(std::move(vrLayer));
+    // Issue the program now, such that the driver has time to compile it until the first frame
+    getGLProgramTexture(std::holds_alternative<SurfaceTextureUpdate*>(vrContentProvider),headTracking!=HEAD_TRACKING::NONE);
+}
+
+AGLProgramTexture* VrCompositorRenderer::getGLProgramTexture(const bool externalTexture,const bool vddc) {
+    if(vddc){
+        if(externalTexture){
+            if(!mGLProgramTextureExtVDDC)mGLProgramTextureExtVDDC=std::make_unique<GLProgramTextureExt>(true, false);
+            return mGLProgramTextureExtVDDC.get();
+        }
+        if(!mGLProgramTextureVDDC)mGLProgramTextureVDDC=std::make_unique<GLProgramTexture>(true);
+        return mGLProgramTextureVDDC.get();
+    }
+    if(externalTexture){
+        if(!mGLProgramTextureExt2D)mGLProgramTextureExt2D=std::make_unique<GLProgramTextureExt>(false,true,false);
+        return mGLProgramTextureExt2D.get();
+    }
+    if(!mGLProgramTexture2D)mGLProgramTexture2D=std::make_unique<GLProgramTexture>(false, true);
+    return mGLProgramTexture2D.get();
 }
 
 void VrCompositorRenderer::addLayer2DCanvas(float z, float width, float height,VrContentProvider vrContentProvider,HEAD_TRACKING headTracking) {
@@ -157,34 +242,74 @@ void VrCompositorRenderer::addLayerSphere360(float radius,UvSphere::MEDIA_FORMAT
     addLayer(sphere,vrContentProvider,HEAD_TRACKING::FULL);
 }
 
+int VrCompositorRenderer::executeGLWork(const std::chrono::steady_clock::duration maxDuration) {
+    ATrace_beginSection("GLWorkQueue::drain");
+    const int nExecuted=mGLWorkQueue.drain(std::min(glWorkBudget,maxDuration));
+    ATrace_endSection();
+    return nExecuted;
+}
+
 void VrCompositorRenderer::drawLayers(gvr::Eye eye) {
     ATrace_beginSection((eye==GVR_LEFT_EYE ? "VrCompositorRenderer::drawLayers LEFT" : "VrCompositorRenderer::drawLayers RIGHT"));
     const int EYE_IDX=eye==GVR_LEFT_EYE ? 0 : 1;
     cpuTime[EYE_IDX].start();
+    // The application (and gvr) might have changed the OpenGL state since the last call
+    GLState::invalidate();
     const bool leftEye=eye==GVR_LEFT_EYE;
-    mGLProgramTextureVDDC->updateUnDistortionUniforms(leftEye, mDataUnDistortion);
-    mGLProgramTextureExtVDDC->updateUnDistortionUniforms(leftEye, mDataUnDistortion);
+    // Only the variants used by at least one layer exist
+    if(mGLProgramTextureVDDC)mGLProgramTextureVDDC->updateUnDistortionUniforms(leftEye, mDataUnDistortion);
+    if(mGLProgramTextureExtVDDC)mGLProgramTextureExtVDDC->updateUnDistortionUniforms(leftEye, mDataUnDistortion);
     const auto viewport=getViewportForEye(eye);
     glViewport(viewport[0],viewport[1],viewport[2],viewport[3]);
+    const bool partialRedraw=pendingPartialRedraw[EYE_IDX];
+    pendingPartialRedraw[EYE_IDX]=false;
+    const auto& damage=frameDamage.eyeRects[EYE_IDX];
+    if(partialRedraw && !damage){
+        // Nothing changed for this eye
+        finishEye(eye);
+        return;
+    }
+    GLint previousScissor[4];
+    GLboolean previousScissorEnabled=GL_FALSE;
+    if(partialRedraw){
+        glGetIntegerv(GL_SCISSOR_BOX,previousScissor);
+        previousScissorEnabled=glIsEnabled(GL_SCISSOR_TEST);
+        GLState::enable(GL_SCISSOR_TEST);
+        DirectRender::setGlScissor(*damage);
+    }
     const auto rotation = GetLatestHeadSpaceFromStartSpaceRotation();
     for(int i=0;i<mVrLayerList.size();i++){
-        const auto& layer=mVrLayerList[i];
+        auto& layer=mVrLayerList[i];
+        if(partialRedraw && layer.skip[EYE_IDX]){
+            continue;
+        }
+        const GLInstrumentation::ScopedTag glTag(GLInstrumentation::Subsystem::COMPOSITOR_LAYER,i);
         // Calculate the view matrix for this layer.
         const glm::mat4 viewM= layer.headTracking==NONE ? eyeFromHead[EYE_IDX] : eyeFromHead[EYE_IDX] * rotation;
         const bool isExternalTexture=std::holds_alternative<SurfaceTextureUpdate*>(layer.contentProvider);
         FramebufferTexture::TimingInformation timingInformation;
         bool isNewFrame=false;
+        std::array<float,2> uvScale={1.0f,1.0f};
 
-        const GLint textureId=isExternalTexture ? std::get<SurfaceTextureUpdate*>(layer.contentProvider)->getTextureId() :
-                              std::get<VrRenderBuffer2*>(layer.contentProvider)->getLatestRenderedTexture(isNewFrame,timingInformation);
+        const GLint textureId=getLatestTexture(layer.contentProvider,isNewFrame,timingInformation,uvScale);
         if(layer.headTracking==HEAD_TRACKING::NONE){
             TexturedGLMeshBuffer* distortedMesh= eye == GVR_LEFT_EYE ? layer.optionalLeftEyeDistortedMesh.get() :
                     layer.optionalRightEyeDistortedMesh.get();
-            AGLProgramTexture* glProgramTexture2D= isExternalTexture ? (AGLProgramTexture*) mGLProgramTextureExt2D.get() : (AGLProgramTexture*)mGLProgramTexture2D.get();
+            AGLProgramTexture* glProgramTexture2D=getGLProgramTexture(isExternalTexture,false);
+            glProgramTexture2D->setTexCoordScale(uvScale);
             glProgramTexture2D->drawX(textureId,glm::mat4(1.0f),glm::mat4(1.0f),*distortedMesh);
         }else{
-            AGLProgramTexture* glProgramTexture= isExternalTexture ? (AGLProgramTexture*) mGLProgramTextureExtVDDC.get() : (AGLProgramTexture*) mGLProgramTextureVDDC.get();
-            glProgramTexture->drawXStereoVertex(textureId,viewM,mProjectionM[EYE_IDX],*layer.meshLeftAndRightEye,eye==GVR_LEFT_EYE);
+            AGLProgramTexture* glProgramTexture=getGLProgramTexture(isExternalTexture,true);
+            glProgramTexture->setTexCoordScale(uvScale);
+            if(layer.compactMeshLeftAndRightEye){
+                glProgramTexture->drawX(textureId,viewM,mProjectionM[EYE_IDX],*layer.compactMeshLeftAndRightEye,eye==GVR_LEFT_EYE);
+            }else{
+                glProgramTexture->drawXStereoVertex(textureId,viewM,mProjectionM[EYE_IDX],*layer.meshLeftAndRightEye,eye==GVR_LEFT_EYE);
+            }
+        }
+        // A new frame arrived after updateFrameDamage(), make sure it is fully drawn with the next frame
+        if(isNewFrame && !layer.isDirty){
+            layer.forceDirty=true;
         }
         if(!isExternalTexture && isNewFrame){
             //MLOGD<<"Latency of osd "<<MyTimeHelper::R(std::chrono::steady_clock::now()-timingInformation.startSubmitCommands);
@@ -193,18 +318,247 @@ void VrCompositorRenderer::drawLayers(gvr::Eye eye) {
     // Render the mesh that occludes everything except the part actually visible inside the headset
     if (ENABLE_VIGNETTE) {
         int idx = eye == GVR_LEFT_EYE ? 0 : 1;
-        mGLProgramVC2D->drawX( mOcclusionMesh[idx]);
+        const GLInstrumentation::ScopedTag glTag(GLInstrumentation::Subsystem::OCCLUSION);
+        mGLProgramVC2D->drawX(mColoredMeshArena, mOcclusionMesh[idx]);
+    }
+    if(partialRedraw){
+        GLState::scissor(previousScissor[0],previousScissor[1],previousScissor[2],previousScissor[3]);
+        if(!previousScissorEnabled)GLState::disable(GL_SCISSOR_TEST);
     }
+    finishEye(eye);
+}
+
+void VrCompositorRenderer::finishEye(gvr::Eye eye) {
+    const int EYE_IDX=eye==GVR_LEFT_EYE ? 0 : 1;
+    // Code outside of RenderingXCore (gvr, Java) does not know about the vertex array objects of the meshes
+    GLState::bindDefaultVertexArrayIfNeeded();
     GLHelper::checkGlError("VrCompositorRenderer::drawLayers");
     cpuTime[EYE_IDX].stop();
+    if(eye==GVR_RIGHT_EYE){
+        // The right eye ends the frame (also with front buffer rendering, where it is rendered first)
+        GLInstrumentation::endFrame();
+        accumulateGLStateCounters();
+    }
+    if(eye==GVR_RIGHT_EYE && initializeGLTime){
+        const AllocationCounter::Exclude logging;
+        MLOGD<<"Time to first frame "<<MyTimeHelper::R(std::chrono::steady_clock::now()-*initializeGLTime)<<" "<<ProgramBinaryCache::getStats().toString();
+        initializeGLTime.reset();
+    }
     ATrace_endSection();
 }
 
+void VrCompositorRenderer::accumulateGLStateCounters() {
+    // Counts everything that went through GLState on this thread since the last frame, not only drawLayers()
+    const auto counters=GLState::getCounters();
+    GLState::resetCounters();
+    glStateCounters.nCalls+=counters.nCalls;
+    glStateCounters.nSkipped+=counters.nSkipped;
+    glStateNFrames++;
+}
+
+void VrCompositorRenderer::printLogIfNeeded() {
+    const auto now=std::chrono::steady_clock::now();
+    if(now-glStateLastLog>std::chrono::seconds(5) && glStateNFrames>0){
+        glStateLastLog=now;
+        MLOGD<<"GLState per frame: skipped "<<(glStateCounters.nSkipped/glStateNFrames)<<" of "<<(glStateCounters.nCalls/glStateNFrames)<<" calls"
+        <<" | drawLayers CPU left "<<cpuTime[0].getAvgReadable()<<" right "<<cpuTime[1].getAvgReadable()
+        <<" | vertex array objects "<<(GLState::vertexArraysAvailable() ? "on" : "off");
+        if(GLInstrumentation::isEnabled()){
+            MLOGD<<GLInstrumentation::getLastFrame().toString();
+        }
+        cpuTime[0].reset();
+        cpuTime[1].reset();
+        glStateCounters={};
+        glStateNFrames=0;
+    }
+}
+
+GLuint VrCompositorRenderer::getLatestTexture(const VrContentProvider& contentProvider,bool& isNewFrame,FramebufferTexture::TimingInformation& timingInformation,
+        std::array<float,2>& uvScale) {
+    if(std::holds_alternative<SurfaceTextureUpdate*>(contentProvider)){
+        return std::get<SurfaceTextureUpdate*>(contentProvider)->getTextureId();
+    }
+    if(std::holds_alternative<VrRenderBuffer2*>(contentProvider)){
+        return std::get<VrRenderBuffer2*>(contentProvider)->getLatestRenderedTexture(isNewFrame,timingInformation,&uvScale);
+    }
+    if(std::holds_alternative<VrRenderBuffer3*>(contentProvider)){
+        return std::get<VrRenderBuffer3*>(contentProvider)->getLatestRenderedTexture(isNewFrame,timingInformation,&uvScale);
+    }
+    return std::get<EGLImageSwapchain*>(contentProvider)->getLatestRenderedTexture(isNewFrame,timingInformation);
+}
+
+bool VrCompositorRenderer::hasNewContent(const VrContentProvider& contentProvider) {
+    // We cannot know if the surface texture got a new frame until updateTexImage() is called
+    if(std::holds_alternative<SurfaceTextureUpdate*>(contentProvider)){
+        return true;
+    }
+    if(std::holds_alternative<VrRenderBuffer2*>(contentProvider)){
+        return std::get<VrRenderBuffer2*>(contentProvider)->isNewFrameAvailable();
+    }
+    if(std::holds_alternative<VrRenderBuffer3*>(contentProvider)){
+        return std::get<VrRenderBuffer3*>(contentProvider)->isNewFrameAvailable();
+    }
+    return std::get<EGLImageSwapchain*>(contentProvider)->isNewFrameAvailable();
+}
+
 void VrCompositorRenderer::removeLayers() {
     for(auto& layer:mVrLayerList){
         //layer.geometry.deleteGL();
+        // The compositor is the consumer of the swapchain, release the imported textures
+        if(std::holds_alternative<EGLImageSwapchain*>(layer.contentProvider)){
+            std::get<EGLImageSwapchain*>(layer.contentProvider)->deleteConsumerGL();
+        }
     }
     mVrLayerList.resize(0);
+    forceFullDamage=true;
+}
+
+static bool isEmpty(const DirectRender::GLViewport& rect){
+    return rect[2]<=0 || rect[3]<=0;
+}
+
+static int64_t area(const DirectRender::GLViewport& rect){
+    return isEmpty(rect) ? 0 : (int64_t)rect[2]*rect[3];
+}
+
+static DirectRender::GLViewport unionRect(const DirectRender::GLViewport& a,const DirectRender::GLViewport& b){
+    if(isEmpty(a))return b;
+    if(isEmpty(b))return a;
+    const int x=std::min(a[0],b[0]);
+    const int y=std::min(a[1],b[1]);
+    return {x,y,std::max(a[0]+a[2],b[0]+b[2])-x,std::max(a[1]+a[3],b[1]+b[3])-y};
+}
+
+static DirectRender::GLViewport intersectRect(const DirectRender::GLViewport& a,const DirectRender::GLViewport& b){
+    const int x=std::max(a[0],b[0]);
+    const int y=std::max(a[1],b[1]);
+    const int w=std::min(a[0]+a[2],b[0]+b[2])-x;
+    const int h=std::min(a[1]+a[3],b[1]+b[3])-y;
+    if(w<=0 || h<=0)return {x,y,0,0};
+    return {x,y,w,h};
+}
+
+DirectRender::GLViewport VrCompositorRenderer::ndcBoundsToViewport(int eyeIdx,glm::vec2 min,glm::vec2 max) const {
+    const auto viewport=getViewportForEye(eyeIdx==0 ? GVR_LEFT_EYE : GVR_RIGHT_EYE);
+    min=glm::clamp(min,glm::vec2(-1.0f),glm::vec2(1.0f));
+    max=glm::clamp(max,glm::vec2(-1.0f),glm::vec2(1.0f));
+    if(min.x>=max.x || min.y>=max.y){
+        return {viewport[0],viewport[1],0,0};
+    }
+    // Enlarge by a few pixels to account for rasterization and the vertices that were not sampled
+    constexpr int MARGIN_PX=4;
+    const int x0=viewport[0]+(int)std::floor((min.x*0.5f+0.5f)*viewport[2])-MARGIN_PX;
+    const int y0=viewport[1]+(int)std::floor((min.y*0.5f+0.5f)*viewport[3])-MARGIN_PX;
+    const int x1=viewport[0]+(int)std::ceil((max.x*0.5f+0.5f)*viewport[2])+MARGIN_PX;
+    const int y1=viewport[1]+(int)std::ceil((max.y*0.5f+0.5f)*viewport[3])+MARGIN_PX;
+    return intersectRect({x0,y0,x1-x0,y1-y0},viewport);
+}
+
+DirectRender::GLViewport VrCompositorRenderer::calculateScreenBounds(int eyeIdx,const std::vector<glm::vec3>& points,const glm::mat4& rotation) const {
+    const auto MVMatrix=eyeFromHead[eyeIdx]*rotation;
+    glm::vec2 min(std::numeric_limits<float>::max()),max(std::numeric_limits<float>::lowest());
+    for(const auto& point:points){
+        const glm::vec4 pos=VDDC::CalculateVertexPosition(mDataUnDistortion.radialDistortionCoefficients,
+                mDataUnDistortion.screen_params[eyeIdx],mDataUnDistortion.texture_params[eyeIdx],MVMatrix,
+                mProjectionM[eyeIdx],glm::vec4(point,1.0f));
+        // Behind the eye (e.g. the 360° sphere) - the projected bounds are meaningless, assume the whole viewport
+        if(pos.w<=0){
+            return getViewportForEye(eyeIdx==0 ? GVR_LEFT_EYE : GVR_RIGHT_EYE);
+        }
+        const glm::vec2 ndc=glm::vec2(pos)/pos.w;
+        min=glm::min(min,ndc);
+        max=glm::max(max,ndc);
+    }
+    return ndcBoundsToViewport(eyeIdx,min,max);
+}
+
+void VrCompositorRenderer::updateVisibleArea() {
+    for(int eyeIdx=0;eyeIdx<2;eyeIdx++){
+        if(!ENABLE_VIGNETTE){
+            visibleArea[eyeIdx]=getViewportForEye(eyeIdx==0 ? GVR_LEFT_EYE : GVR_RIGHT_EYE);
+            continue;
+        }
+        // Same as the inner edge of the occlusion mesh (see CardboardViewportOcclusion::makeMesh)
+        glm::vec2 min(std::numeric_limits<float>::max()),max(std::numeric_limits<float>::lowest());
+        constexpr int TESSELLATION=32;
+        for(int i=0;i<=TESSELLATION;i++){
+            const float t=-1.0f+2.0f*i/TESSELLATION;
+            for(const glm::vec2 edge:{glm::vec2(-1,t),glm::vec2(1,t),glm::vec2(t,-1),glm::vec2(t,1)}){
+                const auto xy=UndistortedNDCForDistortedNDC(edge,eyeIdx);
+                min=glm::min(min,xy);
+                max=glm::max(max,xy);
+            }
+        }
+        visibleArea[eyeIdx]=ndcBoundsToViewport(eyeIdx,min,max);
+    }
+}
+
+const VrCompositorRenderer::FrameDamage& VrCompositorRenderer::updateFrameDamage(const bool contentPreserved) {
+    const auto rotation=GetLatestHeadSpaceFromStartSpaceRotation();
+    const bool poseChanged=rotation!=lastDamageRotation;
+    lastDamageRotation=rotation;
+    std::array<DirectRender::GLViewport,2> damage{};
+    for(auto& layer:mVrLayerList){
+        const bool isHeadTracked=layer.headTracking==HEAD_TRACKING::FULL;
+        const bool recalculateBounds=isHeadTracked && (poseChanged || layer.forceDirty);
+        layer.isDirty=layer.forceDirty || hasNewContent(layer.contentProvider) || recalculateBounds;
+        layer.forceDirty=false;
+        if(!layer.isDirty)continue;
+        for(int eyeIdx=0;eyeIdx<2;eyeIdx++){
+            // The area covered with the old pose has to be re-drawn, too
+            damage[eyeIdx]=unionRect(damage[eyeIdx],layer.screenBounds[eyeIdx]);
+            if(recalculateBounds){
+                layer.screenBounds[eyeIdx]=calculateScreenBounds(eyeIdx,layer.boundsSamplePoints,rotation);
+                damage[eyeIdx]=unionRect(damage[eyeIdx],layer.screenBounds[eyeIdx]);
+            }
+        }
+    }
+    frameDamage.nDamagedPixels=0;
+    frameDamage.nTotalPixels=(int64_t)SCREEN_WIDTH_PX*SCREEN_HEIGHT_PX;
+    for(int eyeIdx=0;eyeIdx<2;eyeIdx++){
+        const auto viewport=getViewportForEye(eyeIdx==0 ? GVR_LEFT_EYE : GVR_RIGHT_EYE);
+        // Everything outside the visible area is covered by the occlusion mesh, which never changes
+        const auto eyeDamage=forceFullDamage ? viewport : intersectRect(damage[eyeIdx],visibleArea[eyeIdx]);
+        if(isEmpty(eyeDamage)){
+            frameDamage.eyeRects[eyeIdx]=std::nullopt;
+        }else{
+            frameDamage.eyeRects[eyeIdx]=eyeDamage;
+            frameDamage.nDamagedPixels+=area(eyeDamage);
+        }
+        for(auto& layer:mVrLayerList){
+            layer.skip[eyeIdx]=!frameDamage.eyeRects[eyeIdx] || isEmpty(intersectRect(layer.screenBounds[eyeIdx],eyeDamage));
+        }
+        pendingPartialRedraw[eyeIdx]=contentPreserved;
+    }
+    forceFullDamage=false;
+    nDamagedPixelsSinceLastLog+=frameDamage.nDamagedPixels;
+    nTotalPixelsSinceLastLog+=frameDamage.nTotalPixels;
+    nFramesSinceLastLog++;
+    const auto now=std::chrono::steady_clock::now();
+    if(now-lastDamageLog>std::chrono::seconds(5)){
+        const float damagedPercentage=nTotalPixelsSinceLastLog==0 ? 0 : 100.0f*nDamagedPixelsSinceLastLog/nTotalPixelsSinceLastLog;
+        const int64_t avgSavedKBPerFrame=(nTotalPixelsSinceLastLog-nDamagedPixelsSinceLastLog)*4/1024/nFramesSinceLastLog;
+        MLOGD<<"Damage: "<<damagedPercentage<<"% of the surface re-drawn, saved "<<avgSavedKBPerFrame<<"KB composition bandwidth per frame";
+        nDamagedPixelsSinceLastLog=0;
+        nTotalPixelsSinceLastLog=0;
+        nFramesSinceLastLog=0;
+        lastDamageLog=now;
+    }
+    return frameDamage;
+}
+
+EGLint VrCompositorRenderer::FrameDamage::writeEGLRects(std::array<EGLint,8>& rects) const {
+    EGLint nRects=0;
+    for(const auto& rect:eyeRects){
+        if(!rect)continue;
+        std::copy(rect->begin(),rect->end(),rects.begin()+nRects*4);
+        nRects++;
+    }
+    if(nRects==0){
+        rects[0]=rects[1]=rects[2]=rects[3]=0;
+        nRects=1;
+    }
+    return nRects;
 }
 
 
@@ -19,7 +19,14 @@
 #include <TimeHelper.hpp>
 #include <SurfaceTextureUpdate.hpp>
 #include <VrRenderBuffer2.hpp>
+#include <VrRenderBuffer3.hpp>
+#include <EGLImageExchange.hpp>
 #include <DirectRender.hpp>
+#include <GLWorkQueue.hpp>
+#include <GLState.hpp>
+#include <GLInstrumentation.hpp>
+#include <optional>
+#include <chrono>
 
 
 class VrCompositorRenderer {
@@ -31,6 +38,8 @@ public:
      * @param occlusionMeshColor1 Use a custom color for the occlusion mesh for Debugging
      */
     VrCompositorRenderer(JNIEnv* env,jobject androidContext,gvr::GvrApi *gvr_api,const bool ENABLE_VDDC,const bool ENABLE_DEBUG1,const bool ENABLE_VIGNETTE=true);
+    // Same as above, but the headset params are given directly instead of being read from java (e.g. host tests)
+    VrCompositorRenderer(const MVrHeadsetParams& headsetParams,gvr::GvrApi *gvr_api,const bool ENABLE_VDDC,const bool ENABLE_DEBUG1,const bool ENABLE_VIGNETTE=true);
     /**
      *  Call this once the OpenGL context is available
      */
@@ -77,8 +86,10 @@ public:
     void updateHeadsetParams(const MVrHeadsetParams& mDP);
 // V.D.D.C end ---
 private:
+    // The occlusion meshes and the solid rectangles share the vertex buffer of this arena
+    ColoredMeshArena mColoredMeshArena{4096,0,"CompositorMeshArena"};
     //One for left and right eye each
-    std::array<ColoredGLMeshBuffer,2> mOcclusionMesh;
+    std::array<ColoredMeshArena::MeshId,2> mOcclusionMesh;
     const bool ENABLE_VDDC;
     //this one is for drawing the occlusion mesh only, no V.D.D.C, source mesh holds NDC
     std::unique_ptr<GLProgramVC2D> mGLProgramVC2D;
@@ -88,13 +99,16 @@ private:
     // Apply V.D.D.C to the 3d coordinates, both for normal and ext texture
     std::unique_ptr<GLProgramTexture> mGLProgramTextureVDDC;
     std::unique_ptr<GLProgramTextureExt> mGLProgramTextureExtVDDC;
+    // The texture programs are created when the first layer that needs them is added, such that only the used variants are compiled.
+    // Creating only issues the program, the driver compiles it (in parallel with KHR_parallel_shader_compile) until the first draw call.
+    AGLProgramTexture* getGLProgramTexture(bool externalTexture,bool vddc);
 public:
     // NONE == position is fixed
     enum HEAD_TRACKING{
         NONE,
         FULL
     };
-    using VrContentProvider=std::variant<SurfaceTextureUpdate*,VrRenderBuffer2*>;
+    using VrContentProvider=std::variant<SurfaceTextureUpdate*,VrRenderBuffer2*,VrRenderBuffer3*,EGLImageSwapchain*>;
     // https://developer.oculus.com/documentation/unity/unity-ovroverlay/
     struct VRLayer{
         HEAD_TRACKING headTracking;
@@ -104,9 +118,21 @@ public:
         // for both the left and right eye. Else, the vertex shader does the un-distortion and
         // we do not touch the mesh data.
         std::unique_ptr<TexturedStereoGLMeshBuffer> meshLeftAndRightEye=nullptr;
+        // Used instead of meshLeftAndRightEye if the compact vertex format is enabled and the conversion error is acceptable
+        std::unique_ptr<CompactTexturedStereoGLMeshBuffer> compactMeshLeftAndRightEye=nullptr;
         std::unique_ptr<TexturedGLMeshBuffer> optionalLeftEyeDistortedMesh=nullptr;
         std::unique_ptr<TexturedGLMeshBuffer> optionalRightEyeDistortedMesh=nullptr;
-        // the time point when the data for this layer was created
+        // Dirty region tracking, see updateFrameDamage()
+        // A subset of the (object space) vertices, used to calculate the screen space bounds of layers with head tracking
+        std::vector<glm::vec3> boundsSamplePoints;
+        // Screen space bounds for the left and right eye with the pose of the last frame
+        // Never change for layers without head tracking
+        std::array<DirectRender::GLViewport,2> screenBounds{};
+        // Set for new layers and when a new frame was consumed that was not accounted for in the damage
+        bool forceDirty=true;
+        bool isDirty=true;
+        // Not touching the damaged area of this eye, drawLayers() does not need to draw it
+        std::array<bool,2> skip{};
     };
     // List of layer descriptions
     std::vector<VRLayer> mVrLayerList;
@@ -114,6 +140,7 @@ public:
     void addLayer(const TexturedMeshData& meshData, VrContentProvider vrContentProvider, HEAD_TRACKING headTracking=FULL){
         addLayer(TexturedStereoVertexHelper::convert(meshData), vrContentProvider, headTracking);
     }
+    // Call on the OpenGL thread. Also releases the imported textures of EGLImageSwapchain layers (see EGLImageSwapchain::deleteConsumerGL())
     void removeLayers();
     void drawLayers(gvr::Eye eye);
     // Add a 2D layer at position (0,0,Z) and (width,height) in VR 3D space.
@@ -123,10 +150,83 @@ public:
     std::vector<VRLayer>& getLayers(){
         return mVrLayerList;
     }
+    // Store the vertices of head tracked layers (e.g. the 360 sphere) as CompactTexturedStereoVertex (16 instead of 28 bytes).
+    // Only affects layers added afterwards, requires half float vertex attributes
+    void setUseCompactVertexFormat(const bool enable){
+        useCompactVertexFormat=enable;
+    }
+private:
+    bool useCompactVertexFormat=true;
+    // Returns the texture to sample for this layer and sets isNewFrame if the content provider has a new frame.
+    // uvScale is the scale for the texture coordinates of the content, see FramebufferTexture::Config::useCapacity
+    static GLuint getLatestTexture(const VrContentProvider& contentProvider,bool& isNewFrame,FramebufferTexture::TimingInformation& timingInformation,
+            std::array<float,2>& uvScale);
+    // Like above, but does not consume the new frame
+    static bool hasNewContent(const VrContentProvider& contentProvider);
+// Deferred OpenGL work begin ---
+public:
+    // Uploads and other OpenGL work posted from any thread are executed by executeGLWork()
+    GLWorkQueue& getGLWorkQueue(){
+        return mGLWorkQueue;
+    }
+    // Executes posted OpenGL work for at most the budget (or maxDuration if shorter), but at least one item.
+    // Call once per frame where the frame has some slack, never right before a deadline: before FramePacer::beginFrame()
+    // sleeps, after the frame was submitted, or (front buffer rendering) after the GPU finished an eye, see FBRManager
+    int executeGLWork(std::chrono::steady_clock::duration maxDuration=std::chrono::steady_clock::duration::max());
+    // Max time per frame spent executing posted OpenGL work
+    void setGLWorkBudget(const std::chrono::steady_clock::duration budget){
+        glWorkBudget=budget;
+    }
+private:
+    GLWorkQueue mGLWorkQueue{"VrCompositorRenderer::GLWorkQueue"};
+    std::chrono::steady_clock::duration glWorkBudget=std::chrono::milliseconds(1);
+// Deferred OpenGL work end ---
+// Dirty region tracking begin ---
+public:
+    // The area of the surface that changed since the last frame, at most one rectangle per eye
+    struct FrameDamage{
+        std::array<std::optional<DirectRender::GLViewport>,2> eyeRects;
+        int64_t nDamagedPixels=0;
+        int64_t nTotalPixels=0;
+        // Composition bandwidth (RGBA8888) the compositor does not need to read / write this frame
+        int64_t getSavedBytes()const{
+            return (nTotalPixels-nDamagedPixels)*4;
+        }
+        // Write the rectangles as needed by eglSwapBuffersWithDamageKHR, returns the n of rectangles
+        // Since 0 rectangles means 'everything changed' an undamaged frame reports one empty rectangle
+        EGLint writeEGLRects(std::array<EGLint,8>& rects)const;
+    };
+    /**
+     * Call once per frame, after updateLatestHeadSpaceFromStartSpaceRotation() and before drawLayers().
+     * A layer is dirty if its content provider has a new frame (external textures always count as new) or its pose changed.
+     * The damage is the union of the screen space bounds of all dirty layers with the old and the new pose, after
+     * distortion and clipped to the area that is not covered by the occlusion mesh.
+     * @param contentPreserved true if the surface keeps its content between frames (front buffer, EGL_BUFFER_PRESERVED).
+     * Then the next drawLayers() call for each eye only draws into the damaged area and skips layers that do not touch it.
+     * Otherwise, everything is drawn and the damage is only a hint for the compositor
+     */
+    const FrameDamage& updateFrameDamage(bool contentPreserved);
+private:
+    FrameDamage frameDamage;
+    // Set by updateFrameDamage(), consumed by drawLayers() for each eye
+    std::array<bool,2> pendingPartialRedraw{};
+    glm::mat4 lastDamageRotation=glm::mat4(1.0f);
+    // Set initially and when layers are removed
+    bool forceFullDamage=true;
+    // The area of each eye viewport that is not covered by the occlusion mesh
+    std::array<DirectRender::GLViewport,2> visibleArea{};
+    void updateVisibleArea();
+    DirectRender::GLViewport calculateScreenBounds(int eyeIdx,const std::vector<glm::vec3>& points,const glm::mat4& rotation)const;
+    DirectRender::GLViewport ndcBoundsToViewport(int eyeIdx,glm::vec2 min,glm::vec2 max)const;
+    int64_t nDamagedPixelsSinceLastLog=0;
+    int64_t nTotalPixelsSinceLastLog=0;
+    int nFramesSinceLastLog=0;
+    std::chrono::steady_clock::time_point lastDamageLog=std::chrono::steady_clock::now();
+// Dirty region tracking end ---
 public:
     // The left/right eye viewport is exactly the area covered when splitting the screen in half
     // while holding the device in landscape mode
-    DirectRender::GLViewport getViewportForEye(gvr::Eye eye){
+    DirectRender::GLViewport getViewportForEye(gvr::Eye eye)const{
         if(eye==GVR_LEFT_EYE){
             return {0,0,EYE_VIEWPORT_W,EYE_VIEWPORT_H};
         }
@@ -153,16 +253,16 @@ public:
         //MLOGD<<"w value"<<gl_Position.w;
     }
     // Distort the mesh for the selected perspective from either the left or right eye perspective
-    TexturedMeshData distortMesh(const gvr::Eye eye,const TexturedMeshData& input){
-        auto tmp=input;
+    // Takes the mesh by value, pass a temporary (or std::move) to avoid copying the vertices
+    TexturedMeshData distortMesh(const gvr::Eye eye,TexturedMeshData input){
         //if(input.hasIndices()){
         //    MLOGD<<"Merging indices into vertices";
-        //    tmp.mergeIndicesIntoVertices();
+        //    input.mergeIndicesIntoVertices();
         //}
-        for(auto& vertex : tmp.vertices){
+        const glm::mat3 rot=glm::rotate(glm::mat4(1.0f),glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        for(auto& vertex : input.vertices){
             glm::vec3 pos=glm::vec3(vertex.x,vertex.y,vertex.z);
             if(REVERSE_LANDSCAPE){
-                const glm::mat3 rot=glm::rotate(glm::mat4(1.0f),glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
                 pos=rot*pos;
             }
             const glm::vec3 newPos= UndistortedCoordinatesFor3DPoint(eye, pos);
@@ -170,23 +270,40 @@ public:
             vertex.y=newPos.y;
             vertex.z=newPos.z;
         }
-        return tmp;
+        return input;
     }
     // When Rendering the OpenGL layers the following OpenGL params
     // have to be set
     static void setGLParamsWhenRenderingLayers(){
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_ONE,GL_ONE_MINUS_SRC_ALPHA);
-        glEnable(GL_SCISSOR_TEST);
-        glDisable(GL_DEPTH_TEST);
+        GLState::enable(GL_BLEND);
+        GLState::blendFunc(GL_ONE,GL_ONE_MINUS_SRC_ALPHA);
+        GLState::enable(GL_SCISSOR_TEST);
+        GLState::disable(GL_DEPTH_TEST);
     }
+public:
+    // Logs the GLState counters, the CPU time of drawLayers() and the last GLInstrumentation frame every 5 seconds.
+    // Allocates when logging, call it outside of drawLayers() and after the frame was submitted
+    void printLogIfNeeded();
 private:
     std::array<Chronometer,2> cpuTime={Chronometer{"CPU left"},Chronometer{"CPU right"}};
-    ColoredGLMeshBuffer solidRectangleYellow;
-    ColoredGLMeshBuffer solidRectangleBlack;
+    // Time to first frame, from initializeGL() until the first drawLayers() for the right eye is done.
+    // Logged once together with the ProgramBinaryCache stats, to compare a cold and a warm cache
+    std::optional<std::chrono::steady_clock::time_point> initializeGLTime;
+    // Redundant OpenGL calls removed by GLState, summed up over the frames since the last log.
+    // Logged together with the average CPU time of drawLayers(), toggle GLState::enableVertexArrays to compare both paths
+    GLState::Counters glStateCounters;
+    int glStateNFrames=0;
+    std::chrono::steady_clock::time_point glStateLastLog=std::chrono::steady_clock::now();
+    // Only sums up the counters, the report is done by printLogIfNeeded()
+    void accumulateGLStateCounters();
+    // Common exit path of drawLayers(), also when the eye was not drawn because nothing changed.
+    // The right eye ends the frame
+    void finishEye(gvr::Eye eye);
+    ColoredMeshArena::MeshId solidRectangleYellow;
+    ColoredMeshArena::MeshId solidRectangleBlack;
 public:
     void clearViewportUsingRenderedMesh(const bool blackOrYellow)const{
-        mGLProgramVC2D->drawX(blackOrYellow ? solidRectangleBlack : solidRectangleYellow);
+        mGLProgramVC2D->drawX(mColoredMeshArena,blackOrYellow ? solidRectangleBlack : solidRectangleYellow);
     }
 };
 
@@ -0,0 +1,543 @@
+#ifndef RENDERINGX_EGLIMAGEEXCHANGE_HPP
+#define RENDERINGX_EGLIMAGEEXCHANGE_HPP
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <AndroidLogger.hpp>
+#include <AllocationCounter.h>
+#include <Extensions.h>
+#include <FramebufferTexture.hpp>
+#include <GLState.hpp>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#ifdef __ANDROID__
+#include <dlfcn.h>
+#include <android/hardware_buffer.h>
+#endif
+
+// Zero-copy exchange of frames between OpenGL contexts that do not share a share group, or between processes.
+// The producer renders into a texture whose memory is exported as EGLImage, the consumer imports the same memory
+// and samples it directly. Rendering is synchronized with fences instead of glFinish(), see EGLImageSwapchain
+namespace EGLImageExchange{
+    enum class Backend{
+        // Same process only, EGL_KHR_gl_texture_2D_image. The EGLImage itself is passed to the consumer
+        SHARED_TEXTURE,
+        // Android (api>=26), AHardwareBuffer. Can be passed to another process with AHardwareBuffer_sendHandleToUnixSocket
+        HARDWARE_BUFFER,
+        // Linux, single plane dmabuf exported with EGL_MESA_image_dma_buf_export. The fd can be passed to another process (SCM_RIGHTS)
+        DMA_BUF
+    };
+    static const char* toString(const Backend backend){
+        switch (backend) {
+            case Backend::SHARED_TEXTURE:return "SHARED_TEXTURE";
+            case Backend::HARDWARE_BUFFER:return "HARDWARE_BUFFER";
+            default:return "DMA_BUF";
+        }
+    }
+#ifdef __ANDROID__
+    // AHardwareBuffer_allocate and friends are only available on api>=26, but our minSdkVersion is lower. Load them at runtime
+    namespace HardwareBufferFunctions{
+        typedef int (*PFN_AHardwareBuffer_allocate)(const AHardwareBuffer_Desc* desc, AHardwareBuffer** outBuffer);
+        typedef void (*PFN_AHardwareBuffer_release)(AHardwareBuffer* buffer);
+        static PFN_AHardwareBuffer_allocate allocate=nullptr;
+        static PFN_AHardwareBuffer_release release=nullptr;
+        static bool load(){
+            static bool loaded=false;
+            if(loaded)return allocate!=nullptr;
+            loaded=true;
+            void* lib=dlopen("libandroid.so",RTLD_NOW | RTLD_LOCAL);
+            if(lib==nullptr){
+                MLOGE<<"Cannot open libandroid.so";
+                return false;
+            }
+            allocate=reinterpret_cast<PFN_AHardwareBuffer_allocate>(dlsym(lib,"AHardwareBuffer_allocate"));
+            release=reinterpret_cast<PFN_AHardwareBuffer_release>(dlsym(lib,"AHardwareBuffer_release"));
+            if(allocate==nullptr || release==nullptr){
+                MLOGD<<"AHardwareBuffer not available";
+                allocate=nullptr;
+                return false;
+            }
+            return true;
+        }
+    }
+#endif
+    // Call with the OpenGL context current, after Extensions::initializeGL()
+    static bool isSupported(const Backend backend){
+        if(!Extensions::EGL_KHR_image_base_available || !Extensions::GL_OES_EGL_image_available)return false;
+        switch (backend) {
+            case Backend::SHARED_TEXTURE:
+                return Extensions::EGL_KHR_gl_texture_2D_image_available;
+            case Backend::HARDWARE_BUFFER:
+#ifdef __ANDROID__
+                return Extensions::EGL_ANDROID_get_native_client_buffer_available && HardwareBufferFunctions::load();
+#else
+                return false;
+#endif
+            default:
+                return Extensions::EGL_KHR_gl_texture_2D_image_available && Extensions::EGL_MESA_image_dma_buf_export_available
+                    && Extensions::EGL_EXT_image_dma_buf_import_available;
+        }
+    }
+    // Prefers the backends that also work across processes
+    static std::optional<Backend> getBestBackend(){
+        for(const Backend backend:{Backend::HARDWARE_BUFFER,Backend::DMA_BUF,Backend::SHARED_TEXTURE}){
+            if(isSupported(backend))return backend;
+        }
+        return std::nullopt;
+    }
+
+    // Everything the consumer needs to import a buffer
+    struct BufferDescriptor{
+        Backend backend=Backend::SHARED_TEXTURE;
+        int width=0,height=0;
+        // SHARED_TEXTURE
+        EGLImageKHR image=EGL_NO_IMAGE_KHR;
+#ifdef __ANDROID__
+        // HARDWARE_BUFFER
+        AHardwareBuffer* hardwareBuffer=nullptr;
+#endif
+        // DMA_BUF
+        int dmaBufFd=-1;
+        int fourcc=0;
+        EGLint stride=0;
+        EGLint offset=0;
+        std::optional<EGLuint64KHR> modifier;
+    };
+
+    // Binds the EGLImage as storage of the currently bound GL_TEXTURE_2D
+    static void bindImageToTexture(const GLuint texture,const EGLImageKHR image){
+        GLState::bindTexture(GL_TEXTURE_2D,texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        Extensions::glEGLImageTargetTexture2DOES_(GL_TEXTURE_2D,(GLeglImageOES)image);
+        GLState::bindTexture(GL_TEXTURE_2D,0);
+    }
+
+    // Producer side: A framebuffer with a RGBA8 color attachment whose memory can be shared. Call everything on the producer context
+    class ExportableFramebuffer{
+    public:
+        GLuint framebuffer=0;
+        GLuint texture=0;
+        bool initializeGL(const Backend backend,const int W,const int H){
+            eglDisplay=eglGetCurrentDisplay();
+            descriptor.backend=backend;
+            descriptor.width=W;
+            descriptor.height=H;
+            glGenTextures(1,&texture);
+            if(backend==Backend::HARDWARE_BUFFER){
+#ifdef __ANDROID__
+                AHardwareBuffer_Desc desc{};
+                desc.width=W;
+                desc.height=H;
+                desc.layers=1;
+                desc.format=AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+                desc.usage=AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE | AHARDWAREBUFFER_USAGE_GPU_COLOR_OUTPUT;
+                if(HardwareBufferFunctions::allocate(&desc,&descriptor.hardwareBuffer)!=0){
+                    MLOGE<<"Cannot allocate AHardwareBuffer";
+                    return false;
+                }
+                const EGLClientBuffer clientBuffer=Extensions::eglGetNativeClientBufferANDROID_(descriptor.hardwareBuffer);
+                const EGLint attribs[]={EGL_IMAGE_PRESERVED_KHR,EGL_TRUE,EGL_NONE};
+                image=Extensions::eglCreateImageKHR_(eglDisplay,EGL_NO_CONTEXT,EGL_NATIVE_BUFFER_ANDROID,clientBuffer,attribs);
+                if(image==EGL_NO_IMAGE_KHR){
+                    MLOGE<<"Cannot create EGLImage from AHardwareBuffer";
+                    return false;
+                }
+                bindImageToTexture(texture,image);
+#else
+                return false;
+#endif
+            }else{
+                GLState::bindTexture(GL_TEXTURE_2D,texture);
+                GLInstrumentation::texImage2D(GL_TEXTURE_2D, 0, GL_RGBA, W,H, 0,GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                GLState::bindTexture(GL_TEXTURE_2D,0);
+                const EGLint attribs[]={EGL_GL_TEXTURE_LEVEL_KHR,0,EGL_IMAGE_PRESERVED_KHR,EGL_TRUE,EGL_NONE};
+                image=Extensions::eglCreateImageKHR_(eglDisplay,eglGetCurrentContext(),EGL_GL_TEXTURE_2D_KHR,
+                        reinterpret_cast<EGLClientBuffer>(static_cast<uintptr_t>(texture)),attribs);
+                if(image==EGL_NO_IMAGE_KHR){
+                    MLOGE<<"Cannot create EGLImage from texture";
+                    return false;
+                }
+                descriptor.image=image;
+                if(backend==Backend::DMA_BUF && !exportDmaBuf()){
+                    return false;
+                }
+            }
+            glGenFramebuffers(1,&framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER,framebuffer);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,texture, 0);
+            const auto status=glCheckFramebufferStatus(GL_FRAMEBUFFER);
+            glBindFramebuffer(GL_FRAMEBUFFER,0);
+            if(status!=GL_FRAMEBUFFER_COMPLETE){
+                MLOGE<<"Framebuffer not complete "<<status;
+                return false;
+            }
+            return true;
+        }
+        void deleteGL(){
+            if(descriptor.dmaBufFd>=0){
+                close(descriptor.dmaBufFd);
+                descriptor.dmaBufFd=-1;
+            }
+            if(image!=EGL_NO_IMAGE_KHR){
+                Extensions::eglDestroyImageKHR_(eglDisplay,image);
+                image=EGL_NO_IMAGE_KHR;
+                descriptor.image=EGL_NO_IMAGE_KHR;
+            }
+#ifdef __ANDROID__
+            if(descriptor.hardwareBuffer!=nullptr){
+                HardwareBufferFunctions::release(descriptor.hardwareBuffer);
+                descriptor.hardwareBuffer=nullptr;
+            }
+#endif
+            glDeleteFramebuffers(1,&framebuffer);
+            GLState::deleteTextures(1,&texture);
+        }
+        // The descriptor stays owned by this buffer. Duplicate the fd / acquire the AHardwareBuffer when passing it on
+        const BufferDescriptor& getDescriptor()const{
+            return descriptor;
+        }
+    private:
+        EGLDisplay eglDisplay=EGL_NO_DISPLAY;
+        EGLImageKHR image=EGL_NO_IMAGE_KHR;
+        BufferDescriptor descriptor;
+        bool exportDmaBuf(){
+            int fourcc=0;
+            int nPlanes=0;
+            EGLuint64KHR modifier=0;
+            if(!Extensions::eglExportDMABUFImageQueryMESA_(eglDisplay,image,&fourcc,&nPlanes,&modifier)){
+                MLOGE<<"eglExportDMABUFImageQueryMESA failed";
+                return false;
+            }
+            // RGBA8 is always a single plane
+            if(nPlanes!=1){
+                MLOGE<<"Unsupported n of dmabuf planes "<<nPlanes;
+                return false;
+            }
+            if(!Extensions::eglExportDMABUFImageMESA_(eglDisplay,image,&descriptor.dmaBufFd,&descriptor.stride,&descriptor.offset)){
+                MLOGE<<"eglExportDMABUFImageMESA failed";
+                return false;
+            }
+            descriptor.fourcc=fourcc;
+            // DRM_FORMAT_MOD_INVALID means the layout is implied by the driver
+            if(modifier!=0x00ffffffffffffffULL)descriptor.modifier=modifier;
+            return true;
+        }
+    };
+
+    // Consumer side: A GL_TEXTURE_2D that samples the memory of a ExportableFramebuffer. Call everything on the consumer context
+    class ImportedTexture{
+    public:
+        GLuint texture=0;
+        bool initializeGL(const BufferDescriptor& descriptor){
+            eglDisplay=eglGetCurrentDisplay();
+            switch (descriptor.backend) {
+                case Backend::SHARED_TEXTURE:
+                    // EGLImages belong to the display, all contexts of this process can use it
+                    image=descriptor.image;
+                    ownsImage=false;
+                    break;
+                case Backend::HARDWARE_BUFFER:{
+#ifdef __ANDROID__
+                    const EGLClientBuffer clientBuffer=Extensions::eglGetNativeClientBufferANDROID_(descriptor.hardwareBuffer);
+                    const EGLint attribs[]={EGL_IMAGE_PRESERVED_KHR,EGL_TRUE,EGL_NONE};
+                    image=Extensions::eglCreateImageKHR_(eglDisplay,EGL_NO_CONTEXT,EGL_NATIVE_BUFFER_ANDROID,clientBuffer,attribs);
+#endif
+                }break;
+                case Backend::DMA_BUF:{
+                    std::vector<EGLint> attribs={
+                            EGL_WIDTH,descriptor.width,
+                            EGL_HEIGHT,descriptor.height,
+                            EGL_LINUX_DRM_FOURCC_EXT,descriptor.fourcc,
+                            EGL_DMA_BUF_PLANE0_FD_EXT,descriptor.dmaBufFd,
+                            EGL_DMA_BUF_PLANE0_OFFSET_EXT,descriptor.offset,
+                            EGL_DMA_BUF_PLANE0_PITCH_EXT,descriptor.stride
+                    };
+                    if(descriptor.modifier){
+                        attribs.insert(attribs.end(),{
+                            EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT,(EGLint)(*descriptor.modifier & 0xFFFFFFFF),
+                            EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT,(EGLint)(*descriptor.modifier >> 32)
+                        });
+                    }
+                    attribs.push_back(EGL_NONE);
+                    // The importer does not take ownership of the fd
+                    image=Extensions::eglCreateImageKHR_(eglDisplay,EGL_NO_CONTEXT,EGL_LINUX_DMA_BUF_EXT,nullptr,attribs.data());
+                }break;
+            }
+            if(image==EGL_NO_IMAGE_KHR){
+                MLOGE<<"Cannot import "<<toString(descriptor.backend)<<" buffer";
+                return false;
+            }
+            glGenTextures(1,&texture);
+            bindImageToTexture(texture,image);
+            return true;
+        }
+        // If the context the texture was created on is gone, only the EGLImage is destroyed (the texture died with the context)
+        void deleteGL(const bool contextIsCurrent=true){
+            if(contextIsCurrent)GLState::deleteTextures(1,&texture);
+            texture=0;
+            if(ownsImage && image!=EGL_NO_IMAGE_KHR){
+                Extensions::eglDestroyImageKHR_(eglDisplay,image);
+            }
+            image=EGL_NO_IMAGE_KHR;
+        }
+    private:
+        EGLDisplay eglDisplay=EGL_NO_DISPLAY;
+        EGLImageKHR image=EGL_NO_IMAGE_KHR;
+        bool ownsImage=true;
+    };
+
+    // Signaled once the GPU reached the point in the command stream where the fence was created.
+    // A native fence fd if available (works across processes), a EGLSyncKHR of the current display otherwise (same process only)
+    class Fence{
+    public:
+        Fence()=default;
+        Fence(const Fence&)=delete;
+        Fence(Fence&& other)noexcept{
+            *this=std::move(other);
+        }
+        Fence& operator=(Fence&& other)noexcept{
+            reset();
+            std::swap(fd,other.fd);
+            std::swap(sync,other.sync);
+            std::swap(eglDisplay,other.eglDisplay);
+            return *this;
+        }
+        ~Fence(){
+            reset();
+        }
+        // Inserts a fence into the command stream of the current context
+        static Fence create(){
+            Fence fence;
+            fence.fd=NativeFence::create();
+            if(fence.fd<0 && Extensions::GL_OES_EGL_sync){
+                fence.eglDisplay=eglGetCurrentDisplay();
+                fence.sync=Extensions::eglCreateSyncKHR(fence.eglDisplay,EGL_SYNC_FENCE_KHR,nullptr);
+                // The fence can only be signaled once the commands reach the GPU
+                glFlush();
+            }else if(fence.fd<0){
+                // No fences at all
+                glFinish();
+            }
+            return fence;
+        }
+        // Makes the GPU of the current context wait for the fence (the CPU only blocks without EGL_KHR_wait_sync). Consumes the fence
+        void waitGPU(){
+            if(fd>=0){
+                NativeFence::waitGPU(fd);
+                fd=-1;
+            }else if(sync!=EGL_NO_SYNC_KHR){
+                if(Extensions::EGL_KHR_wait_sync_available){
+                    Extensions::eglWaitSyncKHR_(eglDisplay,sync,0);
+                }else{
+                    Extensions::eglClientWaitSyncKHR(eglDisplay,sync,EGL_SYNC_FLUSH_COMMANDS_BIT_KHR,EGL_FOREVER_KHR);
+                }
+            }
+            reset();
+        }
+        // Give up ownership of the native fence fd (e.g. to send it to another process). -1 if this is not a native fence
+        int releaseFd(){
+            return std::exchange(fd,-1);
+        }
+        void reset(){
+            if(fd>=0)close(fd);
+            fd=-1;
+            if(sync!=EGL_NO_SYNC_KHR)Extensions::eglDestroySyncKHR(eglDisplay,sync);
+            sync=EGL_NO_SYNC_KHR;
+        }
+    private:
+        int fd=-1;
+        EGLSyncKHR sync=EGL_NO_SYNC_KHR;
+        EGLDisplay eglDisplay=EGL_NO_DISPLAY;
+    };
+}
+
+// Like VrRenderBuffer3, but producer and consumer contexts do not have to be in the same share group.
+// Producer (any context / thread): initializeProducerGL() once, then bind() -> render -> unbindAndSwap()
+// Consumer (compositor): getLatestRenderedTexture(), imports the buffers on the first call
+// Neither side blocks on the CPU: the consumer's GPU waits for the fence published with each frame, and the producer's GPU waits
+// for the fence created when the consumer gave a buffer back. When a frame is published before the consumer took the previous one,
+// the previous one is dropped.
+// Only the buffer hand-off itself is in-process, the BufferDescriptors and native fences can be passed to another process as well.
+class EGLImageSwapchain{
+public:
+    static constexpr int N_BUFFERS=3;
+    explicit EGLImageSwapchain(std::string tag="EGLImageSwapchain"):TAG(std::move(tag)){}
+    EGLImageSwapchain(const EGLImageSwapchain&)=delete;
+    // Producer: Allocates the exportable buffers. Uses the best backend if none is specified
+    bool initializeProducerGL(const int W,const int H,std::optional<EGLImageExchange::Backend> backend=std::nullopt){
+        if(!backend)backend=EGLImageExchange::getBestBackend();
+        if(!backend || !EGLImageExchange::isSupported(*backend)){
+            MLOGE2(TAG.c_str())<<"EGLImage exchange not supported";
+            return false;
+        }
+        for(auto& buffer:buffers){
+            if(!buffer.initializeGL(*backend,W,H))return false;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        for(int i=0;i<N_BUFFERS;i++){
+            freeBuffers.emplace_back(i,EGLImageExchange::Fence());
+        }
+        producerInitialized=true;
+        MLOGD2(TAG.c_str())<<"Initialized "<<W<<"x"<<H<<" "<<EGLImageExchange::toString(*backend);
+        return true;
+    }
+    // Producer: bind the framebuffer of a free buffer
+    void bind(){
+        EGLImageExchange::Fence releaseFence;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            // With 3 buffers there is always at least one free buffer (at most one is published and one is read by the consumer)
+            writeIdx=freeBuffers.front().first;
+            releaseFence=std::move(freeBuffers.front().second);
+            freeBuffers.erase(freeBuffers.begin());
+        }
+        // The consumer might still sample this buffer
+        releaseFence.waitGPU();
+        timingInformation[writeIdx].startSubmitCommands=std::chrono::steady_clock::now();
+        glBindFramebuffer(GL_FRAMEBUFFER,buffers[writeIdx].framebuffer);
+        const auto& descriptor=buffers[writeIdx].getDescriptor();
+        GLState::scissor(0,0,descriptor.width,descriptor.height);
+        glViewport(0,0,descriptor.width,descriptor.height);
+    }
+    // Producer: publish the frame rendered since bind() without waiting for the GPU
+    void unbindAndSwap(){
+        timingInformation[writeIdx].stopSubmitCommands=std::chrono::steady_clock::now();
+        EGLImageExchange::Fence readyFence=EGLImageExchange::Fence::create();
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(publishedIdx){
+            // The consumer never took this frame. Rendering into it again does not need to wait for anything
+            freeBuffers.emplace_back(*publishedIdx,EGLImageExchange::Fence());
+            nDroppedFrames++;
+        }
+        publishedIdx=writeIdx;
+        publishedFence=std::move(readyFence);
+        nPublishedFrames++;
+    }
+    // Consumer: true if a frame newer than the one returned by the last getLatestRenderedTexture() call was published
+    bool isNewFrameAvailable(){
+        std::lock_guard<std::mutex> lock(mMutex);
+        return publishedIdx.has_value();
+    }
+    // Consumer: returns the texture of the newest published frame on the consumer context, 0 if there was none yet.
+    // The GPU only starts sampling once the producer's rendering is complete
+    GLuint getLatestRenderedTexture(bool& isNewFrame,FramebufferTexture::TimingInformation& timing){
+        if(!consumerInitialized && !initializeConsumerGL()){
+            return 0;
+        }
+        EGLImageExchange::Fence readyFence;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if(publishedIdx){
+                if(readIdx){
+                    lock.unlock();
+                    // Sampling commands for the old read buffer have already been submitted
+                    EGLImageExchange::Fence releaseFence=EGLImageExchange::Fence::create();
+                    lock.lock();
+                    freeBuffers.emplace_back(*readIdx,std::move(releaseFence));
+                }
+                readIdx=publishedIdx;
+                publishedIdx.reset();
+                readyFence=std::move(publishedFence);
+                isNewFrame=true;
+            }
+        }
+        if(!readIdx)return 0;
+        readyFence.waitGPU();
+        timing=timingInformation[*readIdx];
+        logPeriodically();
+        return importedTextures[*readIdx].texture;
+    }
+    // Consumer: call when the swapchain is not sampled anymore, e.g. VrCompositorRenderer::removeLayers().
+    // Gives the buffer that was read back to the producer. If the consumer context is not current anymore (it was destroyed),
+    // only the EGLImages are released. The consumer is initialized again with the next getLatestRenderedTexture()
+    void deleteConsumerGL(){
+        const bool contextIsCurrent=consumerContext!=EGL_NO_CONTEXT && eglGetCurrentContext()==consumerContext;
+        EGLImageExchange::Fence releaseFence=contextIsCurrent ? EGLImageExchange::Fence::create() : EGLImageExchange::Fence();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if(readIdx){
+                freeBuffers.emplace_back(*readIdx,std::move(releaseFence));
+                readIdx.reset();
+            }
+        }
+        for(auto& texture:importedTextures){
+            texture.deleteGL(contextIsCurrent);
+        }
+        consumerInitialized=false;
+        consumerContext=EGL_NO_CONTEXT;
+    }
+    // Call on the producer context, after deleteConsumerGL()
+    void deleteProducerGL(){
+        std::lock_guard<std::mutex> lock(mMutex);
+        freeBuffers.clear();
+        publishedFence.reset();
+        publishedIdx.reset();
+        for(auto& buffer:buffers){
+            buffer.deleteGL();
+        }
+        producerInitialized=false;
+    }
+    // To pass the buffers on to another process
+    const EGLImageExchange::BufferDescriptor& getDescriptor(const int idx)const{
+        return buffers[idx].getDescriptor();
+    }
+private:
+    const std::string TAG;
+    std::array<EGLImageExchange::ExportableFramebuffer,N_BUFFERS> buffers;
+    std::array<EGLImageExchange::ImportedTexture,N_BUFFERS> importedTextures;
+    // Written by the producer before the buffer is published, read by the consumer after it took the buffer
+    std::array<FramebufferTexture::TimingInformation,N_BUFFERS> timingInformation;
+    std::mutex mMutex;
+    bool producerInitialized=false;
+    // Buffers the producer can render into, with the fence the producer has to wait for before rendering
+    std::vector<std::pair<int,EGLImageExchange::Fence>> freeBuffers;
+    std::optional<int> publishedIdx;
+    EGLImageExchange::Fence publishedFence;
+    int nPublishedFrames=0;
+    int nDroppedFrames=0;
+    // Only accessed by the producer
+    int writeIdx=0;
+    // Only accessed by the consumer
+    std::optional<int> readIdx;
+    bool consumerInitialized=false;
+    EGLContext consumerContext=EGL_NO_CONTEXT;
+    std::chrono::steady_clock::time_point lastLog=std::chrono::steady_clock::now();
+    bool initializeConsumerGL(){
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if(!producerInitialized)return false;
+        }
+        for(int i=0;i<N_BUFFERS;i++){
+            if(!importedTextures[i].initializeGL(buffers[i].getDescriptor()))return false;
+        }
+        consumerInitialized=true;
+        consumerContext=eglGetCurrentContext();
+        return true;
+    }
+    void logPeriodically(){
+        const auto now=std::chrono::steady_clock::now();
+        if(now-lastLog>std::chrono::seconds(5)){
+            lastLog=now;
+            // Called from the render loop, but logging is allowed to allocate
+            const AllocationCounter::Exclude logging;
+            std::lock_guard<std::mutex> lock(mMutex);
+            MLOGD2(TAG.c_str())<<"Published "<<nPublishedFrames<<" dropped "<<nDroppedFrames;
+            nPublishedFrames=0;
+            nDroppedFrames=0;
+        }
+    }
+};
+
+#endif //RENDERINGX_EGLIMAGEEXCHANGE_HPP
@@ -8,13 +8,40 @@
 #include <GLES2/gl2.h>
 #include <AndroidLogger.hpp>
 #include <GLHelper.hpp>
+#include <GLState.hpp>
+#include <Extensions.h>
+#include <algorithm>
+#include <array>
 #include <chrono>
 
 // Wrapper around one framebuffer that is bound to a texture id
 // Width and Height can be changed dynamically after initializeGL() is called
+// The Config selects the color format, an optional depth/stencil attachment and MSAA. With EXT_multisampled_render_to_texture
+// the multisampled color and depth/stencil values only exist in tile memory and are resolved / discarded when the tile is written
+// back, so MSAA costs no extra memory bandwidth. Lower precision formats (RGB565) halve the bandwidth of a UI layer.
 class FramebufferTexture{
 public:
+    enum class ColorFormat{
+        RGB565,
+        RGBA8,
+        // Needs EXT_texture_type_2_10_10_10_REV, falls back to RGBA8
+        RGB10A2,
+        // Needs EXT_sRGB, falls back to RGBA8
+        SRGB8_ALPHA8
+    };
+    struct Config{
+        ColorFormat colorFormat=ColorFormat::RGBA8;
+        // Packed 24 bit depth + 8 bit stencil if OES_packed_depth_stencil is available, 16 bit depth only otherwise
+        bool depthStencil=false;
+        // 0 == no MSAA. Needs EXT_multisampled_render_to_texture, clamped to GL_MAX_SAMPLES_EXT
+        int msaaSamples=0;
+        // If enabled, the texture is only re-allocated when it has to grow. Shrinking only changes the viewport,
+        // and the content occupies the lower left part of the texture - sample it with the uv coordinates multiplied by getUvScale().
+        // The VrCompositorRenderer does this for VrRenderBuffer2/3 layers
+        bool useCapacity=false;
+    };
     FramebufferTexture()=default;
+    explicit FramebufferTexture(const Config& config):config(config){}
     FramebufferTexture(const FramebufferTexture&)=delete;
     FramebufferTexture(FramebufferTexture&&)=default;
     using CLOCK=std::chrono::steady_clock;
@@ -24,10 +51,23 @@ public:
         CLOCK::time_point gpuFinishedRendering;
     };
     TimingInformation timingInformation;
+    // getUvScale() at the last bind(), of the content that was rendered since. Read by the consumer together with the texture
+    std::array<float,2> contentUvScale={1.0f,1.0f};
 
     GLuint framebuffer;
     GLuint texture;
+    GLuint depthStencilRenderbuffer=0;
+    // Size of the content
     GLuint WIDTH_PX=0,HEIGH_PX=0;
+    // Size of the allocated texture, larger than the content only with Config::useCapacity
+    GLuint CAPACITY_WIDTH_PX=0,CAPACITY_HEIGHT_PX=0;
+    // Has to be called before initializeGL()
+    void setConfig(const Config& config1){
+        config=config1;
+    }
+    const Config& getConfig()const{
+        return config;
+    }
     // call this once the OpenGL context is available
     void initializeGL(){
         glGenTextures(1, &texture);
@@ -43,38 +83,128 @@ public:
         }
         WIDTH_PX=W;
         HEIGH_PX=H;
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        //  GL_RGBA8_OES
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, WIDTH_PX,HEIGH_PX, 0,
-                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                               texture, 0);
-        auto status=glCheckFramebufferStatus(GL_FRAMEBUFFER);
-        if(status!=GL_FRAMEBUFFER_COMPLETE){
-            MLOGE<<"Framebuffer not complete "<<status;
+        if(config.useCapacity && W<=CAPACITY_WIDTH_PX && H<=CAPACITY_HEIGHT_PX){
+            return;
         }
-        glBindFramebuffer(GL_FRAMEBUFFER,0);
+        allocate(config.useCapacity ? std::max((GLuint)W,CAPACITY_WIDTH_PX) : W,config.useCapacity ? std::max((GLuint)H,CAPACITY_HEIGHT_PX) : H);
+    }
+    // Multiply the uv coordinates used for sampling with this value. (1,1) unless Config::useCapacity is set
+    std::array<float,2> getUvScale()const{
+        if(CAPACITY_WIDTH_PX==0 || CAPACITY_HEIGHT_PX==0)return {1.0f,1.0f};
+        return {(float)WIDTH_PX/CAPACITY_WIDTH_PX,(float)HEIGH_PX/CAPACITY_HEIGHT_PX};
     }
     // Bind the framebuffer to render to it
     void bind(){
         glBindFramebuffer(GL_FRAMEBUFFER,framebuffer);
         timingInformation.startSubmitCommands=CLOCK::now();
-        glScissor(0,0,WIDTH_PX,HEIGH_PX);
+        contentUvScale=getUvScale();
+        GLState::scissor(0,0,WIDTH_PX,HEIGH_PX);
         glViewport(0,0,WIDTH_PX,HEIGH_PX);
     }
+    // The depth / stencil values are not needed after rendering, tell the driver to not write them back to memory
+    // Call with the framebuffer still bound
+    void invalidateDepthStencil()const{
+        if(depthStencilRenderbuffer==0 || Extensions::glInvalidateFramebuffer_==nullptr)return;
+        const GLenum attachmentsDepthStencil[2] = {GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT};
+        Extensions::glInvalidateFramebuffer_(GL_FRAMEBUFFER, 2, attachmentsDepthStencil );
+    }
     // Unbind the framebuffer
     // Does not return until all OpenGL commands have been executed
     void unbindAndFinishCommands(){
+        invalidateDepthStencil();
         timingInformation.stopSubmitCommands=CLOCK::now();
         glFinish();
         //MLOGD<<"FramebufferTexture fence sync took "<<MyTimeHelper::R(fenceSync.getDeltaCreationSatisfied());
         timingInformation.gpuFinishedRendering=CLOCK::now();
     }
+private:
+    Config config;
+    struct GLFormat{
+        GLint internalFormat;
+        GLenum format;
+        GLenum type;
+        int bytesPerPixel;
+    };
+    // Falls back to RGBA8 if the format is not supported
+    static GLFormat getGLFormat(const ColorFormat colorFormat){
+        switch (colorFormat) {
+            case ColorFormat::RGB565:
+                return {GL_RGB,GL_RGB,GL_UNSIGNED_SHORT_5_6_5,2};
+            case ColorFormat::RGB10A2:
+                if(Extensions::GL_EXT_texture_type_2_10_10_10_REV_available){
+                    return {GL_RGBA,GL_RGBA,GL_UNSIGNED_INT_2_10_10_10_REV_EXT,4};
+                }
+                MLOGE<<"RGB10A2 not supported, using RGBA8";
+                break;
+            case ColorFormat::SRGB8_ALPHA8:
+                if(Extensions::GL_EXT_sRGB_available){
+                    return {GL_SRGB_ALPHA_EXT,GL_SRGB_ALPHA_EXT,GL_UNSIGNED_BYTE,4};
+                }
+                MLOGE<<"sRGB not supported, using RGBA8";
+                break;
+            default:
+                break;
+        }
+        //  GL_RGBA8_OES
+        return {GL_RGBA,GL_RGBA,GL_UNSIGNED_BYTE,4};
+    }
+    int getMsaaSamples()const{
+        if(config.msaaSamples<=0)return 0;
+        if(!Extensions::GL_EXT_multisampled_render_to_texture_available){
+            MLOGE<<"EXT_multisampled_render_to_texture not supported, MSAA disabled";
+            return 0;
+        }
+        GLint maxSamples=0;
+        glGetIntegerv(GL_MAX_SAMPLES_EXT,&maxSamples);
+        return std::min(config.msaaSamples,(int)maxSamples);
+    }
+    void allocate(const GLuint W,const GLuint H){
+        CAPACITY_WIDTH_PX=W;
+        CAPACITY_HEIGHT_PX=H;
+        const GLFormat glFormat=getGLFormat(config.colorFormat);
+        const int samples=getMsaaSamples();
+        GLState::bindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        GLInstrumentation::texImage2D(GL_TEXTURE_2D, 0, glFormat.internalFormat, W,H, 0,
+                     glFormat.format, glFormat.type, nullptr);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        if(samples>0){
+            // The multisampled buffer is implicit and resolved into the texture when the tile is written back
+            Extensions::glFramebufferTexture2DMultisampleEXT_(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                                               texture, 0, samples);
+        }else{
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                   texture, 0);
+        }
+        if(config.depthStencil){
+            if(depthStencilRenderbuffer==0){
+                glGenRenderbuffers(1,&depthStencilRenderbuffer);
+            }
+            const bool packed=Extensions::GL_OES_packed_depth_stencil_available;
+            const GLenum depthFormat=packed ? GL_DEPTH24_STENCIL8_OES : GL_DEPTH_COMPONENT16;
+            glBindRenderbuffer(GL_RENDERBUFFER,depthStencilRenderbuffer);
+            if(samples>0){
+                Extensions::glRenderbufferStorageMultisampleEXT_(GL_RENDERBUFFER,samples,depthFormat,W,H);
+            }else{
+                glRenderbufferStorage(GL_RENDERBUFFER,depthFormat,W,H);
+            }
+            glBindRenderbuffer(GL_RENDERBUFFER,0);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER,GL_DEPTH_ATTACHMENT,GL_RENDERBUFFER,depthStencilRenderbuffer);
+            if(packed){
+                glFramebufferRenderbuffer(GL_FRAMEBUFFER,GL_STENCIL_ATTACHMENT,GL_RENDERBUFFER,depthStencilRenderbuffer);
+            }
+        }
+        auto status=glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if(status!=GL_FRAMEBUFFER_COMPLETE){
+            MLOGE<<"Framebuffer not complete "<<status;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER,0);
+        MLOGD<<"FramebufferTexture "<<W<<"x"<<H<<" "<<(W*H*glFormat.bytesPerPixel/1024)<<"KB samples "<<samples
+             <<" depthStencil "<<config.depthStencil;
+    }
 };
 #endif //RENDERINGX_FRAMEBUFFERTEXTURE_HPP
@@ -6,9 +6,11 @@
 #define FPV_VR_OS_GLBUFFER_HPP
 
 #include <GLHelper.hpp>
+#include <GLState.hpp>
 #include <vector>
 #include <array>
 #include <iterator>
+#include <algorithm>
 
 // Provides convenient functions to upload cpp
 // data types to GPU using OpenGL c style api
@@ -16,10 +18,17 @@ namespace GLBufferHelper {
     //c-style function that takes a data pointer and the data size in bytes
     //binds and un-binds gl buffer for data upload
     static void uploadGLBuffer(const GLuint buff,const void *array,GLsizeiptr arraySizeBytes,GLenum usage=GL_STATIC_DRAW) {
-        glBindBuffer(GL_ARRAY_BUFFER, buff);
-        glBufferData(GL_ARRAY_BUFFER, arraySizeBytes,
+        GLState::bindBuffer(GL_ARRAY_BUFFER, buff);
+        GLInstrumentation::bufferData(GL_ARRAY_BUFFER, arraySizeBytes,
                      array,usage);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    // Overwrite a part of the buffer without re-allocating it (glBufferSubData)
+    // offsetBytes+arraySizeBytes has to be <= the size of the buffer
+    static void updateGLBuffer(const GLuint buff,GLintptr offsetBytes,const void *array,GLsizeiptr arraySizeBytes){
+        GLState::bindBuffer(GL_ARRAY_BUFFER, buff);
+        GLInstrumentation::bufferSubData(GL_ARRAY_BUFFER,offsetBytes,arraySizeBytes,array);
+        GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
     }
     //wrap std::vector<>
     //returns the n of elements inside the vector (NOT the n of bytes)
@@ -27,13 +36,13 @@ namespace GLBufferHelper {
     template<class T>
     static std::size_t uploadGLBuffer(const GLuint buff, const std::vector<T> &data,GLenum usage=GL_STATIC_DRAW) {
         const auto size = data.size();
-        uploadGLBuffer(buff, (void *) data.data(), size * sizeof(T));
+        uploadGLBuffer(buff, (void *) data.data(), size * sizeof(T),usage);
         return size;
     }
     //wrap std::array, similar to std::vector<>
     template<class T,std::size_t S>
     static  std::size_t uploadGLBuffer(const GLuint buff, const std::array<T,S> &data,GLenum usage=GL_STATIC_DRAW) {
-        uploadGLBuffer(buff, (void *)data.data(), S * sizeof(T));
+        uploadGLBuffer(buff, (void *)data.data(), S * sizeof(T),usage);
         return S;
     }
    /* template<typename Container>
@@ -85,6 +94,10 @@ public:
 private:
     // N of elements of type T stored inside OpenGL buffer.
     std::size_t count=0;
+    // N of elements of type T the OpenGL buffer was allocated for (>= count)
+    std::size_t capacity=0;
+    // usage hint the OpenGL buffer was allocated with
+    GLenum currentUsage=GL_STATIC_DRAW;
     // the GL Buffer ID that is generated with the first call to uploadGL
     GLuint glBufferId;
     // Holds true it the GL Buffer was already generated
@@ -98,41 +111,81 @@ private:
             return;
         glGenBuffers(1,&glBufferId);
         alreadyCreatedGLBuffer=true;
-        GLHelper::checkGlError(getTAG()+"::createGL");
+        GLHelper::checkGlError("GLBuffer::createGL");
     }
-    // Calling uploadGL on the same OpenGL buffer multiple times is not a bug
-    // but might be an accident. Log debug message in this case;
-    void checkSetAlreadyUploaded(){
-        if(alreadyUploaded){
+    // Holds true if the debug message below was already logged
+    bool loggedUploadedMoreThanOnce=false;
+    // Replacing the content of a GL_STATIC_DRAW buffer is not a bug
+    // but might be an accident (use GL_DYNAMIC_DRAW for content that changes). Log debug message in this case (only once, buffers that are updated each frame
+    // would otherwise log and allocate the TAG each frame)
+    void checkSetAlreadyUploaded(GLenum usage){
+        if(alreadyUploaded && usage==GL_STATIC_DRAW && !loggedUploadedMoreThanOnce){
             MLOGD2(getTAG())<<"uploadGL called more than once,overwriting previous content";
+            loggedUploadedMoreThanOnce=true;
         }
         alreadyUploaded=true;
     }
+    // If the data fits into the current allocation (and the usage did not change) the content is replaced in place.
+    // Otherwise, the buffer is re-allocated. Buffers that are uploaded more than once grow geometrically, such that
+    // content with a slightly varying size (e.g. text) does not re-allocate each frame
+    void uploadData(const T* data,const std::size_t size,const GLenum usage){
+        createGLBufferIfNeeded();
+        checkSetAlreadyUploaded(usage);
+        if(capacity>0 && size<=capacity && usage==currentUsage){
+            if(size>0)GLBufferHelper::updateGLBuffer(glBufferId,0,data,size*sizeof(T));
+        }else{
+            const std::size_t newCapacity=(capacity==0 || usage==GL_STATIC_DRAW) ? size : std::max(size,capacity*2);
+            GLState::bindBuffer(GL_ARRAY_BUFFER,glBufferId);
+            if(newCapacity==size){
+                GLInstrumentation::bufferData(GL_ARRAY_BUFFER,size*sizeof(T),data,usage);
+            }else{
+                GLInstrumentation::bufferData(GL_ARRAY_BUFFER,newCapacity*sizeof(T),nullptr,usage);
+                GLInstrumentation::bufferSubData(GL_ARRAY_BUFFER,0,size*sizeof(T),data);
+            }
+            GLState::bindBuffer(GL_ARRAY_BUFFER,0);
+            capacity=newCapacity;
+            currentUsage=usage;
+        }
+        count=size;
+        GLHelper::checkGlError("GLBuffer::uploadGL");
+    }
 public:
     // Return the TAG for this OpenGL buffer (glBufferId is unique)
     const std::string getTAG()const{
         return "GLBuffer"+std::to_string(glBufferId);
     }
     // Calling uploadGL multiple times overrides any previous content
+    // Use GL_DYNAMIC_DRAW for content that changes often, the buffer is then only re-allocated when it has to grow
     // Make sure you call this from the GL Thread only
     void uploadGL(const std::vector<T> &vertices,GLenum usage=GL_STATIC_DRAW){
-        createGLBufferIfNeeded();
-        checkSetAlreadyUploaded();
-        count = GLBufferHelper::uploadGLBuffer(glBufferId, vertices,usage);
-        GLHelper::checkGlError(getTAG()+"uploadGL");
+        uploadData(vertices.data(),vertices.size(),usage);
         //MDebug::log("N vertices is "+std::to_string(nVertices));
     }
     // same as above but for different data type
     template<size_t S>
     void uploadGL(const std::array<T,S> &vertices,GLenum usage=GL_STATIC_DRAW){
-        createGLBufferIfNeeded();
-        checkSetAlreadyUploaded();
-        count = GLBufferHelper::uploadGLBuffer(glBufferId, vertices,usage);
-        GLHelper::checkGlError(getTAG()+"uploadGL");
+        uploadData(vertices.data(),S,usage);
+    }
+    // Overwrite the elements [offset,offset+size) of the current content, e.g. when only a few characters of a text changed
+    // Does not change the count and never re-allocates. Make sure you call this from the GL Thread only
+    void updateGL(const std::size_t offset,const T* data,const std::size_t size){
+        if(offset+size>count){
+            MLOGE2(getTAG())<<"updateGL out of range "<<offset<<"+"<<size<<" count "<<count;
+            return;
+        }
+        if(size==0)return;
+        GLBufferHelper::updateGLBuffer(glBufferId,offset*sizeof(T),data,size*sizeof(T));
+        GLHelper::checkGlError("GLBuffer::updateGL");
+    }
+    void updateGL(const std::size_t offset,const std::vector<T>& data){
+        updateGL(offset,data.data(),data.size());
     }
     // this doesn't delete the GLBuffer itself,but rather resizes the GL Buffer to size 0, deleting its previous content
     void freeDataGL(){
-        uploadGL(std::vector<T>());
+        createGLBufferIfNeeded();
+        GLBufferHelper::uploadGLBuffer(glBufferId,nullptr,0,currentUsage);
+        count=0;
+        capacity=0;
     }
     GLint getGLBufferId()const{
         return glBufferId;
@@ -140,9 +193,12 @@ public:
     int getCount()const{
         return (int)count;
     }
+    int getCapacity()const{
+        return (int)capacity;
+    }
     /*void deleteGL() {
         if(alreadyCreatedGLBuffer){
-            glDeleteBuffers(1, &glBufferId);
+            GLState::deleteBuffers(1, &glBufferId);
             alreadyCreatedGLBuffer=false;
         }
         alreadyUploaded=false;
@@ -0,0 +1,52 @@
+#ifndef RENDERINGX_GLBUFFERBENCHMARK_HPP
+#define RENDERINGX_GLBUFFERBENCHMARK_HPP
+
+#include "GLBuffer.hpp"
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Measures repeated dynamic uploads (e.g. OSD text that changes each frame) with a re-allocation per upload (glBufferData)
+// versus the capacity tracking of GLBuffer (glBufferSubData, geometric growth).
+// Not called by the library itself, run it manually (e.g. from a test activity) on the GL thread of the device of interest,
+// or on the host (mesa) with the GLBufferBenchmark executable of src/test/cpp.
+namespace GLBufferBenchmark{
+    // Similar in size to a GLProgramText::Character
+    struct Vertex{
+        float data[9];
+    };
+    static std::string runDynamicUploads(const int nUploads=1000,const std::size_t maxVertices=6*256){
+        // Slightly varying sizes, like a text that changes each frame
+        std::vector<std::vector<Vertex>> content;
+        for(std::size_t i=0;i<16;i++){
+            content.emplace_back(maxVertices-i*6);
+        }
+        GLuint reallocatingBuffer;
+        glGenBuffers(1,&reallocatingBuffer);
+        GLBuffer<Vertex> glBuffer;
+        glFinish();
+        auto start=std::chrono::steady_clock::now();
+        for(int i=0;i<nUploads;i++){
+            GLBufferHelper::uploadGLBuffer(reallocatingBuffer,content[i%content.size()],GL_DYNAMIC_DRAW);
+        }
+        glFinish();
+        const double timeReallocateUs=std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/nUploads;
+        start=std::chrono::steady_clock::now();
+        for(int i=0;i<nUploads;i++){
+            glBuffer.uploadGL(content[i%content.size()],GL_DYNAMIC_DRAW);
+        }
+        glFinish();
+        const double timeCapacityUs=std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/nUploads;
+        const int capacity=glBuffer.getCapacity();
+        glDeleteBuffers(1,&reallocatingBuffer);
+        glBuffer.freeDataGL();
+        std::stringstream ss;
+        ss<<"GLBuffer dynamic uploads ("<<nUploads<<"x ~"<<(maxVertices*sizeof(Vertex)/1024)<<"KB)"
+          <<"\nglBufferData each upload: "<<timeReallocateUs<<"us"
+          <<"\nGLBuffer with capacity: "<<timeCapacityUs<<"us capacity "<<capacity;
+        return ss.str();
+    }
+}
+
+#endif //RENDERINGX_GLBUFFERBENCHMARK_HPP
@@ -27,24 +27,26 @@ namespace GLHelper{
             default: return "unknown";
         }
     }
-    static void checkGlError(const std::string& caller) {
-        GLenum error;
+    // Only formats the error message if there actually is an error, since this is called in the render loop
+    static void checkGlError(const char* caller) {
+        GLenum error=glGetError();
+        if(error==GL_NO_ERROR)return;
         std::stringstream ss;
-        ss<<"GLError:"<<caller.c_str();
+        ss<<"GLError:"<<caller;
         ss<<__FILE__<<__LINE__;
-        bool anyError=false;
-        while ((error = glGetError()) != GL_NO_ERROR) {
+        while (error != GL_NO_ERROR) {
             ss<<" |"<<GlErrorString(error);
-            anyError=true;
+            error=glGetError();
         }
-        if(anyError){
-            MLOGE<<ss.str();
-            // CRASH_APPLICATION_ON_GL_ERROR
-            if(false){
-                std::exit(-1);
-            }
+        MLOGE<<ss.str();
+        // CRASH_APPLICATION_ON_GL_ERROR
+        if(false){
+            std::exit(-1);
         }
     }
+    static void checkGlError(const std::string& caller) {
+        checkGlError(caller.c_str());
+    }
     static void checkFramebufferStatus(GLenum target){
         auto status=glCheckFramebufferStatus(target);
         if(status!=GL_FRAMEBUFFER_COMPLETE){
@@ -0,0 +1,261 @@
+#ifndef RENDERINGX_GLINSTRUMENTATION_HPP
+#define RENDERINGX_GLINSTRUMENTATION_HPP
+
+#include <GLES2/gl2.h>
+#include <TraceCounter.hpp>
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// Counts what a frame costs on the OpenGL side: draw calls, state changes (the calls GLState did not skip), uniform uploads
+// and the bytes uploaded into buffers and textures. RenderingXCore issues these calls through the wrappers below.
+// Each count is attributed to the subsystem tag that is active on the calling thread (see ScopedTag), the compositor for example
+// tags each layer. endFrame() stores the counters of the frame as a snapshot and writes them as trace counters.
+// Counting costs a bit of CPU for each call, therefore it is only compiled in when RENDERINGX_GL_INSTRUMENTATION is defined
+// (see RenderingXCore.cmake). Without it the wrappers only forward to OpenGL and all counters stay 0.
+// Like GLState the counters are per thread.
+namespace GLInstrumentation{
+    enum class Subsystem{
+        // Everything that is not tagged
+        OTHER,
+        COMPOSITOR_LAYER,
+        TEXT,
+        LINE,
+        // The mesh that occludes everything outside of the visible part of the display (vignette)
+        OCCLUSION,
+        // Front buffer rendering work around the compositor, e.g. clearing the eye
+        FBR,
+        COUNT
+    };
+    static constexpr int N_SUBSYSTEMS=(int)Subsystem::COUNT;
+    static constexpr std::array<const char*,N_SUBSYSTEMS> SUBSYSTEM_NAMES={"other","layer","text","line","occlusion","fbr"};
+    // Compositor layers with a higher index are only counted in the COMPOSITOR_LAYER total
+    static constexpr int MAX_TRACKED_LAYERS=8;
+    struct Counters{
+        uint64_t drawCalls=0;
+        uint64_t stateChanges=0;
+        uint64_t uniformUploads=0;
+        uint64_t bufferUploadBytes=0;
+        uint64_t textureUploadBytes=0;
+        Counters& operator+=(const Counters& o){
+            drawCalls+=o.drawCalls;
+            stateChanges+=o.stateChanges;
+            uniformUploads+=o.uniformUploads;
+            bufferUploadBytes+=o.bufferUploadBytes;
+            textureUploadBytes+=o.textureUploadBytes;
+            return *this;
+        }
+        std::string toString()const{
+            std::stringstream ss;
+            ss<<"draws "<<drawCalls<<" state "<<stateChanges<<" uniforms "<<uniformUploads<<" buffer bytes "<<bufferUploadBytes
+            <<" texture bytes "<<textureUploadBytes;
+            return ss.str();
+        }
+    };
+    struct FrameSnapshot{
+        // Number of the frame on this thread, counted by endFrame()
+        uint64_t frame=0;
+        std::array<Counters,N_SUBSYSTEMS> subsystems;
+        // Per compositor layer index, also included in subsystems[COMPOSITOR_LAYER]
+        std::array<Counters,MAX_TRACKED_LAYERS> layers;
+        const Counters& get(const Subsystem subsystem)const{
+            return subsystems[(int)subsystem];
+        }
+        Counters total()const{
+            Counters ret;
+            for(const auto& counters:subsystems)ret+=counters;
+            return ret;
+        }
+        std::string toString()const{
+            std::stringstream ss;
+            ss<<"GL frame "<<frame<<" total: "<<total().toString();
+            for(int i=0;i<N_SUBSYSTEMS;i++){
+                const Counters& c=subsystems[i];
+                if(c.drawCalls==0 && c.stateChanges==0 && c.uniformUploads==0 && c.bufferUploadBytes==0 && c.textureUploadBytes==0)continue;
+                ss<<"\n"<<SUBSYSTEM_NAMES[i]<<": "<<c.toString();
+            }
+            return ss.str();
+        }
+    };
+
+    static constexpr bool isEnabled(){
+#ifdef RENDERINGX_GL_INSTRUMENTATION
+        return true;
+#else
+        return false;
+#endif
+    }
+
+#ifdef RENDERINGX_GL_INSTRUMENTATION
+    struct Tag{
+        Subsystem subsystem=Subsystem::OTHER;
+        int index=0;
+    };
+    inline thread_local Tag currentTag;
+    inline thread_local FrameSnapshot currentFrame;
+    inline thread_local FrameSnapshot lastFrame;
+
+    // Calls f with the counters of the current tag, and of the layer if the tag is a tracked compositor layer
+    template<class F>
+    static void count(F&& f){
+        f(currentFrame.subsystems[(int)currentTag.subsystem]);
+        if(currentTag.subsystem==Subsystem::COMPOSITOR_LAYER && currentTag.index>=0 && currentTag.index<MAX_TRACKED_LAYERS){
+            f(currentFrame.layers[currentTag.index]);
+        }
+    }
+    // "GL <counter> <subsystem>", created once such that the trace counter names stay valid
+    static const std::array<std::array<std::string,5>,N_SUBSYSTEMS>& getTraceCounterNames(){
+        static const auto names=[](){
+            std::array<std::array<std::string,5>,N_SUBSYSTEMS> ret;
+            static constexpr std::array<const char*,5> COUNTER_NAMES={"draws","state","uniforms","buffer bytes","texture bytes"};
+            for(int i=0;i<N_SUBSYSTEMS;i++){
+                for(int j=0;j<5;j++){
+                    ret[i][j]=std::string("GL ")+COUNTER_NAMES[j]+" "+SUBSYSTEM_NAMES[i];
+                }
+            }
+            return ret;
+        }();
+        return names;
+    }
+#endif
+
+    // Attributes everything counted on this thread to the given subsystem until destroyed, then the previous tag is active again.
+    // For COMPOSITOR_LAYER index is the layer index
+    class ScopedTag{
+    public:
+#ifdef RENDERINGX_GL_INSTRUMENTATION
+        explicit ScopedTag(const Subsystem subsystem,const int index=0):previous(currentTag){
+            currentTag={subsystem,index};
+        }
+        ~ScopedTag(){
+            currentTag=previous;
+        }
+    private:
+        const Tag previous;
+#else
+        explicit ScopedTag(const Subsystem subsystem,const int index=0){}
+#endif
+    public:
+        ScopedTag(const ScopedTag&)=delete;
+        ScopedTag& operator=(const ScopedTag&)=delete;
+    };
+
+    // Called by GLState for each call that was not skipped
+    static void countStateChange(){
+#ifdef RENDERINGX_GL_INSTRUMENTATION
+        count([](Counters& c){c.stateChanges++;});
+#endif
+    }
+    // For buffer content that is not uploaded through the wrappers below, e.g. written into a mapped buffer
+    static void countBufferUpload(const GLsizeiptr bytes){
+#ifdef RENDERINGX_GL_INSTRUMENTATION
+        count([bytes](Counters& c){c.bufferUploadBytes+=bytes;});
+#endif
+    }
+    static void countTextureUpload(const uint64_t bytes){
+#ifdef RENDERINGX_GL_INSTRUMENTATION
+        count([bytes](Counters& c){c.textureUploadBytes+=bytes;});
+#endif
+    }
+    static void countUniformUpload(){
+#ifdef RENDERINGX_GL_INSTRUMENTATION
+        count([](Counters& c){c.uniformUploads++;});
+#endif
+    }
+    static void countDrawCall(){
+#ifdef RENDERINGX_GL_INSTRUMENTATION
+        count([](Counters& c){c.drawCalls++;});
+#endif
+    }
+
+    static void drawArrays(const GLenum mode,const GLint first,const GLsizei count){
+        countDrawCall();
+        glDrawArrays(mode,first,count);
+    }
+    static void drawElements(const GLenum mode,const GLsizei count,const GLenum type,const void* indices){
+        countDrawCall();
+        glDrawElements(mode,count,type,indices);
+    }
+    static void uniform1i(const GLint location,const GLint v0){
+        countUniformUpload();
+        glUniform1i(location,v0);
+    }
+    static void uniform1f(const GLint location,const GLfloat v0){
+        countUniformUpload();
+        glUniform1f(location,v0);
+    }
+    static void uniform1fv(const GLint location,const GLsizei count,const GLfloat* value){
+        countUniformUpload();
+        glUniform1fv(location,count,value);
+    }
+    static void uniform2f(const GLint location,const GLfloat v0,const GLfloat v1){
+        countUniformUpload();
+        glUniform2f(location,v0,v1);
+    }
+    static void uniform3f(const GLint location,const GLfloat v0,const GLfloat v1,const GLfloat v2){
+        countUniformUpload();
+        glUniform3f(location,v0,v1,v2);
+    }
+    static void uniformMatrix4fv(const GLint location,const GLsizei count,const GLboolean transpose,const GLfloat* value){
+        countUniformUpload();
+        glUniformMatrix4fv(location,count,transpose,value);
+    }
+    // Only counted if data!=nullptr (else the buffer is only (re-) allocated)
+    static void bufferData(const GLenum target,const GLsizeiptr size,const void* data,const GLenum usage){
+        if(data!=nullptr)countBufferUpload(size);
+        glBufferData(target,size,data,usage);
+    }
+    static void bufferSubData(const GLenum target,const GLintptr offset,const GLsizeiptr size,const void* data){
+        countBufferUpload(size);
+        glBufferSubData(target,offset,size,data);
+    }
+    // Bytes per pixel for the formats / types of OpenGL ES 2.0
+    static int getBytesPerPixel(const GLenum format,const GLenum type){
+        if(type==GL_UNSIGNED_SHORT_5_6_5 || type==GL_UNSIGNED_SHORT_4_4_4_4 || type==GL_UNSIGNED_SHORT_5_5_5_1)return 2;
+        const int bytesPerComponent=type==GL_FLOAT ? 4 : type==GL_UNSIGNED_SHORT ? 2 : 1;
+        switch(format){
+            case GL_RGBA:return 4*bytesPerComponent;
+            case GL_RGB:return 3*bytesPerComponent;
+            case GL_LUMINANCE_ALPHA:return 2*bytesPerComponent;
+            default:return bytesPerComponent;
+        }
+    }
+    // Only counted if pixels!=nullptr (else the texture is only (re-) allocated)
+    static void texImage2D(const GLenum target,const GLint level,const GLint internalFormat,const GLsizei width,const GLsizei height,
+            const GLint border,const GLenum format,const GLenum type,const void* pixels){
+        if(pixels!=nullptr)countTextureUpload((uint64_t)width*height*getBytesPerPixel(format,type));
+        glTexImage2D(target,level,internalFormat,width,height,border,format,type,pixels);
+    }
+
+    // Ends the frame on the calling thread: the counters become the snapshot returned by getLastFrame() and are written
+    // as trace counters (one for each counter and subsystem) if a trace is recorded
+    static void endFrame(){
+#ifdef RENDERINGX_GL_INSTRUMENTATION
+        if(TraceCounter::isEnabled()){
+            const auto& names=getTraceCounterNames();
+            for(int i=0;i<N_SUBSYSTEMS;i++){
+                const Counters& c=currentFrame.subsystems[i];
+                TraceCounter::set(names[i][0].c_str(),(int64_t)c.drawCalls);
+                TraceCounter::set(names[i][1].c_str(),(int64_t)c.stateChanges);
+                TraceCounter::set(names[i][2].c_str(),(int64_t)c.uniformUploads);
+                TraceCounter::set(names[i][3].c_str(),(int64_t)c.bufferUploadBytes);
+                TraceCounter::set(names[i][4].c_str(),(int64_t)c.textureUploadBytes);
+            }
+        }
+        lastFrame=currentFrame;
+        currentFrame=FrameSnapshot();
+        currentFrame.frame=lastFrame.frame+1;
+#endif
+    }
+    // The counters of the last frame that was ended on the calling thread. Empty without RENDERINGX_GL_INSTRUMENTATION
+    static FrameSnapshot getLastFrame(){
+#ifdef RENDERINGX_GL_INSTRUMENTATION
+        return lastFrame;
+#else
+        return FrameSnapshot();
+#endif
+    }
+}
+
+#endif //RENDERINGX_GLINSTRUMENTATION_HPP
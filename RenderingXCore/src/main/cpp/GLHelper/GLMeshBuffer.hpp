@@ -7,6 +7,7 @@
 
 #include <optional>
 #include <GLBuffer.hpp>
+#include <GLState.hpp>
 #include <AndroidLogger.hpp>
 #include <IndicesHelper.hpp>
 
@@ -66,6 +67,14 @@ private:
     // True if index buffer is active,false otherwise
     std::pair<GLBuffer<INDEX>,bool> glBufferIndices;
     GLenum mode;
+    // Vertex array objects, one for each key passed to bindVertexArray(). Created on first use
+    mutable std::vector<std::pair<uint64_t,GLuint>> vertexArrays;
+    void deleteVertexArrays(){
+        for(const auto& vertexArray:vertexArrays){
+            GLState::deleteVertexArrays(1,&vertexArray.second);
+        }
+        vertexArrays.clear();
+    }
 public:
     AGLMeshBuffer()=default;
     // Same as GLBuffer
@@ -74,8 +83,14 @@ public:
     AGLMeshBuffer(const AMeshData<VERTEX,INDEX>& meshData){
         setData(meshData);
     }
+    // Vertex array objects only exist if the mesh was drawn with them, make sure to destroy the mesh on the OpenGL thread in this case
+    ~AGLMeshBuffer(){
+        deleteVertexArrays();
+    }
     // Return self for Method chaining ?
     void setData(const AMeshData<VERTEX,INDEX>& meshData){
+        // The vertex array objects would keep an outdated index buffer binding if the mesh gained indices
+        deleteVertexArrays();
         glBufferVertices.uploadGL(meshData.vertices);
         if(meshData.hasIndices()){
             //glBufferIndices=GLBuffer<INDEX>();
@@ -109,6 +124,40 @@ public:
     GLuint getIndexBufferId()const{
         return glBufferIndices.first.getGLBufferId();
     }
+    // For glDrawElements
+    static constexpr GLenum getIndexType(){
+        return IndicesHelper::GLIndexType<INDEX>::value;
+    }
+    // Binds the vertex array object for this key, it is created on first use. The key has to identify everything setupAttributes()
+    // depends on, e.g. the program (attribute locations) and which texture coordinates of a stereo vertex are used.
+    // setupAttributes() is called with the vertex buffer bound to GL_ARRAY_BUFFER and has to enable the vertex attribute arrays
+    // and set their pointers via GLState. The index buffer is part of the vertex array object.
+    // Requires GLState::vertexArraysAvailable()
+    template<class F>
+    void bindVertexArray(const uint64_t key,F&& setupAttributes)const{
+        for(const auto& vertexArray:vertexArrays){
+            if(vertexArray.first==key){
+                GLState::bindVertexArray(vertexArray.second);
+                return;
+            }
+        }
+        const GLuint vertexArray=GLState::createVertexArray([this,&setupAttributes](){
+            GLState::bindBuffer(GL_ARRAY_BUFFER,getVertexBufferId());
+            setupAttributes();
+            if(hasIndices()){
+                GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER,getIndexBufferId());
+            }
+        });
+        vertexArrays.emplace_back(key,vertexArray);
+    }
+    // Draw the whole mesh with the vertex array object bound by bindVertexArray()
+    void drawVertexArray()const{
+        if(hasIndices()){
+            GLInstrumentation::drawElements(mode,getCount(),getIndexType(),nullptr);
+        }else{
+            GLInstrumentation::drawArrays(mode,0,getCount());
+        }
+    }
 };
 
 #endif //FPV_VR_OS_GLMESHBUFFER_HPP
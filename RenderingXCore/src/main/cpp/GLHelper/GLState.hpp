@@ -0,0 +1,278 @@
+#ifndef RENDERINGX_GLSTATE_HPP
+#define RENDERINGX_GLSTATE_HPP
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <Extensions.h>
+#include <GLInstrumentation.hpp>
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <sstream>
+#include <string>
+
+// Shadow copy of the OpenGL state that changes between draw calls (program, buffer bindings, texture bindings per unit,
+// enabled vertex attribute arrays and their pointers, blend / depth / scissor state).
+// Calls that would not change the state are skipped. All programs and helpers in RenderingXCore go through GLState.
+// The shadow copy is per thread, since an OpenGL context is current on exactly one thread.
+// Anything that changes the same state with raw gl calls (Java code, gvr, SurfaceTexture.updateTexImage()) has to be followed by
+// invalidate(), VrCompositorRenderer::drawLayers() does this for each eye.
+// Unknown state (e.g. after invalidate()) is never skipped.
+// Vertex array objects: the element array buffer binding and the vertex attribute state belong to the bound vertex array object.
+// Code that does not use vertex array objects works on the default one (0), GLState binds it automatically before changing
+// that state. The cached state of the default vertex array object is kept while another one is bound.
+namespace GLState{
+    // OpenGL ES 2.0 guarantees at least 8 of each, indices above are not tracked
+    static constexpr int MAX_VERTEX_ATTRIBS=8;
+    static constexpr int MAX_TEXTURE_UNITS=8;
+    struct Counters{
+        // Calls to GLState functions that change state
+        uint64_t nCalls=0;
+        // Of them, the ones that were skipped because the state already matched
+        uint64_t nSkipped=0;
+        std::string toString()const{
+            std::stringstream ss;
+            ss<<"GLState skipped "<<nSkipped<<" of "<<nCalls;
+            return ss.str();
+        }
+    };
+    struct VertexAttribPointer{
+        GLuint buffer;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        GLsizei stride;
+        const void* pointer;
+        bool operator==(const VertexAttribPointer& o)const{
+            return buffer==o.buffer && size==o.size && type==o.type && normalized==o.normalized && stride==o.stride && pointer==o.pointer;
+        }
+    };
+    // The part of the state that is stored in a vertex array object
+    struct VertexArrayState{
+        std::optional<GLuint> elementArrayBuffer;
+        std::array<std::optional<bool>,MAX_VERTEX_ATTRIBS> vertexAttribArrayEnabled;
+        std::array<std::optional<VertexAttribPointer>,MAX_VERTEX_ATTRIBS> vertexAttribPointers;
+    };
+    struct State{
+        std::optional<GLuint> program;
+        std::optional<GLuint> arrayBuffer;
+        std::optional<GLuint> vertexArray;
+        // Of the bound vertex array object
+        VertexArrayState vertexArrayState;
+        // Of the default vertex array object while another one is bound
+        VertexArrayState defaultVertexArrayState;
+        std::optional<GLenum> activeTexture;
+        // [unit][0]==GL_TEXTURE_2D, [unit][1]==GL_TEXTURE_EXTERNAL_OES
+        std::array<std::array<std::optional<GLuint>,2>,MAX_TEXTURE_UNITS> textures;
+        std::optional<bool> blend,depthTest,scissorTest,cullFace;
+        std::optional<std::array<GLenum,2>> blendFunc;
+        std::optional<std::array<GLint,4>> scissor;
+    };
+    inline thread_local State state;
+    inline thread_local Counters counters;
+    // True while createVertexArray() records the state of a new vertex array object
+    inline thread_local bool recordingVertexArray=false;
+    // Set to false to draw without vertex array objects even if they are available, e.g. to compare the CPU time
+    inline bool enableVertexArrays=true;
+
+    // Returns true if the call can be skipped, else updates the cached value
+    template<class T>
+    static bool updateCached(std::optional<T>& cached,const T& value){
+        counters.nCalls++;
+        if(cached.has_value() && *cached==value){
+            counters.nSkipped++;
+            return true;
+        }
+        cached=value;
+        GLInstrumentation::countStateChange();
+        return false;
+    }
+    // Forget everything, e.g. after the state was changed outside of GLState
+    static void invalidate(){
+        state=State();
+    }
+    static Counters getCounters(){
+        return counters;
+    }
+    static void resetCounters(){
+        counters=Counters();
+    }
+    static void useProgram(const GLuint program){
+        if(updateCached(state.program,program))return;
+        glUseProgram(program);
+    }
+    static bool vertexArraysAvailable(){
+        return enableVertexArrays && Extensions::GL_vertex_array_object_available;
+    }
+    // Requires Extensions::GL_vertex_array_object_available (or vertexArray==0)
+    static void bindVertexArray(const GLuint vertexArray){
+        const std::optional<GLuint> previous=state.vertexArray;
+        if(updateCached(state.vertexArray,vertexArray))return;
+        if(previous==0u){
+            state.defaultVertexArrayState=state.vertexArrayState;
+        }
+        // The state of other vertex array objects is not tracked, it is only set once in createVertexArray()
+        state.vertexArrayState=(vertexArray==0 && previous.has_value()) ? state.defaultVertexArrayState : VertexArrayState();
+        Extensions::glBindVertexArray_(vertexArray);
+    }
+    // Called before the state of the default vertex array object is changed, such that code that does not use
+    // vertex array objects never modifies the bound one
+    static void bindDefaultVertexArrayIfNeeded(){
+        if(recordingVertexArray || state.vertexArray==0u || !Extensions::GL_vertex_array_object_available)return;
+        bindVertexArray(0);
+    }
+    // Creates and binds a new vertex array object. setup() sets the element array buffer and the vertex attributes
+    // (using the functions below), which are recorded into the vertex array object instead of the default one
+    template<class F>
+    static GLuint createVertexArray(F&& setup){
+        GLuint vertexArray=0;
+        Extensions::glGenVertexArrays_(1,&vertexArray);
+        bindVertexArray(vertexArray);
+        recordingVertexArray=true;
+        setup();
+        recordingVertexArray=false;
+        return vertexArray;
+    }
+    // Deleting the bound vertex array object binds the default one
+    static void deleteVertexArrays(const GLsizei n,const GLuint* vertexArrays){
+        for(GLsizei i=0;i<n;i++){
+            if(vertexArrays[i]!=0 && state.vertexArray==vertexArrays[i]){
+                state.vertexArray=0;
+                state.vertexArrayState=state.defaultVertexArrayState;
+            }
+        }
+        Extensions::glDeleteVertexArrays_(n,vertexArrays);
+    }
+    static void bindBuffer(const GLenum target,const GLuint buffer){
+        if(target==GL_ARRAY_BUFFER){
+            if(updateCached(state.arrayBuffer,buffer))return;
+        }else if(target==GL_ELEMENT_ARRAY_BUFFER){
+            bindDefaultVertexArrayIfNeeded();
+            if(updateCached(state.vertexArrayState.elementArrayBuffer,buffer))return;
+        }
+        glBindBuffer(target,buffer);
+    }
+    // Deleting a bound buffer resets the binding to 0 (for vertex array objects only in the bound one)
+    static void deleteBuffers(const GLsizei n,const GLuint* buffers){
+        for(GLsizei i=0;i<n;i++){
+            if(buffers[i]==0)continue;
+            if(state.arrayBuffer==buffers[i])state.arrayBuffer=0;
+            if(state.vertexArrayState.elementArrayBuffer==buffers[i])state.vertexArrayState.elementArrayBuffer=0;
+            if(state.defaultVertexArrayState.elementArrayBuffer==buffers[i])state.defaultVertexArrayState.elementArrayBuffer.reset();
+            for(auto* vertexArrayState:{&state.vertexArrayState,&state.defaultVertexArrayState}){
+                for(auto& pointer:vertexArrayState->vertexAttribPointers){
+                    if(pointer && pointer->buffer==buffers[i])pointer.reset();
+                }
+            }
+        }
+        glDeleteBuffers(n,buffers);
+    }
+    static void activeTexture(const GLenum unit){
+        if(updateCached(state.activeTexture,unit))return;
+        glActiveTexture(unit);
+    }
+    // Binds to the currently active texture unit
+    static void bindTexture(const GLenum target,const GLuint texture){
+        const int targetIdx=target==GL_TEXTURE_2D ? 0 : target==GL_TEXTURE_EXTERNAL_OES ? 1 : -1;
+        const int unitIdx=state.activeTexture ? (int)(*state.activeTexture-GL_TEXTURE0) : -1;
+        if(targetIdx>=0 && unitIdx>=0 && unitIdx<MAX_TEXTURE_UNITS){
+            if(updateCached(state.textures[unitIdx][targetIdx],texture))return;
+        }
+        glBindTexture(target,texture);
+    }
+    static void bindTexture(const GLenum unit,const GLenum target,const GLuint texture){
+        activeTexture(unit);
+        bindTexture(target,texture);
+    }
+    // Deleting a bound texture resets the binding to 0
+    static void deleteTextures(const GLsizei n,const GLuint* textures){
+        for(GLsizei i=0;i<n;i++){
+            if(textures[i]==0)continue;
+            for(auto& unit:state.textures){
+                for(auto& texture:unit){
+                    if(texture==textures[i])texture=0;
+                }
+            }
+        }
+        glDeleteTextures(n,textures);
+    }
+    static void setVertexAttribArrayEnabled(const GLint index,const bool enable){
+        if(index<0)return;
+        bindDefaultVertexArrayIfNeeded();
+        if(index>=MAX_VERTEX_ATTRIBS || !updateCached(state.vertexArrayState.vertexAttribArrayEnabled[index],enable)){
+            if(enable){
+                glEnableVertexAttribArray((GLuint)index);
+            }else{
+                glDisableVertexAttribArray((GLuint)index);
+            }
+        }
+    }
+    // Enables exactly the given vertex attribute arrays (negative indices are ignored) and disables all the others.
+    // Programs call this in beforeDraw() instead of enabling in beforeDraw() and disabling in afterDraw()
+    static void setVertexAttribArrays(std::initializer_list<GLint> indices){
+        bindDefaultVertexArrayIfNeeded();
+        std::array<bool,MAX_VERTEX_ATTRIBS> enabled{};
+        for(const GLint index:indices){
+            if(index<0)continue;
+            if(index<MAX_VERTEX_ATTRIBS){
+                enabled[index]=true;
+            }else{
+                setVertexAttribArrayEnabled(index,true);
+            }
+        }
+        for(int i=0;i<MAX_VERTEX_ATTRIBS;i++){
+            // Attributes that are known to be disabled don't count as a call
+            if(!enabled[i] && state.vertexArrayState.vertexAttribArrayEnabled[i]==false)continue;
+            setVertexAttribArrayEnabled(i,enabled[i]);
+        }
+    }
+    static void disableAllVertexAttribArrays(){
+        setVertexAttribArrays({});
+    }
+    // The pointer refers to the buffer that is currently bound to GL_ARRAY_BUFFER
+    static void vertexAttribPointer(const GLint index,const GLint size,const GLenum type,const GLboolean normalized,const GLsizei stride,const void* pointer){
+        if(index<0)return;
+        bindDefaultVertexArrayIfNeeded();
+        auto& pointers=state.vertexArrayState.vertexAttribPointers;
+        if(index<MAX_VERTEX_ATTRIBS && state.arrayBuffer.has_value()){
+            if(updateCached(pointers[index],VertexAttribPointer{*state.arrayBuffer,size,type,normalized,stride,pointer}))return;
+        }else if(index<MAX_VERTEX_ATTRIBS){
+            pointers[index].reset();
+        }
+        glVertexAttribPointer((GLuint)index,size,type,normalized,stride,pointer);
+    }
+    // For GL_BLEND, GL_DEPTH_TEST, GL_SCISSOR_TEST and GL_CULL_FACE, other caps are passed through
+    static void setEnabled(const GLenum cap,const bool enable){
+        std::optional<bool>* cached=nullptr;
+        switch(cap){
+            case GL_BLEND:cached=&state.blend;break;
+            case GL_DEPTH_TEST:cached=&state.depthTest;break;
+            case GL_SCISSOR_TEST:cached=&state.scissorTest;break;
+            case GL_CULL_FACE:cached=&state.cullFace;break;
+            default:break;
+        }
+        if(cached!=nullptr && updateCached(*cached,enable))return;
+        if(enable){
+            glEnable(cap);
+        }else{
+            glDisable(cap);
+        }
+    }
+    static void enable(const GLenum cap){
+        setEnabled(cap,true);
+    }
+    static void disable(const GLenum cap){
+        setEnabled(cap,false);
+    }
+    static void blendFunc(const GLenum sfactor,const GLenum dfactor){
+        if(updateCached(state.blendFunc,std::array<GLenum,2>{sfactor,dfactor}))return;
+        glBlendFunc(sfactor,dfactor);
+    }
+    static void scissor(const GLint x,const GLint y,const GLsizei width,const GLsizei height){
+        if(updateCached(state.scissor,std::array<GLint,4>{x,y,width,height}))return;
+        glScissor(x,y,width,height);
+    }
+}
+
+#endif //RENDERINGX_GLSTATE_HPP
@@ -0,0 +1,207 @@
+#ifndef RENDERINGX_GLSTREAMINGBUFFER_HPP
+#define RENDERINGX_GLSTREAMINGBUFFER_HPP
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <AndroidLogger.hpp>
+#include <AllocationCounter.h>
+#include <GLHelper.hpp>
+#include <GLState.hpp>
+#include <Extensions.h>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+// One GL_ARRAY_BUFFER for all the dynamic vertex data of a frame (text, lines, widgets that change each frame).
+// Per frame:
+// beginFrame() -> allocate() and write the vertices of all dynamic geometry -> commit() -> draw with the returned offsets
+// With map buffer range (OpenGL ES 3.0 or EXT_map_buffer_range) the buffer is split into N_REGIONS regions, one per frame in flight.
+// Each frame maps its region once with GL_MAP_UNSYNCHRONIZED_BIT, and the fence inserted after the frame's draw calls guarantees
+// the GPU is done reading the region before it is written again - no implicit synchronization by the driver.
+// Without map buffer range the vertices are written into a CPU copy and uploaded with one orphaning glBufferData per frame.
+class GLStreamingBuffer{
+public:
+    static constexpr int N_REGIONS=3;
+    // Offsets are aligned such that any vertex layout can be used
+    static constexpr std::size_t ALIGNMENT=16;
+    // Where the vertices were written to. Bind the buffer and add byteOffset to the vertex attribute pointers,
+    // e.g. GLProgramText::beforeDraw(allocation.buffer,allocation.byteOffset)
+    template<class T>
+    struct Allocation{
+        T* data=nullptr;
+        std::size_t count=0;
+        GLuint buffer=0;
+        GLintptr byteOffset=0;
+        bool isValid()const{
+            return data!=nullptr;
+        }
+    };
+    explicit GLStreamingBuffer(std::size_t regionSizeBytes=256*1024,std::string tag="GLStreamingBuffer"):
+    regionSizeBytes(regionSizeBytes),TAG(std::move(tag)){}
+    GLStreamingBuffer(const GLStreamingBuffer&)=delete;
+    // Call once the OpenGL context is available (after Extensions::initializeGL())
+    void initializeGL(){
+        useMapping=Extensions::GL_map_buffer_range_available && Extensions::GL_OES_EGL_sync;
+        glGenBuffers(1,&buffer);
+        allocateStorage();
+        MLOGD2(TAG.c_str())<<"Initialized "<<(useMapping ? "map buffer range" : "orphaning")<<" region size "<<regionSizeBytes;
+    }
+    // Begin writing the dynamic geometry of a new frame
+    void beginFrame(){
+        assert(!inFrame);
+        inFrame=true;
+        // The previous frame did not fit, grow before writing the new one
+        if(requiredBytes>regionSizeBytes){
+            while(regionSizeBytes<requiredBytes)regionSizeBytes*=2;
+            MLOGD2(TAG.c_str())<<"Growing region size to "<<regionSizeBytes;
+            allocateStorage();
+        }
+        requiredBytes=0;
+        usedBytes=0;
+        if(!useMapping){
+            staging.resize(regionSizeBytes);
+            mappedData=staging.data();
+            return;
+        }
+        // The draw calls of the previous frame that read from its region have been submitted
+        if(lastCommittedRegion){
+            fences[*lastCommittedRegion].emplace();
+            lastCommittedRegion.reset();
+        }
+        currentRegion=(currentRegion+1)%N_REGIONS;
+        auto& fence=fences[currentRegion];
+        if(fence){
+            // Usually signaled long ago (N_REGIONS-1 frames in between)
+            if(!fence->wait(0)){
+                const auto before=std::chrono::steady_clock::now();
+                fence->wait(std::chrono::milliseconds(100));
+                stallTime+=std::chrono::steady_clock::now()-before;
+                nStalls++;
+            }
+            fence.reset();
+        }
+        GLState::bindBuffer(GL_ARRAY_BUFFER,buffer);
+        mappedData=static_cast<uint8_t*>(Extensions::glMapBufferRange_(GL_ARRAY_BUFFER,currentRegion*regionSizeBytes,regionSizeBytes,
+                GL_MAP_WRITE_BIT_EXT | GL_MAP_UNSYNCHRONIZED_BIT_EXT | GL_MAP_INVALIDATE_RANGE_BIT_EXT | GL_MAP_FLUSH_EXPLICIT_BIT_EXT));
+        GLState::bindBuffer(GL_ARRAY_BUFFER,0);
+        if(mappedData==nullptr){
+            MLOGE2(TAG.c_str())<<"glMapBufferRange failed, falling back to orphaning";
+            useMapping=false;
+            allocateStorage();
+            staging.resize(regionSizeBytes);
+            mappedData=staging.data();
+        }
+    }
+    // Reserve space for count elements in the current frame. The returned data pointer is only valid until commit().
+    // Returns an invalid allocation if the frame does not fit - the buffer grows before the next frame
+    template<class T>
+    Allocation<T> allocate(const std::size_t count){
+        assert(inFrame);
+        const std::size_t offset=align(usedBytes);
+        const std::size_t sizeBytes=count*sizeof(T);
+        // Includes the allocations that did not fit
+        requiredBytes=align(requiredBytes)+sizeBytes;
+        if(offset+sizeBytes>regionSizeBytes){
+            nOverflows++;
+            return {};
+        }
+        usedBytes=offset+sizeBytes;
+        Allocation<T> allocation;
+        allocation.data=reinterpret_cast<T*>(mappedData+offset);
+        allocation.count=count;
+        allocation.buffer=buffer;
+        allocation.byteOffset=(useMapping ? currentRegion*regionSizeBytes : 0)+offset;
+        return allocation;
+    }
+    // Convenience, copies the data into a new allocation
+    template<class T>
+    Allocation<T> write(const std::vector<T>& data){
+        auto allocation=allocate<T>(data.size());
+        if(allocation.isValid()){
+            std::memcpy(allocation.data,data.data(),data.size()*sizeof(T));
+        }
+        return allocation;
+    }
+    // Makes the data written since beginFrame() visible to the GPU. Draw calls using the allocations of this frame have to be
+    // issued after commit() and before the next beginFrame()
+    void commit(){
+        assert(inFrame);
+        inFrame=false;
+        GLState::bindBuffer(GL_ARRAY_BUFFER,buffer);
+        if(useMapping){
+            if(usedBytes>0)Extensions::glFlushMappedBufferRange_(GL_ARRAY_BUFFER,0,usedBytes);
+            GLInstrumentation::countBufferUpload(usedBytes);
+            Extensions::glUnmapBuffer_(GL_ARRAY_BUFFER);
+            lastCommittedRegion=currentRegion;
+        }else{
+            // Orphan the previous storage (the driver keeps it alive until the GPU is done with it), then upload
+            GLInstrumentation::bufferData(GL_ARRAY_BUFFER,regionSizeBytes,nullptr,GL_STREAM_DRAW);
+            if(usedBytes>0)GLInstrumentation::bufferSubData(GL_ARRAY_BUFFER,0,usedBytes,staging.data());
+        }
+        GLState::bindBuffer(GL_ARRAY_BUFFER,0);
+        mappedData=nullptr;
+        maxUsedBytes=std::max(maxUsedBytes,usedBytes);
+        nFrames++;
+        GLHelper::checkGlError("GLStreamingBuffer::commit");
+        printLogIfNeeded();
+    }
+    GLuint getGLBufferId()const{
+        return buffer;
+    }
+    bool isUsingMapping()const{
+        return useMapping;
+    }
+private:
+    std::size_t regionSizeBytes;
+    const std::string TAG;
+    GLuint buffer=0;
+    bool useMapping=false;
+    bool inFrame=false;
+    int currentRegion=0;
+    std::optional<int> lastCommittedRegion;
+    // Signaled once the GPU is done reading the region
+    std::array<std::optional<FenceSync>,N_REGIONS> fences;
+    uint8_t* mappedData=nullptr;
+    // CPU copy without mapping
+    std::vector<uint8_t> staging;
+    std::size_t usedBytes=0;
+    std::size_t requiredBytes=0;
+    // stats
+    std::size_t maxUsedBytes=0;
+    int nFrames=0;
+    int nStalls=0;
+    int nOverflows=0;
+    std::chrono::steady_clock::duration stallTime{0};
+    std::chrono::steady_clock::time_point lastLog=std::chrono::steady_clock::now();
+    static std::size_t align(const std::size_t bytes){
+        return (bytes+ALIGNMENT-1)/ALIGNMENT*ALIGNMENT;
+    }
+    // (Re-) allocates the storage for all regions. Orphans the old storage, so pending fences are not needed anymore
+    void allocateStorage(){
+        GLState::bindBuffer(GL_ARRAY_BUFFER,buffer);
+        GLInstrumentation::bufferData(GL_ARRAY_BUFFER,(useMapping ? N_REGIONS : 1)*regionSizeBytes,nullptr,useMapping ? GL_DYNAMIC_DRAW : GL_STREAM_DRAW);
+        GLState::bindBuffer(GL_ARRAY_BUFFER,0);
+        for(auto& fence:fences)fence.reset();
+        lastCommittedRegion.reset();
+    }
+    void printLogIfNeeded(){
+        const auto now=std::chrono::steady_clock::now();
+        if(now-lastLog>std::chrono::seconds(5)){
+            lastLog=now;
+            // Called from the render loop, but logging is allowed to allocate
+            const AllocationCounter::Exclude logging;
+            MLOGD2(TAG.c_str())<<"Frames "<<nFrames<<" max used "<<maxUsedBytes<<"/"<<regionSizeBytes<<" bytes"
+            <<" stalls "<<nStalls<<" ("<<MyTimeHelper::R(stallTime)<<") overflows "<<nOverflows;
+            nFrames=0;
+            nStalls=0;
+            nOverflows=0;
+            maxUsedBytes=0;
+            stallTime=std::chrono::steady_clock::duration{0};
+        }
+    }
+};
+
+#endif //RENDERINGX_GLSTREAMINGBUFFER_HPP
@@ -0,0 +1,115 @@
+#ifndef RENDERINGX_GLWORKQUEUE_HPP
+#define RENDERINGX_GLWORKQUEUE_HPP
+
+#include <AndroidLogger.hpp>
+#include <DurationHistogram.hpp>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+// Texture loads, mesh uploads and other OpenGL work can take tens of milliseconds.
+// Instead of doing them wherever the caller happens to be, any thread can post them into this queue
+// and the OpenGL thread executes them at a point where the frame has some slack (see VrCompositorRenderer::executeGLWork),
+// but only as much as fits into a time budget.
+// The result (or exception) of the work is returned via std::future
+class GLWorkQueue{
+public:
+    explicit GLWorkQueue(std::string tag="GLWorkQueue"):TAG(std::move(tag)){}
+    GLWorkQueue(const GLWorkQueue&)=delete;
+    // Can be called from any thread. The work is executed on the OpenGL thread with the next call to drain()
+    // Do not wait for the returned future on the OpenGL thread itself, this would dead lock
+    template<class F>
+    auto post(F&& work)->std::future<decltype(work())>{
+        using R=decltype(work());
+        // std::function needs to be copyable, std::packaged_task is not
+        auto task=std::make_shared<std::packaged_task<R()>>(std::forward<F>(work));
+        std::future<R> future=task->get_future();
+        std::lock_guard<std::mutex> lock(mMutex);
+        queue.emplace_back([task](){(*task)();});
+        maxQueueDepth=std::max(maxQueueDepth,queue.size());
+        return future;
+    }
+    /**
+     * Execute queued work on the OpenGL thread until either the queue is empty or the budget is used up.
+     * At least one item is executed (if there is one) to guarantee progress, even if it alone exceeds the budget.
+     * Work posted during drain() is executed with the next call
+     * @return the n of executed items
+     */
+    int drain(const std::chrono::steady_clock::duration budget){
+        const auto start=std::chrono::steady_clock::now();
+        size_t nItems;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            nItems=queue.size();
+        }
+        int nExecuted=0;
+        for(size_t i=0;i<nItems;i++){
+            std::function<void()> work;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                work=std::move(queue.front());
+                queue.pop_front();
+            }
+            work();
+            nExecuted++;
+            if(std::chrono::steady_clock::now()-start>=budget){
+                break;
+            }
+        }
+        if(nExecuted==0)return 0;
+        const auto elapsed=std::chrono::steady_clock::now()-start;
+        std::lock_guard<std::mutex> lock(mMutex);
+        nExecutedTotal+=nExecuted;
+        drainTime.add(elapsed);
+        if(elapsed>budget){
+            nBudgetOverruns++;
+        }
+        if(start-lastLog>std::chrono::seconds(5)){
+            lastLog=start;
+            MLOGD2(TAG.c_str())<<getStatsReadableLocked();
+        }
+        return nExecuted;
+    }
+    // Execute everything, e.g. at initialization when there is no frame budget yet
+    int drainAll(){
+        return drain(std::chrono::steady_clock::duration::max());
+    }
+    struct Stats{
+        size_t currentQueueDepth;
+        size_t maxQueueDepth;
+        uint64_t nExecuted;
+        // drain() calls that exceeded their budget
+        uint64_t nBudgetOverruns;
+    };
+    Stats getStats(){
+        std::lock_guard<std::mutex> lock(mMutex);
+        return {queue.size(),maxQueueDepth,nExecutedTotal,nBudgetOverruns};
+    }
+    std::string getStatsReadable(){
+        std::lock_guard<std::mutex> lock(mMutex);
+        return getStatsReadableLocked();
+    }
+private:
+    const std::string TAG;
+    std::mutex mMutex;
+    std::deque<std::function<void()>> queue;
+    size_t maxQueueDepth=0;
+    uint64_t nExecutedTotal=0;
+    uint64_t nBudgetOverruns=0;
+    // Time spent per drain() call that executed at least one item
+    DurationHistogram<> drainTime{std::chrono::microseconds(250)};
+    std::chrono::steady_clock::time_point lastLog=std::chrono::steady_clock::now();
+    std::string getStatsReadableLocked()const{
+        std::stringstream ss;
+        ss<<"Queue depth "<<queue.size()<<" max "<<maxQueueDepth<<" executed "<<nExecutedTotal
+          <<" budget overruns "<<nBudgetOverruns<<"\nDrain time "<<drainTime.getPercentilesReadable();
+        return ss.str();
+    }
+};
+
+#endif //RENDERINGX_GLWORKQUEUE_HPP
@@ -0,0 +1,296 @@
+#ifndef RENDERINGX_MESHARENA_HPP
+#define RENDERINGX_MESHARENA_HPP
+
+#include <GLES2/gl2.h>
+#include <GLHelper.hpp>
+#include <GLMeshBuffer.hpp>
+#include <GLState.hpp>
+#include <AndroidLogger.hpp>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Instead of one vertex and one index buffer per mesh (AGLMeshBuffer), many small meshes with the same vertex format are
+// packed into a few large 'pages' (one vertex and one index buffer each). Space inside a page is managed with a first-fit free list.
+// Meshes on the same page share the vertex buffer binding, and the n of OpenGL buffer objects stays small.
+// OpenGL ES 2.0 has no base vertex for glDrawElements - indices are therefore stored rebased (index + first vertex of the mesh),
+// which limits the vertices per page to what INDEX can address. A CPU copy of each mesh is kept such that
+// the arena can be compacted (and the indices rebased again) without reading back from the GPU.
+// Call everything on the OpenGL thread.
+template<class VERTEX,class INDEX=GLushort>
+class MeshArena{
+public:
+    using MeshId=int;
+    static constexpr MeshId INVALID_MESH=-1;
+    static constexpr std::size_t MAX_VERTICES_PER_PAGE=(std::size_t)std::numeric_limits<INDEX>::max()+1;
+    // Where a mesh is located inside the arena
+    struct Location{
+        int page=-1;
+        GLint firstVertex=0;
+        GLsizei nVertices=0;
+        GLint firstIndex=0;
+        // 0 if the mesh has no indices
+        GLsizei nIndices=0;
+        GLenum mode=GL_TRIANGLES;
+    };
+    struct Stats{
+        int nPages=0;
+        int nMeshes=0;
+        std::size_t usedVertices=0;
+        std::size_t capacityVertices=0;
+        std::size_t usedIndices=0;
+        std::size_t capacityIndices=0;
+        std::size_t largestFreeVertexBlock=0;
+        // 0 == all free vertex space is one contiguous block, close to 1 == the free space is split into many small blocks
+        float vertexFragmentation=0;
+        std::string toString()const{
+            std::stringstream ss;
+            ss<<"Pages "<<nPages<<" meshes "<<nMeshes<<" vertices "<<usedVertices<<"/"<<capacityVertices
+              <<" indices "<<usedIndices<<"/"<<capacityIndices<<" fragmentation "<<vertexFragmentation;
+            return ss.str();
+        }
+    };
+    explicit MeshArena(std::size_t verticesPerPage=16*1024,std::size_t indicesPerPage=32*1024,std::string tag="MeshArena"):
+            VERTICES_PER_PAGE(std::min(verticesPerPage,MAX_VERTICES_PER_PAGE)),INDICES_PER_PAGE(indicesPerPage),TAG(std::move(tag)){}
+    MeshArena(const MeshArena&)=delete;
+    // Returns INVALID_MESH if the mesh cannot be stored (e.g. more vertices than INDEX can address)
+    template<class MESH_INDEX>
+    MeshId add(const AMeshData<VERTEX,MESH_INDEX>& meshData){
+        Mesh mesh;
+        mesh.vertices=meshData.vertices;
+        mesh.mode=meshData.mode;
+        if(mesh.vertices.size()>MAX_VERTICES_PER_PAGE){
+            MLOGE2(TAG.c_str())<<"Mesh has too many vertices "<<mesh.vertices.size();
+            return INVALID_MESH;
+        }
+        if(meshData.hasIndices()){
+            mesh.indices.reserve(meshData.indices->size());
+            for(const auto index:*meshData.indices){
+                if((std::size_t)index>=mesh.vertices.size()){
+                    MLOGE2(TAG.c_str())<<"Index out of range "<<index;
+                    return INVALID_MESH;
+                }
+                mesh.indices.push_back((INDEX)index);
+            }
+        }
+        place(mesh);
+        MeshId id;
+        if(!freeIds.empty()){
+            id=freeIds.back();
+            freeIds.pop_back();
+            meshes[id]=std::move(mesh);
+        }else{
+            id=(MeshId)meshes.size();
+            meshes.push_back(std::move(mesh));
+        }
+        return id;
+    }
+    // The space of the mesh is re-used by the next meshes that fit into it
+    void remove(const MeshId id){
+        Mesh& mesh=meshes.at(id);
+        if(!mesh.alive)return;
+        Page& page=pages[mesh.location.page];
+        page.freeVertices.free(mesh.location.firstVertex,mesh.location.nVertices);
+        if(mesh.location.nIndices>0)page.freeIndices.free(mesh.location.firstIndex,mesh.location.nIndices);
+        page.nMeshes--;
+        mesh=Mesh();
+        freeIds.push_back(id);
+    }
+    // Re-packs all meshes into as few pages as possible. The MeshIds stay valid, the Locations change
+    void compact(){
+        deleteGL();
+        // Place the large meshes first, such that the small ones fill the gaps
+        std::vector<MeshId> order;
+        for(MeshId i=0;i<(MeshId)meshes.size();i++){
+            if(meshes[i].alive)order.push_back(i);
+        }
+        std::sort(order.begin(),order.end(),[this](MeshId a,MeshId b){
+            return meshes[a].vertices.size()>meshes[b].vertices.size();
+        });
+        for(const MeshId id:order){
+            place(meshes[id]);
+        }
+        MLOGD2(TAG.c_str())<<"Compacted "<<getStats().toString();
+    }
+    const Location& getLocation(const MeshId id)const{
+        return meshes.at(id).location;
+    }
+    // Set up the vertex attribute pointers of the program for this buffer before calling draw()
+    GLuint getVertexBufferId(const MeshId id)const{
+        return pages[meshes.at(id).location.page].vertexBuffer;
+    }
+    // Issues the draw call. Meshes on the same page (same getVertexBufferId()) can be drawn without re-binding the vertex buffer
+    void draw(const MeshId id)const{
+        const Location& location=meshes.at(id).location;
+        if(location.nIndices>0){
+            GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER,pages[location.page].indexBuffer);
+            GLInstrumentation::drawElements(location.mode,location.nIndices,IndicesHelper::GLIndexType<INDEX>::value,(GLvoid*)(location.firstIndex*sizeof(INDEX)));
+        }else{
+            GLInstrumentation::drawArrays(location.mode,location.firstVertex,location.nVertices);
+        }
+    }
+    Stats getStats()const{
+        Stats stats;
+        stats.nPages=(int)pages.size();
+        std::size_t freeVertices=0;
+        for(const Page& page:pages){
+            stats.nMeshes+=page.nMeshes;
+            stats.capacityVertices+=page.vertexCapacity;
+            stats.capacityIndices+=page.indexCapacity;
+            stats.usedVertices+=page.vertexCapacity-page.freeVertices.total();
+            stats.usedIndices+=page.indexCapacity-page.freeIndices.total();
+            freeVertices+=page.freeVertices.total();
+            stats.largestFreeVertexBlock=std::max(stats.largestFreeVertexBlock,page.freeVertices.largest());
+        }
+        if(freeVertices>0){
+            stats.vertexFragmentation=1.0f-(float)stats.largestFreeVertexBlock/freeVertices;
+        }
+        return stats;
+    }
+    // Deletes the OpenGL buffers, the CPU copy of the meshes is kept
+    void deleteGL(){
+        for(Page& page:pages){
+            GLState::deleteBuffers(1,&page.vertexBuffer);
+            GLState::deleteBuffers(1,&page.indexBuffer);
+        }
+        pages.clear();
+    }
+private:
+    const std::size_t VERTICES_PER_PAGE;
+    const std::size_t INDICES_PER_PAGE;
+    const std::string TAG;
+    // Sorted by offset, adjacent blocks are merged
+    class FreeList{
+    private:
+        struct Block{
+            std::size_t offset;
+            std::size_t size;
+        };
+        std::vector<Block> blocks;
+    public:
+        explicit FreeList(std::size_t size){
+            if(size>0)blocks.push_back({0,size});
+        }
+        // First fit
+        std::optional<std::size_t> allocate(const std::size_t size){
+            for(auto it=blocks.begin();it!=blocks.end();++it){
+                if(it->size<size)continue;
+                const std::size_t offset=it->offset;
+                it->offset+=size;
+                it->size-=size;
+                if(it->size==0)blocks.erase(it);
+                return offset;
+            }
+            return std::nullopt;
+        }
+        void free(const std::size_t offset,const std::size_t size){
+            auto it=std::lower_bound(blocks.begin(),blocks.end(),offset,[](const Block& block,std::size_t offset){
+                return block.offset<offset;
+            });
+            it=blocks.insert(it,{offset,size});
+            // merge with the next block
+            if(it+1!=blocks.end() && it->offset+it->size==(it+1)->offset){
+                it->size+=(it+1)->size;
+                blocks.erase(it+1);
+            }
+            // merge with the previous block
+            if(it!=blocks.begin() && (it-1)->offset+(it-1)->size==it->offset){
+                (it-1)->size+=it->size;
+                blocks.erase(it);
+            }
+        }
+        std::size_t total()const{
+            std::size_t ret=0;
+            for(const auto& block:blocks)ret+=block.size;
+            return ret;
+        }
+        std::size_t largest()const{
+            std::size_t ret=0;
+            for(const auto& block:blocks)ret=std::max(ret,block.size);
+            return ret;
+        }
+    };
+    struct Page{
+        GLuint vertexBuffer=0;
+        GLuint indexBuffer=0;
+        std::size_t vertexCapacity;
+        std::size_t indexCapacity;
+        FreeList freeVertices;
+        FreeList freeIndices;
+        int nMeshes=0;
+        Page(std::size_t vertexCapacity,std::size_t indexCapacity):vertexCapacity(vertexCapacity),indexCapacity(indexCapacity),
+        freeVertices(vertexCapacity),freeIndices(indexCapacity){}
+    };
+    struct Mesh{
+        bool alive=false;
+        Location location;
+        GLenum mode=GL_TRIANGLES;
+        // CPU copy, indices are not rebased
+        std::vector<VERTEX> vertices;
+        std::vector<INDEX> indices;
+    };
+    std::vector<Page> pages;
+    // indexed by MeshId
+    std::vector<Mesh> meshes;
+    std::vector<MeshId> freeIds;
+    // Allocates space for the mesh (on an existing or a new page) and uploads it
+    void place(Mesh& mesh){
+        const std::size_t nVertices=mesh.vertices.size();
+        const std::size_t nIndices=mesh.indices.size();
+        int pageIdx=-1;
+        std::size_t firstVertex=0,firstIndex=0;
+        for(int i=0;i<(int)pages.size() && pageIdx<0;i++){
+            Page& page=pages[i];
+            if(page.freeVertices.largest()<nVertices || page.freeIndices.largest()<nIndices)continue;
+            firstVertex=*page.freeVertices.allocate(nVertices);
+            if(nIndices>0)firstIndex=*page.freeIndices.allocate(nIndices);
+            pageIdx=i;
+        }
+        if(pageIdx<0){
+            // Meshes larger than a page get a page of their own
+            pages.emplace_back(std::max(VERTICES_PER_PAGE,nVertices),std::max(INDICES_PER_PAGE,nIndices));
+            pageIdx=(int)pages.size()-1;
+            Page& page=pages.back();
+            glGenBuffers(1,&page.vertexBuffer);
+            GLState::bindBuffer(GL_ARRAY_BUFFER,page.vertexBuffer);
+            GLInstrumentation::bufferData(GL_ARRAY_BUFFER,page.vertexCapacity*sizeof(VERTEX),nullptr,GL_STATIC_DRAW);
+            GLState::bindBuffer(GL_ARRAY_BUFFER,0);
+            glGenBuffers(1,&page.indexBuffer);
+            GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER,page.indexBuffer);
+            GLInstrumentation::bufferData(GL_ELEMENT_ARRAY_BUFFER,page.indexCapacity*sizeof(INDEX),nullptr,GL_STATIC_DRAW);
+            GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
+            firstVertex=*page.freeVertices.allocate(nVertices);
+            if(nIndices>0)firstIndex=*page.freeIndices.allocate(nIndices);
+        }
+        Page& page=pages[pageIdx];
+        page.nMeshes++;
+        if(nVertices>0){
+            GLState::bindBuffer(GL_ARRAY_BUFFER,page.vertexBuffer);
+            GLInstrumentation::bufferSubData(GL_ARRAY_BUFFER,firstVertex*sizeof(VERTEX),nVertices*sizeof(VERTEX),mesh.vertices.data());
+            GLState::bindBuffer(GL_ARRAY_BUFFER,0);
+        }
+        if(nIndices>0){
+            std::vector<INDEX> rebased(nIndices);
+            for(std::size_t i=0;i<nIndices;i++){
+                rebased[i]=(INDEX)(mesh.indices[i]+firstVertex);
+            }
+            GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER,page.indexBuffer);
+            GLInstrumentation::bufferSubData(GL_ELEMENT_ARRAY_BUFFER,firstIndex*sizeof(INDEX),nIndices*sizeof(INDEX),rebased.data());
+            GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
+        }
+        mesh.alive=true;
+        mesh.location.page=pageIdx;
+        mesh.location.firstVertex=(GLint)firstVertex;
+        mesh.location.nVertices=(GLsizei)nVertices;
+        mesh.location.firstIndex=(GLint)firstIndex;
+        mesh.location.nIndices=(GLsizei)nIndices;
+        mesh.location.mode=mesh.mode;
+        GLHelper::checkGlError("MeshArena::place");
+    }
+};
+
+#endif //RENDERINGX_MESHARENA_HPP
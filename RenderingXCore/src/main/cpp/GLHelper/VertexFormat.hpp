@@ -0,0 +1,134 @@
+#ifndef RENDERINGX_VERTEXFORMAT_HPP
+#define RENDERINGX_VERTEXFORMAT_HPP
+
+#include <GLES2/gl2.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+
+// Conversion between 32 bit floats and the compact representations used by compact vertex formats:
+// Half floats (positions), normalized unsigned shorts (texture coordinates in [0,1]) and octahedral encoded normals (2 normalized shorts).
+// Converting a mesh reports the error introduced by the compact representation, such that the caller can decide to keep the float data.
+namespace VertexFormat{
+    // IEEE 754 binary16, 1 sign 5 exponent 10 mantissa bits
+    using Half=uint16_t;
+    static constexpr float HALF_MAX=65504.0f;
+    // Round to nearest. Values larger than HALF_MAX become +-infinity, denormals are flushed to zero
+    static Half floatToHalf(const float value){
+        uint32_t bits;
+        std::memcpy(&bits,&value,sizeof(float));
+        const uint32_t sign=(bits>>16) & 0x8000u;
+        const uint32_t absBits=bits & 0x7FFFFFFFu;
+        // NaN
+        if(absBits>0x7F800000u)return (Half)(sign | 0x7E00u);
+        // Overflow, rounds up to infinity
+        if(absBits>=0x477FF000u)return (Half)(sign | 0x7C00u);
+        // Too small for a normalized half
+        if(absBits<0x38800000u)return (Half)sign;
+        // Re-bias the exponent and round the mantissa (carry into the exponent is intended)
+        const uint32_t rounded=absBits+0x00000FFFu+((absBits>>13) & 1u);
+        return (Half)(sign | ((rounded-0x38000000u)>>13));
+    }
+    static float halfToFloat(const Half value){
+        const uint32_t sign=(uint32_t)(value & 0x8000u)<<16;
+        const uint32_t exponent=(value>>10) & 0x1Fu;
+        const uint32_t mantissa=value & 0x3FFu;
+        if(exponent==0){
+            // zero or denormal
+            const float ret=std::ldexp((float)mantissa,-24);
+            return sign ? -ret : ret;
+        }
+        uint32_t bits;
+        if(exponent==0x1F){
+            bits=sign | 0x7F800000u | mantissa<<13;
+        }else{
+            bits=sign | (exponent+112u)<<23 | mantissa<<13;
+        }
+        float ret;
+        std::memcpy(&ret,&bits,sizeof(float));
+        return ret;
+    }
+    // Maps [0,1] to [0,65535], values outside [0,1] are clamped
+    static GLushort floatToUnorm16(const float value){
+        return (GLushort)std::lround(std::clamp(value,0.0f,1.0f)*65535.0f);
+    }
+    static float unorm16ToFloat(const GLushort value){
+        return value/65535.0f;
+    }
+    // Maps [-1,1] to [-32767,32767], values outside [-1,1] are clamped
+    static GLshort floatToSnorm16(const float value){
+        return (GLshort)std::lround(std::clamp(value,-1.0f,1.0f)*32767.0f);
+    }
+    static float snorm16ToFloat(const GLshort value){
+        return std::max(value/32767.0f,-1.0f);
+    }
+    // Unit vector to 2 normalized shorts. Error < 0.0001 rad, compared to 12 bytes for 3 floats.
+    // See "A Survey of Efficient Representations for Independent Unit Vectors" (Cigolle et al.)
+    static std::array<GLshort,2> encodeOctahedral(const glm::vec3& normal){
+        glm::vec2 p=glm::vec2(normal.x,normal.y)*(1.0f/(std::abs(normal.x)+std::abs(normal.y)+std::abs(normal.z)));
+        if(normal.z<0){
+            const glm::vec2 signNotZero(p.x>=0 ? 1.0f : -1.0f,p.y>=0 ? 1.0f : -1.0f);
+            p=(1.0f-glm::abs(glm::vec2(p.y,p.x)))*signNotZero;
+        }
+        return {floatToSnorm16(p.x),floatToSnorm16(p.y)};
+    }
+    // Same as the decoding in a vertex shader (normalized GL_SHORT attribute)
+    static glm::vec3 decodeOctahedral(const std::array<GLshort,2>& encoded){
+        const glm::vec2 p(snorm16ToFloat(encoded[0]),snorm16ToFloat(encoded[1]));
+        glm::vec3 n(p.x,p.y,1.0f-std::abs(p.x)-std::abs(p.y));
+        if(n.z<0){
+            const glm::vec2 signNotZero(n.x>=0 ? 1.0f : -1.0f,n.y>=0 ? 1.0f : -1.0f);
+            const glm::vec2 xy=(1.0f-glm::abs(glm::vec2(n.y,n.x)))*signNotZero;
+            n.x=xy.x;
+            n.y=xy.y;
+        }
+        return glm::normalize(n);
+    }
+    // The maximum error introduced by converting a mesh, measured by decoding each converted value again
+    struct ConversionError{
+        // In object space units
+        float maxPositionError=0;
+        // In texture coordinate units (the texture is [0,1])
+        float maxUvError=0;
+        // In radians
+        float maxNormalError=0;
+        // Values that were clamped (e.g. uv outside [0,1] or positions larger than HALF_MAX)
+        int nClamped=0;
+        void addPosition(const float original,const Half converted){
+            const float decoded=halfToFloat(converted);
+            if(std::isinf(decoded)){
+                nClamped++;
+                maxPositionError=std::numeric_limits<float>::infinity();
+                return;
+            }
+            maxPositionError=std::max(maxPositionError,std::abs(decoded-original));
+        }
+        void addUv(const float original,const GLushort converted){
+            if(original<0.0f || original>1.0f)nClamped++;
+            maxUvError=std::max(maxUvError,std::abs(unorm16ToFloat(converted)-original));
+        }
+        void addNormal(const glm::vec3& original,const std::array<GLshort,2>& converted){
+            // atan2 instead of acos(dot), which is not precise enough for small angles
+            const glm::vec3 a=glm::normalize(original);
+            const glm::vec3 b=decodeOctahedral(converted);
+            maxNormalError=std::max(maxNormalError,std::atan2(glm::length(glm::cross(a,b)),glm::dot(a,b)));
+        }
+        // True if the compact mesh can be used instead of the float one
+        bool isAcceptable(const float maxPositionErrorAllowed,const float maxUvErrorAllowed=1.0f/4096.0f)const{
+            return nClamped==0 && maxPositionError<=maxPositionErrorAllowed && maxUvError<=maxUvErrorAllowed;
+        }
+        std::string toString()const{
+            std::stringstream ss;
+            ss<<"ConversionError position "<<maxPositionError<<" uv "<<maxUvError<<" normal "<<maxNormalError<<" clamped "<<nClamped;
+            return ss.str();
+        }
+    };
+}
+
+#endif //RENDERINGX_VERTEXFORMAT_HPP
@@ -8,6 +8,7 @@
 #include <GLES2/gl2.h>
 #include <AndroidLogger.hpp>
 #include <GLHelper.hpp>
+#include <GLState.hpp>
 
 class VrRenderBuffer{
 public:
@@ -20,13 +21,13 @@ public:
         GLHelper::checkGlError("createVrRenderbuffer1");
         // Create render texture.
         glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
+        GLState::bindTexture(GL_TEXTURE_2D, texture);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         //  GL_RGBA8_OES
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, W,H, 0,
+        GLInstrumentation::texImage2D(GL_TEXTURE_2D, 0, GL_RGBA, W,H, 0,
                      GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
         // Create render target.
         glGenFramebuffers(1, &framebuffer);
@@ -44,7 +45,7 @@ public:
     // Also sets scissor and viewport appropriately
     void bind(){
         glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-        glScissor(0,0,WIDTH_PX,HEIGH_PX);
+        GLState::scissor(0,0,WIDTH_PX,HEIGH_PX);
         glViewport(0,0,WIDTH_PX,HEIGH_PX);
     }
     // Flush to ensure synchronisation
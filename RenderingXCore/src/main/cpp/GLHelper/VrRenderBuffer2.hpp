@@ -10,6 +10,7 @@
 #include <GLHelper.hpp>
 #include <Extensions.h>
 #include <FramebufferTexture.hpp>
+#include <mutex>
 
 // Double buffered
 class VrRenderBuffer2{
@@ -33,8 +34,10 @@ public:
         AGLProgramTexture::loadTexture(defaultTexture, env, androidContext, defaultTextureUrl->c_str());
     }
 
-    void initializeGL(){
+    // @param config: format, depth/stencil and MSAA of the framebuffers
+    void initializeGL(const FramebufferTexture::Config& config={}){
         for(FramebufferTexture& buffer:buffers){
+            buffer.setConfig(config);
             buffer.initializeGL();
         }
     }
@@ -71,7 +74,8 @@ public:
         }
         return buffers[currentSampleBufferIdx].texture;
     }
-    GLuint getLatestRenderedTexture(bool& isNewFrame,FramebufferTexture::TimingInformation& timingInformation){
+    // uvScale: see FramebufferTexture::Config::useCapacity
+    GLuint getLatestRenderedTexture(bool& isNewFrame,FramebufferTexture::TimingInformation& timingInformation,std::array<float,2>* uvScale=nullptr){
         if(defaultTextureUrl!=std::nullopt){
             return defaultTexture;
         }
@@ -81,9 +85,21 @@ public:
             newFrameAvailable=false;
         }
         timingInformation=buffers[currentSampleBufferIdx].timingInformation;
+        if(uvScale!=nullptr){
+            *uvScale=buffers[currentSampleBufferIdx].contentUvScale;
+        }
         return buffers[currentSampleBufferIdx].texture;
     }
 
+    // Same as above, but does not consume the new frame
+    bool isNewFrameAvailable(){
+        if(defaultTextureUrl!=std::nullopt){
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        return newFrameAvailable;
+    }
+
     static int incrementAndModulo(int value){
         value++;
         value=value % 2;
@@ -10,34 +10,145 @@
 #include <GLHelper.hpp>
 #include <Extensions.h>
 #include <FramebufferTexture.hpp>
+#include <DurationHistogram.hpp>
+#include <AllocationCounter.h>
+#include <array>
+#include <atomic>
+#include <optional>
+#include <string>
 
-using CLOCK=std::chrono::steady_clock;
-struct TimingInformation{
-    CLOCK::time_point startSubmitCommands;
-    CLOCK::time_point stopSubmitCommands;
-    CLOCK::time_point gpuFinishedRendering;
-};
-
-struct Frame{
-    const FramebufferTexture& renderBuffer;
-    TimingInformation timingInformation;
-};
-
-
+// Triple buffered, for rendering (e.g. UI) on a secondary (shared) OpenGL context while the compositor samples the latest frame.
+// Producer (secondary context): bind() -> render -> unbindAndSwap()
+// Consumer (compositor): getLatestRenderedTexture()
+// One buffer is owned by the producer (write), one by the consumer (read) and one is in between (middle).
+// Ownership changes with an atomic exchange of the middle index instead of a mutex, and
+// instead of glFinish() the producer publishes a fence with each frame. The consumer only takes a frame once its fence
+// is signaled, so it always samples the newest completed frame and the producer never waits for the consumer.
 class VrRenderBuffer3{
-private:
-    std::array<FramebufferTexture,3> buffers;
 public:
-   void acquireFrameForRendering(){
-
-   }
-   void submitFrameAfterRendering(){
-
-   }
-   void getLatestRenderedFrame(){
-
-   }
+    explicit VrRenderBuffer3(std::string tag="VrRenderBuffer3"):TAG(std::move(tag)){}
+    VrRenderBuffer3(const VrRenderBuffer3&)=delete;
+    ~VrRenderBuffer3(){
+        for(auto& slot:slots){
+            const EGLSyncKHR sync=slot.readyFence.load();
+            if(sync!=EGL_NO_SYNC_KHR)Extensions::eglDestroySyncKHR(eglDisplay,sync);
+        }
+    }
+    // Call on the producer context
+    // @param config: format, depth/stencil and MSAA of the framebuffers
+    void initializeGL(const FramebufferTexture::Config& config={}){
+        eglDisplay=eglGetCurrentDisplay();
+        for(auto& slot:slots){
+            slot.buffer.setConfig(config);
+            slot.buffer.initializeGL();
+        }
+    }
+    // Call on the producer context
+    void setSize(int W,int H){
+        for(auto& slot:slots){
+            slot.buffer.setSize(W,H);
+        }
+    }
+    // Producer: bind the framebuffer of the write buffer
+    void bind(){
+        Slot& slot=slots[writeIdx];
+        // The consumer might have sampled this buffer just before it was given back
+        if(slot.releaseFence){
+            const auto before=std::chrono::steady_clock::now();
+            slot.releaseFence->wait(std::chrono::milliseconds(100));
+            producerStall.add(std::chrono::steady_clock::now()-before);
+            slot.releaseFence.reset();
+        }
+        slot.buffer.bind();
+    }
+    // Producer: publish the frame rendered since bind() without waiting for the GPU
+    void unbindAndSwap(){
+        Slot& slot=slots[writeIdx];
+        slot.buffer.invalidateDepthStencil();
+        slot.buffer.timingInformation.stopSubmitCommands=std::chrono::steady_clock::now();
+        const EGLSyncKHR oldFence=slot.readyFence.exchange(Extensions::eglCreateSyncKHR(eglDisplay,EGL_SYNC_FENCE_KHR,nullptr));
+        if(oldFence!=EGL_NO_SYNC_KHR)Extensions::eglDestroySyncKHR(eglDisplay,oldFence);
+        // The fence can only be signaled once the commands reach the GPU
+        glFlush();
+        // Publish the new frame. We get back either the frame the consumer gave back or a previous frame the consumer never took
+        writeIdx=middle.exchange(writeIdx | DIRTY) & INDEX_MASK;
+        logPeriodically(lastProducerLog,"Producer stall ",producerStall);
+    }
+    // Consumer: true if a frame newer than the one returned by the last getLatestRenderedTexture() call
+    // has been completed by the GPU
+    bool isNewFrameAvailable()const{
+        const uint8_t current=middle.load();
+        return (current & DIRTY) && isSignaled(slots[current & INDEX_MASK].readyFence.load());
+    }
+    // Consumer: returns the newest completed frame
+    // uvScale: see FramebufferTexture::Config::useCapacity
+    GLuint getLatestRenderedTexture(bool& isNewFrame,FramebufferTexture::TimingInformation& timingInformation,std::array<float,2>* uvScale=nullptr){
+        uint8_t current=middle.load();
+        // If the fence of the middle buffer is not signaled yet, keep the current one and try again next time.
+        // The producer might have exchanged the middle buffer in between, in this case the compare exchange fails
+        if((current & DIRTY) && isSignaled(slots[current & INDEX_MASK].readyFence.load())){
+            Slot& oldReadSlot=slots[readIdx];
+            // Sampling commands for the old read buffer have already been submitted
+            oldReadSlot.releaseFence.emplace();
+            if(middle.compare_exchange_strong(current,(uint8_t)readIdx)){
+                readIdx=current & INDEX_MASK;
+                Slot& slot=slots[readIdx];
+                const auto now=std::chrono::steady_clock::now();
+                slot.buffer.timingInformation.gpuFinishedRendering=now;
+                consumerLatency.add(now-slot.buffer.timingInformation.stopSubmitCommands);
+                isNewFrame=true;
+            }else{
+                oldReadSlot.releaseFence.reset();
+            }
+        }
+        logPeriodically(lastConsumerLog,"Consumer latency ",consumerLatency);
+        timingInformation=slots[readIdx].buffer.timingInformation;
+        if(uvScale!=nullptr){
+            *uvScale=slots[readIdx].buffer.contentUvScale;
+        }
+        return slots[readIdx].buffer.texture;
+    }
+private:
+    const std::string TAG;
+    EGLDisplay eglDisplay=EGL_NO_DISPLAY;
+    struct Slot{
+        FramebufferTexture buffer;
+        // Created by the producer when the frame is published. Since the consumer queries the fence of the middle buffer
+        // without owning it, the raw handle is used (instead of a FenceSync) and a stale handle only results in a failed compare exchange
+        std::atomic<EGLSyncKHR> readyFence{EGL_NO_SYNC_KHR};
+        // Created by the consumer when the buffer is given back, the producer waits for it before rendering into the buffer again
+        std::optional<FenceSync> releaseFence;
+    };
+    std::array<Slot,3> slots;
+    static constexpr uint8_t INDEX_MASK=0x3;
+    // Set if the middle buffer holds a frame the consumer did not take yet
+    static constexpr uint8_t DIRTY=0x4;
+    std::atomic<uint8_t> middle{1};
+    // Only accessed by the producer
+    int writeIdx=0;
+    DurationHistogram<> producerStall{std::chrono::microseconds(100)};
+    std::chrono::steady_clock::time_point lastProducerLog=std::chrono::steady_clock::now();
+    // Only accessed by the consumer
+    int readIdx=2;
+    // Time between the producer publishing a frame and the consumer taking it
+    DurationHistogram<> consumerLatency;
+    std::chrono::steady_clock::time_point lastConsumerLog=std::chrono::steady_clock::now();
+    bool isSignaled(const EGLSyncKHR sync)const{
+        if(sync==EGL_NO_SYNC_KHR)return false;
+        EGLint status=EGL_UNSIGNALED_KHR;
+        if(Extensions::eglGetSyncAttribKHR(eglDisplay,sync,EGL_SYNC_STATUS_KHR,&status)!=EGL_TRUE)return false;
+        return status==EGL_SIGNALED_KHR;
+    }
+    void logPeriodically(std::chrono::steady_clock::time_point& lastLog,const char* name,DurationHistogram<>& histogram)const{
+        const auto now=std::chrono::steady_clock::now();
+        if(now-lastLog>std::chrono::seconds(5)){
+            lastLog=now;
+            // Called from the render loop, but logging is allowed to allocate
+            const AllocationCounter::Exclude logging;
+            MLOGD2(TAG.c_str())<<name<<histogram.getPercentilesReadable();
+            histogram.reset();
+        }
+    }
 };
 
-
 #endif //RENDERINGX_VRRENDERBUFFER3_H
@@ -3,9 +3,11 @@
 //
 
 #include "GLProgramLine.h"
+#include "ProgramBinaryCache.h"
+#include <GLState.hpp>
 
 GLProgramLine::GLProgramLine(){
-    mProgram = GLHelper::createProgram(VS,FS);
+    mProgram = ProgramBinaryCache::createProgram(VS,FS);
     mMVMatrixHandle=GLHelper::GlGetUniformLocation(mProgram,"uMVMatrix");
     mPMatrixHandle=GLHelper::GlGetUniformLocation(mProgram,"uPMatrix");
     mPositionHandle =GLHelper::GlGetAttribLocation(mProgram, "aPosition");
@@ -16,9 +18,8 @@ GLProgramLine::GLProgramLine(){
     uEdge=GLHelper::GlGetUniformLocation(mProgram,"uEdge");
     uBorderEdge=GLHelper::GlGetUniformLocation(mProgram,"uBorderEdge");
     uOutlineStrength=GLHelper::GlGetUniformLocation(mProgram,"uOutlineStrength");
-    glUseProgram(mProgram);
+    GLState::useProgram(mProgram);
     setOtherUniforms();
-    glUseProgram(0);
     GLHelper::checkGlError("GLProgramLine())");
     // {0,1,2,
     //  0,2,3}; and so on
@@ -36,44 +37,38 @@ GLProgramLine::GLProgramLine(){
     mGLIndicesB.uploadGL(indices,GL_STATIC_DRAW);*/
 }
 
-void GLProgramLine::beforeDraw(GLuint buffer) const {
-    glUseProgram(mProgram);
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    glEnableVertexAttribArray(mPositionHandle);
-    glVertexAttribPointer(mPositionHandle, 2, GL_FLOAT, GL_FALSE,sizeof(Vertex), nullptr);
-    glEnableVertexAttribArray(mNormalHandle);
-    glVertexAttribPointer(mNormalHandle,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(GLvoid*)offsetof(Vertex,normalX));
-    glEnableVertexAttribArray(mLineWidthHandle);
-    glVertexAttribPointer(mLineWidthHandle,1,GL_FLOAT,GL_FALSE,sizeof(Vertex),(GLvoid*)offsetof(Vertex,lineW));
-    glEnableVertexAttribArray(mBaseColorHandle);
-    glVertexAttribPointer(mBaseColorHandle,4,GL_UNSIGNED_BYTE, GL_TRUE,sizeof(Vertex),(GLvoid*)offsetof(Vertex,baseColor));
-    glEnableVertexAttribArray(mOutlineColorHandle);
-    glVertexAttribPointer(mOutlineColorHandle,4,GL_UNSIGNED_BYTE, GL_TRUE,sizeof(Vertex),(GLvoid*)offsetof(Vertex,outlineColor));
+void GLProgramLine::beforeDraw(GLuint buffer,GLintptr byteOffset) const {
+    const GLInstrumentation::ScopedTag tag(GLInstrumentation::Subsystem::LINE);
+    GLState::useProgram(mProgram);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+    GLState::setVertexAttribArrays({(GLint)mPositionHandle,(GLint)mNormalHandle,(GLint)mLineWidthHandle,(GLint)mBaseColorHandle,(GLint)mOutlineColorHandle});
+    GLState::vertexAttribPointer(mPositionHandle, 2, GL_FLOAT, GL_FALSE,sizeof(Vertex), (GLvoid*)byteOffset);
+    GLState::vertexAttribPointer(mNormalHandle,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(GLvoid*)(byteOffset+offsetof(Vertex,normalX)));
+    GLState::vertexAttribPointer(mLineWidthHandle,1,GL_FLOAT,GL_FALSE,sizeof(Vertex),(GLvoid*)(byteOffset+offsetof(Vertex,lineW)));
+    GLState::vertexAttribPointer(mBaseColorHandle,4,GL_UNSIGNED_BYTE, GL_TRUE,sizeof(Vertex),(GLvoid*)(byteOffset+offsetof(Vertex,baseColor)));
+    GLState::vertexAttribPointer(mOutlineColorHandle,4,GL_UNSIGNED_BYTE, GL_TRUE,sizeof(Vertex),(GLvoid*)(byteOffset+offsetof(Vertex,outlineColor)));
     //
     //glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mGLIndicesB.getGLBufferId());
 }
 
 void GLProgramLine::setOtherUniforms(float outlineWidth,float edge, float borderEdge) const {
-    glUniform1f(uOutlineStrength,outlineWidth);
-    glUniform1f(uEdge,edge);
-    glUniform1f(uBorderEdge,borderEdge);
+    GLInstrumentation::uniform1f(uOutlineStrength,outlineWidth);
+    GLInstrumentation::uniform1f(uEdge,edge);
+    GLInstrumentation::uniform1f(uBorderEdge,borderEdge);
 }
 
 void GLProgramLine::draw(const glm::mat4x4 &ViewM, const glm::mat4x4 &ProjM, int verticesOffset,
                          int numberVertices) const {
+    const GLInstrumentation::ScopedTag tag(GLInstrumentation::Subsystem::LINE);
     //const auto mvp=ViewM*ProjM;
-    glUniformMatrix4fv(mMVMatrixHandle, 1, GL_FALSE, glm::value_ptr(ViewM));
-    glUniformMatrix4fv(mPMatrixHandle, 1, GL_FALSE, glm::value_ptr(ProjM));
-    glDrawArrays(GL_TRIANGLES, verticesOffset, numberVertices);
+    GLInstrumentation::uniformMatrix4fv(mMVMatrixHandle, 1, GL_FALSE, glm::value_ptr(ViewM));
+    GLInstrumentation::uniformMatrix4fv(mPMatrixHandle, 1, GL_FALSE, glm::value_ptr(ProjM));
+    GLInstrumentation::drawArrays(GL_TRIANGLES, verticesOffset, numberVertices);
     //glDrawElements(GL_TRIANGLES,numberVertices,GL_UNSIGNED_SHORT, (void*)(sizeof(INDEX_DATA)*verticesOffset));
 }
 
 void GLProgramLine::afterDraw() const {
-    glDisableVertexAttribArray(mPositionHandle);
-    glDisableVertexAttribArray(mNormalHandle);
-    glDisableVertexAttribArray(mLineWidthHandle);
-    glDisableVertexAttribArray(mBaseColorHandle);
-    glDisableVertexAttribArray(mOutlineColorHandle);
+    // The vertex attribute arrays stay enabled, the next beforeDraw() only changes what differs (see GLState)
     //distortionManager.afterDraw();
 }
 
@@ -154,6 +149,16 @@ GLProgramLine::makeLine(const glm::vec2 &start, const glm::vec2 &end, float line
     return ret;
 }
 
+GLStreamingBuffer::Allocation<GLProgramLine::Vertex>
+GLProgramLine::writeLine(GLStreamingBuffer& streamingBuffer,const glm::vec2 &start, const glm::vec2 &end, float lineWidth,
+                         TrueColor baseColor, TrueColor outlineColor) {
+    auto allocation=streamingBuffer.allocate<Vertex>(VERTICES_PER_LINE);
+    if(allocation.isValid()){
+        convertLineToRenderingData(start,end,lineWidth,allocation.data,0,baseColor,outlineColor);
+    }
+    return allocation;
+}
+
 std::vector<GLProgramLine::Vertex>
 GLProgramLine::makeHorizontalLine(const glm::vec2 start, float width, float lineHeight,
                                   TrueColor baseColor, TrueColor outlineColor) {
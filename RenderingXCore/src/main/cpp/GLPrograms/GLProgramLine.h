@@ -12,6 +12,7 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <TrueColor.hpp>
 #include <GLBuffer.hpp>
+#include <GLStreamingBuffer.hpp>
 
 /**
  * Drawing a line with OpenGL can be more complicated than it seems at first.
@@ -41,10 +42,14 @@ public:
     static constexpr const int VERTICES_PER_LINE=6; //2 quads
     static constexpr const int INDICES_PER_LINE=6;
     explicit GLProgramLine();
-    void beforeDraw(GLuint buffer) const;
+    // @param byteOffset: offset of the first vertex inside the buffer
+    void beforeDraw(GLuint buffer,GLintptr byteOffset=0) const;
     void beforeDraw(GLBuffer<Vertex>& buffer)const{
         beforeDraw(buffer.getGLBufferId());
     }
+    void beforeDraw(const GLStreamingBuffer::Allocation<Vertex>& allocation)const{
+        beforeDraw(allocation.buffer,allocation.byteOffset);
+    }
     void setOtherUniforms(float outlineWidth=0.4f,float edge=0.1f,float borderEdge=0.1f)const;
     void draw(const glm::mat4x4& ViewM, const glm::mat4x4& ProjM, int verticesOffset, int numberVertices) const;
     void afterDraw() const;
@@ -55,6 +60,9 @@ public:
     static void convertLineToRenderingData(const glm::vec2& start, const glm::vec2& end, float lineWidth,
                                            Vertex array[], int arrayOffset, TrueColor baseColor=TrueColor2::BLACK, TrueColor outlineColor=TrueColor2::WHITE);
     static void appendLineRenderingData(std::vector<GLProgramLine::Vertex>& data,const glm::vec2& start, const glm::vec2& end, float lineWidth,TrueColor baseColor=TrueColor2::BLACK, TrueColor outlineColor=TrueColor2::WHITE);
+    // same as above, but writes straight into the streaming buffer. Draw it with beforeDraw(allocation) and draw(...,0,allocation.count)
+    static GLStreamingBuffer::Allocation<Vertex> writeLine(GLStreamingBuffer& streamingBuffer,const glm::vec2& start, const glm::vec2& end, float lineWidth,
+                                                           TrueColor baseColor=TrueColor2::BLACK, TrueColor outlineColor=TrueColor2::WHITE);
 public:
     // same as above, but returns the data in a std::vector instead of writing into a c-style buffer
     static std::vector<GLProgramLine::Vertex> makeLine(const glm::vec2& start, const glm::vec2& end, float lineWidth,TrueColor baseColor=TrueColor2::BLACK, TrueColor outlineColor=TrueColor2::WHITE);
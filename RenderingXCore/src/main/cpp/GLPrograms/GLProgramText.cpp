@@ -1,4 +1,5 @@
 #include "GLProgramText.h"
+#include "ProgramBinaryCache.h"
 #include "TextAssetsHelper.hpp"
 #include <TrueColor.hpp>
 #include <NDKHelper.hpp>
@@ -6,6 +7,7 @@
 #include <android/asset_manager_jni.h>
 #include <vector>
 #include <GLHelper.hpp>
+#include <GLState.hpp>
 
 constexpr auto TAG="GLProgramText";
 
@@ -20,7 +22,7 @@ static float FONTS_WIDTHS_U[CHAR_CNT];
 //#define WIREFRAME
 
 GLProgramText::GLProgramText(){
-    mProgram = GLHelper::createProgram(VS(),FS2());
+    mProgram = ProgramBinaryCache::createProgram(VS(),FS2());
     uProjectionMatrix=GLHelper::GlGetUniformLocation(mProgram,"uProjectionMatrix");
     mPositionHandle = GLHelper::GlGetAttribLocation(mProgram, "aPosition");
     mTextureHandle = GLHelper::GlGetAttribLocation(mProgram, "aTexCoord");
@@ -49,62 +51,58 @@ GLProgramText::GLProgramText(){
     mGLIndicesB.uploadGL(indices,GL_STATIC_DRAW);
     //
     glGenTextures(1, &mTexture);
-    glUseProgram(mProgram);
+    GLState::useProgram(mProgram);
+    // The sampler never changes, uniforms are part of the program state
+    GLInstrumentation::uniform1i(mSamplerHandle,MY_SAMPLER_UNIT);
     updateOutline();
     setOtherUniforms();
-    glUseProgram(0);
     GLHelper::checkGlError(TAG);
 }
 
-void GLProgramText::beforeDraw(const GLuint buffer) const{
-    glUseProgram(mProgram);
-    glActiveTexture(MY_TEXTURE_UNIT);
-    glBindTexture(GL_TEXTURE_2D,mTexture);
-    glUniform1i(mSamplerHandle,MY_SAMPLER_UNIT);
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    glEnableVertexAttribArray(mPositionHandle);
+void GLProgramText::beforeDraw(const GLuint buffer,const GLintptr byteOffset) const{
+    const GLInstrumentation::ScopedTag tag(GLInstrumentation::Subsystem::TEXT);
+    GLState::useProgram(mProgram);
+    GLState::bindTexture(MY_TEXTURE_UNIT,GL_TEXTURE_2D,mTexture);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+    GLState::setVertexAttribArrays({(GLint)mPositionHandle,(GLint)mTextureHandle,(GLint)mColorHandle});
     // 2 vertices (x and y)
-    glVertexAttribPointer(mPositionHandle, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),nullptr);
-    glEnableVertexAttribArray(mTextureHandle);
+    GLState::vertexAttribPointer(mPositionHandle, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),(GLvoid*)byteOffset);
     // 2 u,v values
-    glVertexAttribPointer(mTextureHandle, 2/*uv*/,GL_FLOAT, GL_FALSE,sizeof(Vertex),(GLvoid*)offsetof(Vertex,u));
-    glEnableVertexAttribArray(mColorHandle);
+    GLState::vertexAttribPointer(mTextureHandle, 2/*uv*/,GL_FLOAT, GL_FALSE,sizeof(Vertex),(GLvoid*)(byteOffset+offsetof(Vertex,u)));
     // 4 rgba values (each of them 1 byte wide)
-    glVertexAttribPointer(mColorHandle,4/*r,g,b,a*/,GL_UNSIGNED_BYTE, GL_TRUE,sizeof(Vertex),(GLvoid*)offsetof(Vertex,color));
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mGLIndicesB.getGLBufferId());
+    GLState::vertexAttribPointer(mColorHandle,4/*r,g,b,a*/,GL_UNSIGNED_BYTE, GL_TRUE,sizeof(Vertex),(GLvoid*)(byteOffset+offsetof(Vertex,color)));
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mGLIndicesB.getGLBufferId());
 }
 
 void GLProgramText::setOtherUniforms(float edge, float borderEdge)const {
-    glUniform1f(uEdge,edge);
-    glUniform1f(uBorderEdge,borderEdge);
+    GLInstrumentation::uniform1f(uEdge,edge);
+    GLInstrumentation::uniform1f(uBorderEdge,borderEdge);
 }
 
 void GLProgramText::updateOutline(const glm::vec3 &outlineColor, const float outlineStrength) const{
-    glUniform3f(mOutlineColorHandle,outlineColor.r,outlineColor.g,outlineColor.b);
-    glUniform1f(mOutlineStrengthHandle,outlineStrength);
+    GLInstrumentation::uniform3f(mOutlineColorHandle,outlineColor.r,outlineColor.g,outlineColor.b);
+    GLInstrumentation::uniform1f(mOutlineStrengthHandle,outlineStrength);
 }
 
 void GLProgramText::draw(const glm::mat4x4& MVPMatrix, const int verticesOffset, const int numberIndices) const {
+    const GLInstrumentation::ScopedTag tag(GLInstrumentation::Subsystem::TEXT);
     if(verticesOffset+numberIndices>INDEX_BUFFER_SIZE){
         MLOGE<<"n vert:"<<numberIndices<<" n Indices:"<<verticesOffset;
     }
-    glUniformMatrix4fv(uProjectionMatrix, 1, GL_FALSE, glm::value_ptr(MVPMatrix));
+    GLInstrumentation::uniformMatrix4fv(uProjectionMatrix, 1, GL_FALSE, glm::value_ptr(MVPMatrix));
 #ifdef WIREFRAME
-    glUniform1f(mOverrideColorHandle,1.0f);
+    GLInstrumentation::uniform1f(mOverrideColorHandle,1.0f);
     glLineWidth(1);
-    glDrawElements(GL_LINES,numberIndices,GL_UNSIGNED_SHORT, (void*)(sizeof(INDEX_DATA)*verticesOffset));
-    glDrawElements(GL_POINTS,numberIndices,GL_UNSIGNED_SHORT, (void*)(sizeof(INDEX_DATA)*verticesOffset));
+    GLInstrumentation::drawElements(GL_LINES,numberIndices,GL_UNSIGNED_SHORT, (void*)(sizeof(INDEX_DATA)*verticesOffset));
+    GLInstrumentation::drawElements(GL_POINTS,numberIndices,GL_UNSIGNED_SHORT, (void*)(sizeof(INDEX_DATA)*verticesOffset));
 #else
-    glDrawElements(GL_TRIANGLES,numberIndices,GL_UNSIGNED_SHORT, (void*)(sizeof(INDEX_DATA)*verticesOffset));
+    GLInstrumentation::drawElements(GL_TRIANGLES,numberIndices,GL_UNSIGNED_SHORT, (void*)(sizeof(INDEX_DATA)*verticesOffset));
 #endif
 }
 
 
 void GLProgramText::afterDraw() const {
-    glDisableVertexAttribArray(mPositionHandle);
-    glDisableVertexAttribArray(mTextureHandle);
-    glBindTexture(GL_TEXTURE_2D,0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
+    // The vertex attribute arrays, the texture and the index buffer stay bound, the next beforeDraw() only changes what differs (see GLState)
     //distortionManager.afterDraw();
 }
 
@@ -178,6 +176,16 @@ GLProgramText::convertStringToRenderingData(float X, float Y,float charHeight,
     return ret;
 }
 
+GLStreamingBuffer::Allocation<GLProgramText::Character>
+GLProgramText::writeString(GLStreamingBuffer& streamingBuffer,float X, float Y, float charHeight,
+                           const std::wstring &text, TrueColor color) {
+    auto allocation=streamingBuffer.allocate<Character>(text.length());
+    if(allocation.isValid()){
+        convertStringToRenderingData(X,Y,charHeight,text,color,allocation.data,0);
+    }
+    return allocation;
+}
+
 void GLProgramText::appendString(std::vector<Character>& buff, float X, float Y,
                                  float charHeight, const std::wstring &text, TrueColor color) {
     const auto offset=buff.size();
@@ -197,8 +205,7 @@ float GLProgramText::getStringLength(const std::wstring s, const float charHeigh
 
 void  GLProgramText::loadTextRenderingData(JNIEnv *env, jobject androidContext,
                                            const TextAssetsHelper::TEXT_STYLE& textStyle)const {
-    glActiveTexture(MY_TEXTURE_UNIT);
-    glBindTexture(GL_TEXTURE_2D,mTexture);
+    GLState::bindTexture(MY_TEXTURE_UNIT,GL_TEXTURE_2D,mTexture);
     int maxTextureSize;
     glGetIntegerv(GL_MAX_TEXTURE_SIZE,&maxTextureSize);
 
@@ -227,7 +234,7 @@ void  GLProgramText::loadTextRenderingData(JNIEnv *env, jobject androidContext,
                     GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
                     GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState::bindTexture(GL_TEXTURE_2D, 0);
     GLHelper::checkGlError("loadTexture");
 }
 
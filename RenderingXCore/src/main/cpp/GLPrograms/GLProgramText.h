@@ -26,6 +26,8 @@
 #include "TextAssetsHelper.hpp"
 #include <TrueColor.hpp>
 #include "../GLHelper/GLBuffer.hpp"
+#include <GLStreamingBuffer.hpp>
+#include <GLState.hpp>
 
 class GLProgramText {
 private:
@@ -62,10 +64,14 @@ public:
 public:
     explicit GLProgramText();
     void loadTextRenderingData(JNIEnv *env, jobject androidContext,const TextAssetsHelper::TEXT_STYLE& textStyle)const;
-    void beforeDraw(GLuint buffer) const;
+    // @param byteOffset: offset of the first character inside the buffer
+    void beforeDraw(GLuint buffer,GLintptr byteOffset=0) const;
     void beforeDraw(GLBuffer<Character>& buffer)const{
         beforeDraw(buffer.getGLBufferId());
     }
+    void beforeDraw(const GLStreamingBuffer::Allocation<Character>& allocation)const{
+        beforeDraw(allocation.buffer,allocation.byteOffset);
+    }
     //Outline with: 0==no outline, 0.2==default outline size
     void updateOutline(const glm::vec3 &outlineColor=glm::vec3(1,1,1), float outlineStrength=0.2f)const;
     void setOtherUniforms(float edge=0.1f,float borderEdge=0.1f)const;
@@ -81,6 +87,10 @@ public:
     // same as above, but return a vector with the OpenGL data (more safe regarding pointers)
     static std::vector<Character> convertStringToRenderingData(float X, float Y, float charHeight,
                                             const std::wstring &text, TrueColor color);
+    // writes the rendering data straight into the streaming buffer (no intermediate std::vector)
+    // draw it with beforeDraw(allocation) and draw(...,0,allocation.count*INDICES_PER_CHARACTER)
+    static GLStreamingBuffer::Allocation<Character> writeString(GLStreamingBuffer& streamingBuffer,float X, float Y, float charHeight,
+                                            const std::wstring &text, TrueColor color);
     // increases the size of buff accordingly and
     // appends the rendering data at the current position
     static void appendString(std::vector<Character>& buff,float X, float Y,float charHeight, const std::wstring &text, TrueColor color);
@@ -98,9 +108,9 @@ public:
     static constexpr const wchar_t ICON_ARTIFICIAL_HORIZON=(wchar_t)ICONS_OFFSET+7;
     // We need specific blend mode(s) when rendering text
     static void setupDepthTestAndBlending(){
-        glDisable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GLState::disable(GL_DEPTH_TEST);
+        GLState::enable(GL_BLEND);
+        GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     }
 private:
     static const std::string VS(){
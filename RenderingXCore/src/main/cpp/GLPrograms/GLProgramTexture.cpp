@@ -3,7 +3,6 @@
 #include "GLProgramTexture.h"
 
 constexpr auto TAG="GLProgramTexture(Ext)";
-constexpr auto GL_TEXTURE_EXTERNAL_OES=0x00008d65;
 
 TexturedStereoMeshData TexturedStereoVertexHelper::convert(const TexturedMeshData &input) {
     std::vector<TexturedStereoVertex> vertices;
@@ -44,56 +43,70 @@ AGLProgramTexture::AGLProgramTexture(const bool USE_EXTERNAL_TEXTURE,const bool
         flags+="#define USE_2D_COORDINATES\n";
     }
     if(USE_EXTERNAL_TEXTURE)flags+="#define USE_EXTERNAL_TEXTURE\n";
-    mProgram = GLHelper::createProgram(VS(), FS(mapEquirectangularToInsta360), flags);
+    mPendingProgram=ProgramBinaryCache::issueProgram(VS(), FS(mapEquirectangularToInsta360), flags);
+}
+
+bool AGLProgramTexture::isProgramReady() const {
+    return !mPendingProgram.has_value() || ProgramBinaryCache::isProgramReady(*mPendingProgram);
+}
+
+void AGLProgramTexture::finishProgram() const {
+    if(!mPendingProgram.has_value())return;
+    mProgram=ProgramBinaryCache::finishProgram(*mPendingProgram);
+    mPendingProgram=std::nullopt;
     mMVMatrixHandle=GLHelper::GlGetUniformLocation(mProgram,"uMVMatrix");
     mPMatrixHandle=GLHelper::GlGetUniformLocation(mProgram,"uPMatrix");
     mPositionHandle = GLHelper::GlGetAttribLocation(mProgram, "aPosition");
     mTextureHandle = GLHelper::GlGetAttribLocation(mProgram, "aTexCoord");
     mSamplerHandle = GLHelper::GlGetUniformLocation (mProgram, "sTexture" );
+    // The sampler never changes, uniforms are part of the program state
+    GLState::useProgram(mProgram);
+    GLInstrumentation::uniform1i(mSamplerHandle,MY_SAMPLER_UNIT);
+    mTexCoordScaleHandle=GLHelper::GlGetUniformLocation(mProgram,"uTexCoordScale");
+    GLInstrumentation::uniform2f(mTexCoordScaleHandle,mTexCoordScale[0],mTexCoordScale[1]);
     if(ENABLE_VDDC){
         mUndistortionHandles=VDDC::getUndistortionUniformHandles(mProgram);
     }
     GLHelper::checkGlError(TAG);
 }
 
+void AGLProgramTexture::bindProgramAndTexture(GLuint texture) const {
+    finishProgram();
+    GLState::useProgram(mProgram);
+    GLState::bindTexture(MY_TEXTURE_UNIT,USE_EXTERNAL_TEXTURE ? GL_TEXTURE_EXTERNAL_OES : GL_TEXTURE_2D,texture);
+}
+
 void AGLProgramTexture::beforeDraw(const GLuint buffer, GLuint texture) const{
-    glUseProgram((GLuint)mProgram);
-    glActiveTexture(MY_TEXTURE_UNIT);
-    glBindTexture(USE_EXTERNAL_TEXTURE ? GL_TEXTURE_EXTERNAL_OES : GL_TEXTURE_2D,texture);
-    glUniform1i(mSamplerHandle,MY_SAMPLER_UNIT);
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    glEnableVertexAttribArray((GLuint)mPositionHandle);
-    glVertexAttribPointer((GLuint)mPositionHandle, 3/*xyz*/, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), nullptr);
-    glEnableVertexAttribArray((GLuint)mTextureHandle);
-    glVertexAttribPointer((GLuint)mTextureHandle, 2/*uv*/,GL_FLOAT, GL_FALSE,sizeof(TexturedVertex),(GLvoid*)offsetof(TexturedVertex,u));
+    beforeDraw<TexturedVertex>(buffer,texture,true);
     //MLOGD<<"LOL USE_EXTERNAL_TEXTURE "<<USE_EXTERNAL_TEXTURE<<"ENABLE_VDDC "<<ENABLE_VDDC<<" USE_2D_COORDINATES "<<USE_2D_COORDINATES;
 }
 
+void AGLProgramTexture::updateMatrices(const glm::mat4x4 &ViewM, const glm::mat4x4 &ProjM) const {
+    GLInstrumentation::uniformMatrix4fv(mMVMatrixHandle, 1, GL_FALSE, glm::value_ptr(ViewM));
+    GLInstrumentation::uniformMatrix4fv(mPMatrixHandle, 1, GL_FALSE, glm::value_ptr(ProjM));
+}
+
 void AGLProgramTexture::draw(const glm::mat4x4& ViewM, const glm::mat4x4& ProjM, const int verticesOffset, const int numberVertices, GLenum mode) const{
-    glUniformMatrix4fv(mMVMatrixHandle, 1, GL_FALSE, glm::value_ptr(ViewM));
-    glUniformMatrix4fv(mPMatrixHandle, 1, GL_FALSE, glm::value_ptr(ProjM));
-    glDrawArrays(mode, verticesOffset, numberVertices);
+    updateMatrices(ViewM,ProjM);
+    GLInstrumentation::drawArrays(mode, verticesOffset, numberVertices);
 
 }
 
 void AGLProgramTexture::drawIndexed(GLuint indexBuffer, const glm::mat4x4 &ViewM,
                                     const glm::mat4x4 &ProjM, int indicesOffset, int numberIndices,
-                                    GLenum mode) const {
-    glUniformMatrix4fv(mMVMatrixHandle, 1, GL_FALSE, glm::value_ptr(ViewM));
-    glUniformMatrix4fv(mPMatrixHandle, 1, GL_FALSE, glm::value_ptr(ProjM));
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-    glDrawElements(mode,numberIndices,GL_UNSIGNED_INT, (void*)(indicesOffset*sizeof(INDEX_DATA)));
+                                    GLenum mode, GLenum indexType) const {
+    updateMatrices(ViewM,ProjM);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    GLInstrumentation::drawElements(mode,numberIndices,indexType, (void*)(indicesOffset*IndicesHelper::getIndexTypeSize(indexType)));
 }
 
 void AGLProgramTexture::afterDraw() const{
-    glDisableVertexAttribArray((GLuint)mPositionHandle);
-    glDisableVertexAttribArray((GLuint)mTextureHandle);
-    glBindTexture(USE_EXTERNAL_TEXTURE ? GL_TEXTURE_EXTERNAL_OES : GL_TEXTURE_2D,0);
+    // The vertex attribute arrays and the texture stay bound, the next beforeDraw() only changes what differs (see GLState)
 }
 
 void AGLProgramTexture::loadTexture(GLuint texture, JNIEnv *env, jobject androidContext, const char *name) {
     //Load texture, generate mipmaps, set sampling parameters
-    glBindTexture(GL_TEXTURE_2D,texture);
+    GLState::bindTexture(GL_TEXTURE_2D,texture);
     NDKHelper::LoadPngFromAssetManager2(env,androidContext,GL_TEXTURE_2D,name);
     glHint(GL_GENERATE_MIPMAP_HINT,GL_NICEST);
     glGenerateMipmap(GL_TEXTURE_2D);
@@ -101,19 +114,21 @@ void AGLProgramTexture::loadTexture(GLuint texture, JNIEnv *env, jobject android
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState::bindTexture(GL_TEXTURE_2D, 0);
 }
 
 void AGLProgramTexture::drawX(GLuint texture, const glm::mat4x4 &ViewM, const glm::mat4x4 &ProjM,
                               const TexturedGLMeshBuffer &mesh)const {
-    mesh.logWarningWhenDrawingMeshWithoutData();
-    beforeDraw(mesh.getVertexBufferId(), texture);
-    if(mesh.hasIndices()){
-        drawIndexed(mesh.getIndexBufferId(), ViewM, ProjM, 0, mesh.getCount(), mesh.getMode());
-    }else{
-        draw(ViewM,ProjM,0,mesh.getCount(),mesh.getMode());
-    }
-    afterDraw();
+    drawX(texture,ViewM,ProjM,mesh,true);
+}
+
+void AGLProgramTexture::setTexCoordScale(const std::array<float,2>& scale) const {
+    if(scale==mTexCoordScale)return;
+    mTexCoordScale=scale;
+    // Else uploaded by finishProgram()
+    if(mPendingProgram.has_value())return;
+    GLState::useProgram(mProgram);
+    GLInstrumentation::uniform2f(mTexCoordScaleHandle,mTexCoordScale[0],mTexCoordScale[1]);
 }
 
 void AGLProgramTexture::updateUnDistortionUniforms(bool leftEye, const VDDC::DataUnDistortion &dataUnDistortion) const {
@@ -121,35 +136,16 @@ void AGLProgramTexture::updateUnDistortionUniforms(bool leftEye, const VDDC::Dat
         MLOGE<<"called GLProgramTexture::updateUnDistortion with VDDC disabled";
         return;
     }
-    glUseProgram(mProgram);
+    finishProgram();
+    GLState::useProgram(mProgram);
     VDDC::updateUnDistortionUniforms(leftEye, *mUndistortionHandles, dataUnDistortion);
     //MLOGD<<"GLPT"<<MLensDistortion::ViewportParamsNDCAsString(dataUnDistortion.screen_params[0],dataUnDistortion.texture_params[0]);
 }
 
 void AGLProgramTexture::beforeDrawStereoVertex(GLuint buffer, GLuint texture, bool useLeftTextureCoords) const {
-    glUseProgram((GLuint)mProgram);
-    glActiveTexture(MY_TEXTURE_UNIT);
-    glBindTexture(USE_EXTERNAL_TEXTURE ? GL_TEXTURE_EXTERNAL_OES : GL_TEXTURE_2D,texture);
-    glUniform1i(mSamplerHandle,MY_SAMPLER_UNIT);
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    glEnableVertexAttribArray((GLuint)mPositionHandle);
-    glVertexAttribPointer((GLuint)mPositionHandle, 3/*xyz*/, GL_FLOAT, GL_FALSE, sizeof(TexturedStereoVertex), nullptr);
-    glEnableVertexAttribArray((GLuint)mTextureHandle);
-    if(useLeftTextureCoords){
-        glVertexAttribPointer((GLuint)mTextureHandle, 2/*uv*/, GL_FLOAT, GL_FALSE, sizeof(TexturedStereoVertex), (GLvoid*)offsetof(TexturedStereoVertex, u_left));
-    }else{
-        glVertexAttribPointer((GLuint)mTextureHandle, 2/*uv*/, GL_FLOAT, GL_FALSE, sizeof(TexturedStereoVertex), (GLvoid*)offsetof(TexturedStereoVertex, u_right));
-    }
+    beforeDraw<TexturedStereoVertex>(buffer,texture,useLeftTextureCoords);
 }
 
 void AGLProgramTexture::drawXStereoVertex(GLuint texture, const glm::mat4x4& ViewM, const glm::mat4x4& ProjM, const TexturedStereoGLMeshBuffer& mesh, bool useLeftTextureCoords)const {
-    mesh.logWarningWhenDrawingMeshWithoutData();
-    beforeDrawStereoVertex(mesh.getVertexBufferId(),texture,useLeftTextureCoords);
-    if(mesh.hasIndices()){
-        drawIndexed(mesh.getIndexBufferId(), ViewM, ProjM, 0, mesh.getCount(), mesh.getMode());
-    }else{
-        draw(ViewM,ProjM,0,mesh.getCount(),mesh.getMode());
-    }
-    afterDraw();
+    drawX(texture,ViewM,ProjM,mesh,useLeftTextureCoords);
 }
-
@@ -2,8 +2,13 @@
 #define GLRENDERTEXTUREEXTERNAL
 
 #include <VDDC.hpp>
+#include "ProgramBinaryCache.h"
 #include <GLMeshBuffer.hpp>
+#include <GLState.hpp>
+#include <VertexFormat.hpp>
+#include <Extensions.h>
 #include <GLES2/gl2.h>
+#include <array>
 #include <glm/mat4x4.hpp>
 #include <jni.h>
 #include <glm/glm.hpp>
@@ -32,11 +37,111 @@ struct TexturedStereoVertex{
 using TexturedStereoMeshData=AMeshData<TexturedStereoVertex,GLuint>;
 using TexturedStereoGLMeshBuffer=AGLMeshBuffer<TexturedStereoVertex,GLuint>;
 
+// Compact versions of the vertices above. x,y,z are half floats (w is always 1, such that the vertex stays 4 byte aligned)
+// and u,v are normalized unsigned shorts, which only works for texture coordinates in [0,1].
+// 12 instead of 20 bytes for a TexturedVertex, 16 instead of 28 bytes for a TexturedStereoVertex.
+// Use TexturedStereoVertexHelper::convertFormat() to create them and check the reported error.
+struct CompactTexturedVertex{
+    VertexFormat::Half x,y,z,w;
+    GLushort u,v;
+};
+// Compact meshes use 16 bit indices, see MeshOptimizer::narrowIndices()
+using CompactTexturedMeshData=AMeshData<CompactTexturedVertex,GLushort>;
+using CompactTexturedGLMeshBuffer=AGLMeshBuffer<CompactTexturedVertex,GLushort>;
+struct CompactTexturedStereoVertex{
+    VertexFormat::Half x,y,z,w;
+    GLushort u_left,v_left;
+    GLushort u_right,v_right;
+};
+using CompactTexturedStereoMeshData=AMeshData<CompactTexturedStereoVertex,GLushort>;
+using CompactTexturedStereoGLMeshBuffer=AGLMeshBuffer<CompactTexturedStereoVertex,GLushort>;
+
+// Describes how a vertex format is fed into the position and texture coordinate attributes of AGLProgramTexture
+// and how it is created from a TexturedStereoVertex
+template<class VERTEX>
+struct TexturedVertexTraits;
+template<>
+struct TexturedVertexTraits<TexturedVertex>{
+    static void setupAttributes(GLint positionHandle,GLint textureHandle,bool useLeftTextureCoords){
+        GLState::vertexAttribPointer(positionHandle, 3/*xyz*/, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), nullptr);
+        GLState::vertexAttribPointer(textureHandle, 2/*uv*/,GL_FLOAT, GL_FALSE,sizeof(TexturedVertex),(GLvoid*)offsetof(TexturedVertex,u));
+    }
+    static TexturedVertex fromStereo(const TexturedStereoVertex& v,VertexFormat::ConversionError& error){
+        return {v.x,v.y,v.z,v.u_left,v.v_left};
+    }
+};
+template<>
+struct TexturedVertexTraits<TexturedStereoVertex>{
+    static void setupAttributes(GLint positionHandle,GLint textureHandle,bool useLeftTextureCoords){
+        GLState::vertexAttribPointer(positionHandle, 3/*xyz*/, GL_FLOAT, GL_FALSE, sizeof(TexturedStereoVertex), nullptr);
+        GLState::vertexAttribPointer(textureHandle, 2/*uv*/, GL_FLOAT, GL_FALSE, sizeof(TexturedStereoVertex),
+                useLeftTextureCoords ? (GLvoid*)offsetof(TexturedStereoVertex, u_left) : (GLvoid*)offsetof(TexturedStereoVertex, u_right));
+    }
+    static TexturedStereoVertex fromStereo(const TexturedStereoVertex& v,VertexFormat::ConversionError& error){
+        return v;
+    }
+};
+// Requires Extensions::GL_HALF_FLOAT_VERTEX_ATTRIBUTE_TYPE!=0
+template<>
+struct TexturedVertexTraits<CompactTexturedVertex>{
+    static void setupAttributes(GLint positionHandle,GLint textureHandle,bool useLeftTextureCoords){
+        GLState::vertexAttribPointer(positionHandle, 4/*xyzw*/, Extensions::GL_HALF_FLOAT_VERTEX_ATTRIBUTE_TYPE, GL_FALSE, sizeof(CompactTexturedVertex), nullptr);
+        GLState::vertexAttribPointer(textureHandle, 2/*uv*/,GL_UNSIGNED_SHORT, GL_TRUE,sizeof(CompactTexturedVertex),(GLvoid*)offsetof(CompactTexturedVertex,u));
+    }
+    static CompactTexturedVertex fromStereo(const TexturedStereoVertex& v,VertexFormat::ConversionError& error){
+        using namespace VertexFormat;
+        CompactTexturedVertex ret{floatToHalf(v.x),floatToHalf(v.y),floatToHalf(v.z),floatToHalf(1.0f),
+                                  floatToUnorm16(v.u_left),floatToUnorm16(v.v_left)};
+        error.addPosition(v.x,ret.x);
+        error.addPosition(v.y,ret.y);
+        error.addPosition(v.z,ret.z);
+        error.addUv(v.u_left,ret.u);
+        error.addUv(v.v_left,ret.v);
+        return ret;
+    }
+};
+// Requires Extensions::GL_HALF_FLOAT_VERTEX_ATTRIBUTE_TYPE!=0
+template<>
+struct TexturedVertexTraits<CompactTexturedStereoVertex>{
+    static void setupAttributes(GLint positionHandle,GLint textureHandle,bool useLeftTextureCoords){
+        GLState::vertexAttribPointer(positionHandle, 4/*xyzw*/, Extensions::GL_HALF_FLOAT_VERTEX_ATTRIBUTE_TYPE, GL_FALSE, sizeof(CompactTexturedStereoVertex), nullptr);
+        GLState::vertexAttribPointer(textureHandle, 2/*uv*/, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactTexturedStereoVertex),
+                useLeftTextureCoords ? (GLvoid*)offsetof(CompactTexturedStereoVertex, u_left) : (GLvoid*)offsetof(CompactTexturedStereoVertex, u_right));
+    }
+    static CompactTexturedStereoVertex fromStereo(const TexturedStereoVertex& v,VertexFormat::ConversionError& error){
+        using namespace VertexFormat;
+        CompactTexturedStereoVertex ret{floatToHalf(v.x),floatToHalf(v.y),floatToHalf(v.z),floatToHalf(1.0f),
+                                        floatToUnorm16(v.u_left),floatToUnorm16(v.v_left),floatToUnorm16(v.u_right),floatToUnorm16(v.v_right)};
+        error.addPosition(v.x,ret.x);
+        error.addPosition(v.y,ret.y);
+        error.addPosition(v.z,ret.z);
+        error.addUv(v.u_left,ret.u_left);
+        error.addUv(v.v_left,ret.v_left);
+        error.addUv(v.u_right,ret.u_right);
+        error.addUv(v.v_right,ret.v_right);
+        return ret;
+    }
+};
+
 namespace TexturedStereoVertexHelper{
     // convert TexturedMeshData to TexturedStereoMeshData duplicating the u,v coordinates for left and right eye
     TexturedStereoMeshData convert(const TexturedMeshData& input);
     // convert TexturedStereoMeshData to TexturedMeshData by selecting either the left or right eye u,v coordinates only
     TexturedMeshData convert(const TexturedStereoMeshData& input,const bool left);
+    // convert the output of the geometry builders into any of the vertex formats above (mono formats take the left eye u,v coordinates).
+    // error holds the maximum error introduced by the conversion afterwards
+    template<class VERTEX>
+    AMeshData<VERTEX,GLuint> convertFormat(const TexturedStereoMeshData& input,VertexFormat::ConversionError& error){
+        std::vector<VERTEX> vertices;
+        vertices.reserve(input.vertices.size());
+        for(const auto& vertex:input.vertices){
+            vertices.push_back(TexturedVertexTraits<VERTEX>::fromStereo(vertex,error));
+        }
+        if(input.hasIndices()){
+            return AMeshData<VERTEX,GLuint>(vertices,*input.indices,input.mode);
+        }
+        return AMeshData<VERTEX,GLuint>(vertices,input.mode);
+    }
 }
 
 // Abstract GLProgram Texture. Abstract because there is a declaration for
@@ -50,11 +155,17 @@ private:
     const bool ENABLE_VDDC;
     const bool USE_2D_COORDINATES;
     const bool MAP_EQUIRECTANGULAR_TO_INSTA360;
-    GLuint mProgram;
-    GLint mPositionHandle,mTextureHandle,mSamplerHandle;
-    GLuint mMVMatrixHandle,mPMatrixHandle;
+    // The program is only issued in the constructor and finished on first use (see ProgramBinaryCache::issueProgram())
+    // Therefore the program and the handles are mutable
+    mutable std::optional<ProgramBinaryCache::PendingProgram> mPendingProgram;
+    mutable GLuint mProgram=0;
+    mutable GLint mPositionHandle=-1,mTextureHandle=-1,mSamplerHandle=-1;
+    mutable GLuint mMVMatrixHandle=0,mPMatrixHandle=0;
+    mutable GLint mTexCoordScaleHandle=-1;
+    // Value of the uTexCoordScale uniform of the program
+    mutable std::array<float,2> mTexCoordScale={1.0f,1.0f};
     // Only active if V.D.D.C is enabled
-    std::optional<VDDC::UnDistortionUniformHandles> mUndistortionHandles;
+    mutable std::optional<VDDC::UnDistortionUniformHandles> mUndistortionHandles;
     static constexpr auto MY_TEXTURE_UNIT=GL_TEXTURE1;
     static constexpr auto MY_SAMPLER_UNIT=1;
 public:
@@ -74,24 +185,71 @@ public:
     void beforeDraw(GLBuffer<TexturedVertex>& buffer,GLuint texture)const{
         beforeDraw(buffer.getGLBufferId(),texture);
     }
+    // Same as above for any vertex format that has a TexturedVertexTraits specialization.
+    // useLeftTextureCoords only has an effect for stereo vertices
+    template<class VERTEX>
+    void beforeDraw(GLuint buffer,GLuint texture,bool useLeftTextureCoords) const{
+        bindProgramAndTexture(texture);
+        GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+        setupAttributes<VERTEX>(useLeftTextureCoords);
+    }
     void draw(const glm::mat4x4& ViewM, const glm::mat4x4& ProjM, int verticesOffset, int numberVertices,GLenum mode=GL_TRIANGLES) const;
-    void drawIndexed(GLuint indexBuffer,const glm::mat4x4& ViewM, const glm::mat4x4& ProjM, int indicesOffset, int numberIndices,GLenum mode) const;
+    void drawIndexed(GLuint indexBuffer,const glm::mat4x4& ViewM, const glm::mat4x4& ProjM, int indicesOffset, int numberIndices,GLenum mode,GLenum indexType=GL_UNSIGNED_INT) const;
     void afterDraw() const;
     // Upload an image as texture to the specified texture unit
     static void loadTexture(GLuint texture,JNIEnv *env, jobject androidContext,const char* name);
     // convenient methods for drawing a textured mesh with / without indices
-    // calls beforeDraw(), draw() and afterDraw() properly
+    // calls beforeDraw(), draw() and afterDraw() properly.
+    // If available, the attributes are set up once in a vertex array object of the mesh instead (one for each program and eye)
     void drawX(GLuint texture,const glm::mat4x4& ViewM, const glm::mat4x4& ProjM,const TexturedGLMeshBuffer& mesh)const;
+    template<class VERTEX,class INDEX>
+    void drawX(GLuint texture,const glm::mat4x4& ViewM, const glm::mat4x4& ProjM,const AGLMeshBuffer<VERTEX,INDEX>& mesh,bool useLeftTextureCoords)const{
+        mesh.logWarningWhenDrawingMeshWithoutData();
+        if(GLState::vertexArraysAvailable()){
+            bindProgramAndTexture(texture);
+            const uint64_t key=((uint64_t)mProgram<<1) | (useLeftTextureCoords ? 1 : 0);
+            mesh.bindVertexArray(key,[this,useLeftTextureCoords](){
+                setupAttributes<VERTEX>(useLeftTextureCoords);
+            });
+            updateMatrices(ViewM,ProjM);
+            mesh.drawVertexArray();
+            afterDraw();
+            return;
+        }
+        beforeDraw<VERTEX>(mesh.getVertexBufferId(),texture,useLeftTextureCoords);
+        if(mesh.hasIndices()){
+            drawIndexed(mesh.getIndexBufferId(), ViewM, ProjM, 0, mesh.getCount(), mesh.getMode(),mesh.getIndexType());
+        }else{
+            draw(ViewM,ProjM,0,mesh.getCount(),mesh.getMode());
+        }
+        afterDraw();
+    }
+    // Multiply the texture coordinates with scale, e.g. FramebufferTexture::getUvScale() when the texture is larger than its content.
+    // Stays set for all following draw calls with this program, the uniform is only uploaded when it changes
+    void setTexCoordScale(const std::array<float,2>& scale)const;
     // update the uniform values to perform VDDC for left or right eye
     void updateUnDistortionUniforms(bool leftEye, const VDDC::DataUnDistortion& dataUnDistortion)const;
+    // True if the first use of this program won't wait for the driver to finish compiling
+    bool isProgramReady()const;
+    // Wait for the driver to finish compiling and query the handles. Called automatically on first use
+    void finishProgram()const;
 public:
     void beforeDrawStereoVertex(GLuint buffer,GLuint texture,bool useLeftTextureCoords=false) const;
     void drawXStereoVertex(GLuint texture,const glm::mat4x4& ViewM, const glm::mat4x4& ProjM,const TexturedStereoGLMeshBuffer& mesh,bool useLeftTextureCoords=false)const;
 private:
+    void bindProgramAndTexture(GLuint texture)const;
+    // Expects the vertex buffer to be bound to GL_ARRAY_BUFFER
+    template<class VERTEX>
+    void setupAttributes(bool useLeftTextureCoords)const{
+        GLState::setVertexAttribArrays({mPositionHandle,mTextureHandle});
+        TexturedVertexTraits<VERTEX>::setupAttributes(mPositionHandle,mTextureHandle,useLeftTextureCoords);
+    }
+    void updateMatrices(const glm::mat4x4& ViewM, const glm::mat4x4& ProjM)const;
     static const std::string VS(){
         std::stringstream s;
         s<<"uniform mat4 uMVMatrix;\n";
         s<<"uniform mat4 uPMatrix;\n";
+        s<<"uniform vec2 uTexCoordScale;\n";
         s<<"attribute vec4 aPosition;\n";
         s<<"attribute vec2 aTexCoord;\n";
         s<<"varying vec2 vTexCoord;\n";
@@ -107,7 +265,7 @@ private:
         s<<"#else\n";
         s<<"gl_Position = (uPMatrix*uMVMatrix)* aPosition;\n";
         s<<"#endif\n";
-        s<<"vTexCoord = aTexCoord;\n";
+        s<<"vTexCoord = aTexCoord*uTexCoordScale;\n";
         s<<"}\n";
         return s.str();
     }
@@ -1,12 +1,13 @@
 
 #include "GLProgramVC.h"
+#include "ProgramBinaryCache.h"
 
 AGLProgramVC::AGLProgramVC(const bool DO_MVP_MULTIPLICATION1):DO_MVP_MULTIPLICATION(DO_MVP_MULTIPLICATION1){
     std::string flags;
     if(DO_MVP_MULTIPLICATION){
         flags="#define DO_MVP_MULTIPLICATION\n";
     }
-    mProgram = GLHelper::createProgram(VS, FS, flags);
+    mProgram = ProgramBinaryCache::createProgram(VS, FS, flags);
     mPositionHandle =GLHelper::GlGetAttribLocation((GLuint)mProgram, "aPosition");
     mColorHandle =GLHelper::GlGetAttribLocation((GLuint)mProgram, "aColor");
     if(DO_MVP_MULTIPLICATION){
@@ -16,37 +17,53 @@ AGLProgramVC::AGLProgramVC(const bool DO_MVP_MULTIPLICATION1):DO_MVP_MULTIPLICAT
 }
 
 void AGLProgramVC::beforeDraw(const GLuint buffer) const {
-    glUseProgram(mProgram);
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    glEnableVertexAttribArray((GLuint)mPositionHandle);
-    glVertexAttribPointer((GLuint)mPositionHandle, 3/*xyz*/, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), nullptr);
-    glEnableVertexAttribArray((GLuint)mColorHandle);
-    glVertexAttribPointer((GLuint)mColorHandle, 4/*rgba*/,GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ColoredVertex),(GLvoid*)offsetof(ColoredVertex,colorRGBA));
+    GLState::useProgram(mProgram);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+    setupAttributes();
+}
+
+void AGLProgramVC::setupAttributes() const {
+    GLState::setVertexAttribArrays({(GLint)mPositionHandle,(GLint)mColorHandle});
+    GLState::vertexAttribPointer(mPositionHandle, 3/*xyz*/, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), nullptr);
+    GLState::vertexAttribPointer(mColorHandle, 4/*rgba*/,GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ColoredVertex),(GLvoid*)offsetof(ColoredVertex,colorRGBA));
+}
+
+void AGLProgramVC::bindProgramAndVertexArray(const ColoredGLMeshBuffer &mesh) const {
+    GLState::useProgram(mProgram);
+    mesh.bindVertexArray(mProgram,[this](){
+        setupAttributes();
+    });
 }
 
 void AGLProgramVC::afterDraw() const {
-    glDisableVertexAttribArray((GLuint)mPositionHandle);
-    glDisableVertexAttribArray((GLuint)mColorHandle);
-    glBindBuffer(GL_ARRAY_BUFFER,0);
+    // The vertex attribute arrays and the buffer stay bound, the next beforeDraw() only changes what differs (see GLState)
 }
 
 void GLProgramVC::draw(const glm::mat4 &ViewM, const glm::mat4 &ProjM, int verticesOffset,
                        int numberVertices, GLenum mode) const {
     const glm::mat4 mvp=ProjM*ViewM;
-    glUniformMatrix4fv(mMVPMatrixHandle, 1, GL_FALSE, glm::value_ptr(mvp));
-    glDrawArrays(mode, verticesOffset, numberVertices);
+    GLInstrumentation::uniformMatrix4fv(mMVPMatrixHandle, 1, GL_FALSE, glm::value_ptr(mvp));
+    GLInstrumentation::drawArrays(mode, verticesOffset, numberVertices);
 }
 
 void GLProgramVC::drawIndexed(GLuint indexBuffer, const glm::mat4 &ViewM, const glm::mat4 &ProjM,
                               int indicesOffset, int numberIndices, GLenum mode) const {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
     const glm::mat4 mvp=ProjM*ViewM;
-    glUniformMatrix4fv(mMVPMatrixHandle, 1, GL_FALSE, glm::value_ptr(mvp));
-    glDrawArrays(mode,indicesOffset, numberIndices);
+    GLInstrumentation::uniformMatrix4fv(mMVPMatrixHandle, 1, GL_FALSE, glm::value_ptr(mvp));
+    GLInstrumentation::drawElements(mode,numberIndices,IndicesHelper::GLIndexType<COLORED_INDEX_DATA>::value,(void*)(indicesOffset*sizeof(COLORED_INDEX_DATA)));
 }
 
 void GLProgramVC::drawX(const glm::mat4 &ViewM, glm::mat4 ProjM, const ColoredGLMeshBuffer &mesh) const {
     mesh.logWarningWhenDrawingMeshWithoutData();
+    if(GLState::vertexArraysAvailable()){
+        bindProgramAndVertexArray(mesh);
+        const glm::mat4 mvp=ProjM*ViewM;
+        GLInstrumentation::uniformMatrix4fv(mMVPMatrixHandle, 1, GL_FALSE, glm::value_ptr(mvp));
+        mesh.drawVertexArray();
+        afterDraw();
+        return;
+    }
     beforeDraw(mesh.getVertexBufferId());
     // MLOGD<<mesh.getCount()<<" "<<mesh.glBufferVertices.count<<" "<<mesh.glBufferIndices->count;
     if(mesh.hasIndices()){
@@ -57,18 +74,33 @@ void GLProgramVC::drawX(const glm::mat4 &ViewM, glm::mat4 ProjM, const ColoredGL
     afterDraw();
 }
 
+void GLProgramVC::drawX(const glm::mat4 &ViewM, glm::mat4 ProjM, const ColoredMeshArena &arena,
+                        ColoredMeshArena::MeshId mesh) const {
+    beforeDraw(arena.getVertexBufferId(mesh));
+    const glm::mat4 mvp=ProjM*ViewM;
+    GLInstrumentation::uniformMatrix4fv(mMVPMatrixHandle, 1, GL_FALSE, glm::value_ptr(mvp));
+    arena.draw(mesh);
+    afterDraw();
+}
+
 void GLProgramVC2D::draw(int verticesOffset, int numberVertices, GLenum mode) const {
-    glDrawArrays(mode, verticesOffset, numberVertices);
+    GLInstrumentation::drawArrays(mode, verticesOffset, numberVertices);
 }
 
 void GLProgramVC2D::drawIndexed(GLuint indexBuffer, int indicesOffset, int numberIndices,
                                 GLenum mode) const {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-    glDrawArrays(mode,indicesOffset, numberIndices);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    GLInstrumentation::drawElements(mode,numberIndices,IndicesHelper::GLIndexType<COLORED_INDEX_DATA>::value,(void*)(indicesOffset*sizeof(COLORED_INDEX_DATA)));
 }
 
 void GLProgramVC2D::drawX(const ColoredGLMeshBuffer &mesh) const {
     mesh.logWarningWhenDrawingMeshWithoutData();
+    if(GLState::vertexArraysAvailable()){
+        bindProgramAndVertexArray(mesh);
+        mesh.drawVertexArray();
+        afterDraw();
+        return;
+    }
     beforeDraw(mesh.getVertexBufferId());
     // MLOGD<<mesh.getCount()<<" "<<mesh.glBufferVertices.count<<" "<<mesh.glBufferIndices->count;
     if(mesh.hasIndices()){
@@ -78,3 +110,9 @@ void GLProgramVC2D::drawX(const ColoredGLMeshBuffer &mesh) const {
     }
     afterDraw();
 }
+
+void GLProgramVC2D::drawX(const ColoredMeshArena &arena, ColoredMeshArena::MeshId mesh) const {
+    beforeDraw(arena.getVertexBufferId(mesh));
+    arena.draw(mesh);
+    afterDraw();
+}
@@ -14,6 +14,8 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <TrueColor.hpp>
 #include <GLMeshBuffer.hpp>
+#include <MeshArena.hpp>
+#include <GLState.hpp>
 
 struct ColoredVertex{
     float x,y,z;
@@ -22,6 +24,8 @@ struct ColoredVertex{
 using COLORED_INDEX_DATA=GLuint;
 using ColoredMeshData=AMeshData<ColoredVertex,COLORED_INDEX_DATA>;
 using ColoredGLMeshBuffer=AGLMeshBuffer<ColoredVertex,COLORED_INDEX_DATA>;
+// Many small colored meshes packed into shared buffers
+using ColoredMeshArena=MeshArena<ColoredVertex>;
 
 // Abstract class that loads the appropriate vertex and fragment shader for rendering colored geometry
 class AGLProgramVC {
@@ -33,6 +37,10 @@ protected:
     GLuint mPositionHandle,mColorHandle;
     GLuint mMVPMatrixHandle;
     AGLProgramVC(const bool DO_MVP_MULTIPLICATION);
+    // Expects the vertex buffer to be bound to GL_ARRAY_BUFFER
+    void setupAttributes()const;
+    // Binds the program and the vertex array object of this mesh (one for each program). Requires GLState::vertexArraysAvailable()
+    void bindProgramAndVertexArray(const ColoredGLMeshBuffer& mesh)const;
 public:
     void beforeDraw(GLuint buffer) const;
     void beforeDraw(GLBuffer<ColoredVertex>& buffer)const{
@@ -71,6 +79,7 @@ public:
     void draw(const glm::mat4& ViewM,const glm::mat4& ProjM, int verticesOffset,int numberVertices, GLenum mode) const;
     void drawIndexed(GLuint indexBuffer,const glm::mat4& ViewM,const glm::mat4& ProjM,int indicesOffset,int numberIndices, GLenum mode) const;
     void drawX(const glm::mat4& ViewM,const glm::mat4 ProjM,const ColoredGLMeshBuffer& mesh)const;
+    void drawX(const glm::mat4& ViewM,const glm::mat4 ProjM,const ColoredMeshArena& arena,ColoredMeshArena::MeshId mesh)const;
 };
 
 class GLProgramVC2D: public AGLProgramVC{
@@ -79,6 +88,7 @@ public:
     void draw(int verticesOffset,int numberVertices, GLenum mode) const;
     void drawIndexed(GLuint indexBuffer,int indicesOffset,int numberIndices, GLenum mode) const;
     void drawX(const ColoredGLMeshBuffer& mesh)const;
+    void drawX(const ColoredMeshArena& arena,ColoredMeshArena::MeshId mesh)const;
 };
 
 
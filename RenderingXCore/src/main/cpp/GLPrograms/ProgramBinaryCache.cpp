@@ -0,0 +1,275 @@
+#include "ProgramBinaryCache.h"
+#include <GLHelper.hpp>
+#include <Extensions.h>
+#include <TimeHelper.hpp>
+#include <AndroidLogger.hpp>
+#include <jni.h>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sys/stat.h>
+#include <vector>
+
+constexpr auto TAG="ProgramBinaryCache";
+// GL_PROGRAM_BINARY_RETRIEVABLE_HINT, OpenGL ES 3.0
+constexpr GLenum GL_PROGRAM_BINARY_RETRIEVABLE_HINT_=0x8257;
+
+namespace{
+    struct Header{
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t binaryFormat;
+        uint32_t binaryLength;
+        uint64_t checksum;
+    };
+    constexpr uint32_t MAGIC=0x50424352; //"PBCR"
+    constexpr uint32_t VERSION=1;
+    std::mutex mMutex;
+    std::string mDirectory;
+    ProgramBinaryCache::Stats mStats;
+
+    // FNV-1a 64 bit
+    uint64_t hash(const void* data,const std::size_t size,uint64_t hash=14695981039346656037ULL){
+        const auto* bytes=static_cast<const uint8_t*>(data);
+        for(std::size_t i=0;i<size;i++){
+            hash^=bytes[i];
+            hash*=1099511628211ULL;
+        }
+        return hash;
+    }
+    uint64_t hash(const std::string& s,const uint64_t seed){
+        // include the terminating 0, such that "ab"+"c" and "a"+"bc" differ
+        return hash(s.c_str(),s.size()+1,seed);
+    }
+    std::string glString(const GLenum name){
+        const auto* s=(const char*)glGetString(name);
+        return s==nullptr ? "" : s;
+    }
+    uint64_t calculateKey(const std::string& vertexSource,const std::string& fragmentSource,const std::string& additionalFlags){
+        uint64_t ret=hash(vertexSource,14695981039346656037ULL);
+        ret=hash(fragmentSource,ret);
+        ret=hash(additionalFlags,ret);
+        ret=hash(glString(GL_VENDOR),ret);
+        ret=hash(glString(GL_RENDERER),ret);
+        ret=hash(glString(GL_VERSION),ret);
+        return ret;
+    }
+    std::string getFilename(const std::string& directory,const uint64_t key){
+        std::stringstream ss;
+        ss<<directory<<"/"<<std::hex<<std::setw(16)<<std::setfill('0')<<key<<".bin";
+        return ss.str();
+    }
+    bool linkStatusOk(const GLuint program){
+        GLint linkStatus=GL_FALSE;
+        glGetProgramiv(program,GL_LINK_STATUS,&linkStatus);
+        return linkStatus==GL_TRUE;
+    }
+    // Returns 0 if there is no valid binary for this key
+    GLuint loadFromFile(const std::string& filename,const uint64_t key,bool& invalid){
+        invalid=false;
+        std::ifstream file(filename,std::ios::binary | std::ios::ate);
+        if(!file.is_open())return 0;
+        const std::streamoff fileSize=file.tellg();
+        file.seekg(0,std::ios::beg);
+        Header header{};
+        std::vector<uint8_t> binary;
+        if(file.read(reinterpret_cast<char*>(&header),sizeof(Header))){
+            // Do not trust the length read from disk, a corrupted header must not trigger a huge allocation
+            const bool lengthMatchesFile=fileSize>=(std::streamoff)sizeof(Header) && header.binaryLength==(uint64_t)(fileSize-(std::streamoff)sizeof(Header));
+            if(header.magic==MAGIC && header.version==VERSION && header.key==key && lengthMatchesFile){
+                binary.resize(header.binaryLength);
+                file.read(reinterpret_cast<char*>(binary.data()),binary.size());
+            }
+        }
+        if(binary.empty() || !file || hash(binary.data(),binary.size())!=header.checksum){
+            invalid=true;
+            return 0;
+        }
+        const GLuint program=glCreateProgram();
+        Extensions::glProgramBinary_(program,header.binaryFormat,binary.data(),(GLint)binary.size());
+        // glProgramBinary can fail with GL_INVALID_ENUM if the format is not supported anymore
+        while(glGetError()!=GL_NO_ERROR){}
+        if(!linkStatusOk(program)){
+            glDeleteProgram(program);
+            invalid=true;
+            return 0;
+        }
+        return program;
+    }
+    void storeToFile(const std::string& filename,const uint64_t key,const GLuint program){
+        GLint length=0;
+        glGetProgramiv(program,GL_PROGRAM_BINARY_LENGTH_OES,&length);
+        if(length<=0)return;
+        std::vector<uint8_t> binary(length);
+        GLsizei actualLength=0;
+        GLenum binaryFormat=0;
+        Extensions::glGetProgramBinary_(program,length,&actualLength,&binaryFormat,binary.data());
+        if(actualLength<=0)return;
+        binary.resize(actualLength);
+        const Header header{MAGIC,VERSION,key,binaryFormat,(uint32_t)binary.size(),hash(binary.data(),binary.size())};
+        // Write to a temporary file first, such that an interrupted write never leaves a truncated binary with the final name
+        const std::string tmpFilename=filename+".tmp";
+        {
+            std::ofstream file(tmpFilename,std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header),sizeof(Header));
+            file.write(reinterpret_cast<const char*>(binary.data()),binary.size());
+            if(!file){
+                MLOGE2(TAG)<<"Cannot write "<<tmpFilename;
+                std::remove(tmpFilename.c_str());
+                return;
+            }
+        }
+        std::rename(tmpFilename.c_str(),filename.c_str());
+    }
+    // Unlike GLHelper::loadShader does not query the compile status, which would wait for the compiler
+    GLuint issueShader(const GLenum type,const std::string& shaderCode,const std::string& additionalFlags){
+        const GLuint shader=glCreateShader(type);
+        const char* tmp[2]={additionalFlags.c_str(),shaderCode.c_str()};
+        glShaderSource(shader,2,tmp,nullptr);
+        glCompileShader(shader);
+        return shader;
+    }
+    void logShaderInfoLogIfNeeded(const GLuint shader){
+        GLint result;
+        glGetShaderiv(shader,GL_COMPILE_STATUS,&result);
+        if(result!=GL_TRUE){
+            const int size=1024*4;
+            GLchar infoLog[size];
+            GLsizei len;
+            glGetShaderInfoLog(shader,size,&len,infoLog);
+            MLOGD<<"Couldn't compile shader "+std::string(infoLog);
+        }
+    }
+}
+
+void ProgramBinaryCache::setDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mkdir(directory.c_str(),0700);
+    mDirectory=directory;
+    MLOGD2(TAG)<<"Directory "<<directory;
+}
+
+GLuint ProgramBinaryCache::createProgram(const std::string &vertexSource, const std::string &fragmentSource, const std::string &additionalFlags) {
+    return finishProgram(issueProgram(vertexSource,fragmentSource,additionalFlags));
+}
+
+ProgramBinaryCache::PendingProgram ProgramBinaryCache::issueProgram(const std::string &vertexSource,const std::string &fragmentSource,const std::string &additionalFlags) {
+    PendingProgram ret;
+    ret.issueTime=std::chrono::steady_clock::now();
+    std::string directory;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        directory=mDirectory;
+    }
+    if(!directory.empty() && Extensions::GL_program_binary_available){
+        ret.key=calculateKey(vertexSource,fragmentSource,additionalFlags);
+        ret.filename=getFilename(directory,ret.key);
+        ret.program=loadFromFile(ret.filename,ret.key,ret.invalidCacheEntry);
+        if(ret.program!=0){
+            ret.loadedFromCache=true;
+            return ret;
+        }
+        if(ret.invalidCacheEntry){
+            MLOGD2(TAG)<<"Invalid binary "<<ret.filename;
+            std::remove(ret.filename.c_str());
+        }
+    }
+    ret.vertexShader=issueShader(GL_VERTEX_SHADER,vertexSource,additionalFlags);
+    ret.fragmentShader=issueShader(GL_FRAGMENT_SHADER,fragmentSource,additionalFlags);
+    ret.program=glCreateProgram();
+    glAttachShader(ret.program,ret.vertexShader);
+    glAttachShader(ret.program,ret.fragmentShader);
+    if(!ret.filename.empty() && Extensions::glProgramParameteri_!=nullptr){
+        Extensions::glProgramParameteri_(ret.program,GL_PROGRAM_BINARY_RETRIEVABLE_HINT_,GL_TRUE);
+    }
+    glLinkProgram(ret.program);
+    return ret;
+}
+
+bool ProgramBinaryCache::isProgramReady(const PendingProgram &pendingProgram) {
+    if(pendingProgram.loadedFromCache || !Extensions::GL_KHR_parallel_shader_compile_available){
+        return true;
+    }
+    GLint completed=GL_TRUE;
+    glGetProgramiv(pendingProgram.program,Extensions::GL_COMPLETION_STATUS_KHR_,&completed);
+    return completed==GL_TRUE;
+}
+
+GLuint ProgramBinaryCache::finishProgram(const PendingProgram &pendingProgram) {
+    const auto before=std::chrono::steady_clock::now();
+    GLuint program=pendingProgram.program;
+    if(!pendingProgram.loadedFromCache){
+        // Blocks until the driver is done linking
+        if(!linkStatusOk(program)){
+            logShaderInfoLogIfNeeded(pendingProgram.vertexShader);
+            logShaderInfoLogIfNeeded(pendingProgram.fragmentShader);
+            MLOGD<<"Couldn't create shader program";
+            glDeleteProgram(program);
+            program=0;
+        }
+        // The program keeps working without the shader objects
+        if(program!=0){
+            glDetachShader(program,pendingProgram.vertexShader);
+            glDetachShader(program,pendingProgram.fragmentShader);
+        }
+        glDeleteShader(pendingProgram.vertexShader);
+        glDeleteShader(pendingProgram.fragmentShader);
+        if(program!=0 && !pendingProgram.filename.empty()){
+            storeToFile(pendingProgram.filename,pendingProgram.key,program);
+        }
+        GLHelper::checkGlError("ProgramBinaryCache::finishProgram");
+    }
+    const auto now=std::chrono::steady_clock::now();
+    if(!pendingProgram.filename.empty()){
+        MLOGD2(TAG)<<(pendingProgram.loadedFromCache ? "Hit " : "Miss ")<<std::hex<<pendingProgram.key<<std::dec
+        <<" issued "<<MyTimeHelper::R(now-pendingProgram.issueTime)<<" ago, waited "<<MyTimeHelper::R(now-before);
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(pendingProgram.loadedFromCache){
+        mStats.nHits++;
+    }else{
+        mStats.nMisses++;
+    }
+    if(pendingProgram.invalidCacheEntry)mStats.nInvalid++;
+    mStats.totalTime+=now-before;
+    return program;
+}
+
+ProgramBinaryCache::Stats ProgramBinaryCache::getStats() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+std::string ProgramBinaryCache::Stats::toString() const {
+    std::stringstream ss;
+    ss<<"ProgramBinaryCache hits "<<nHits<<" misses "<<nMisses<<" invalid "<<nInvalid<<" total "<<MyTimeHelper::R(totalTime);
+    return ss.str();
+}
+
+void ProgramBinaryCache::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mDirectory.empty())return;
+    DIR* dir=opendir(mDirectory.c_str());
+    if(dir==nullptr)return;
+    while(const dirent* entry=readdir(dir)){
+        const std::string name=entry->d_name;
+        if(name.size()>4 && name.compare(name.size()-4,4,".bin")==0){
+            std::remove((mDirectory+"/"+name).c_str());
+        }
+    }
+    closedir(dir);
+}
+
+extern "C" {
+
+void Java_constantin_renderingx_core_deviceinfo_Extensions_nativeSetProgramBinaryCacheDirectory(JNIEnv *env, jclass jclass1,jstring directory) {
+    const char* directoryC=env->GetStringUTFChars(directory,nullptr);
+    ProgramBinaryCache::setDirectory(directoryC);
+    env->ReleaseStringUTFChars(directory,directoryC);
+}
+
+}
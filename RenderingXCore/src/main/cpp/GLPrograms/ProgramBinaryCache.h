@@ -0,0 +1,56 @@
+#ifndef RENDERINGX_PROGRAMBINARYCACHE_H
+#define RENDERINGX_PROGRAMBINARYCACHE_H
+
+#include <GLES2/gl2.h>
+#include <chrono>
+#include <string>
+
+/*******************************************************************
+ * Persistent cache for linked shader programs. Compiling all the GLPrograms (with the generated V.D.D.C code) takes hundreds of ms on
+ * mid-range phones at each startup. With the cache only the first startup (or the first one after a driver update) pays for it.
+ * The key is a hash of the final source code, the defines and the vendor / renderer / version strings of the driver.
+ * Binaries are validated when loaded (header, checksum, link status) and the program is compiled from source if anything fails.
+ * Requires OpenGL ES 3.0 or OES_get_program_binary, else (or until setDirectory() was called) programs are always compiled.
+ * Program creation can be split into issueProgram() and finishProgram(): Issue all programs first, such that the driver can
+ * compile them in parallel (KHR_parallel_shader_compile) or at least while the application does other work, and finish each one
+ * right before its first use.
+ *******************************************************************/
+namespace ProgramBinaryCache{
+    // The binaries are stored in this directory, e.g. Context.getCacheDir()+"/gl_programs". Created if needed
+    void setDirectory(const std::string& directory);
+    // Same as GLHelper::createProgram, but loads the program from the cache if possible.
+    // Call Extensions::initializeGL() first
+    GLuint createProgram(const std::string& vertexSource,const std::string& fragmentSource,const std::string& additionalFlags="");
+    // A program that was issued but not finished yet
+    struct PendingProgram{
+        GLuint program=0;
+        GLuint vertexShader=0;
+        GLuint fragmentShader=0;
+        uint64_t key=0;
+        // empty if the cache is disabled
+        std::string filename;
+        bool loadedFromCache=false;
+        bool invalidCacheEntry=false;
+        std::chrono::steady_clock::time_point issueTime;
+    };
+    // Loads the binary or starts compiling and linking, without waiting for the result
+    PendingProgram issueProgram(const std::string& vertexSource,const std::string& fragmentSource,const std::string& additionalFlags="");
+    // True if finishProgram() will not block. Always true without KHR_parallel_shader_compile
+    bool isProgramReady(const PendingProgram& pendingProgram);
+    // Waits for the program (if needed), checks the link status and stores the binary. Returns 0 on failure
+    GLuint finishProgram(const PendingProgram& pendingProgram);
+    struct Stats{
+        int nHits=0;
+        int nMisses=0;
+        // Cached binaries the driver did not accept (e.g. after a driver update with the same version string)
+        int nInvalid=0;
+        // Time spent in createProgram() / finishProgram()
+        std::chrono::steady_clock::duration totalTime{0};
+        std::string toString()const;
+    };
+    Stats getStats();
+    // Delete all cached binaries
+    void clear();
+}
+
+#endif //RENDERINGX_PROGRAMBINARYCACHE_H
@@ -9,6 +9,7 @@
 #include <array>
 #include <vector>
 #include <VrCompositorRenderer.h>
+#include <TaskScheduler.h>
 
 namespace CardboardViewportOcclusion{
     // V1--V3--V5-- .... VN
@@ -69,16 +70,19 @@ namespace CardboardViewportOcclusion{
         mesh.at(2)=makeSomething({-1,1},2.0f,true,color,tessellation);
         mesh.at(3)=makeSomething({-1,-1},2.0f,true,color,tessellation);
 
-        //Distort every second vertex
-        for(auto& tmp:mesh){
-            for(int i=1;i<tmp.size();i+=2){
-                ColoredVertex& v=tmp.at(i);
-                auto xy=params.UndistortedNDCForDistortedNDC({v.x,v.y},eye);
-                v.x=xy[0];
-                v.y=xy[1];
-                v.z=0.0f;
+        //Distort every second vertex. Each undistortion is an iterative inverse, the 4 meshes are done on the TaskScheduler workers
+        TaskScheduler::instance().parallelFor(0,mesh.size(),1,[&mesh,&params,eye](const size_t begin,const size_t end){
+            for(size_t m=begin;m<end;m++){
+                auto& tmp=mesh[m];
+                for(int i=1;i<tmp.size();i+=2){
+                    ColoredVertex& v=tmp.at(i);
+                    auto xy=params.UndistortedNDCForDistortedNDC({v.x,v.y},eye);
+                    v.x=xy[0];
+                    v.y=xy[1];
+                    v.z=0.0f;
+                }
             }
-        }
+        });
 
         //merge them together
         //using degenerate triangles in between
@@ -102,6 +106,11 @@ namespace CardboardViewportOcclusion{
         vb[0].setData(makeMesh(params, 0, color));
         vb[1].setData(makeMesh(params, 1, color));
     }
+    // Same as above, but both meshes are added to the arena
+    static const void uploadOcclusionMeshLeftRight(const VrCompositorRenderer& params, TrueColor color, ColoredMeshArena& arena, std::array<ColoredMeshArena::MeshId,2>& ids){
+        ids[0]=arena.add(makeMesh(params, 0, color));
+        ids[1]=arena.add(makeMesh(params, 1, color));
+    }
 };
 
 
@@ -6,6 +6,7 @@
 #define RENDERINGX_INDICES_HPP
 
 #include <vector>
+#include <numeric>
 #include <AndroidLogger.hpp>
 #include "GLES2/gl2.h"
 
@@ -24,6 +25,59 @@ namespace IndicesHelper{
         }
         return ret;
     }
+    // The OpenGL type of an index, e.g. for glDrawElements
+    template<class INDEX>
+    struct GLIndexType;
+    template<>
+    struct GLIndexType<GLubyte>{
+        static constexpr GLenum value=GL_UNSIGNED_BYTE;
+    };
+    template<>
+    struct GLIndexType<GLushort>{
+        static constexpr GLenum value=GL_UNSIGNED_SHORT;
+    };
+    template<>
+    struct GLIndexType<GLuint>{
+        static constexpr GLenum value=GL_UNSIGNED_INT;
+    };
+    static std::size_t getIndexTypeSize(const GLenum indexType){
+        return indexType==GL_UNSIGNED_BYTE ? 1 : indexType==GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+    // 0,1,2...n-1, for meshes without indices
+    static std::vector<GLuint> makeSequentialIndices(const std::size_t n){
+        std::vector<GLuint> ret(n);
+        std::iota(ret.begin(),ret.end(),0);
+        return ret;
+    }
+    // converts the indices of a GL_TRIANGLE_STRIP into the indices of GL_TRIANGLES with the same winding.
+    // Degenerate triangles (e.g. used to join multiple strips) are removed if they repeat an index. Strips that repeat a vertex by
+    // copying it (e.g. UvSphere) only become degenerate by index after merging identical vertices, see removeDegenerateTriangles()
+    static std::vector<GLuint> triangleStripToTriangles(const std::vector<GLuint>& strip){
+        std::vector<GLuint> ret;
+        ret.reserve(strip.size()*3);
+        for(std::size_t i=2;i<strip.size();i++){
+            const GLuint a=strip[i-2],b=strip[i-1],c=strip[i];
+            if(a==b || b==c || a==c)continue;
+            // every second triangle of a strip has the reverse vertex order
+            if(i%2==0){
+                ret.insert(ret.end(),{a,b,c});
+            }else{
+                ret.insert(ret.end(),{b,a,c});
+            }
+        }
+        return ret;
+    }
+    // removes the triangles of GL_TRIANGLES indices that use the same vertex index more than once (they have no area)
+    static std::vector<GLuint> removeDegenerateTriangles(const std::vector<GLuint>& triangles){
+        std::vector<GLuint> ret;
+        ret.reserve(triangles.size());
+        for(std::size_t i=0;i+2<triangles.size();i+=3){
+            const GLuint a=triangles[i],b=triangles[i+1],c=triangles[i+2];
+            if(a==b || b==c || a==c)continue;
+            ret.insert(ret.end(),{a,b,c});
+        }
+        return ret;
+    }
 }
 
 #endif //RENDERINGX_INDICES_HPP
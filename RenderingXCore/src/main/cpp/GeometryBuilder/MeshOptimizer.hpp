@@ -0,0 +1,279 @@
+#ifndef RENDERINGX_MESHOPTIMIZER_HPP
+#define RENDERINGX_MESHOPTIMIZER_HPP
+
+#include <GLMeshBuffer.hpp>
+#include <IndicesHelper.hpp>
+#include <AndroidLogger.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reduces the n of vertex shader invocations of a static mesh. Especially useful with V.D.D.C, where the vertex shader is expensive.
+// 1) Triangle strips (the output of most geometry builders, joined by degenerate triangles) and meshes without indices are converted into indexed triangles
+// 2) Bitwise identical vertices are merged, the triangles that become degenerate by that (e.g. strips joined with copied vertices) are removed
+// 3) The triangles are reordered for the post-transform vertex cache (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+// 4) The vertices are reordered in the order they are first used, such that vertex fetch reads the buffer linearly
+// The result is only used if its ACMR (average cache miss ratio, vertex shader invocations per triangle) is lower than the one of the input.
+// ACMR is simulated with a FIFO cache, real GPUs differ in size and replacement policy.
+namespace MeshOptimizer{
+    struct Options{
+        bool deduplicateVertices=true;
+        bool reorderForVertexCache=true;
+        bool reorderVertexFetch=true;
+        // Size of the simulated post-transform cache
+        int cacheSize=16;
+    };
+    struct Report{
+        std::size_t nVerticesBefore=0;
+        std::size_t nVerticesAfter=0;
+        std::size_t nIndicesBefore=0;
+        std::size_t nIndicesAfter=0;
+        float acmrBefore=0;
+        float acmrAfter=0;
+        GLenum modeBefore=GL_TRIANGLES;
+        GLenum modeAfter=GL_TRIANGLES;
+        // False if the input was cheaper (or not a triangle mesh) and therefore returned unchanged
+        bool optimized=false;
+        std::string toString()const{
+            std::stringstream ss;
+            ss<<"MeshOptimizer vertices "<<nVerticesBefore<<"->"<<nVerticesAfter<<" indices "<<nIndicesBefore<<"->"<<nIndicesAfter
+              <<" ACMR "<<acmrBefore<<"->"<<acmrAfter<<(modeAfter==modeBefore ? "" : " strip->triangles")<<(optimized ? "" : " (unchanged)");
+            return ss.str();
+        }
+    };
+
+    // Vertex shader invocations per triangle when drawing the indices as GL_TRIANGLES with a FIFO cache of cacheSize entries.
+    // 0.5 is the optimum for a regular grid, 3 means no re-use at all
+    static float calculateACMR(const std::vector<GLuint>& triangles,const int cacheSize){
+        if(triangles.size()<3)return 0;
+        std::deque<GLuint> cache;
+        std::size_t nMisses=0;
+        for(const GLuint index:triangles){
+            if(std::find(cache.begin(),cache.end(),index)!=cache.end())continue;
+            nMisses++;
+            cache.push_back(index);
+            if((int)cache.size()>cacheSize)cache.pop_front();
+        }
+        return (float)nMisses/(triangles.size()/3);
+    }
+
+    // Merges bitwise identical vertices, returns the remapped indices
+    template<class VERTEX>
+    static std::vector<GLuint> deduplicateVertices(std::vector<VERTEX>& vertices,const std::vector<GLuint>& indices){
+        std::unordered_map<std::string,GLuint> unique;
+        std::vector<GLuint> remap(vertices.size());
+        std::vector<VERTEX> uniqueVertices;
+        for(std::size_t i=0;i<vertices.size();i++){
+            const std::string key(reinterpret_cast<const char*>(&vertices[i]),sizeof(VERTEX));
+            const auto it=unique.find(key);
+            if(it!=unique.end()){
+                remap[i]=it->second;
+            }else{
+                remap[i]=(GLuint)uniqueVertices.size();
+                unique.emplace(key,remap[i]);
+                uniqueVertices.push_back(vertices[i]);
+            }
+        }
+        vertices=std::move(uniqueVertices);
+        std::vector<GLuint> ret(indices.size());
+        for(std::size_t i=0;i<indices.size();i++){
+            ret[i]=remap[indices[i]];
+        }
+        return ret;
+    }
+
+    // Forsyth's linear-speed vertex cache optimisation, returns the reordered triangles
+    static std::vector<GLuint> reorderForVertexCache(const std::vector<GLuint>& triangles,const std::size_t nVertices){
+        constexpr int CACHE_SIZE=32;
+        const std::size_t nTriangles=triangles.size()/3;
+        // Score of a vertex depending on its position in the simulated LRU cache and the n of triangles still using it
+        const auto vertexScore=[](const int cachePosition,const int nRemainingTriangles){
+            if(nRemainingTriangles==0)return -1.0f;
+            float score=0;
+            if(cachePosition>=0){
+                // The last triangle's vertices get a fixed score, to avoid favouring them too much
+                score=cachePosition<3 ? 0.75f : std::pow(1.0f-(float)(cachePosition-3)/(CACHE_SIZE-3),1.5f);
+            }
+            return score+2.0f/std::sqrt((float)nRemainingTriangles);
+        };
+        std::vector<int> nRemaining(nVertices,0);
+        for(const GLuint index:triangles)nRemaining[index]++;
+        // triangles using each vertex
+        std::vector<std::size_t> offsets(nVertices+1,0);
+        for(std::size_t v=0;v<nVertices;v++)offsets[v+1]=offsets[v]+nRemaining[v];
+        std::vector<std::size_t> vertexTriangles(triangles.size());
+        {
+            std::vector<std::size_t> fill(offsets.begin(),offsets.end()-1);
+            for(std::size_t t=0;t<nTriangles;t++){
+                for(int k=0;k<3;k++)vertexTriangles[fill[triangles[t*3+k]]++]=t;
+            }
+        }
+        std::vector<int> cachePosition(nVertices,-1);
+        std::vector<float> score(nVertices);
+        for(std::size_t v=0;v<nVertices;v++)score[v]=vertexScore(-1,nRemaining[v]);
+        std::vector<float> triangleScore(nTriangles);
+        std::vector<bool> emitted(nTriangles,false);
+        for(std::size_t t=0;t<nTriangles;t++){
+            triangleScore[t]=score[triangles[t*3]]+score[triangles[t*3+1]]+score[triangles[t*3+2]];
+        }
+        std::vector<GLuint> ret;
+        ret.reserve(triangles.size());
+        std::vector<GLuint> cache;
+        std::size_t scanCursor=0;
+        std::optional<std::size_t> best;
+        for(std::size_t n=0;n<nTriangles;n++){
+            if(!best){
+                // No cached vertex has remaining triangles, continue with the first not yet emitted one
+                // (the scores of triangles without cached vertices barely differ)
+                while(emitted[scanCursor])scanCursor++;
+                best=scanCursor;
+            }
+            const std::size_t t=*best;
+            emitted[t]=true;
+            std::array<GLuint,3> vertices{triangles[t*3],triangles[t*3+1],triangles[t*3+2]};
+            ret.insert(ret.end(),vertices.begin(),vertices.end());
+            // Update the LRU cache, the vertices of the new triangle are at the front
+            std::vector<GLuint> newCache(vertices.begin(),vertices.end());
+            for(const GLuint v:cache){
+                if(v!=vertices[0] && v!=vertices[1] && v!=vertices[2])newCache.push_back(v);
+            }
+            for(const GLuint v:vertices){
+                nRemaining[v]--;
+                // remove the triangle from the list of the vertex
+                auto begin=vertexTriangles.begin()+offsets[v];
+                auto end=begin+nRemaining[v]+1;
+                auto it=std::find(begin,end,t);
+                std::iter_swap(it,end-1);
+            }
+            for(std::size_t i=0;i<newCache.size();i++){
+                const GLuint v=newCache[i];
+                cachePosition[v]=i<CACHE_SIZE ? (int)i : -1;
+                score[v]=vertexScore(cachePosition[v],nRemaining[v]);
+            }
+            if(newCache.size()>CACHE_SIZE)newCache.resize(CACHE_SIZE);
+            cache=std::move(newCache);
+            // Update the scores of the triangles touching the cache and pick the best one
+            best.reset();
+            float bestScore=-1;
+            for(const GLuint v:cache){
+                for(int i=0;i<nRemaining[v];i++){
+                    const std::size_t tri=vertexTriangles[offsets[v]+i];
+                    triangleScore[tri]=score[triangles[tri*3]]+score[triangles[tri*3+1]]+score[triangles[tri*3+2]];
+                    if(triangleScore[tri]>bestScore){
+                        bestScore=triangleScore[tri];
+                        best=tri;
+                    }
+                }
+            }
+        }
+        return ret;
+    }
+
+    // Reorders the vertices in the order they are first referenced, unused vertices are removed. Returns the remapped indices
+    template<class VERTEX>
+    static std::vector<GLuint> reorderVertexFetch(std::vector<VERTEX>& vertices,const std::vector<GLuint>& indices){
+        constexpr GLuint UNUSED=std::numeric_limits<GLuint>::max();
+        std::vector<GLuint> remap(vertices.size(),UNUSED);
+        std::vector<VERTEX> reordered;
+        reordered.reserve(vertices.size());
+        std::vector<GLuint> ret(indices.size());
+        for(std::size_t i=0;i<indices.size();i++){
+            GLuint& newIndex=remap[indices[i]];
+            if(newIndex==UNUSED){
+                newIndex=(GLuint)reordered.size();
+                reordered.push_back(vertices[indices[i]]);
+            }
+            ret[i]=newIndex;
+        }
+        vertices=std::move(reordered);
+        return ret;
+    }
+
+    // Returns the optimized mesh (indexed GL_TRIANGLES) or the input if it is already cheaper to draw.
+    // Only GL_TRIANGLES and GL_TRIANGLE_STRIP meshes are optimized
+    template<class VERTEX,class INDEX>
+    static AMeshData<VERTEX,GLuint> optimize(const AMeshData<VERTEX,INDEX>& mesh,Report* report=nullptr,const Options& options=Options()){
+        std::vector<GLuint> inputIndices;
+        if(mesh.hasIndices()){
+            inputIndices.assign(mesh.indices->begin(),mesh.indices->end());
+        }
+        Report tmp;
+        Report& r=report ? *report : tmp;
+        r=Report();
+        r.nVerticesBefore=r.nVerticesAfter=mesh.vertices.size();
+        r.nIndicesBefore=r.nIndicesAfter=inputIndices.size();
+        r.modeBefore=r.modeAfter=mesh.mode;
+        const auto unchanged=[&mesh,&inputIndices](){
+            if(mesh.hasIndices())return AMeshData<VERTEX,GLuint>(mesh.vertices,inputIndices,mesh.mode);
+            return AMeshData<VERTEX,GLuint>(mesh.vertices,mesh.mode);
+        };
+        if(mesh.mode!=GL_TRIANGLES && mesh.mode!=GL_TRIANGLE_STRIP){
+            return unchanged();
+        }
+        const std::vector<GLuint> submitted=mesh.hasIndices() ? inputIndices : IndicesHelper::makeSequentialIndices(mesh.vertices.size());
+        std::vector<GLuint> triangles=mesh.mode==GL_TRIANGLE_STRIP ? IndicesHelper::triangleStripToTriangles(submitted) : submitted;
+        if(triangles.empty()){
+            return unchanged();
+        }
+        const std::size_t nTriangles=triangles.size()/3;
+        // Without indices each submitted vertex is shaded, a strip only shares the 2 vertices of the previous triangle
+        if(!mesh.hasIndices()){
+            r.acmrBefore=(float)mesh.vertices.size()/nTriangles;
+        }else if(mesh.mode==GL_TRIANGLE_STRIP){
+            r.acmrBefore=std::min(calculateACMR(triangles,options.cacheSize),(float)submitted.size()/nTriangles);
+        }else{
+            r.acmrBefore=calculateACMR(triangles,options.cacheSize);
+        }
+        std::vector<VERTEX> vertices=mesh.vertices;
+        if(options.deduplicateVertices){
+            triangles=IndicesHelper::removeDegenerateTriangles(deduplicateVertices(vertices,triangles));
+            if(triangles.empty()){
+                return unchanged();
+            }
+        }
+        if(options.reorderForVertexCache){
+            triangles=reorderForVertexCache(triangles,vertices.size());
+        }
+        if(options.reorderVertexFetch){
+            triangles=reorderVertexFetch(vertices,triangles);
+        }
+        const float acmrAfter=calculateACMR(triangles,options.cacheSize);
+        r.acmrAfter=r.acmrBefore;
+        if(acmrAfter>=r.acmrBefore){
+            return unchanged();
+        }
+        r.optimized=true;
+        r.acmrAfter=acmrAfter;
+        r.nVerticesAfter=vertices.size();
+        r.nIndicesAfter=triangles.size();
+        r.modeAfter=GL_TRIANGLES;
+        return AMeshData<VERTEX,GLuint>(std::move(vertices),std::move(triangles),GL_TRIANGLES);
+    }
+
+    // Returns the mesh with INDEX indices, or std::nullopt if it has more vertices than INDEX can address.
+    // E.g. GLushort halves the size of the index buffer
+    template<class INDEX,class VERTEX>
+    static std::optional<AMeshData<VERTEX,INDEX>> narrowIndices(const AMeshData<VERTEX,GLuint>& mesh){
+        if(mesh.vertices.size()>(std::size_t)std::numeric_limits<INDEX>::max()+1){
+            return std::nullopt;
+        }
+        if(!mesh.hasIndices()){
+            return AMeshData<VERTEX,INDEX>(mesh.vertices,mesh.mode);
+        }
+        std::vector<INDEX> indices(mesh.indices->size());
+        for(std::size_t i=0;i<indices.size();i++){
+            indices[i]=(INDEX)(*mesh.indices)[i];
+        }
+        return AMeshData<VERTEX,INDEX>(mesh.vertices,std::move(indices),mesh.mode);
+    }
+}
+
+#endif //RENDERINGX_MESHOPTIMIZER_HPP
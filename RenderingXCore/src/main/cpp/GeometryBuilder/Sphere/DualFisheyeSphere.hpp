@@ -12,6 +12,7 @@
 #include "cmath"
 #include <GLBuffer.hpp>
 #include <GLProgramTexture.h>
+#include <TaskScheduler.h>
 
 class DualFisheyeSphere {
 public:
@@ -63,14 +64,18 @@ public:
         uint32_t dx = trisize;
         uint32_t dy = trisize;
 
-        // Create the vertex array
-        for (uint32_t y = 0; y <= ny; ++y) {
-            uint32_t cy = y * dy;
-            for (uint32_t x = 0; x <= nx; ++x) {
-                uint32_t cx = x * dx;
-                add_vert(verts, width, height, radius, c1x, c1y, c2x, c2y, cx, cy);
+        // Create the vertex array. The rows are independent of each other and generated on the TaskScheduler workers
+        const size_t offset = verts.size();
+        verts.resize(offset + (size_t)(ny + 1) * (nx + 1) * 5);
+        TaskScheduler::instance().parallelFor(ny + 1, [&](const size_t begin, const size_t end) {
+            for (uint32_t y = (uint32_t)begin; y < (uint32_t)end; ++y) {
+                uint32_t cy = y * dy;
+                for (uint32_t x = 0; x <= nx; ++x) {
+                    uint32_t cx = x * dx;
+                    add_vert(&verts[offset + ((size_t)y * (nx + 1) + x) * 5], width, height, radius, c1x, c1y, c2x, c2y, cx, cy);
+                }
             }
-        }
+        });
 
         // Create the triangles
         uint32_t xinc = nx + 1;
@@ -89,7 +94,8 @@ public:
             indexes.push_back((y + 1) * xinc);
         }
     }
-    static void add_vert(std::vector<GLfloat> &verts,
+    // Writes the 5 floats of the vertex to out
+    static void add_vert(GLfloat* out,
                          uint32_t width, uint32_t height, uint32_t radius,
                          uint32_t c1x, uint32_t c1y, uint32_t c2x, uint32_t c2y,
                          uint32_t x, uint32_t y) {
@@ -118,11 +124,11 @@ public:
         }
 
         // The coordinates should range from -0.5 to 0.5.
-        verts.push_back(fx - 0.5);
-        verts.push_back(fy - 0.5);
-        verts.push_back(fz);
-        verts.push_back(1.0f-u);
-        verts.push_back(v);
+        out[0] = fx - 0.5;
+        out[1] = fy - 0.5;
+        out[2] = fz;
+        out[3] = 1.0f-u;
+        out[4] = v;
     }
 public:
     //
@@ -134,15 +140,18 @@ public:
         std::vector<GLfloat> tmpVertices;
         std::vector<GLuint> tmpIndices;
         create_sphere(tmpVertices,tmpIndices,surf_w,surf_h);
-        for(int i=0;i<=tmpVertices.size()-5;i+=5){
-            TexturedVertex v;
-            v.x=tmpVertices[i+0];
-            v.y=tmpVertices[i+1];
-            v.z=tmpVertices[i+2];
-            v.u=tmpVertices[i+3];
-            v.v=tmpVertices[i+4];
-            vertexData.push_back(v);
-        }
+        const size_t offset=vertexData.size();
+        vertexData.resize(offset+tmpVertices.size()/5);
+        TaskScheduler::instance().parallelFor(tmpVertices.size()/5,[&](const size_t begin,const size_t end){
+            for(size_t i=begin;i<end;i++){
+                TexturedVertex& v=vertexData[offset+i];
+                v.x=tmpVertices[i*5+0];
+                v.y=tmpVertices[i*5+1];
+                v.z=tmpVertices[i*5+2];
+                v.u=tmpVertices[i*5+3];
+                v.v=tmpVertices[i*5+4];
+            }
+        });
         for(auto i=0;i<tmpIndices.size();i++){
             indexData.push_back((AGLProgramTexture::INDEX_DATA) tmpIndices.at(i));
         }
@@ -9,9 +9,16 @@
 #include <Sphere/DualFisheyeSphere.hpp>
 #include "GLProgramTexture.h"
 #include "../TexturedGeometry.hpp"
+#include <TaskScheduler.h>
 
 class SphereBuilder{
 public:
+    // The latitude bands of the UvSphere are generated on the workers of TaskScheduler::instance()
+    static UvSphere::ParallelFor getParallelFor(){
+        return [](size_t n,const std::function<void(size_t,size_t)>& body){
+            TaskScheduler::instance().parallelFor(n,body);
+        };
+    }
     //
     //map equirect to insta360, same function as in fragment shader of GLProgramTexture with mapping enabled
     //
@@ -79,10 +86,17 @@ public:
     static TexturedStereoMeshData
     createSphereEquirectangularMonoscopic(float radius=1.0f, int latitudes=64, int longitudes=32,UvSphere::MEDIA_FORMAT format=UvSphere::MEDIA_EQUIRECT_MONOSCOPIC) {
         static_assert(sizeof(TexturedStereoVertex) == sizeof(UvSphere::Vertex));
-        auto vertexDataAsInGvr=UvSphere::createUvSphere(radius,latitudes,longitudes,180,360,UvSphere::MEDIA_EQUIRECT_MONOSCOPIC,UvSphere::ROTATE_UNKNOWN);
+        auto vertexDataAsInGvr=UvSphere::createUvSphere(radius,latitudes,longitudes,180,360,UvSphere::MEDIA_EQUIRECT_MONOSCOPIC,UvSphere::ROTATE_UNKNOWN,getParallelFor());
         auto vertexData= *reinterpret_cast<std::vector<TexturedStereoVertex>*>(&vertexDataAsInGvr);
         return TexturedStereoMeshData(vertexData,GL_TRIANGLE_STRIP);
     }
+    // Same as above, but in any vertex format supported by AGLProgramTexture (e.g. CompactTexturedStereoVertex).
+    // error holds the maximum error introduced by the conversion
+    template<class VERTEX>
+    static AMeshData<VERTEX,GLuint>
+    createSphereEquirectangularMonoscopic(VertexFormat::ConversionError& error,float radius=1.0f, int latitudes=64, int longitudes=32,UvSphere::MEDIA_FORMAT format=UvSphere::MEDIA_EQUIRECT_MONOSCOPIC){
+        return TexturedStereoVertexHelper::convertFormat<VERTEX>(createSphereEquirectangularMonoscopic(radius,latitudes,longitudes,format),error);
+    }
 
     //Use the map function to convert from equirect to dual fisheye insta360 - TODO fix 'black line'
     static TexturedMeshData
@@ -90,7 +104,7 @@ public:
         float radius=1.0f;
         float latitudes=128;
         float longitudes=36;
-        const auto vertexDataAsInGvr=UvSphere::createUvSphere(radius,latitudes,longitudes,180,360,UvSphere::MEDIA_EQUIRECT_MONOSCOPIC,rot);
+        const auto vertexDataAsInGvr=UvSphere::createUvSphere(radius,latitudes,longitudes,180,360,UvSphere::MEDIA_EQUIRECT_MONOSCOPIC,rot,getParallelFor());
         std::vector<TexturedVertex> ret;
         for(const auto& vertex:vertexDataAsInGvr){
             const auto d=equirect_to_insta360(vertex.u_left,vertex.v_left);
@@ -110,7 +124,7 @@ public:
         float radius=1.0f;
         float latitudes=128;
         float longitudes=36;
-        const auto vertexDataAsInGvr=UvSphere::createUvSphere(radius,latitudes,longitudes,180,360,UvSphere::MEDIA_EQUIRECT_MONOSCOPIC,rot);
+        const auto vertexDataAsInGvr=UvSphere::createUvSphere(radius,latitudes,longitudes,180,360,UvSphere::MEDIA_EQUIRECT_MONOSCOPIC,rot,getParallelFor());
         std::vector<TexturedVertex> ret;
         for(const auto& vertex:vertexDataAsInGvr){
             const auto d=equirect_to_fisheye(vertex.u_left,vertex.v_left,radiusx,radiusy,fov,x_shift,y_shift);
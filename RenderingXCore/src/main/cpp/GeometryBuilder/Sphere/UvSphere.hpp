@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <cmath>
+#include <functional>
 
 /**
  * Only depends on standard libraries
@@ -45,6 +46,8 @@ public:
         float u_left,v_left;
         float u_right,v_right;
     };
+    // Calls body(begin,end) for sub-ranges covering [0,n), e.g. using TaskScheduler::parallelFor()
+    using ParallelFor=std::function<void(size_t n,const std::function<void(size_t,size_t)>& body)>;
     /**
   * Generates a 3D UV sphere for rendering monoscopic or stereoscopic video.
   *
@@ -57,6 +60,7 @@ public:
   *    in (0, 360].
   * @param mediaFormat A MEDIA_* value.
   * @param rotation rotation in 90° steps
+  * @param parallelFor optional, the latitude bands are independent of each other and can be generated in parallel
   * @return  std::vector of type GvrSphere::Vertex
   */
     static std::vector<UvSphere::Vertex> createUvSphere(
@@ -66,7 +70,8 @@ public:
             float verticalFovDegrees,
             float horizontalFovDegrees,
             MEDIA_FORMAT mediaFormat,
-            ROTATION rotation){
+            ROTATION rotation,
+            const ParallelFor& parallelFor=nullptr){
         if (radius <= 0
             || latitudes < 1 || longitudes < 1
             || verticalFovDegrees <= 0 || verticalFovDegrees > 180
@@ -87,88 +92,95 @@ public:
 
         // Generate the data for the sphere which is a set of triangle strips representing each
         // latitude band.
-        int v = 0; // Index into the vertex array.
-        // (i, j) represents a quad in the equirectangular sphere.
-        for (int j = 0; j < latitudes; ++j) { // For each horizontal triangle strip.
-            // Each latitude band lies between the two phi values. Each vertical edge on a band lies on
-            // a theta value.
-            const float phiLow = (quadHeightRads * j - verticalFovRads / 2);
-            const float phiHigh = (quadHeightRads * (j + 1) - verticalFovRads / 2);
+        const auto createBands=[&](const size_t begin,const size_t end){
+            // (i, j) represents a quad in the equirectangular sphere.
+            for (int j = (int)begin; j < (int)end; ++j) { // For each horizontal triangle strip.
+                int v = (2 * (longitudes + 1) + 2) * j; // Index into the vertex array.
+                // Each latitude band lies between the two phi values. Each vertical edge on a band lies on
+                // a theta value.
+                const float phiLow = (quadHeightRads * j - verticalFovRads / 2);
+                const float phiHigh = (quadHeightRads * (j + 1) - verticalFovRads / 2);
 
-            for (int i = 0; i < longitudes + 1; ++i) { // For each vertical edge in the band.
-                for (int k = 0; k < 2; ++k) { // For low and high points on an edge.
-                    // For each point, determine it's position in polar coordinates.
-                    const float phi = (k == 0) ? phiLow : phiHigh;
-                    const float theta = quadWidthRads * i + (float) M_PI - horizontalFovRads / 2;
+                for (int i = 0; i < longitudes + 1; ++i) { // For each vertical edge in the band.
+                    for (int k = 0; k < 2; ++k) { // For low and high points on an edge.
+                        // For each point, determine it's position in polar coordinates.
+                        const float phi = (k == 0) ? phiLow : phiHigh;
+                        const float theta = quadWidthRads * i + (float) M_PI - horizontalFovRads / 2;
 
-                    // Set vertex position data as Cartesian coordinates.
-                    switch (rotation) {
-                        case ROTATE_0:
-                            vertexData[v].x = -(float) (radius * std::cos(theta) * std::cos(phi));
-                            vertexData[v].y = (float) (radius * std::sin(theta) * std::cos(phi));
-                            vertexData[v].z = -(float) (radius * std::sin(phi));
-                            break;
-                        case ROTATE_90:
-                            vertexData[v].x = -(float) (radius * std::sin(theta) * std::cos(phi));
-                            vertexData[v].y = -(float) (radius * std::cos(theta) * std::cos(phi));
-                            vertexData[v].z = -(float) (radius * std::sin(phi));
-                            break;
-                        case ROTATE_180:
-                            vertexData[v].x = (float) (radius * std::cos(theta) * std::cos(phi));
-                            vertexData[v].y = -(float) (radius * std::sin(theta) * std::cos(phi));
-                            vertexData[v].z = -(float) (radius * std::sin(phi));
-                            break;
-                        case ROTATE_270:
-                            vertexData[v].x = -(float) (radius * std::sin(theta) * std::cos(phi));
-                            vertexData[v].y = (float) (radius * std::cos(theta) * std::cos(phi));
-                            vertexData[v].z = -(float) (radius * std::sin(phi));
-                            break;
-                        default:
-                            //This is what the original source code of GvrSphere uses.
-                            //Not sure what rotation, but needed for the Gvr test video
-                            vertexData[v].x = -(float) (radius * std::sin(theta) * std::cos(phi));
-                            vertexData[v].y =  (float) (radius * std::sin(phi));
-                            vertexData[v].z =  (float) (radius * std::cos(theta) * std::cos(phi));
-                            break;
-                    }
-                    //vertexData[v].y =  (float) (radius * sin(theta) * sin(phi));
-                    //vertexData[v].z =  (float) (radius * cos(theta));
+                        // Set vertex position data as Cartesian coordinates.
+                        switch (rotation) {
+                            case ROTATE_0:
+                                vertexData[v].x = -(float) (radius * std::cos(theta) * std::cos(phi));
+                                vertexData[v].y = (float) (radius * std::sin(theta) * std::cos(phi));
+                                vertexData[v].z = -(float) (radius * std::sin(phi));
+                                break;
+                            case ROTATE_90:
+                                vertexData[v].x = -(float) (radius * std::sin(theta) * std::cos(phi));
+                                vertexData[v].y = -(float) (radius * std::cos(theta) * std::cos(phi));
+                                vertexData[v].z = -(float) (radius * std::sin(phi));
+                                break;
+                            case ROTATE_180:
+                                vertexData[v].x = (float) (radius * std::cos(theta) * std::cos(phi));
+                                vertexData[v].y = -(float) (radius * std::sin(theta) * std::cos(phi));
+                                vertexData[v].z = -(float) (radius * std::sin(phi));
+                                break;
+                            case ROTATE_270:
+                                vertexData[v].x = -(float) (radius * std::sin(theta) * std::cos(phi));
+                                vertexData[v].y = (float) (radius * std::cos(theta) * std::cos(phi));
+                                vertexData[v].z = -(float) (radius * std::sin(phi));
+                                break;
+                            default:
+                                //This is what the original source code of GvrSphere uses.
+                                //Not sure what rotation, but needed for the Gvr test video
+                                vertexData[v].x = -(float) (radius * std::sin(theta) * std::cos(phi));
+                                vertexData[v].y =  (float) (radius * std::sin(phi));
+                                vertexData[v].z =  (float) (radius * std::cos(theta) * std::cos(phi));
+                                break;
+                        }
+                        //vertexData[v].y =  (float) (radius * sin(theta) * sin(phi));
+                        //vertexData[v].z =  (float) (radius * cos(theta));
 
-                    // Set vertex texture.x data.
-                    if (mediaFormat == MEDIA_EQUIRECT_STEREO_LEFT_RIGHT) {
-                        // For left-right media, each eye's x coordinate points to the left or right half of the
-                        // texture.
-                        vertexData[v].u_left = (i * quadWidthRads / horizontalFovRads) / 2;
-                        vertexData[v].u_right = (i * quadWidthRads / horizontalFovRads) / 2 + .5f;
-                    } else {
-                        // For top-bottom or monoscopic media, the eye's x spans the full width of the texture.
-                        vertexData[v].u_left = i * quadWidthRads / horizontalFovRads;
-                        vertexData[v].u_right = vertexData[v].u_left;
-                    }
+                        // Set vertex texture.x data.
+                        if (mediaFormat == MEDIA_EQUIRECT_STEREO_LEFT_RIGHT) {
+                            // For left-right media, each eye's x coordinate points to the left or right half of the
+                            // texture.
+                            vertexData[v].u_left = (i * quadWidthRads / horizontalFovRads) / 2;
+                            vertexData[v].u_right = (i * quadWidthRads / horizontalFovRads) / 2 + .5f;
+                        } else {
+                            // For top-bottom or monoscopic media, the eye's x spans the full width of the texture.
+                            vertexData[v].u_left = i * quadWidthRads / horizontalFovRads;
+                            vertexData[v].u_right = vertexData[v].u_left;
+                        }
 
-                    // Set vertex texture.y data. The "1 - ..." is due to Canvas vs GL coords.
-                    if (mediaFormat == MEDIA_EQUIRECT_STEREO_TOP_BOTTOM) {
-                        // For top-bottom media, each eye's y coordinate points to the top or bottom half of the
-                        // texture.
-                        vertexData[v].v_left = 1 - (((j + k) * quadHeightRads / verticalFovRads) / 2 + .5f);
-                        vertexData[v].v_right = 1 - ((j + k) * quadHeightRads / verticalFovRads) / 2;
-                    } else {
-                        // For left-right or monoscopic media, the eye's y spans the full height of the texture.
-                        vertexData[v].v_left = 1 - (j + k) * quadHeightRads / verticalFovRads;
-                        vertexData[v].v_right = vertexData[v].v_left;
-                    }
+                        // Set vertex texture.y data. The "1 - ..." is due to Canvas vs GL coords.
+                        if (mediaFormat == MEDIA_EQUIRECT_STEREO_TOP_BOTTOM) {
+                            // For top-bottom media, each eye's y coordinate points to the top or bottom half of the
+                            // texture.
+                            vertexData[v].v_left = 1 - (((j + k) * quadHeightRads / verticalFovRads) / 2 + .5f);
+                            vertexData[v].v_right = 1 - ((j + k) * quadHeightRads / verticalFovRads) / 2;
+                        } else {
+                            // For left-right or monoscopic media, the eye's y spans the full height of the texture.
+                            vertexData[v].v_left = 1 - (j + k) * quadHeightRads / verticalFovRads;
+                            vertexData[v].v_right = vertexData[v].v_left;
+                        }
 
-                    v++;
-
-                    // Break up the triangle strip with degenerate vertices by copying first and last points.
-                    if ((i == 0 && k == 0) || (i == longitudes && k == 1)) {
-                        vertexData[v]=vertexData[v-1];
                         v++;
+
+                        // Break up the triangle strip with degenerate vertices by copying first and last points.
+                        if ((i == 0 && k == 0) || (i == longitudes && k == 1)) {
+                            vertexData[v]=vertexData[v-1];
+                            v++;
+                        }
                     }
+                    // Move on to the next vertical edge in the triangle strip.
                 }
-                // Move on to the next vertical edge in the triangle strip.
+                // Move on to the next triangle strip.
             }
-            // Move on to the next triangle strip.
+        };
+        if(parallelFor){
+            parallelFor((size_t)latitudes,createBands);
+        }else{
+            createBands(0,(size_t)latitudes);
         }
         return vertexData;
     }
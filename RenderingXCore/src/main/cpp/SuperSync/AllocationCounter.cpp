@@ -0,0 +1,70 @@
+#include "AllocationCounter.h"
+
+#ifdef RENDERINGX_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+static thread_local uint64_t nAllocations=0;
+
+static void* countedAllocation(std::size_t size){
+    nAllocations++;
+    if(size==0)size=1;
+    while(true){
+        void* ptr=std::malloc(size);
+        if(ptr!=nullptr)return ptr;
+        std::new_handler handler=std::get_new_handler();
+        if(handler==nullptr)throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new(std::size_t size){
+    return countedAllocation(size);
+}
+void* operator new[](std::size_t size){
+    return countedAllocation(size);
+}
+void* operator new(std::size_t size,const std::nothrow_t&)noexcept{
+    nAllocations++;
+    return std::malloc(size==0 ? 1 : size);
+}
+void* operator new[](std::size_t size,const std::nothrow_t&)noexcept{
+    nAllocations++;
+    return std::malloc(size==0 ? 1 : size);
+}
+void operator delete(void* ptr)noexcept{
+    std::free(ptr);
+}
+void operator delete[](void* ptr)noexcept{
+    std::free(ptr);
+}
+void operator delete(void* ptr,std::size_t)noexcept{
+    std::free(ptr);
+}
+void operator delete[](void* ptr,std::size_t)noexcept{
+    std::free(ptr);
+}
+
+bool AllocationCounter::isEnabled() {
+    return true;
+}
+
+uint64_t AllocationCounter::getNAllocationsCurrentThread() {
+    return nAllocations;
+}
+
+void AllocationCounter::excludeAllocationsCurrentThread(const uint64_t nAllocations1) {
+    nAllocations-=nAllocations1;
+}
+#else
+bool AllocationCounter::isEnabled() {
+    return false;
+}
+
+uint64_t AllocationCounter::getNAllocationsCurrentThread() {
+    return 0;
+}
+
+void AllocationCounter::excludeAllocationsCurrentThread(const uint64_t nAllocations1) {
+}
+#endif
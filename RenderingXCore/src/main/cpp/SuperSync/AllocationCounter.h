@@ -0,0 +1,45 @@
+#ifndef RENDERINGX_ALLOCATIONCOUNTER_H
+#define RENDERINGX_ALLOCATIONCOUNTER_H
+
+#include <cstdint>
+
+// Counts the calls to the global operator new per thread.
+// Used to verify that the render loop does not allocate once it is warmed up (an allocation might
+// take the malloc lock or page fault, which is not acceptable when rendering into the front buffer).
+// Replacing the global operator new has a cost for the whole process, therefore the counting is only
+// compiled in when RENDERINGX_COUNT_ALLOCATIONS is defined (see RenderingXCore.cmake).
+// Without it, getNAllocationsCurrentThread() always returns 0
+namespace AllocationCounter{
+    // true if compiled with RENDERINGX_COUNT_ALLOCATIONS
+    bool isEnabled();
+    // Number of calls to operator new on the calling thread since the thread was started,
+    // without the ones inside an Exclude
+    uint64_t getNAllocationsCurrentThread();
+    // Subtracts nAllocations from the counter of the calling thread, see Exclude
+    void excludeAllocationsCurrentThread(uint64_t nAllocations);
+    // Counts the allocations on the calling thread between construction and getNAllocations()
+    class Scope{
+    public:
+        Scope():start(getNAllocationsCurrentThread()){}
+        uint64_t getNAllocations()const{
+            return getNAllocationsCurrentThread()-start;
+        }
+    private:
+        const uint64_t start;
+    };
+    // The allocations on the calling thread between construction and destruction are not counted by any Scope.
+    // For code in the render loop that is allowed to allocate, e.g. logging or the posted OpenGL work
+    class Exclude{
+    public:
+        Exclude():start(getNAllocationsCurrentThread()){}
+        ~Exclude(){
+            excludeAllocationsCurrentThread(getNAllocationsCurrentThread()-start);
+        }
+        Exclude(const Exclude&)=delete;
+        Exclude& operator=(const Exclude&)=delete;
+    private:
+        const uint64_t start;
+    };
+}
+
+#endif //RENDERINGX_ALLOCATIONCOUNTER_H
@@ -6,6 +6,7 @@
 #define RENDERINGX_DIRECTRENDER_HPP
 
 #include <Extensions.h>
+#include <GLState.hpp>
 
 // Direct Rendering refers to rendering a specific area ( and the specific area only)
 // This class hides the difference(s) between the two major GPU manufacturer: Qualcomm and MALI (ARM)
@@ -16,7 +17,7 @@ namespace DirectRender{
         glViewport(viewport[0],viewport[1],viewport[2],viewport[3]);
     }
     static void setGlScissor(const GLViewport& viewport){
-        glScissor(viewport[0],viewport[1],viewport[2],viewport[3]);
+        GLState::scissor(viewport[0],viewport[1],viewport[2],viewport[3]);
     }
     static void begin(const GLViewport& viewport){
         if(Extensions::QCOM_tiled_rendering){
@@ -3,6 +3,7 @@
 //
 
 #include "Extensions.h"
+#include "ThreadPlacement.h"
 #include <string>
 #include <jni.h>
 
@@ -57,8 +58,49 @@ PFNEGLGETFRAMETIMESTAMPSANDROIDPROC Extensions::eglGetFrameTimestampsANDROID;
 PFNEGLGETCOMPOSITORTIMINGANDROIDPROC Extensions::eglGetCompositorTimingANDROID;
 PFNEGLGETFRAMETIMESTAMPSUPPORTEDANDROIDPROC Extensions::eglGetFrameTimestampSupportedANDROID;
 //
+bool Extensions::GL_EXT_multisampled_render_to_texture_available;
+PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC Extensions::glRenderbufferStorageMultisampleEXT_;
+PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC Extensions::glFramebufferTexture2DMultisampleEXT_;
+bool Extensions::GL_OES_packed_depth_stencil_available;
+bool Extensions::GL_EXT_sRGB_available;
+bool Extensions::GL_EXT_texture_type_2_10_10_10_REV_available;
+//
 bool Extensions::EGL_KHR_swap_buffers_with_damage_available;
 PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC Extensions::eglSwapBuffersWithDamageKHR;
+//
+bool Extensions::EGL_KHR_image_base_available=false;
+PFNEGLCREATEIMAGEKHRPROC Extensions::eglCreateImageKHR_=nullptr;
+PFNEGLDESTROYIMAGEKHRPROC Extensions::eglDestroyImageKHR_=nullptr;
+bool Extensions::EGL_KHR_gl_texture_2D_image_available=false;
+bool Extensions::GL_OES_EGL_image_available=false;
+PFNGLEGLIMAGETARGETTEXTURE2DOESPROC Extensions::glEGLImageTargetTexture2DOES_=nullptr;
+bool Extensions::EGL_ANDROID_get_native_client_buffer_available=false;
+PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC Extensions::eglGetNativeClientBufferANDROID_=nullptr;
+bool Extensions::EGL_EXT_image_dma_buf_import_available=false;
+bool Extensions::EGL_MESA_image_dma_buf_export_available=false;
+PFNEGLEXPORTDMABUFIMAGEQUERYMESAPROC Extensions::eglExportDMABUFImageQueryMESA_=nullptr;
+PFNEGLEXPORTDMABUFIMAGEMESAPROC Extensions::eglExportDMABUFImageMESA_=nullptr;
+bool Extensions::EGL_ANDROID_native_fence_sync_available=false;
+PFNEGLDUPNATIVEFENCEFDANDROIDPROC Extensions::eglDupNativeFenceFDANDROID_=nullptr;
+bool Extensions::EGL_KHR_wait_sync_available=false;
+PFNEGLWAITSYNCKHRPROC Extensions::eglWaitSyncKHR_=nullptr;
+bool Extensions::GL_map_buffer_range_available=false;
+PFNGLMAPBUFFERRANGEEXTPROC Extensions::glMapBufferRange_=nullptr;
+PFNGLFLUSHMAPPEDBUFFERRANGEEXTPROC Extensions::glFlushMappedBufferRange_=nullptr;
+PFNGLUNMAPBUFFEROESPROC Extensions::glUnmapBuffer_=nullptr;
+GLenum Extensions::GL_HALF_FLOAT_VERTEX_ATTRIBUTE_TYPE=0;
+bool Extensions::GL_program_binary_available=false;
+PFNGLGETPROGRAMBINARYOESPROC Extensions::glGetProgramBinary_=nullptr;
+PFNGLPROGRAMBINARYOESPROC Extensions::glProgramBinary_=nullptr;
+Extensions::PFNGLPROGRAMPARAMETERIPROC_ Extensions::glProgramParameteri_=nullptr;
+bool Extensions::GL_KHR_parallel_shader_compile_available=false;
+Extensions::PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_ Extensions::glMaxShaderCompilerThreadsKHR_=nullptr;
+bool Extensions::GL_vertex_array_object_available=false;
+PFNGLGENVERTEXARRAYSOESPROC Extensions::glGenVertexArrays_=nullptr;
+PFNGLBINDVERTEXARRAYOESPROC Extensions::glBindVertexArray_=nullptr;
+PFNGLDELETEVERTEXARRAYSOESPROC Extensions::glDeleteVertexArrays_=nullptr;
+//
+int Extensions::GLES_MAJOR_VERSION=2;
 
 void Extensions::initializeGL(){
     const char* glExtensionsC=(const char*)glGetString(GL_EXTENSIONS);
@@ -130,6 +172,106 @@ void Extensions::initializeGL(){
         eglSwapBuffersWithDamageKHR=reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(eglGetProcAddress("eglSwapBuffersWithDamageKHR"));
         assert(eglSwapBuffersWithDamageKHR!=nullptr);
     }
+    if(ExtensionStringPresent("GL_EXT_multisampled_render_to_texture",glExtensions)){
+        GL_EXT_multisampled_render_to_texture_available=true;
+        glRenderbufferStorageMultisampleEXT_=reinterpret_cast<PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC>(eglGetProcAddress("glRenderbufferStorageMultisampleEXT"));
+        glFramebufferTexture2DMultisampleEXT_=reinterpret_cast<PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC>(eglGetProcAddress("glFramebufferTexture2DMultisampleEXT"));
+        assert(glRenderbufferStorageMultisampleEXT_!=nullptr && glFramebufferTexture2DMultisampleEXT_!=nullptr);
+    }
+    GL_OES_packed_depth_stencil_available=ExtensionStringPresent("GL_OES_packed_depth_stencil",glExtensions);
+    GL_EXT_sRGB_available=ExtensionStringPresent("GL_EXT_sRGB",glExtensions);
+    GL_EXT_texture_type_2_10_10_10_REV_available=ExtensionStringPresent("GL_EXT_texture_type_2_10_10_10_REV",glExtensions);
+    if(ExtensionStringPresent("EGL_KHR_image_base",eglExtensions)){
+        EGL_KHR_image_base_available=true;
+        eglCreateImageKHR_=reinterpret_cast<PFNEGLCREATEIMAGEKHRPROC>(eglGetProcAddress("eglCreateImageKHR"));
+        eglDestroyImageKHR_=reinterpret_cast<PFNEGLDESTROYIMAGEKHRPROC>(eglGetProcAddress("eglDestroyImageKHR"));
+        assert(eglCreateImageKHR_!=nullptr && eglDestroyImageKHR_!=nullptr);
+    }
+    EGL_KHR_gl_texture_2D_image_available=ExtensionStringPresent("EGL_KHR_gl_texture_2D_image",eglExtensions);
+    if(ExtensionStringPresent("GL_OES_EGL_image",glExtensions)){
+        GL_OES_EGL_image_available=true;
+        glEGLImageTargetTexture2DOES_=reinterpret_cast<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC>(eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+        assert(glEGLImageTargetTexture2DOES_!=nullptr);
+    }
+    if(ExtensionStringPresent("EGL_ANDROID_get_native_client_buffer",eglExtensions)){
+        EGL_ANDROID_get_native_client_buffer_available=true;
+        eglGetNativeClientBufferANDROID_=reinterpret_cast<PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC>(eglGetProcAddress("eglGetNativeClientBufferANDROID"));
+        assert(eglGetNativeClientBufferANDROID_!=nullptr);
+    }
+    EGL_EXT_image_dma_buf_import_available=ExtensionStringPresent("EGL_EXT_image_dma_buf_import",eglExtensions);
+    if(ExtensionStringPresent("EGL_MESA_image_dma_buf_export",eglExtensions)){
+        EGL_MESA_image_dma_buf_export_available=true;
+        eglExportDMABUFImageQueryMESA_=reinterpret_cast<PFNEGLEXPORTDMABUFIMAGEQUERYMESAPROC>(eglGetProcAddress("eglExportDMABUFImageQueryMESA"));
+        eglExportDMABUFImageMESA_=reinterpret_cast<PFNEGLEXPORTDMABUFIMAGEMESAPROC>(eglGetProcAddress("eglExportDMABUFImageMESA"));
+        assert(eglExportDMABUFImageQueryMESA_!=nullptr && eglExportDMABUFImageMESA_!=nullptr);
+    }
+    if(ExtensionStringPresent("EGL_ANDROID_native_fence_sync",eglExtensions)){
+        EGL_ANDROID_native_fence_sync_available=true;
+        eglDupNativeFenceFDANDROID_=reinterpret_cast<PFNEGLDUPNATIVEFENCEFDANDROIDPROC>(eglGetProcAddress("eglDupNativeFenceFDANDROID"));
+        assert(eglDupNativeFenceFDANDROID_!=nullptr);
+    }
+    if(ExtensionStringPresent("EGL_KHR_wait_sync",eglExtensions)){
+        EGL_KHR_wait_sync_available=true;
+        eglWaitSyncKHR_=reinterpret_cast<PFNEGLWAITSYNCKHRPROC>(eglGetProcAddress("eglWaitSyncKHR"));
+        assert(eglWaitSyncKHR_!=nullptr);
+    }
+    const char* glVersionC=(const char*)glGetString(GL_VERSION);
+    // "OpenGL ES <major>.<minor> <vendor-specific information>"
+    if(glVersionC!=nullptr && std::string(glVersionC).rfind("OpenGL ES 3",0)==0){
+        GLES_MAJOR_VERSION=3;
+    }
+    MLOGD<<"GLES_MAJOR_VERSION "<<GLES_MAJOR_VERSION;
+    if(GLES_MAJOR_VERSION>=3){
+        GL_map_buffer_range_available=true;
+        glMapBufferRange_=reinterpret_cast<PFNGLMAPBUFFERRANGEEXTPROC>(eglGetProcAddress("glMapBufferRange"));
+        glFlushMappedBufferRange_=reinterpret_cast<PFNGLFLUSHMAPPEDBUFFERRANGEEXTPROC>(eglGetProcAddress("glFlushMappedBufferRange"));
+        glUnmapBuffer_=reinterpret_cast<PFNGLUNMAPBUFFEROESPROC>(eglGetProcAddress("glUnmapBuffer"));
+    }else if(ExtensionStringPresent("GL_EXT_map_buffer_range",glExtensions) && ExtensionStringPresent("GL_OES_mapbuffer",glExtensions)){
+        GL_map_buffer_range_available=true;
+        glMapBufferRange_=reinterpret_cast<PFNGLMAPBUFFERRANGEEXTPROC>(eglGetProcAddress("glMapBufferRangeEXT"));
+        glFlushMappedBufferRange_=reinterpret_cast<PFNGLFLUSHMAPPEDBUFFERRANGEEXTPROC>(eglGetProcAddress("glFlushMappedBufferRangeEXT"));
+        glUnmapBuffer_=reinterpret_cast<PFNGLUNMAPBUFFEROESPROC>(eglGetProcAddress("glUnmapBufferOES"));
+    }
+    if(GL_map_buffer_range_available && (glMapBufferRange_==nullptr || glFlushMappedBufferRange_==nullptr || glUnmapBuffer_==nullptr)){
+        MLOGE<<"Cannot load map buffer range";
+        GL_map_buffer_range_available=false;
+    }
+    if(GLES_MAJOR_VERSION>=3){
+        GL_HALF_FLOAT_VERTEX_ATTRIBUTE_TYPE=0x140B; //GL_HALF_FLOAT
+    }else if(ExtensionStringPresent("GL_OES_vertex_half_float",glExtensions)){
+        GL_HALF_FLOAT_VERTEX_ATTRIBUTE_TYPE=GL_HALF_FLOAT_OES;
+    }
+    if(GLES_MAJOR_VERSION>=3){
+        glGetProgramBinary_=reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(eglGetProcAddress("glGetProgramBinary"));
+        glProgramBinary_=reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(eglGetProcAddress("glProgramBinary"));
+        glProgramParameteri_=reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC_>(eglGetProcAddress("glProgramParameteri"));
+    }else if(ExtensionStringPresent("GL_OES_get_program_binary",glExtensions)){
+        glGetProgramBinary_=reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(eglGetProcAddress("glGetProgramBinaryOES"));
+        glProgramBinary_=reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(eglGetProcAddress("glProgramBinaryOES"));
+    }
+    GLint nProgramBinaryFormats=0;
+    if(glGetProgramBinary_!=nullptr && glProgramBinary_!=nullptr){
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES,&nProgramBinaryFormats);
+    }
+    GL_program_binary_available=nProgramBinaryFormats>0;
+    MLOGD<<"GL_program_binary_available "<<GL_program_binary_available<<" n formats "<<nProgramBinaryFormats;
+    if(ExtensionStringPresent("GL_KHR_parallel_shader_compile",glExtensions)){
+        GL_KHR_parallel_shader_compile_available=true;
+        glMaxShaderCompilerThreadsKHR_=reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_>(eglGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        // Let the driver decide how many threads to use
+        if(glMaxShaderCompilerThreadsKHR_!=nullptr)glMaxShaderCompilerThreadsKHR_(0xFFFFFFFF);
+    }
+    if(GLES_MAJOR_VERSION>=3){
+        glGenVertexArrays_=reinterpret_cast<PFNGLGENVERTEXARRAYSOESPROC>(eglGetProcAddress("glGenVertexArrays"));
+        glBindVertexArray_=reinterpret_cast<PFNGLBINDVERTEXARRAYOESPROC>(eglGetProcAddress("glBindVertexArray"));
+        glDeleteVertexArrays_=reinterpret_cast<PFNGLDELETEVERTEXARRAYSOESPROC>(eglGetProcAddress("glDeleteVertexArrays"));
+    }else if(ExtensionStringPresent("GL_OES_vertex_array_object",glExtensions)){
+        glGenVertexArrays_=reinterpret_cast<PFNGLGENVERTEXARRAYSOESPROC>(eglGetProcAddress("glGenVertexArraysOES"));
+        glBindVertexArray_=reinterpret_cast<PFNGLBINDVERTEXARRAYOESPROC>(eglGetProcAddress("glBindVertexArrayOES"));
+        glDeleteVertexArrays_=reinterpret_cast<PFNGLDELETEVERTEXARRAYSOESPROC>(eglGetProcAddress("glDeleteVertexArraysOES"));
+    }
+    GL_vertex_array_object_available=glGenVertexArrays_!=nullptr && glBindVertexArray_!=nullptr && glDeleteVertexArrays_!=nullptr;
+    MLOGD<<"GL_vertex_array_object_available "<<GL_vertex_array_object_available;
     //other
     glInvalidateFramebuffer_  = (PFNGLINVALIDATEFRAMEBUFFER_)eglGetProcAddress("glInvalidateFramebuffer");
 }
@@ -140,4 +282,8 @@ void Java_constantin_renderingx_core_deviceinfo_Extensions_nativeSetThreadAffini
 CPUAffinityHelper::setAffinity(core);
 }
 
+void Java_constantin_renderingx_core_deviceinfo_Extensions_nativePlaceCurrentThread(JNIEnv *env, jclass jclass1,jint role) {
+    ThreadPlacement::placeCurrentThread(static_cast<ThreadPlacement::ThreadRole>(role));
+}
+
 }
\ No newline at end of file
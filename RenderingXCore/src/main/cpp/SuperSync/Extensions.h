@@ -15,6 +15,8 @@
 #include <GLES2/gl2ext.h>
 #include <AndroidLogger.hpp>
 #include <array>
+#include <cassert>
+#include <cstring>
 #include <vector>
 #include <optional>
 #include <TimeHelper.hpp>
@@ -28,6 +30,9 @@ namespace Extensions{
 
     // Call this once the OpenGL context becomes available
     void initializeGL();
+    // Major version of the current OpenGL ES context (2 or 3), parsed from GL_VERSION. Some entry points below
+    // are loaded from core OpenGL ES 3.0 if available and from the equivalent extension otherwise
+    extern int GLES_MAJOR_VERSION;
 
     // https://www.khronos.org/registry/OpenGL/extensions/QCOM/QCOM_tiled_rendering.txt
     extern bool QCOM_tiled_rendering;
@@ -85,9 +90,154 @@ namespace Extensions{
     extern PFNEGLGETCOMPOSITORTIMINGANDROIDPROC eglGetCompositorTimingANDROID;
     extern PFNEGLGETFRAMETIMESTAMPSUPPORTEDANDROIDPROC eglGetFrameTimestampSupportedANDROID;
 
+    // https://www.khronos.org/registry/OpenGL/extensions/EXT/EXT_multisampled_render_to_texture.txt
+    extern bool GL_EXT_multisampled_render_to_texture_available;
+    extern PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC glRenderbufferStorageMultisampleEXT_;
+    extern PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC glFramebufferTexture2DMultisampleEXT_;
+    // Formats that are not part of core OpenGL ES 2.0
+    // https://www.khronos.org/registry/OpenGL/extensions/OES/OES_packed_depth_stencil.txt
+    extern bool GL_OES_packed_depth_stencil_available;
+    // https://www.khronos.org/registry/OpenGL/extensions/EXT/EXT_sRGB.txt
+    extern bool GL_EXT_sRGB_available;
+    // https://www.khronos.org/registry/OpenGL/extensions/EXT/EXT_texture_type_2_10_10_10_REV.txt
+    extern bool GL_EXT_texture_type_2_10_10_10_REV_available;
+
     // https://www.khronos.org/registry/EGL/extensions/KHR/EGL_KHR_swap_buffers_with_damage.txt
     extern bool EGL_KHR_swap_buffers_with_damage_available;
     extern PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC eglSwapBuffersWithDamageKHR;
+
+    // EGLImage based buffer sharing between contexts / processes, see EGLImageExchange.hpp
+    // https://www.khronos.org/registry/EGL/extensions/KHR/EGL_KHR_image_base.txt
+    extern bool EGL_KHR_image_base_available;
+    extern PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR_;
+    extern PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR_;
+    // https://www.khronos.org/registry/EGL/extensions/KHR/EGL_KHR_gl_image.txt
+    extern bool EGL_KHR_gl_texture_2D_image_available;
+    // https://www.khronos.org/registry/OpenGL/extensions/OES/OES_EGL_image.txt
+    extern bool GL_OES_EGL_image_available;
+    extern PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES_;
+    // https://www.khronos.org/registry/EGL/extensions/ANDROID/EGL_ANDROID_get_native_client_buffer.txt
+    extern bool EGL_ANDROID_get_native_client_buffer_available;
+    extern PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC eglGetNativeClientBufferANDROID_;
+    // https://www.khronos.org/registry/EGL/extensions/EXT/EGL_EXT_image_dma_buf_import.txt
+    extern bool EGL_EXT_image_dma_buf_import_available;
+    // https://www.khronos.org/registry/EGL/extensions/MESA/EGL_MESA_image_dma_buf_export.txt
+    extern bool EGL_MESA_image_dma_buf_export_available;
+    extern PFNEGLEXPORTDMABUFIMAGEQUERYMESAPROC eglExportDMABUFImageQueryMESA_;
+    extern PFNEGLEXPORTDMABUFIMAGEMESAPROC eglExportDMABUFImageMESA_;
+    // https://www.khronos.org/registry/EGL/extensions/ANDROID/EGL_ANDROID_native_fence_sync.txt
+    extern bool EGL_ANDROID_native_fence_sync_available;
+    extern PFNEGLDUPNATIVEFENCEFDANDROIDPROC eglDupNativeFenceFDANDROID_;
+    // https://www.khronos.org/registry/EGL/extensions/KHR/EGL_KHR_wait_sync.txt
+    extern bool EGL_KHR_wait_sync_available;
+    extern PFNEGLWAITSYNCKHRPROC eglWaitSyncKHR_;
+
+    // Core in OpenGL ES 3.0, https://www.khronos.org/registry/OpenGL/extensions/EXT/EXT_map_buffer_range.txt on OpenGL ES 2.0
+    // The GL_MAP_*_BIT_EXT values are the same as the core ones
+    extern bool GL_map_buffer_range_available;
+    extern PFNGLMAPBUFFERRANGEEXTPROC glMapBufferRange_;
+    extern PFNGLFLUSHMAPPEDBUFFERRANGEEXTPROC glFlushMappedBufferRange_;
+    extern PFNGLUNMAPBUFFEROESPROC glUnmapBuffer_;
+
+    // Half float vertex attributes. Core in OpenGL ES 3.0 (GL_HALF_FLOAT), https://www.khronos.org/registry/OpenGL/extensions/OES/OES_vertex_half_float.txt
+    // on OpenGL ES 2.0 (GL_HALF_FLOAT_OES, different value). 0 if not supported
+    extern GLenum GL_HALF_FLOAT_VERTEX_ATTRIBUTE_TYPE;
+
+    // Core in OpenGL ES 3.0, https://www.khronos.org/registry/OpenGL/extensions/OES/OES_get_program_binary.txt on OpenGL ES 2.0
+    // Only true if the driver supports at least one binary format
+    extern bool GL_program_binary_available;
+    extern PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinary_;
+    extern PFNGLPROGRAMBINARYOESPROC glProgramBinary_;
+    // OpenGL ES 3.0 only, used for GL_PROGRAM_BINARY_RETRIEVABLE_HINT. nullptr otherwise
+    typedef void (GL_APIENTRYP PFNGLPROGRAMPARAMETERIPROC_) (GLuint program, GLenum pname, GLint value);
+    extern PFNGLPROGRAMPARAMETERIPROC_ glProgramParameteri_;
+
+    // https://www.khronos.org/registry/OpenGL/extensions/KHR/KHR_parallel_shader_compile.txt
+    // Compile / link in driver threads, poll GL_COMPLETION_STATUS_KHR instead of blocking
+    extern bool GL_KHR_parallel_shader_compile_available;
+    static constexpr GLenum GL_COMPLETION_STATUS_KHR_=0x91B1;
+    typedef void (GL_APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_) (GLuint count);
+    extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_ glMaxShaderCompilerThreadsKHR_;
+
+    // Core in OpenGL ES 3.0, https://www.khronos.org/registry/OpenGL/extensions/OES/OES_vertex_array_object.txt on OpenGL ES 2.0
+    extern bool GL_vertex_array_object_available;
+    extern PFNGLGENVERTEXARRAYSOESPROC glGenVertexArrays_;
+    extern PFNGLBINDVERTEXARRAYOESPROC glBindVertexArray_;
+    extern PFNGLDELETEVERTEXARRAYSOESPROC glDeleteVertexArrays_;
+}
+
+// A native fence is a sync_file fd that is signaled once the GPU reached the fence in the command stream.
+// Unlike a EGLSyncKHR it can be passed to another process (e.g. over a unix socket) or to a different EGLDisplay.
+namespace NativeFence{
+    static bool isAvailable(){
+        return Extensions::EGL_ANDROID_native_fence_sync_available && Extensions::GL_OES_EGL_sync;
+    }
+    // Inserts a fence into the command stream of the current context and returns its fd, -1 on failure.
+    // The caller owns the returned fd
+    static int create(){
+        if(!isAvailable())return -1;
+        const EGLDisplay dpy=eglGetCurrentDisplay();
+        const EGLSyncKHR sync=Extensions::eglCreateSyncKHR(dpy,EGL_SYNC_NATIVE_FENCE_ANDROID,nullptr);
+        if(sync==EGL_NO_SYNC_KHR){
+            MLOGE<<"Cannot create native fence";
+            return -1;
+        }
+        // The fd can only be duplicated once the fence was flushed
+        glFlush();
+        const int fd=Extensions::eglDupNativeFenceFDANDROID_(dpy,sync);
+        Extensions::eglDestroySyncKHR(dpy,sync);
+        return fd==EGL_NO_NATIVE_FENCE_FD_ANDROID ? -1 : fd;
+    }
+    // Makes the GPU wait for the fence before executing the following commands of the current context.
+    // The CPU does not block, unless EGL_KHR_wait_sync is not available.
+    // Takes ownership of the fd. -1 means there is nothing to wait for
+    static bool waitGPU(const int fd){
+        if(fd<0)return true;
+        if(!isAvailable()){
+            close(fd);
+            return false;
+        }
+        const EGLDisplay dpy=eglGetCurrentDisplay();
+        const EGLint attribs[]={EGL_SYNC_NATIVE_FENCE_FD_ANDROID,fd,EGL_NONE};
+        const EGLSyncKHR sync=Extensions::eglCreateSyncKHR(dpy,EGL_SYNC_NATIVE_FENCE_ANDROID,attribs);
+        if(sync==EGL_NO_SYNC_KHR){
+            // EGL only takes ownership on success
+            MLOGE<<"Cannot import native fence";
+            close(fd);
+            return false;
+        }
+        bool ret;
+        if(Extensions::EGL_KHR_wait_sync_available){
+            ret=Extensions::eglWaitSyncKHR_(dpy,sync,0)==EGL_TRUE;
+        }else{
+            ret=Extensions::eglClientWaitSyncKHR(dpy,sync,0,EGL_FOREVER_KHR)==EGL_CONDITION_SATISFIED_KHR;
+        }
+        Extensions::eglDestroySyncKHR(dpy,sync);
+        return ret;
+    }
+}
+
+// Damage rectangles are x,y,width,height with the origin at the bottom left of the surface (same as glViewport)
+namespace SwapBuffersWithDamage{
+    // Falls back to eglSwapBuffers if EGL_KHR_swap_buffers_with_damage is not available
+    // Note: nRects==0 means the whole surface is damaged
+    static EGLBoolean swap(EGLDisplay dpy,EGLSurface surface,const EGLint* rects,EGLint nRects){
+        if(Extensions::EGL_KHR_swap_buffers_with_damage_available){
+            return Extensions::eglSwapBuffersWithDamageKHR(dpy,surface,const_cast<EGLint*>(rects),nRects);
+        }
+        return eglSwapBuffers(dpy,surface);
+    }
+    // true if the content of the surface is still valid after eglSwapBuffers - either when rendering
+    // into the front buffer (EGL_SINGLE_BUFFER) or with EGL_BUFFER_PRESERVED.
+    // Only then it is safe to re-draw the damaged area only
+    static bool isContentPreserved(EGLDisplay dpy,EGLSurface surface){
+        EGLint renderBuffer=EGL_BACK_BUFFER;
+        eglQuerySurface(dpy,surface,EGL_RENDER_BUFFER,&renderBuffer);
+        if(renderBuffer==EGL_SINGLE_BUFFER)return true;
+        EGLint swapBehaviour=EGL_BUFFER_DESTROYED;
+        eglQuerySurface(dpy,surface,EGL_SWAP_BEHAVIOR,&swapBehaviour);
+        return swapBehaviour==EGL_BUFFER_PRESERVED;
+    }
 }
 
 
@@ -187,6 +337,101 @@ public:
         }
     }
 };
+// Reading back the result of a TimerQuery directly after the commands were submitted stalls the CPU (or the result is not yet available)
+// This ring of queries is read back N frames later instead. Each measurement has a user-defined tag (e.g. which eye)
+// Only one measurement can be active at a time (GL_TIME_ELAPSED_EXT queries cannot be nested)
+template<size_t N_SLOTS=8>
+class TimerQueryRing{
+private:
+    struct Slot{
+        GLuint query=0;
+        int tag=0;
+    };
+    std::array<Slot,N_SLOTS> slots;
+    // Queries are created lazily, since there might be no OpenGL context when the TimerQueryRing is created
+    bool initialized=false;
+    // next slot to begin a query on
+    size_t head=0;
+    // oldest slot that might still be pending
+    size_t tail=0;
+    size_t nPending=0;
+    bool active=false;
+public:
+    // Measurements that were overwritten before they became available
+    int nDropped=0;
+    // Measurements discarded because the GPU reported a disjoint operation (e.g. frequency change)
+    int nDisjoint=0;
+    ~TimerQueryRing(){
+        if(initialized){
+            for(auto& slot:slots){
+                Extensions::glDeleteQueriesEXT_(1,&slot.query);
+            }
+        }
+    }
+    static bool isAvailable(){
+        return Extensions::GL_EXT_disjoint_timer_query_available;
+    }
+    void begin(const int tag){
+        assert(isAvailable());
+        assert(!active);
+        if(!initialized){
+            for(auto& slot:slots){
+                Extensions::glGenQueriesEXT_(1,&slot.query);
+            }
+            // Clear a disjoint operation that happened before the first measurement
+            GLint disjointOccurred=0;
+            glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjointOccurred);
+            initialized=true;
+        }
+        if(nPending==N_SLOTS){
+            // The oldest result was never read back - reuse its query
+            tail=(tail+1)%N_SLOTS;
+            nPending--;
+            nDropped++;
+        }
+        auto& slot=slots[head];
+        slot.tag=tag;
+        Extensions::glBeginQueryEXT_(GL_TIME_ELAPSED_EXT,slot.query);
+        active=true;
+    }
+    void end(){
+        assert(active);
+        Extensions::glEndQueryEXT_(GL_TIME_ELAPSED_EXT);
+        head=(head+1)%N_SLOTS;
+        nPending++;
+        active=false;
+    }
+    // Read back all available results, oldest first, without blocking
+    // onResult(int tag,std::chrono::nanoseconds gpuTime) is called for each result
+    template<class ON_RESULT>
+    void collect(ON_RESULT&& onResult){
+        if(!initialized)return;
+        // Queries complete in order, so stop at the first one that is not available yet
+        size_t nAvailable=0;
+        for(size_t i=0;i<nPending;i++){
+            GLint available=0;
+            Extensions::glGetQueryObjectivEXT_(slots[(tail+i)%N_SLOTS].query, Extensions::GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available)break;
+            nAvailable++;
+        }
+        if(nAvailable==0)return;
+        // If a disjoint operation occurred since the last check, the results of all queries that finished in between are unreliable
+        GLint disjointOccurred=0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjointOccurred);
+        for(size_t i=0;i<nAvailable;i++){
+            auto& slot=slots[tail];
+            if(disjointOccurred){
+                nDisjoint++;
+            }else{
+                GLuint64 timeElapsed;
+                Extensions::glGetQueryObjectui64vEXT_(slot.query, Extensions::GL_QUERY_RESULT, &timeElapsed);
+                onResult(slot.tag,std::chrono::nanoseconds(timeElapsed));
+            }
+            tail=(tail+1)%N_SLOTS;
+            nPending--;
+        }
+    }
+};
 
 
 // https://www.khronos.org/registry/EGL/extensions/ANDROID/EGL_ANDROID_get_frame_timestamps.txt
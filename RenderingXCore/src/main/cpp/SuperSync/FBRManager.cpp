@@ -4,9 +4,13 @@
 #include <android/log.h>
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
+#include <cassert>
 #include <sstream>
 #include "FBRManager.h"
 #include "Extensions.h"
+#include <GLState.hpp>
+#include <GLInstrumentation.hpp>
+#include "ThreadPlacement.h"
 #include <AndroidLogger.hpp>
 #include <NDKThreadHelper.hpp>
 #include <utility>
@@ -28,7 +32,20 @@ vsync(*vsync),CHANGE_CLEAR_COLOR_TO_MAKE_TEARING_OBSERVABLE(CHANGE_CLEAR_COLOR_T
     resetTS();
 }
 
-void FBRManager::enterWarping(JNIEnv* env,VrCompositorRenderer& vrCompositorRenderer,std::function<void(JNIEnv*)> optionalCallback){
+void FBRManager::setRenderNewEyeCallback(RENDER_NEW_EYE_CALLBACK renderNewEyeCallback1) {
+    renderNewEyeCallback=std::move(renderNewEyeCallback1);
+}
+
+void FBRManager::setMinEyeBudget(VSYNC::CLOCK::duration minEyeBudget1) {
+    minEyeBudget=minEyeBudget1;
+}
+
+void FBRManager::setTelemetry(FrameTimingTelemetry *telemetry1) {
+    telemetry=telemetry1;
+}
+
+void FBRManager::enterWarping(JNIEnv* env,VrCompositorRenderer& vrCompositorRenderer,const std::function<void(JNIEnv*)>& optionalCallback){
+    ThreadPlacement::placeCurrentThread(ThreadPlacement::ThreadRole::FBR_RENDER);
     JThread jThread(env);
     Chronometer callJavaTime{"Call java isInterrupted()"};
     while (true){
@@ -45,10 +62,13 @@ void FBRManager::enterWarping(JNIEnv* env,VrCompositorRenderer& vrCompositorRend
 }
 
 void FBRManager::warpEyesToFrontBufferSynchronized(JNIEnv* env,VrCompositorRenderer& vrCompositorRenderer) {
+    const AllocationCounter::Scope allocationScope;
     const auto latestVSYNC=vsync.getLatestVSYNC();
     const auto nextVSYNCMiddle=latestVSYNC.base+vsync.getEyeRefreshTime()+std::chrono::milliseconds(0);
     const auto nextVSYNC=latestVSYNC.base+vsync.getDisplayRefreshTime()+std::chrono::milliseconds(0);
     if(lastRenderedFrame.count+1!=latestVSYNC.count){
+        // Logging allocates, that is not counted as an allocation of the render loop
+        const AllocationCounter::Exclude logging;
         MLOGE<<"Probably missed VSYNC "<<lastRenderedFrame.count<<" "<<latestVSYNC.count<<" "<<vsync.getVsyncRasterizerPositionNormalized()<<" "<<MyTimeHelper::R(CLOCK::now()-latestVSYNC.base);
     }
     lastRenderedFrame=latestVSYNC;
@@ -66,15 +86,32 @@ void FBRManager::warpEyesToFrontBufferSynchronized(JNIEnv* env,VrCompositorRende
     for(int eye=1;eye>=0;eye--){
         const bool isLeftEye=eye==0;
         const auto nextEvent=eye==1 ? nextVSYNCMiddle : nextVSYNC;
-        if(CLOCK::now()>nextEvent){
-            MLOGE<<"Event already passed";
+        const auto budgetBeforeEye=nextEvent-CLOCK::now();
+        if(budgetBeforeEye<=minEyeBudget){
+            {
+                const AllocationCounter::Exclude logging;
+                MLOGE<<"Event already passed "<<MyTimeHelper::R(budgetBeforeEye);
+            }
+            eyeRenderModeStats[eye].count[(int)EyeRenderMode::SKIPPED]++;
+            if(telemetry){
+                const auto now=FrameTimingTelemetry::toNs(CLOCK::now());
+                telemetry->pushEye({FrameTimingTelemetry::Record::Type::EYE,(uint8_t)eye,(uint8_t)EyeRenderMode::SKIPPED,true,
+                                    latestVSYNC.count,now,now,0,-FrameTimingTelemetry::toNs(budgetBeforeEye),FrameTimingTelemetry::GPU_TIME_NONE,
+                                    vsync.getVsyncRasterizerPositionNormalized()});
+            }
             continue;
         }
+        // The compositor tags its own work (layers, occlusion mesh)
+        const GLInstrumentation::ScopedTag glTag(GLInstrumentation::Subsystem::FBR);
         //render new eye (right eye first)
         ATrace_beginSection(eye==0 ? "FBRManager::renderLeftEye" : "FBRManager::renderRightEye");
+        const auto cpuStart=CLOCK::now();
         eyeChrono[eye].avgCPUTime.start();
-        TimerQuery timerQuery;
-        timerQuery.begin();
+        const bool measureGPUTime=TimerQueryRing<>::isAvailable();
+        if(measureGPUTime){
+            // the eye can be derived from the tag, and the telemetry needs the vsync count to join the GPU time
+            gpuTimerQueries.begin(latestVSYNC.count*2+eye);
+        }
         ATrace_beginSection("SurfaceTexture::update");
         avgCPUTimeUpdateSurfaceTexture.start();
         surfaceTextureUpdate->updateAndCheck(env);
@@ -84,48 +121,101 @@ void FBRManager::warpEyesToFrontBufferSynchronized(JNIEnv* env,VrCompositorRende
         DirectRender::begin(vrCompositorRenderer.getViewportForEye(isLeftEye ? GVR_LEFT_EYE : GVR_RIGHT_EYE));
         ATrace_endSection();
         ATrace_beginSection("renderNewEyeCallback");
-        drawEye(env,isLeftEye,vrCompositorRenderer);
+        // Built right before the callback, such that the remaining budget does not include the SurfaceTexture update
+        const EyeDeadline deadline{isLeftEye,nextEvent-CLOCK::now(),nextEvent,latestVSYNC.count};
+        eyeRenderModeStats[eye].avgRemainingBudget.add(deadline.remainingBudget);
+        const EyeRenderMode eyeRenderMode=drawEye(env,deadline,vrCompositorRenderer);
+        eyeRenderModeStats[eye].count[(int)eyeRenderMode]++;
         ATrace_endSection();
         ATrace_beginSection("DirectRendering::end");
         DirectRender::end();
         eyeChrono[eye].avgCPUTime.stop();
+        const auto cpuEnd=CLOCK::now();
         ATrace_endSection();
         ATrace_beginSection("Wait for GPU completion");
-        std::unique_ptr<FenceSync> fenceSync=std::make_unique<FenceSync>();
+        if(measureGPUTime){
+            gpuTimerQueries.end();
+        }
+        FenceSync& fenceSync=eyeFences[eye].emplace();
         glFlush();
-        timerQuery.end();
+        const float rasterizerPositionAtSubmit=vsync.getVsyncRasterizerPositionNormalized();
         vsyncWaitTime[eye].start();
-        waitUntilTimePoint(nextEvent,*fenceSync);
+        const auto overshoot=waitUntilTimePoint(nextEvent,fenceSync,vrCompositorRenderer);
         ATrace_endSection();
         //timerQuery.print();
         //MLOGD<<"Time from fence "<<MyTimeHelper::R(fenceSync->getDeltaCreationSatisfied());
 
         //MLOGD<<"Vsync pos "<<getVsyncRasterizerPositionNormalized();
         eyeChrono[eye].nEyes++;
-        if(fenceSync->hasAlreadyBeenSatisfied()){
-            eyeChrono[eye].avgGPUTime.add(fenceSync->getDeltaCreationSatisfied());
+        const bool gpuFinishedBeforeDeadline=fenceSync.hasAlreadyBeenSatisfied();
+        if(gpuFinishedBeforeDeadline){
+            // Without timer queries the fence is the only source for the GPU time
+            if(!measureGPUTime){
+                eyeChrono[eye].avgGPUTime.add(fenceSync.getDeltaCreationSatisfied());
+                eyeChrono[eye].gpuTimeHistogram.add(fenceSync.getDeltaCreationSatisfied());
+            }
         }else{
-            MLOGE<<"Couldnt measure GPU time";
+            const AllocationCounter::Exclude logging;
+            MLOGE<<"GPU did not finish eye before deadline";
             eyeChrono[eye].nEyesNotMeasurable++;
         }
-        fenceSync.reset(nullptr);
         vsyncWaitTime[eye].stop();
+        if(telemetry){
+            const auto waitTime=CLOCK::now()-cpuEnd;
+            telemetry->pushEye({FrameTimingTelemetry::Record::Type::EYE,(uint8_t)eye,(uint8_t)eyeRenderMode,!gpuFinishedBeforeDeadline,
+                                latestVSYNC.count,FrameTimingTelemetry::toNs(cpuStart),FrameTimingTelemetry::toNs(cpuEnd),
+                                FrameTimingTelemetry::toNs(waitTime),FrameTimingTelemetry::toNs(overshoot),
+                                measureGPUTime ? FrameTimingTelemetry::GPU_TIME_PENDING : FrameTimingTelemetry::GPU_TIME_NONE,rasterizerPositionAtSubmit});
+        }
         //MLOGD<<"VSYNC pos "<<getVsyncRasterizerPositionNormalized();
     }
+    gpuTimerQueries.collect([this](const int tag,const std::chrono::nanoseconds gpuTime){
+        const int eye=tag & 1;
+        eyeChrono[eye].avgGPUTime.add(gpuTime);
+        eyeChrono[eye].gpuTimeHistogram.add(gpuTime);
+        if(telemetry){
+            telemetry->pushGPUTime((tag-eye)/2,eye,gpuTime);
+        }
+    });
+    nFramesRendered++;
+    if(nFramesRendered>N_WARM_UP_FRAMES){
+        const uint64_t nAllocations=allocationScope.getNAllocations();
+        if(nAllocations>0){
+            // Once warmed up, the render loop must not allocate (see AllocationCounter.h)
+            const AllocationCounter::Exclude logging;
+            MLOGE<<"Frame "<<nFramesRendered<<" allocated "<<nAllocations<<" times after warm-up";
+            assert(nAllocations==0);
+        }
+        nSteadyStateAllocations+=nAllocations;
+    }
+    // The periodic logs allocate, they are done after the allocations of this frame were checked
     printLog();
+    vrCompositorRenderer.printLogIfNeeded();
 }
 
 
-VSYNC::CLOCK::duration FBRManager::waitUntilTimePoint(const std::chrono::steady_clock::time_point& timePoint,FenceSync& fenceSync) {
+VSYNC::CLOCK::duration FBRManager::waitUntilTimePoint(const std::chrono::steady_clock::time_point& timePoint,FenceSync& fenceSync,VrCompositorRenderer& vrCompositorRenderer) {
     const auto timeLeft=timePoint-CLOCK::now();
     if(timeLeft<=0ns){
-        MLOGE<<"Time point already elapsed(wait)";
+        {
+            const AllocationCounter::Exclude logging;
+            MLOGE<<"Time point already elapsed(wait)";
+        }
         const auto overshoot=CLOCK::now()-timePoint;
         ATrace_endSection();
         return overshoot;
     }
     fenceSync.wait(timeLeft);
     ATrace_endSection();
+    // The GPU finished the eye, use some of the time until the deadline for the OpenGL work posted into the GLWorkQueue
+    if(fenceSync.hasAlreadyBeenSatisfied()){
+        const auto slack=timePoint-CLOCK::now();
+        if(slack>MIN_GL_WORK_SLACK){
+            // The posted work (e.g. uploading a mesh) allocates, that is not an allocation of the render loop
+            const AllocationCounter::Exclude glWork;
+            vrCompositorRenderer.executeGLWork(slack/2);
+        }
+    }
     ATrace_beginSection("Sleep");
     std::this_thread::sleep_until(timePoint);
     const auto overshoot=CLOCK::now()-timePoint;
@@ -138,6 +228,11 @@ void FBRManager::printLog() {
     const auto now=steady_clock::now();
     if(now-lastLog>std::chrono::seconds(3)){//every 5 seconds
         lastLog=now;
+        // With telemetry the formatting is done on the telemetry thread, but the averages are still reset periodically
+        if(telemetry!=nullptr){
+            resetTS();
+            return;
+        }
         auto& leChrono=eyeChrono[0];
         auto& reChrono=eyeChrono[1];
         double leGPUTimeNotMeasurablePerc=0;
@@ -155,11 +250,27 @@ void FBRManager::printLog() {
         avgLog << "\nCPU Time: "<<"leftEye: " << leChrono.avgCPUTime.getAvgReadable() << " | rightEye:" << reChrono.avgCPUTime.getAvgReadable();
         avgLog << "\nGPU time: "<<"leftEye: " << leChrono.avgGPUTime.getAvgReadable() << " | rightEye:" << reChrono.avgGPUTime.getAvgReadable()
         <<" | left&right:" <<(leChrono.avgGPUTime+reChrono.avgGPUTime).getAvgReadable();
-        avgLog<<"\nGPU % not measurable:"<<": leftEye:"<<leGPUTimeNotMeasurablePerc<<" | rightEye:"<<reGPUTimeNotMeasurablePerc
+        avgLog<<"\nGPU time distribution: "<<"leftEye: "<<leChrono.gpuTimeHistogram.getPercentilesReadable()
+        <<" | rightEye: "<<reChrono.gpuTimeHistogram.getPercentilesReadable();
+        avgLog<<"\nGPU % not finished before deadline:"<<": leftEye:"<<leGPUTimeNotMeasurablePerc<<" | rightEye:"<<reGPUTimeNotMeasurablePerc
         <<" | left&right:"<<leAreGPUTimeNotMeasurablePerc;
+        if(TimerQueryRing<>::isAvailable()){
+            avgLog<<"\nTimer queries dropped: "<<gpuTimerQueries.nDropped<<" disjoint: "<<gpuTimerQueries.nDisjoint;
+        }
         avgLog<<"\nVsync waitT:"<<" start: "<< vsyncWaitTime[0].getAvgReadable()<<" | middle: "<<vsyncWaitTime[1].getAvgReadable()
         <<" | start&middle "<<(vsyncWaitTime[0]+vsyncWaitTime[1]).getAvgReadable();
         avgLog<<"\n SurfaceTexture update "<<avgCPUTimeUpdateSurfaceTexture.getAvgReadable();
+        if(AllocationCounter::isEnabled()){
+            avgLog<<"\nAllocations after warm-up: "<<nSteadyStateAllocations;
+        }
+        for(int eye=0;eye<2;eye++){
+            const auto& stats=eyeRenderModeStats[eye];
+            avgLog<<"\nEye render modes "<<(eye==0 ? "leftEye:" : "rightEye:");
+            for(int mode=0;mode<3;mode++){
+                avgLog<<" "<<EYE_RENDER_MODE_NAMES[mode]<<" "<<stats.count[mode];
+            }
+            avgLog<<" | remaining budget "<<stats.avgRemainingBudget.getAvgReadable();
+        }
         //avgLog<<"\nDisplay refresh time ms:"<<DISPLAY_REFRESH_TIME/1000.0/1000.0;
         avgLog<<"\n----  -----  ----  ----  ----  ----  ----  ----  --- ---";
         MLOGD<<avgLog.str();
@@ -169,13 +280,16 @@ void FBRManager::printLog() {
 
 void FBRManager::resetTS() {
     for(int eye=0;eye<2;eye++){
-        vsyncWaitTime[0].reset();
+        vsyncWaitTime[eye].reset();
     }
     for(int i=0;i<2;i++){
         eyeChrono[i].avgCPUTime.reset();
         eyeChrono[i].avgGPUTime.reset();
+        eyeChrono[i].gpuTimeHistogram.reset();
         eyeChrono[i].nEyes=0;
         eyeChrono[i].nEyesNotMeasurable=0;
+        eyeRenderModeStats[i].count={};
+        eyeRenderModeStats[i].avgRemainingBudget.reset();
     }
 }
 
@@ -198,6 +312,17 @@ void FBRManager::drawEye(JNIEnv *env, const bool leftEye, VrCompositorRenderer &
     ATrace_endSection();
 }
 
+EyeRenderMode FBRManager::drawEye(JNIEnv *env,const EyeDeadline& deadline,VrCompositorRenderer &vrCompositorRenderer) {
+    if(renderNewEyeCallback== nullptr){
+        drawEye(env,deadline.isLeftEye,vrCompositorRenderer);
+        return EyeRenderMode::FULL;
+    }
+    ATrace_beginSection("drawEye(callback)");
+    const auto ret=renderNewEyeCallback(env,vrCompositorRenderer,deadline);
+    ATrace_endSection();
+    return ret;
+}
+
 void FBRManager::drawEyesToFrontBufferUnsynchronized(JNIEnv *env,VrCompositorRenderer &vrCompositorRenderer) {
     //JThread jThread(env);
     //while (!jThread.isInterrupted()){
@@ -209,11 +334,13 @@ void FBRManager::drawEyesToFrontBufferUnsynchronized(JNIEnv *env,VrCompositorRen
             DirectRender::begin(vrCompositorRenderer.getViewportForEye(isLeftEye ? GVR_LEFT_EYE : GVR_RIGHT_EYE));
             drawEye(env,isLeftEye,vrCompositorRenderer);
             DirectRender::end();
-            std::unique_ptr<FenceSync> fenceSync=std::make_unique<FenceSync>();
+            FenceSync& fenceSync=eyeFences[eye].emplace();
             glFlush();
             // Make sure that I do not submit eyes faster than the GPU is able to render them
-            fenceSync->wait(std::chrono::milliseconds(100));
+            fenceSync.wait(std::chrono::milliseconds(100));
         }
+        vrCompositorRenderer.executeGLWork();
+        vrCompositorRenderer.printLogIfNeeded();
     //}
 }
 
@@ -221,7 +348,27 @@ void FBRManager::drawFramesToFrontBufferUnsynchronized(JNIEnv *env,
                                                        VrCompositorRenderer &vrCompositorRenderer) {
     //JThread jThread(env);
     //while (!jThread.isInterrupted()){
-        glClear(GLHelper::ALL_GL_BUFFERS);
+        const EGLDisplay display=eglGetCurrentDisplay();
+        const EGLSurface surface=eglGetCurrentSurface(EGL_DRAW);
+        // Only the damaged area has to be cleared and re-drawn if the surface keeps its content. The alternating clear color
+        // needs the whole eye to be re-drawn each frame
+        const bool partialRedraw=!CHANGE_CLEAR_COLOR_TO_MAKE_TEARING_OBSERVABLE && SwapBuffersWithDamage::isContentPreserved(display,surface);
+        const auto& damage=vrCompositorRenderer.updateFrameDamage(partialRedraw);
+        if(partialRedraw){
+            GLint previousScissor[4];
+            glGetIntegerv(GL_SCISSOR_BOX,previousScissor);
+            const GLboolean previousScissorEnabled=glIsEnabled(GL_SCISSOR_TEST);
+            GLState::enable(GL_SCISSOR_TEST);
+            for(const auto& rect:damage.eyeRects){
+                if(!rect)continue;
+                DirectRender::setGlScissor(*rect);
+                glClear(GLHelper::ALL_GL_BUFFERS);
+            }
+            GLState::scissor(previousScissor[0],previousScissor[1],previousScissor[2],previousScissor[3]);
+            if(!previousScissorEnabled)GLState::disable(GL_SCISSOR_TEST);
+        }else{
+            glClear(GLHelper::ALL_GL_BUFFERS);
+        }
         SurfaceTextureUpdate* surfaceTextureUpdate=std::get<SurfaceTextureUpdate*>(vrCompositorRenderer.getLayers().at(0).contentProvider);
         for(int eye=0;eye<2;eye++){
             surfaceTextureUpdate->updateAndCheck(env);
@@ -229,7 +376,12 @@ void FBRManager::drawFramesToFrontBufferUnsynchronized(JNIEnv *env,
             const bool isLeftEye=eye==0;
             drawEye(env,isLeftEye,vrCompositorRenderer);
         }
-        eglSwapBuffers(eglGetCurrentDisplay(),eglGetCurrentSurface(EGL_DRAW));
+        // Even if everything was re-drawn the content outside the damage did not change, the compositor can still make use of it
+        std::array<EGLint,8> damageRects{};
+        const EGLint nDamageRects=damage.writeEGLRects(damageRects);
+        SwapBuffersWithDamage::swap(display,surface,damageRects.data(),nDamageRects);
+        vrCompositorRenderer.executeGLWork();
+        vrCompositorRenderer.printLogIfNeeded();
     //}
 }
 
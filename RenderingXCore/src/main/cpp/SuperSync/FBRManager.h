@@ -1,10 +1,13 @@
 /* *********************************************************************************************************************************************
  * Front Buffer rendering
- * 1 Callback Function to register:
+ * 1 Callback Function to register (see setRenderNewEyeCallback() ):
  * //called when the VSYNC rasterizer is at Position <0.5 or Position >0.5
- * //@param whichEye: leftEye if VSYNC is at Position 0.5, rightEye if at Position 0
- * //@param offsetNS: how much time has already elapsed since the eye event
- * onRenderNewEye(boolean whichEye,int64_t offsetNS)
+ * //@param deadline: which eye, the remaining time budget until the rasterizer starts scanning out this eye
+ * //and the predicted scanout time
+ * //@return what was actually rendered (FULL,DEGRADED or SKIPPED). The FBRManager keeps statistics per eye and mode
+ * EyeRenderMode onRenderNewEye(JNIEnv* env,VrCompositorRenderer& renderer,const EyeDeadline& deadline)
+ * //If the scanout of the eye has already started when the FBRManager is ready (or less than minEyeBudget is left),
+ * //the callback is not called at all and the eye is counted as SKIPPED - rendering it now would only produce tearing.
  * //If the application did not render the last eye in less than 8.3ms (half a frame),but in less than 16.6ms, the function will still be called.
  * //With offset being the time the last function exceeded its time frame.
  * //   It is up to the developer to decide what to do in this case. E.g. you might say:
@@ -38,6 +41,9 @@
  * But this value only gets written if the time was actually measurable. If not,
  * leftEye/rightEyeNotMeasurableEyes is incremented, and the % of left/right eyes that couldn't be measured is calculated.
  * If there is no VSYNC_CALLBACK_ADVANCE this % is also a indication of how many frames "failed" btw. did tear
+ * Update: If GL_EXT_disjoint_timer_query is available, the GPU time of each eye is measured with a ring of timer queries
+ * that are read back a few frames later. Then the GPU time is always available and the % above only counts
+ * the eyes where the GPU did not finish before the deadline.
  * *********************************************************************************************************************************************/
 
 #ifndef FPV_VR_FBRMANAGER2_H
@@ -52,43 +58,102 @@
 #include <EGL/eglext.h>
 #include "VSYNC.h"
 #include "DirectRender.hpp"
+#include <DurationHistogram.hpp>
+#include "FrameTimingTelemetry.h"
+#include "AllocationCounter.h"
+#include <optional>
 #include <SurfaceTextureUpdate.hpp>
 #include <VrCompositorRenderer.h>
 
-//using RENDER_NEW_EYE_CALLBACK=std::function<void(JNIEnv*,bool)>;
+// What the render new eye callback actually did
+enum class EyeRenderMode{
+    FULL=0,     // all content was rendered
+    DEGRADED=1, // some (heavy) content was reduced or left out to meet the deadline
+    SKIPPED=2   // nothing was rendered for this eye
+};
+// Passed to the render new eye callback
+struct EyeDeadline{
+    bool isLeftEye;
+    // Time left until the rasterizer starts scanning out the eye (at the moment the callback is invoked)
+    VSYNC::CLOCK::duration remainingBudget;
+    // When the rasterizer is predicted to start scanning out the eye
+    VSYNC::CLOCK::time_point predictedScanout;
+    // The VSYNC count this eye belongs to
+    int vsyncCount;
+};
+// Called in between DirectRender::begin and DirectRender::end, so only draw calls are needed
+using RENDER_NEW_EYE_CALLBACK=std::function<EyeRenderMode(JNIEnv*,VrCompositorRenderer&,const EyeDeadline&)>;
 
 class FBRManager{
 public:
     FBRManager(VSYNC* vsync,bool CHANGE_CLEAR_COLOR_TO_MAKE_TEARING_OBSERVABLE);
+    // Replace the default eye rendering (optional clear color change & VrCompositorRenderer::drawLayers(), always FULL)
+    // with a deadline aware one
+    // Must not be called while warping
+    void setRenderNewEyeCallback(RENDER_NEW_EYE_CALLBACK renderNewEyeCallback);
+    // Eyes with less remaining budget than this are skipped without calling the render new eye callback
+    void setMinEyeBudget(VSYNC::CLOCK::duration minEyeBudget);
+    // Push a timing record for each eye into the telemetry instead of logging the averages on the render thread
+    // Pass nullptr to go back to logging. The FBRManager does not take ownership
+    void setTelemetry(FrameTimingTelemetry* telemetry);
     // Runs until the current thread is interrupted (java thread)
     // You can do optional processing in the optional callback that is called once per frame
-    void enterWarping(JNIEnv* env,VrCompositorRenderer& vrCompositorRenderer,std::function<void(JNIEnv*)> optionalCallback=nullptr);
+    void enterWarping(JNIEnv* env,VrCompositorRenderer& vrCompositorRenderer,const std::function<void(JNIEnv*)>& optionalCallback=nullptr);
     // warp eyes at the right time into front buffer to avoid tearing
     void warpEyesToFrontBufferSynchronized(JNIEnv* env,VrCompositorRenderer& vrCompositorRenderer);
     //
     void drawEyesToFrontBufferUnsynchronized(JNIEnv* env,VrCompositorRenderer& vrCompositorRenderer);
     //
     void drawFramesToFrontBufferUnsynchronized(JNIEnv* env, VrCompositorRenderer& vrCompositorRenderer);
+    // Number of operator new calls in warpEyesToFrontBufferSynchronized() after the first N_WARM_UP_FRAMES frames,
+    // excluding logging and the posted OpenGL work (see AllocationCounter::Exclude). Should be 0, each frame that allocates is logged and fails an assertion.
+    // Only counted when built with RENDERINGX_COUNT_ALLOCATIONS
+    uint64_t getNSteadyStateAllocations()const{
+        return nSteadyStateAllocations;
+    }
+    static constexpr int N_WARM_UP_FRAMES=120;
 private:
     const bool CHANGE_CLEAR_COLOR_TO_MAKE_TEARING_OBSERVABLE=false;
     const VSYNC& vsync;
     struct EyeChrono{
         Chronometer avgCPUTime{};
         AvgCalculator avgGPUTime;
+        DurationHistogram<> gpuTimeHistogram;
         double nEyes=0;
+        // GPU did not finish rendering the eye before the rasterizer started scanning it out
         double nEyesNotMeasurable=0;
     };
+    // GPU time per eye, read back a few frames later. Tag is latestVSYNC.count*2+eye, such that the telemetry can join the GPU time with the eye record
+    TimerQueryRing<> gpuTimerQueries;
+    // One fence per eye, re-created in place for each eye instead of allocating a new one
+    std::array<std::optional<FenceSync>,2> eyeFences;
+    int nFramesRendered=0;
+    uint64_t nSteadyStateAllocations=0;
     Chronometer avgCPUTimeUpdateSurfaceTexture;
-    // return the overshoot
-    static CLOCK::duration waitUntilTimePoint(const std::chrono::steady_clock::time_point& timePoint,FenceSync& fenceSync);
+    // return the overshoot. Executes posted OpenGL work if the GPU finished early enough
+    CLOCK::duration waitUntilTimePoint(const std::chrono::steady_clock::time_point& timePoint,FenceSync& fenceSync,VrCompositorRenderer& vrCompositorRenderer);
+    // Posted OpenGL work is only executed while waiting if at least this much time is left until the deadline
+    static constexpr CLOCK::duration MIN_GL_WORK_SLACK=std::chrono::milliseconds(2);
     std::array<EyeChrono,2> eyeChrono={};
-    //const RENDER_NEW_EYE_CALLBACK onRenderNewEyeCallback;
+    RENDER_NEW_EYE_CALLBACK renderNewEyeCallback=nullptr;
+    FrameTimingTelemetry* telemetry=nullptr;
+    VSYNC::CLOCK::duration minEyeBudget=std::chrono::nanoseconds(0);
+    struct EyeRenderModeStats{
+        // indexed by EyeRenderMode
+        std::array<int,3> count={};
+        AvgCalculator avgRemainingBudget;
+    };
+    std::array<EyeRenderModeStats,2> eyeRenderModeStats={};
+    static constexpr std::array<const char*,3> EYE_RENDER_MODE_NAMES={"full","degraded","skipped"};
     std::array<Chronometer,2> vsyncWaitTime={Chronometer{"VSYNC start wait time"},Chronometer{"VSYNC middle wait time"}};
+    // Logs (unless a telemetry sink is set) and resets the averages periodically
     void printLog();
     std::chrono::steady_clock::time_point lastLog;
     void resetTS();
     VSYNC::VSYNCState lastRenderedFrame;
     void drawEye(JNIEnv* env,const bool isLeftEye,VrCompositorRenderer& vrCompositorRenderer);
+    // Calls the render new eye callback if set, drawEye() otherwise
+    EyeRenderMode drawEye(JNIEnv* env,const EyeDeadline& deadline,VrCompositorRenderer& vrCompositorRenderer);
     std::array<int,2> whichColor;
 };
 
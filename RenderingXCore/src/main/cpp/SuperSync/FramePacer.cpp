@@ -0,0 +1,143 @@
+#include "FramePacer.h"
+#include "Extensions.h"
+#include <AndroidLogger.hpp>
+#include <ATraceCompbat.hpp>
+#include <TimeHelper.hpp>
+#include <thread>
+
+FramePacingController::FrameSchedule FramePacingController::scheduleFrame(const CLOCK::time_point now,const CompositorTiming &timing) {
+    if(timing.compositeInterval>CLOCK::duration::zero()){
+        lastCompositeInterval=timing.compositeInterval;
+    }
+    const auto interval=lastCompositeInterval;
+    const auto startOffset=getStartOffset();
+    auto compositeDeadline=timing.compositeDeadline;
+    // If there is not enough time left until the next deadline, target the one after
+    while(compositeDeadline-startOffset<now){
+        compositeDeadline+=interval;
+    }
+    // Submitting 2 frames for the same composite would just drop one of them (or stuff the queue)
+    while(compositeDeadline<lastCompositeDeadline+interval/2){
+        compositeDeadline+=interval;
+    }
+    lastCompositeDeadline=compositeDeadline;
+    return {compositeDeadline-startOffset,compositeDeadline,compositeDeadline+timing.compositeToPresentLatency};
+}
+
+void FramePacingController::onFrameRendered(const CLOCK::duration workDuration) {
+    if(workDuration<=CLOCK::duration::zero())return;
+    // Follow an increase immediately, but a decrease only slowly
+    if(workDuration>workEstimate){
+        workEstimate=workDuration;
+    }else{
+        workEstimate-=(workEstimate-workDuration)/20;
+    }
+}
+
+void FramePacingController::onFramePresented(const CLOCK::time_point targetPresentTime,const CLOCK::time_point actualPresentTime) {
+    if(actualPresentTime>targetPresentTime+lastCompositeInterval/2){
+        nPresentedLate++;
+        nOnTimeInARow=0;
+        safetyMargin=std::min(safetyMargin+MARGIN_INCREASE,lastCompositeInterval);
+    }else{
+        nPresentedOnTime++;
+        nOnTimeInARow++;
+        if(nOnTimeInARow>=N_ON_TIME_BEFORE_DECREASE){
+            nOnTimeInARow=0;
+            safetyMargin=std::max(safetyMargin-MARGIN_DECREASE,MIN_SAFETY_MARGIN);
+        }
+    }
+}
+
+FramePacer::FramePacer(std::string tag,std::unique_ptr<FrameTimestampsBackend> timestampsBackend):
+TAG(std::move(tag)),frameTimestampsTracker(std::move(timestampsBackend),TAG+"::FrameTimestamps"){
+    frameTimestampsTracker.setListener(this);
+}
+
+bool FramePacer::isAvailable() const {
+    return Extensions::EGL_ANDROID_get_frame_timestamps_available && Extensions::EGL_ANDROID_presentation_time_available
+           && Extensions::eglGetCompositorTimingANDROID!=nullptr;
+}
+
+std::optional<FramePacingController::CompositorTiming> FramePacer::getCompositorTiming(EGLDisplay dpy,EGLSurface surface) {
+    const std::array<EGLint,3> names = {
+            EGL_COMPOSITE_DEADLINE_ANDROID,
+            EGL_COMPOSITE_INTERVAL_ANDROID,
+            EGL_COMPOSITE_TO_PRESENT_LATENCY_ANDROID
+    };
+    // Query into an aligned array, FrameTimestamps::CompositorTiming is packed
+    std::array<EGLnsecsANDROID,3> values{};
+    if(Extensions::eglGetCompositorTimingANDROID(dpy,surface,names.size(),names.data(),values.data())==EGL_FALSE){
+        return std::nullopt;
+    }
+    const FrameTimestamps::CompositorTiming timing{values[0],values[1],values[2]};
+    if(timing.COMPOSITE_DEADLINE_ANDROID<=0 || timing.COMPOSITE_INTERVAL_ANDROID<=0){
+        return std::nullopt;
+    }
+    return FramePacingController::CompositorTiming{
+        CLOCK::time_point(std::chrono::nanoseconds(timing.COMPOSITE_DEADLINE_ANDROID)),
+        std::chrono::nanoseconds(timing.COMPOSITE_INTERVAL_ANDROID),
+        std::chrono::nanoseconds(std::max<EGLnsecsANDROID>(timing.COMPOSITE_TO_PRESENT_LATENCY_ANDROID,0))
+    };
+}
+
+void FramePacer::onFrameTimestamps(const FrameTimestampsTracker::SubmittedFrame& frame,const FrameTimestamps::FrameTimestamps& timestamps) {
+    // Frames that were not paced (e.g. no compositor timing) do not tell anything about the schedule
+    if(frame.targetPresentTime==CLOCK::time_point{})return;
+    if(timestamps.RENDERING_COMPLETE_TIME_ANDROID>=0){
+        controller.onFrameRendered(CLOCK::time_point(std::chrono::nanoseconds(timestamps.RENDERING_COMPLETE_TIME_ANDROID))-frame.startTime);
+    }
+    // Not presented if the frame was dropped (EGL_TIMESTAMP_INVALID_ANDROID)
+    if(timestamps.DISPLAY_PRESENT_TIME_ANDROID>=0){
+        controller.onFramePresented(frame.targetPresentTime,CLOCK::time_point(std::chrono::nanoseconds(timestamps.DISPLAY_PRESENT_TIME_ANDROID)));
+    }
+}
+
+void FramePacer::beginFrame() {
+    frameTimestampsTracker.poll();
+    if(!isAvailable())return;
+    EGLDisplay dpy=eglGetCurrentDisplay();
+    EGLSurface surface=eglGetCurrentSurface(EGL_DRAW);
+    if(surface==EGL_NO_SURFACE)return;
+    if(surface!=timestampsEnabledSurface){
+        // Timestamps have to be enabled per surface
+        eglSurfaceAttrib(dpy,surface,EGL_TIMESTAMPS_ANDROID,EGL_TRUE);
+        timestampsEnabledSurface=surface;
+    }
+    const auto timing=getCompositorTiming(dpy,surface);
+    if(!timing){
+        currentFrame=std::nullopt;
+        return;
+    }
+    auto schedule=controller.scheduleFrame(CLOCK::now(),*timing);
+    ATrace_beginSection("FramePacer::sleep");
+    std::this_thread::sleep_until(schedule.startTime);
+    ATrace_endSection();
+    // used to measure the work duration, the thread might wake up a bit later than requested
+    schedule.startTime=CLOCK::now();
+    currentFrame=schedule;
+}
+
+void FramePacer::endFrame() {
+    if(!currentFrame){
+        // Still measure the presentation latency
+        frameTimestampsTracker.onFrameSubmitted();
+        return;
+    }
+    EGLDisplay dpy=eglGetCurrentDisplay();
+    EGLSurface surface=eglGetCurrentSurface(EGL_DRAW);
+    const auto targetPresentTimeNs=std::chrono::duration_cast<std::chrono::nanoseconds>(currentFrame->targetPresentTime.time_since_epoch()).count();
+    Extensions::eglPresentationTimeANDROID(dpy,surface,targetPresentTimeNs);
+    frameTimestampsTracker.onFrameSubmitted(currentFrame->startTime,currentFrame->targetPresentTime);
+    currentFrame=std::nullopt;
+    printLogIfNeeded();
+}
+
+void FramePacer::printLogIfNeeded() {
+    const auto now=CLOCK::now();
+    if(now-lastLog<std::chrono::seconds(5))return;
+    lastLog=now;
+    MLOGD2(TAG.c_str())<<"Start offset "<<MyTimeHelper::R(controller.getStartOffset())
+    <<" (safety margin "<<MyTimeHelper::R(controller.getSafetyMargin())<<")"
+    <<" presented on time "<<controller.nPresentedOnTime<<" late "<<controller.nPresentedLate;
+}
@@ -0,0 +1,110 @@
+#ifndef RENDERINGX_FRAMEPACER_H
+#define RENDERINGX_FRAMEPACER_H
+
+#include "FrameTimestampsTracker.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <array>
+#include <chrono>
+#include <optional>
+#include <string>
+
+// Pure timing logic of the FramePacer, does not call EGL (and can therefore be driven with recorded / synthetic values).
+// The swap chain path (non-FBR) submits one frame per composite interval. Instead of rendering as soon as the previous
+// eglSwapBuffers() returns (which samples pose and video frame up to one interval too early), each frame is started
+// 'startOffset' before the composite deadline it has to make. The start offset consists of the estimated work duration
+// (CPU + GPU, until rendering is complete) plus a safety margin that adapts to the observed display present times.
+class FramePacingController{
+public:
+    using CLOCK=std::chrono::steady_clock;
+    // Same values as returned by eglGetCompositorTimingANDROID, but as chrono types
+    struct CompositorTiming{
+        // the next composite deadline (absolute, in the future)
+        CLOCK::time_point compositeDeadline;
+        // the time between composites (display refresh time)
+        CLOCK::duration compositeInterval;
+        // time from the start of a composite until the frame is presented on the display
+        CLOCK::duration compositeToPresentLatency;
+    };
+    struct FrameSchedule{
+        // when rendering of the frame should start (sample pose / video as late as possible)
+        CLOCK::time_point startTime;
+        // the composite this frame is targeting
+        CLOCK::time_point compositeDeadline;
+        // pass this value to eglPresentationTimeANDROID
+        CLOCK::time_point targetPresentTime;
+    };
+    // Calculates the schedule of the next frame. Never targets the same or an earlier composite twice in a row
+    // (that would stuff the buffer queue and increase latency)
+    FrameSchedule scheduleFrame(CLOCK::time_point now,const CompositorTiming& timing);
+    // @param workDuration: duration from FrameSchedule::startTime until the GPU completed rendering
+    void onFrameRendered(CLOCK::duration workDuration);
+    // Compare the actual present time with the requested one and adapt the safety margin
+    void onFramePresented(CLOCK::time_point targetPresentTime,CLOCK::time_point actualPresentTime);
+    CLOCK::duration getStartOffset()const{
+        return workEstimate+safetyMargin;
+    }
+    CLOCK::duration getSafetyMargin()const{
+        return safetyMargin;
+    }
+    // The composite targeted by the last scheduled frame (time_point{} if there was none yet) and the
+    // interval between composites. Together they model the display VSYNC
+    CLOCK::time_point getLastCompositeDeadline()const{
+        return lastCompositeDeadline;
+    }
+    CLOCK::duration getCompositeInterval()const{
+        return lastCompositeInterval;
+    }
+    static constexpr CLOCK::duration MIN_SAFETY_MARGIN=std::chrono::milliseconds(1);
+    // margin is increased by this value each time a frame misses its present time
+    static constexpr CLOCK::duration MARGIN_INCREASE=std::chrono::milliseconds(2);
+    // and decreased by this value after N_ON_TIME_BEFORE_DECREASE frames in a row were presented on time
+    static constexpr CLOCK::duration MARGIN_DECREASE=std::chrono::microseconds(250);
+    static constexpr int N_ON_TIME_BEFORE_DECREASE=60;
+private:
+    CLOCK::duration workEstimate=std::chrono::milliseconds(4);
+    CLOCK::duration safetyMargin=std::chrono::milliseconds(2);
+    CLOCK::duration lastCompositeInterval=std::chrono::nanoseconds(16666666);
+    CLOCK::time_point lastCompositeDeadline{};
+    int nOnTimeInARow=0;
+public:
+    int nPresentedOnTime=0;
+    int nPresentedLate=0;
+};
+
+// Paces the swap chain path using EGL_ANDROID_get_frame_timestamps and EGL_ANDROID_presentation_time.
+// Call beginFrame() at the beginning of onDrawFrame() (before updating the video texture and head pose), and
+// endFrame() right before the buffers are swapped. If the extensions are not available frames are not paced.
+// The timestamps of the submitted frames are obtained by the FrameTimestampsTracker owned by the FramePacer
+// (which also measures the presentation latency), use getFrameTimestampsTracker() instead of creating another one.
+class FramePacer: private FrameTimestampsTracker::Listener{
+public:
+    explicit FramePacer(std::string tag="FramePacer",
+            std::unique_ptr<FrameTimestampsBackend> timestampsBackend=std::make_unique<EGLFrameTimestampsBackend>());
+    // Polls the timestamps of previous frames and sleeps until the start time of the next frame.
+    // Uses the current EGL display and draw surface
+    void beginFrame();
+    // Sets the presentation time of the frame that is about to be swapped
+    void endFrame();
+    const FramePacingController& getController()const{
+        return controller;
+    }
+    const FrameTimestampsTracker& getFrameTimestampsTracker()const{
+        return frameTimestampsTracker;
+    }
+private:
+    const std::string TAG;
+    FramePacingController controller;
+    FrameTimestampsTracker frameTimestampsTracker;
+    using CLOCK=FramePacingController::CLOCK;
+    EGLSurface timestampsEnabledSurface=EGL_NO_SURFACE;
+    std::optional<FramePacingController::FrameSchedule> currentFrame;
+    bool isAvailable()const;
+    std::optional<FramePacingController::CompositorTiming> getCompositorTiming(EGLDisplay dpy,EGLSurface surface);
+    void onFrameTimestamps(const FrameTimestampsTracker::SubmittedFrame& frame,const FrameTimestamps::FrameTimestamps& timestamps)override;
+    // stats
+    CLOCK::time_point lastLog=CLOCK::now();
+    void printLogIfNeeded();
+};
+
+#endif //RENDERINGX_FRAMEPACER_H
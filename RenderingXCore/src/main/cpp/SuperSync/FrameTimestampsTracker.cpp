@@ -0,0 +1,156 @@
+#include "FrameTimestampsTracker.h"
+#include <AndroidLogger.hpp>
+#include <TraceCounter.hpp>
+#include <cstring>
+#include <sstream>
+
+std::optional<EGLuint64KHR> EGLFrameTimestampsBackend::getNextFrameId() {
+    if(!isAvailable())return std::nullopt;
+    EGLDisplay dpy=eglGetCurrentDisplay();
+    EGLSurface surface=eglGetCurrentSurface(EGL_DRAW);
+    if(surface==EGL_NO_SURFACE)return std::nullopt;
+    if(surface!=timestampsEnabledSurface){
+        eglSurfaceAttrib(dpy,surface,EGL_TIMESTAMPS_ANDROID,EGL_TRUE);
+        timestampsEnabledSurface=surface;
+    }
+    return FrameTimestamps::getNextFrameId(dpy,surface);
+}
+
+bool EGLFrameTimestampsBackend::getTimestamps(EGLuint64KHR frameId,FrameTimestamps::FrameTimestamps &timestamps) {
+    // Same order as the members of FrameTimestamps::FrameTimestamps
+    static const std::array<EGLint,9> names={
+            EGL_REQUESTED_PRESENT_TIME_ANDROID,
+            EGL_RENDERING_COMPLETE_TIME_ANDROID,
+            EGL_COMPOSITION_LATCH_TIME_ANDROID,
+            EGL_FIRST_COMPOSITION_START_TIME_ANDROID ,
+            EGL_LAST_COMPOSITION_START_TIME_ANDROID ,
+            EGL_FIRST_COMPOSITION_GPU_FINISHED_TIME_ANDROID ,
+            EGL_DISPLAY_PRESENT_TIME_ANDROID ,
+            EGL_DEQUEUE_READY_TIME_ANDROID ,
+            EGL_READS_DONE_TIME_ANDROID
+    };
+    static_assert(sizeof(FrameTimestamps::FrameTimestamps)==names.size()*sizeof(EGLnsecsANDROID));
+    std::array<EGLnsecsANDROID,names.size()> values{};
+    const EGLBoolean result=Extensions::eglGetFrameTimestampsANDROID(eglGetCurrentDisplay(),eglGetCurrentSurface(EGL_DRAW),frameId,
+            names.size(),names.data(),values.data());
+    if(result==EGL_FALSE)return false;
+    std::memcpy(&timestamps,values.data(),sizeof(FrameTimestamps::FrameTimestamps));
+    return true;
+}
+
+FrameTimestampsTracker::FrameTimestampsTracker(std::unique_ptr<FrameTimestampsBackend> backend,std::string tag):
+TAG(std::move(tag)),backend(std::move(backend)){}
+
+void FrameTimestampsTracker::onFrameSubmitted(const CLOCK::time_point startTime,const CLOCK::time_point targetPresentTime) {
+    const auto frameId=backend->getNextFrameId();
+    if(!frameId)return;
+    if(nPending==N_PENDING_FRAMES){
+        // The oldest frame is still pending after N_PENDING_FRAMES frames, give up on it
+        pendingBegin=(pendingBegin+1)%N_PENDING_FRAMES;
+        nPending--;
+        std::lock_guard<std::mutex> lock(statsMutex);
+        nFramesLost++;
+    }
+    pendingFrames[(pendingBegin+nPending)%N_PENDING_FRAMES]={*frameId,CLOCK::now(),startTime,targetPresentTime};
+    nPending++;
+}
+
+static bool isPending(const EGLnsecsANDROID timestamp){
+    return timestamp==EGL_TIMESTAMP_PENDING_ANDROID;
+}
+
+void FrameTimestampsTracker::poll() {
+    while(nPending>0){
+        const auto& frame=pendingFrames[pendingBegin];
+        FrameTimestamps::FrameTimestamps timestamps{};
+        if(!backend->getTimestamps(frame.frameId,timestamps)){
+            std::lock_guard<std::mutex> lock(statsMutex);
+            nFramesLost++;
+        }else{
+            // Frames are presented in order. If this one is still pending, so are all following ones
+            if(isPending(timestamps.RENDERING_COMPLETE_TIME_ANDROID) || isPending(timestamps.COMPOSITION_LATCH_TIME_ANDROID) ||
+               isPending(timestamps.LAST_COMPOSITION_START_TIME_ANDROID) || isPending(timestamps.DISPLAY_PRESENT_TIME_ANDROID)){
+                break;
+            }
+            onFrameTimestamps(frame,timestamps);
+            if(listener!=nullptr){
+                listener->onFrameTimestamps(frame,timestamps);
+            }
+        }
+        pendingBegin=(pendingBegin+1)%N_PENDING_FRAMES;
+        nPending--;
+    }
+    const auto now=CLOCK::now();
+    if(now-lastLog>std::chrono::seconds(5)){
+        lastLog=now;
+        MLOGD2(TAG.c_str())<<getStatsReadable();
+    }
+}
+
+void FrameTimestampsTracker::onFrameTimestamps(const SubmittedFrame &frame,const FrameTimestamps::FrameTimestamps &timestamps) {
+    const EGLnsecsANDROID submitted=std::chrono::duration_cast<std::chrono::nanoseconds>(frame.submitTime.time_since_epoch()).count();
+    // Timestamps that do not apply to this frame are EGL_TIMESTAMP_INVALID_ANDROID
+    const std::array<EGLnsecsANDROID,DISPLAY_PRESENT+2> stageEnds={
+            submitted,
+            timestamps.RENDERING_COMPLETE_TIME_ANDROID,
+            timestamps.COMPOSITION_LATCH_TIME_ANDROID,
+            timestamps.LAST_COMPOSITION_START_TIME_ANDROID,
+            timestamps.DISPLAY_PRESENT_TIME_ANDROID
+    };
+    std::array<std::optional<std::chrono::nanoseconds>,N_STAGES> deltas;
+    for(size_t i=0;i<DISPLAY_PRESENT+1;i++){
+        if(stageEnds[i]>=0 && stageEnds[i+1]>=0){
+            deltas[i]=std::chrono::nanoseconds(stageEnds[i+1]-stageEnds[i]);
+        }
+    }
+    if(timestamps.DISPLAY_PRESENT_TIME_ANDROID>=0){
+        deltas[TOTAL]=std::chrono::nanoseconds(timestamps.DISPLAY_PRESENT_TIME_ANDROID-submitted);
+    }
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        if(!deltas[TOTAL]){
+            nFramesNotPresented++;
+        }
+        for(size_t i=0;i<N_STAGES;i++){
+            if(deltas[i])histograms[i].add(*deltas[i]);
+        }
+    }
+    if(TraceCounter::isEnabled()){
+        for(size_t i=0;i<N_STAGES;i++){
+            if(deltas[i]){
+                TraceCounter::set(STAGE_NAMES[i],std::chrono::duration_cast<std::chrono::microseconds>(*deltas[i]).count());
+            }
+        }
+    }
+}
+
+FrameTimestampsTracker::Stats FrameTimestampsTracker::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    Stats stats{};
+    for(size_t i=0;i<N_STAGES;i++){
+        const auto& histogram=histograms[i];
+        stats.stages[i]={histogram.getPercentile(50),histogram.getPercentile(90),histogram.getPercentile(99),histogram.getNSamples()};
+    }
+    stats.nFramesNotPresented=nFramesNotPresented;
+    stats.nFramesLost=nFramesLost;
+    return stats;
+}
+
+std::string FrameTimestampsTracker::getStatsReadable() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    std::stringstream ss;
+    ss<<"FrameTimestamps: not presented "<<nFramesNotPresented<<" lost "<<nFramesLost;
+    for(size_t i=0;i<N_STAGES;i++){
+        ss<<"\n"<<STAGE_NAMES[i]<<" "<<histograms[i].getPercentilesReadable();
+    }
+    return ss.str();
+}
+
+void FrameTimestampsTracker::resetStats() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    for(auto& histogram:histograms){
+        histogram.reset();
+    }
+    nFramesNotPresented=0;
+    nFramesLost=0;
+}
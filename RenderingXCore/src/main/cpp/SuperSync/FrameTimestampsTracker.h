@@ -0,0 +1,117 @@
+#ifndef RENDERINGX_FRAMETIMESTAMPSTRACKER_H
+#define RENDERINGX_FRAMETIMESTAMPSTRACKER_H
+
+#include "Extensions.h"
+#include <DurationHistogram.hpp>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+// Access to EGL_ANDROID_get_frame_timestamps. The tracker only talks to this interface,
+// such that it can be driven by a fake implementation (e.g. with recorded timestamps on Linux)
+class FrameTimestampsBackend{
+public:
+    virtual ~FrameTimestampsBackend()=default;
+    // id of the frame that is submitted with the next eglSwapBuffers() call
+    virtual std::optional<EGLuint64KHR> getNextFrameId()=0;
+    // Must not block. Values that are not available yet are EGL_TIMESTAMP_PENDING_ANDROID
+    // @return false if the timestamps cannot be queried (anymore) for this frame id
+    virtual bool getTimestamps(EGLuint64KHR frameId,FrameTimestamps::FrameTimestamps& timestamps)=0;
+};
+
+// Uses the current EGL display and draw surface
+class EGLFrameTimestampsBackend: public FrameTimestampsBackend{
+public:
+    static bool isAvailable(){
+        return Extensions::EGL_ANDROID_get_frame_timestamps_available;
+    }
+    std::optional<EGLuint64KHR> getNextFrameId()override;
+    bool getTimestamps(EGLuint64KHR frameId,FrameTimestamps::FrameTimestamps& timestamps)override;
+private:
+    EGLSurface timestampsEnabledSurface=EGL_NO_SURFACE;
+};
+
+// Measures the presentation latency of each frame submitted via the swap chain.
+// Call onFrameSubmitted() right before eglSwapBuffers() and poll() once per frame.
+// The timestamps of a frame become available some frames later, poll() never waits for them.
+// This is the only place that queries frame ids / polls the timestamps, other components (e.g. the FramePacer)
+// get the timestamps of each frame via the Listener instead of keeping their own pending frames.
+class FrameTimestampsTracker{
+public:
+    using CLOCK=std::chrono::steady_clock;
+    explicit FrameTimestampsTracker(std::unique_ptr<FrameTimestampsBackend> backend=std::make_unique<EGLFrameTimestampsBackend>(),
+            std::string tag="FrameTimestamps");
+    FrameTimestampsTracker(const FrameTimestampsTracker&)=delete;
+    FrameTimestampsTracker& operator=(const FrameTimestampsTracker&)=delete;
+    enum STAGE{
+        // submit (onFrameSubmitted) until the GPU finished rendering
+        RENDERING_COMPLETE,
+        // rendering complete until the compositor latched the buffer
+        LATCH,
+        // latch until the (last) composition started
+        COMPOSITION,
+        // composition start until the frame is shown on the display
+        DISPLAY_PRESENT,
+        // submit until the frame is shown on the display
+        TOTAL,
+        N_STAGES
+    };
+    static constexpr std::array<const char*,N_STAGES> STAGE_NAMES={"RenderingComplete","Latch","Composition","DisplayPresent","Total"};
+    struct SubmittedFrame{
+        EGLuint64KHR frameId;
+        CLOCK::time_point submitTime;
+        // Optional, set by the caller of onFrameSubmitted(). time_point{} if not known
+        CLOCK::time_point startTime;
+        CLOCK::time_point targetPresentTime;
+    };
+    class Listener{
+    public:
+        virtual ~Listener()=default;
+        // Called by poll() once for each frame whose timestamps are complete, in submission order.
+        // Timestamps that do not apply to this frame (e.g. DISPLAY_PRESENT of a dropped frame) are EGL_TIMESTAMP_INVALID_ANDROID
+        virtual void onFrameTimestamps(const SubmittedFrame& frame,const FrameTimestamps::FrameTimestamps& timestamps)=0;
+    };
+    // Called on the OpenGL thread
+    void setListener(Listener* listener1){
+        listener=listener1;
+    }
+    // @param startTime,targetPresentTime: passed on to the Listener unchanged
+    void onFrameSubmitted(CLOCK::time_point startTime={},CLOCK::time_point targetPresentTime={});
+    void poll();
+    // Everything below can be called from any thread
+    struct StageStats{
+        std::chrono::nanoseconds p50;
+        std::chrono::nanoseconds p90;
+        std::chrono::nanoseconds p99;
+        uint64_t nSamples;
+    };
+    struct Stats{
+        std::array<StageStats,N_STAGES> stages;
+        // frames that were never presented (e.g. replaced by a newer frame before they were latched)
+        int nFramesNotPresented;
+        // frames whose timestamps could not be obtained (too old / too many frames pending)
+        int nFramesLost;
+    };
+    Stats getStats()const;
+    std::string getStatsReadable()const;
+    void resetStats();
+private:
+    const std::string TAG;
+    const std::unique_ptr<FrameTimestampsBackend> backend;
+    static constexpr size_t N_PENDING_FRAMES=16;
+    std::array<SubmittedFrame,N_PENDING_FRAMES> pendingFrames{};
+    size_t pendingBegin=0;
+    size_t nPending=0;
+    mutable std::mutex statsMutex;
+    std::array<DurationHistogram<100>,N_STAGES> histograms;
+    int nFramesNotPresented=0;
+    int nFramesLost=0;
+    Listener* listener=nullptr;
+    void onFrameTimestamps(const SubmittedFrame& frame,const FrameTimestamps::FrameTimestamps& timestamps);
+    CLOCK::time_point lastLog=CLOCK::now();
+};
+
+#endif //RENDERINGX_FRAMETIMESTAMPSTRACKER_H
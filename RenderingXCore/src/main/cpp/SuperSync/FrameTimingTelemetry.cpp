@@ -0,0 +1,146 @@
+#include "FrameTimingTelemetry.h"
+#include <AndroidLogger.hpp>
+#include <sstream>
+
+FrameTimingTelemetry::FrameTimingTelemetry(const std::string& outputFileName,const OutputFormat outputFormat):
+outputFormat(outputFormat){
+    if(!outputFileName.empty()){
+        outputFile.open(outputFileName,std::ios::out | std::ios::trunc);
+        if(!outputFile.is_open()){
+            MLOGE<<"Cannot open telemetry file "<<outputFileName;
+        }else{
+            writeHeader();
+        }
+    }
+    consumerThread=std::thread(&FrameTimingTelemetry::loop,this);
+}
+
+FrameTimingTelemetry::~FrameTimingTelemetry() {
+    stopRequested=true;
+    consumerThread.join();
+    // Eyes whose GPU time never arrived (e.g. disjoint timer query)
+    while(!pendingEyes.empty()){
+        write(pendingEyes.front());
+        pendingEyes.pop_front();
+    }
+    if(outputFile.is_open()){
+        writeFooter();
+        outputFile.close();
+    }
+    if(queue.getNDropped()>0){
+        MLOGE<<"FrameTimingTelemetry dropped "<<queue.getNDropped()<<" records";
+    }
+}
+
+void FrameTimingTelemetry::pushGPUTime(const int vsyncCount,const int eye,const std::chrono::nanoseconds gpuDuration) {
+    Record record{};
+    record.type=Record::Type::GPU_TIME;
+    record.vsyncCount=vsyncCount;
+    record.eye=(uint8_t)eye;
+    record.gpuDurationNs=gpuDuration.count();
+    queue.push(record);
+}
+
+void FrameTimingTelemetry::loop() {
+    Record record{};
+    while (true){
+        // read the flag before draining,such that no record pushed before the stop request is lost
+        const bool stop=stopRequested;
+        while(queue.pop(record)){
+            consume(record);
+        }
+        if(CLOCK::now()-lastLog>std::chrono::seconds(3)){
+            lastLog=CLOCK::now();
+            logPercentiles();
+        }
+        if(stop)break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+void FrameTimingTelemetry::consume(const Record& record) {
+    if(record.type==Record::Type::EYE){
+        pendingEyes.push_back(record);
+    }else{
+        for(auto& pending:pendingEyes){
+            if(pending.vsyncCount==record.vsyncCount && pending.eye==record.eye){
+                pending.gpuDurationNs=record.gpuDurationNs;
+                break;
+            }
+        }
+    }
+    // GPU times arrive in order, so write all complete eyes at the front.
+    // Eyes that never get a GPU time are written once too many eyes are pending
+    while(!pendingEyes.empty() && (pendingEyes.front().gpuDurationNs!=GPU_TIME_PENDING || pendingEyes.size()>MAX_PENDING_EYES)){
+        write(pendingEyes.front());
+        pendingEyes.pop_front();
+    }
+}
+
+void FrameTimingTelemetry::write(const Record& r) {
+    auto& histograms=eyeHistograms[r.eye];
+    histograms.nEyes++;
+    if(r.missed)histograms.nMissed++;
+    histograms.cpuTime.add(std::chrono::nanoseconds(r.cpuEndNs-r.cpuStartNs));
+    if(r.gpuDurationNs>=0){
+        histograms.gpuTime.add(std::chrono::nanoseconds(r.gpuDurationNs));
+    }
+    histograms.waitTime.add(std::chrono::nanoseconds(r.waitNs));
+    histograms.overshoot.add(std::chrono::nanoseconds(r.overshootNs));
+    if(!outputFile.is_open())return;
+    const char* eyeName=r.eye==0 ? "leftEye" : "rightEye";
+    if(outputFormat==OutputFormat::CSV){
+        outputFile<<r.vsyncCount<<","<<eyeName<<","<<r.cpuStartNs<<","<<r.cpuEndNs<<","<<r.gpuDurationNs<<","
+        <<r.waitNs<<","<<r.overshootNs<<","<<(r.missed ? 1 : 0)<<","<<r.rasterizerPosition<<","<<(int)r.renderMode<<"\n";
+        return;
+    }
+    // Chrome trace event format, timestamps in (integer) microseconds
+    // tid 1: CPU time of the eye, tid 2: GPU time (starting at submit), tid 3: wait time
+    const auto writeEvent=[this,&r,eyeName](const int tid,const int64_t startNs,const int64_t durationNs){
+        if(!isFirstRecord)outputFile<<",\n";
+        isFirstRecord=false;
+        outputFile<<R"({"name":")"<<eyeName<<R"(","ph":"X","pid":1,"tid":)"<<tid<<R"(,"ts":)"<<startNs/1000
+        <<R"(,"dur":)"<<durationNs/1000<<R"(,"args":{"vsync":)"<<r.vsyncCount<<R"(,"missed":)"<<(r.missed ? "true" : "false")
+        <<R"(,"mode":)"<<(int)r.renderMode<<R"(,"rasterizer":)"<<r.rasterizerPosition<<"}}";
+    };
+    writeEvent(1,r.cpuStartNs,r.cpuEndNs-r.cpuStartNs);
+    if(r.gpuDurationNs>=0){
+        writeEvent(2,r.cpuEndNs,r.gpuDurationNs);
+    }
+    writeEvent(3,r.cpuEndNs,r.waitNs);
+}
+
+void FrameTimingTelemetry::writeHeader() {
+    if(outputFormat==OutputFormat::CSV){
+        outputFile<<"vsyncCount,eye,cpuStartNs,cpuEndNs,gpuDurationNs,waitNs,overshootNs,missed,rasterizerPosition,renderMode\n";
+    }else{
+        outputFile<<R"({"displayTimeUnit":"ms","traceEvents":[)"<<"\n";
+    }
+}
+
+void FrameTimingTelemetry::writeFooter() {
+    if(outputFormat==OutputFormat::CHROME_TRACE){
+        outputFile<<"\n]}\n";
+    }
+}
+
+void FrameTimingTelemetry::logPercentiles() {
+    std::stringstream ss;
+    ss<<"------------------------FrameTimingTelemetry------------------------";
+    for(int eye=0;eye<2;eye++){
+        auto& h=eyeHistograms[eye];
+        ss<<"\n"<<(eye==0 ? "leftEye" : "rightEye")<<" n:"<<h.nEyes<<" missed:"<<h.nMissed;
+        ss<<"\n CPU "<<h.cpuTime.getPercentilesReadable();
+        ss<<"\n GPU "<<h.gpuTime.getPercentilesReadable();
+        ss<<"\n Wait "<<h.waitTime.getPercentilesReadable();
+        ss<<"\n Overshoot "<<h.overshoot.getPercentilesReadable();
+        h.cpuTime.reset();
+        h.gpuTime.reset();
+        h.waitTime.reset();
+        h.overshoot.reset();
+        h.nEyes=0;
+        h.nMissed=0;
+    }
+    ss<<"\nDropped records "<<queue.getNDropped();
+    MLOGD<<ss.str();
+}
@@ -0,0 +1,88 @@
+#ifndef RENDERINGX_FRAMETIMINGTELEMETRY_H
+#define RENDERINGX_FRAMETIMINGTELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <DurationHistogram.hpp>
+#include "SPSCQueue.hpp"
+
+// The front buffer renderer pushes one compact record per eye (and one per GPU time measurement, since these
+// become available a few frames later) into a lock-free queue. A background thread joins them,
+// writes them as CSV or Chrome trace JSON (chrome://tracing, perfetto) and logs the percentiles.
+// This way the render thread does no formatting / file IO at all.
+class FrameTimingTelemetry{
+public:
+    using CLOCK=std::chrono::steady_clock;
+    enum class OutputFormat{CSV,CHROME_TRACE};
+    static constexpr int64_t GPU_TIME_PENDING=-1;
+    static constexpr int64_t GPU_TIME_NONE=-2;
+    struct Record{
+        enum class Type:uint8_t{EYE,GPU_TIME};
+        Type type;
+        // 0==left eye, 1==right eye
+        uint8_t eye;
+        // Value of EyeRenderMode
+        uint8_t renderMode;
+        // Either the eye was skipped or the GPU did not finish before the deadline
+        bool missed;
+        int vsyncCount;
+        // All time points are CLOCK::time_since_epoch() in nanoseconds
+        int64_t cpuStartNs;
+        int64_t cpuEndNs;
+        int64_t waitNs;
+        int64_t overshootNs;
+        // For Type::EYE either GPU_TIME_PENDING (a Type::GPU_TIME record follows) or GPU_TIME_NONE
+        int64_t gpuDurationNs;
+        // Normalized rasterizer position when the commands were submitted (glFlush)
+        float rasterizerPosition;
+    };
+    // @param outputFile: where to write the records to. If empty,only the percentiles are logged
+    FrameTimingTelemetry(const std::string& outputFile,OutputFormat outputFormat);
+    // Stops the consumer thread, writes all remaining records and closes the output file
+    ~FrameTimingTelemetry();
+    // Producer side, called from the render thread. Never blocks or allocates
+    void pushEye(const Record& record){
+        queue.push(record);
+    }
+    void pushGPUTime(int vsyncCount,int eye,std::chrono::nanoseconds gpuDuration);
+    static int64_t toNs(const CLOCK::time_point timePoint){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(timePoint.time_since_epoch()).count();
+    }
+    static int64_t toNs(const CLOCK::duration duration){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    }
+private:
+    const OutputFormat outputFormat;
+    std::ofstream outputFile;
+    SPSCQueue<Record,1024> queue;
+    std::atomic<bool> stopRequested{false};
+    std::thread consumerThread;
+    // Consumer side only
+    // Eye records waiting for their GPU time
+    std::deque<Record> pendingEyes;
+    static constexpr size_t MAX_PENDING_EYES=16;
+    struct EyeHistograms{
+        DurationHistogram<> cpuTime;
+        DurationHistogram<> gpuTime;
+        DurationHistogram<> waitTime;
+        DurationHistogram<> overshoot;
+        int nEyes=0;
+        int nMissed=0;
+    };
+    std::array<EyeHistograms,2> eyeHistograms;
+    CLOCK::time_point lastLog=CLOCK::now();
+    bool isFirstRecord=true;
+    void loop();
+    void consume(const Record& record);
+    void write(const Record& eyeRecord);
+    void writeHeader();
+    void writeFooter();
+    void logPercentiles();
+};
+
+#endif //RENDERINGX_FRAMETIMINGTELEMETRY_H
@@ -0,0 +1,50 @@
+#ifndef RENDERINGX_SPSCQUEUE_HPP
+#define RENDERINGX_SPSCQUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Lock-free,bounded single producer single consumer queue
+// The producer (e.g. the front buffer rendering thread) never blocks and never allocates:
+// If the queue is full the element is dropped and counted instead.
+template<class T,size_t CAPACITY>
+class SPSCQueue{
+    static_assert(CAPACITY>=2 && (CAPACITY & (CAPACITY-1))==0,"CAPACITY must be a power of 2");
+public:
+    // Producer only. Returns false if the element was dropped
+    bool push(const T& element){
+        const size_t head=writeIdx.load(std::memory_order_relaxed);
+        const size_t tail=readIdx.load(std::memory_order_acquire);
+        if(head-tail==CAPACITY){
+            nDropped.fetch_add(1,std::memory_order_relaxed);
+            return false;
+        }
+        data[head & (CAPACITY-1)]=element;
+        writeIdx.store(head+1,std::memory_order_release);
+        return true;
+    }
+    // Consumer only. Returns false if the queue is empty
+    bool pop(T& element){
+        const size_t tail=readIdx.load(std::memory_order_relaxed);
+        const size_t head=writeIdx.load(std::memory_order_acquire);
+        if(head==tail){
+            return false;
+        }
+        element=data[tail & (CAPACITY-1)];
+        readIdx.store(tail+1,std::memory_order_release);
+        return true;
+    }
+    int getNDropped()const{
+        return nDropped.load(std::memory_order_relaxed);
+    }
+private:
+    std::array<T,CAPACITY> data;
+    // Indices grow monotonically, the position in data is index % CAPACITY
+    // Each on its own cache line to avoid false sharing between producer and consumer
+    alignas(64) std::atomic<size_t> writeIdx{0};
+    alignas(64) std::atomic<size_t> readIdx{0};
+    std::atomic<int> nDropped{0};
+};
+
+#endif //RENDERINGX_SPSCQUEUE_HPP
@@ -0,0 +1,251 @@
+#include "ThreadPlacement.h"
+#include <AndroidLogger.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sched.h>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Returns the first line of the file, or an empty string if the file does not exist
+static std::string readFirstLine(const std::string& fileName){
+    std::ifstream file(fileName);
+    std::string line;
+    if(file.is_open()){
+        std::getline(file,line);
+    }
+    return line;
+}
+
+static int64_t readInt(const std::string& fileName,const int64_t defaultValue){
+    const auto line=readFirstLine(fileName);
+    if(line.empty())return defaultValue;
+    try{
+        return std::stoll(line);
+    }catch (const std::exception&){
+        return defaultValue;
+    }
+}
+
+static bool directoryExists(const std::string& path){
+    struct stat info{};
+    return stat(path.c_str(),&info)==0 && S_ISDIR(info.st_mode);
+}
+
+std::vector<int> CPUTopology::parseCPUList(const std::string &cpuList) {
+    std::vector<int> ret;
+    std::stringstream ss(cpuList);
+    std::string range;
+    while(std::getline(ss,range,',')){
+        if(range.empty())continue;
+        try{
+            const auto dash=range.find('-');
+            if(dash==std::string::npos){
+                ret.push_back(std::stoi(range));
+            }else{
+                const int first=std::stoi(range.substr(0,dash));
+                const int last=std::stoi(range.substr(dash+1));
+                for(int i=first;i<=last;i++){
+                    ret.push_back(i);
+                }
+            }
+        }catch (const std::exception&){
+            MLOGE<<"Invalid cpu list "<<cpuList;
+        }
+    }
+    std::sort(ret.begin(),ret.end());
+    ret.erase(std::unique(ret.begin(),ret.end()),ret.end());
+    return ret;
+}
+
+CPUTopology::Topology CPUTopology::discover(const std::string &sysfsRoot) {
+    Topology topology;
+    std::vector<int> cpuIds=parseCPUList(readFirstLine(sysfsRoot+"/possible"));
+    if(cpuIds.empty()){
+        for(int i=0;directoryExists(sysfsRoot+"/cpu"+std::to_string(i));i++){
+            cpuIds.push_back(i);
+        }
+    }
+    // Cores that share a frequency domain form a cluster. Older kernels do not have related_cpus,
+    // then the topology cluster_id / physical_package_id is used
+    std::map<std::string,std::vector<int>> coresByClusterKey;
+    for(const int id:cpuIds){
+        const std::string cpuDir=sysfsRoot+"/cpu"+std::to_string(id);
+        if(!directoryExists(cpuDir))continue;
+        Core core{};
+        core.id=id;
+        core.maxFreqKHz=readInt(cpuDir+"/cpufreq/cpuinfo_max_freq",0);
+        core.capacity=readInt(cpuDir+"/cpu_capacity",core.maxFreqKHz);
+        std::string clusterKey;
+        const auto relatedCPUs=parseCPUList(readFirstLine(cpuDir+"/cpufreq/related_cpus"));
+        if(!relatedCPUs.empty()){
+            clusterKey="freq"+std::to_string(relatedCPUs.front());
+        }else{
+            int64_t clusterId=readInt(cpuDir+"/topology/cluster_id",-1);
+            if(clusterId<0)clusterId=readInt(cpuDir+"/topology/physical_package_id",-1);
+            clusterKey=clusterId>=0 ? "topology"+std::to_string(clusterId) : "capacity"+std::to_string(core.capacity);
+        }
+        coresByClusterKey[clusterKey].push_back((int)topology.cores.size());
+        topology.cores.push_back(core);
+    }
+    // Sort the clusters by their max. capacity, little first
+    std::vector<std::vector<int>> clusters;
+    for(const auto& entry:coresByClusterKey){
+        clusters.push_back(entry.second);
+    }
+    const auto clusterCapacity=[&topology](const std::vector<int>& coreIndices){
+        int64_t capacity=0;
+        for(const int idx:coreIndices)capacity=std::max(capacity,topology.cores[idx].capacity);
+        return capacity;
+    };
+    std::stable_sort(clusters.begin(),clusters.end(),[&clusterCapacity](const std::vector<int>& a,const std::vector<int>& b){
+        return clusterCapacity(a)<clusterCapacity(b);
+    });
+    for(size_t i=0;i<clusters.size();i++){
+        std::vector<int> ids;
+        for(const int idx:clusters[i]){
+            topology.cores[idx].cluster=(int)i;
+            ids.push_back(topology.cores[idx].id);
+        }
+        topology.clusters.push_back(ids);
+    }
+    if(topology.clusters.empty()){
+        // sysfs not readable, assume a single cluster with all online cores
+        const long nCores=sysconf(_SC_NPROCESSORS_CONF);
+        std::vector<int> ids;
+        for(int i=0;i<nCores;i++){
+            topology.cores.push_back({i,0,0,0});
+            ids.push_back(i);
+        }
+        topology.clusters.push_back(ids);
+    }
+    return topology;
+}
+
+std::string CPUTopology::Topology::toString() const {
+    std::stringstream ss;
+    ss<<"CPUTopology: "<<cores.size()<<" cores, "<<clusters.size()<<" clusters";
+    for(size_t i=0;i<clusters.size();i++){
+        ss<<"\nCluster "<<i<<":";
+        for(const int id:clusters[i]){
+            const auto core=std::find_if(cores.begin(),cores.end(),[id](const Core& c){return c.id==id;});
+            ss<<" cpu"<<id<<"(capacity "<<core->capacity<<", "<<core->maxFreqKHz/1000<<"MHz)";
+        }
+    }
+    return ss.str();
+}
+
+// All cores that are not part of the little cluster (on heterogeneous CPUs), except the excluded one.
+// Falls back to all cores except the excluded one if that would be empty
+static std::vector<int> performanceCoresExcept(const CPUTopology::Topology& topology,const int excluded){
+    std::vector<int> ret;
+    for(const auto& core:topology.cores){
+        if(core.id==excluded)continue;
+        if(topology.isHeterogeneous() && core.cluster==0)continue;
+        ret.push_back(core.id);
+    }
+    if(ret.empty()){
+        for(const auto& core:topology.cores){
+            if(core.id!=excluded)ret.push_back(core.id);
+        }
+    }
+    return ret;
+}
+
+ThreadPlacement::PlacementPolicy ThreadPlacement::getDefaultPolicy(const CPUTopology::Topology &topology,const ThreadRole role) {
+    PlacementPolicy policy;
+    if(topology.cores.empty())return policy;
+    // The FBR thread gets the last (in case of a tie) core with the highest capacity for itself
+    const int fbrCore=topology.bigCores().back();
+    switch (role) {
+        case ThreadRole::FBR_RENDER:
+            policy.cores={fbrCore};
+            policy.schedFifoPriority=2;
+            policy.nice=-20;
+            break;
+        case ThreadRole::VSYNC:
+            policy.cores=topology.isHeterogeneous() ? topology.littleCores() : performanceCoresExcept(topology,fbrCore);
+            policy.schedFifoPriority=1;
+            policy.nice=-10;
+            break;
+        case ThreadRole::SECONDARY_UI:
+            policy.cores=performanceCoresExcept(topology,fbrCore);
+            policy.nice=-4;
+            break;
+        case ThreadRole::DECODER:
+            policy.cores=performanceCoresExcept(topology,fbrCore);
+            policy.nice=-10;
+            break;
+    }
+    return policy;
+}
+
+ThreadPlacement::Result ThreadPlacement::applyToCurrentThread(const PlacementPolicy &policy,const bool elevatePriority) {
+    Result result;
+    const pid_t tid=(pid_t)syscall(__NR_gettid);
+    if(!policy.cores.empty()){
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for(const int core:policy.cores){
+            CPU_SET(core,&cpuSet);
+        }
+        if(sched_setaffinity(tid,sizeof(cpuSet),&cpuSet)==0){
+            result.affinitySet=true;
+        }else{
+            MLOGE<<"Cannot set affinity "<<strerror(errno);
+        }
+    }
+    if(!elevatePriority)return result;
+    if(policy.schedFifoPriority>0){
+        sched_param param{};
+        param.sched_priority=policy.schedFifoPriority;
+        if(sched_setscheduler(tid,SCHED_FIFO,&param)==0){
+            result.schedFifoSet=true;
+            return result;
+        }
+        // Normal apps are not allowed to use real time scheduling, fall back to nice
+        MLOGD<<"SCHED_FIFO not permitted ("<<strerror(errno)<<"), using nice "<<policy.nice;
+    }
+    if(policy.nice!=0){
+        if(setpriority(PRIO_PROCESS,tid,policy.nice)==0){
+            result.niceSet=true;
+        }else{
+            MLOGE<<"Cannot set nice "<<policy.nice<<" "<<strerror(errno);
+        }
+    }
+    return result;
+}
+
+const CPUTopology::Topology &ThreadPlacement::getTopology() {
+    static const CPUTopology::Topology topology=[](){
+        auto tmp=CPUTopology::discover();
+        MLOGD<<tmp.toString();
+        return tmp;
+    }();
+    return topology;
+}
+
+ThreadPlacement::Result ThreadPlacement::placeCurrentThread(const ThreadRole role,const bool elevatePriority) {
+    const auto policy=getDefaultPolicy(getTopology(),role);
+    const auto result=applyToCurrentThread(policy,elevatePriority);
+    std::stringstream ss;
+    for(const int core:policy.cores)ss<<core<<" ";
+    MLOGD<<"Placed "<<roleName(role)<<" thread on cores "<<ss.str()<<" affinity:"<<result.affinitySet
+    <<" SCHED_FIFO:"<<result.schedFifoSet<<" nice:"<<result.niceSet;
+    return result;
+}
+
+const char *ThreadPlacement::roleName(const ThreadRole role) {
+    switch (role) {
+        case ThreadRole::FBR_RENDER:return "FBR_RENDER";
+        case ThreadRole::VSYNC:return "VSYNC";
+        case ThreadRole::SECONDARY_UI:return "SECONDARY_UI";
+        case ThreadRole::DECODER:return "DECODER";
+    }
+    return "";
+}
@@ -0,0 +1,75 @@
+#ifndef RENDERINGX_THREADPLACEMENT_H
+#define RENDERINGX_THREADPLACEMENT_H
+
+#include <string>
+#include <vector>
+
+// Most android devices have a heterogeneous (big.LITTLE / DynamIQ) CPU. Pinning the front buffer rendering thread
+// to a hard coded core index (as done by CPUAffinityHelper::setAffinity() ) might put it on a little core on one device
+// and on a big core on another one. This discovers the topology from sysfs instead.
+namespace CPUTopology{
+    struct Core{
+        int id;
+        // Relative performance of this core (/sys/devices/system/cpu/cpuN/cpu_capacity, 0..1024)
+        // If not available, the max frequency in kHz is used instead
+        int64_t capacity;
+        int64_t maxFreqKHz;
+        // Index into Topology::clusters
+        int cluster;
+    };
+    struct Topology{
+        std::vector<Core> cores;
+        // Cores that share a frequency domain, sorted by capacity (index 0 == little cluster, last == biggest cluster)
+        std::vector<std::vector<int>> clusters;
+        bool isHeterogeneous()const{
+            return clusters.size()>1;
+        }
+        const std::vector<int>& littleCores()const{
+            return clusters.front();
+        }
+        const std::vector<int>& bigCores()const{
+            return clusters.back();
+        }
+        std::string toString()const;
+    };
+    // Parses a cpu list as used by sysfs, e.g. "0-3,6"
+    std::vector<int> parseCPUList(const std::string& cpuList);
+    // @param sysfsRoot: normally /sys/devices/system/cpu, but can be a fake directory tree for testing
+    Topology discover(const std::string& sysfsRoot="/sys/devices/system/cpu");
+}
+
+namespace ThreadPlacement{
+    enum class ThreadRole{
+        // Front buffer rendering - latency critical, gets a big core for itself
+        FBR_RENDER,
+        // Receives VSYNC events - wakes up shortly once per frame, runs fine on a little core
+        VSYNC,
+        // Secondary (shared) OpenGL context rendering UI layers
+        SECONDARY_UI,
+        // Video decoding / parsing
+        DECODER
+    };
+    struct PlacementPolicy{
+        // The thread is only allowed to run on these cores. Empty means no restriction
+        std::vector<int> cores;
+        // 0 means do not use SCHED_FIFO
+        int schedFifoPriority=0;
+        // Used if SCHED_FIFO is not requested or not permitted (e.g. for normal apps)
+        int nice=0;
+    };
+    PlacementPolicy getDefaultPolicy(const CPUTopology::Topology& topology,ThreadRole role);
+    struct Result{
+        bool affinitySet=false;
+        bool schedFifoSet=false;
+        bool niceSet=false;
+    };
+    // Apply the policy to the calling thread. Everything that is not permitted is logged and skipped
+    Result applyToCurrentThread(const PlacementPolicy& policy,bool elevatePriority=true);
+    // The topology of this device, discovered once
+    const CPUTopology::Topology& getTopology();
+    // Same as applyToCurrentThread(getDefaultPolicy(getTopology(),role))
+    Result placeCurrentThread(ThreadRole role,bool elevatePriority=true);
+    const char* roleName(ThreadRole role);
+}
+
+#endif //RENDERINGX_THREADPLACEMENT_H
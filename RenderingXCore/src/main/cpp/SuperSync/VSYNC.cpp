@@ -1,25 +1,5 @@
 #include "VSYNC.h"
-#include <android/choreographer.h>
-
-static bool resumed=false;
-
-static void refreshRateCallback(int64_t vsyncPeriodNanos, void *data) {
-    MLOGD<<"Refresh rate is"<<MyTimeHelper::ReadableNS(vsyncPeriodNanos);
-}
-static void frameCallback(long frameTimeNanos, void* data) {
-    MLOGD<<"Frame callback A:"<<frameTimeNanos;
-    reinterpret_cast<VSYNC*>(data)->setVSYNCSentByChoreographer(frameTimeNanos);
-    if(resumed){
-        //AChoreographer_postFrameCallback(AChoreographer_getInstance(),frameCallback,data);
-    }
-}
-
-static void test(){
-    //auto choreographer=AChoreographer_getInstance();
-    //AChoreographer_registerRefreshRateCallback(choreographer,refreshRateCallback,nullptr);
-    //AChoreographer_refreshRateCallback* p;
-    //AChoreographer_postFrameCallback64(choreographer,frameCallback,nullptr);
-}
+#include "VSYNCSource.h"
 
 #define JNI_METHOD(return_type, method_name) \
   JNIEXPORT return_type JNICALL              \
@@ -37,17 +17,27 @@ JNI_METHOD(void, nativeDelete)
 delete VSYNC::native(p);
 }
 
-/*JNI_METHOD(void, nativeResume)
-(JNIEnv *env, jobject obj, jlong p) {
-    resumed=true;
-    auto choreographer=AChoreographer_getInstance();
-    AChoreographer_postFrameCallback(choreographer,frameCallback,(void*)p);
+// Start delivering VSYNC events using the native choreographer on its own thread
+// Returns false if not supported (api<24), in this case java has to call nativeSetVSYNCSentByChoreographer() instead
+JNI_METHOD(jboolean, nativeResume)
+(JNIEnv *env, jobject obj, jlong p,jlong appVsyncOffsetNS) {
+#ifdef __ANDROID__
+    VSYNC* vsync=VSYNC::native(p);
+    if(vsync->getVSYNCSource()== nullptr){
+        vsync->setVSYNCSource(std::make_unique<ChoreographerVSYNCSource>(*vsync,std::chrono::nanoseconds(appVsyncOffsetNS)));
+    }
+    return (jboolean)vsync->getVSYNCSource()->start();
+#else
+    return (jboolean)false;
+#endif
 }
 JNI_METHOD(void, nativePause)
 (JNIEnv *env, jobject obj, jlong p) {
-    resumed=false;
-}*/
-
+    VSYNC* vsync=VSYNC::native(p);
+    if(vsync->getVSYNCSource()!= nullptr){
+        vsync->getVSYNCSource()->stop();
+    }
+}
 
 JNI_METHOD(void, nativeSetVSYNCSentByChoreographer)
 (JNIEnv *env, jobject obj, jlong p,jlong value) {
@@ -55,4 +45,4 @@ JNI_METHOD(void, nativeSetVSYNCSentByChoreographer)
     VSYNC::native(p)->setVSYNCSentByChoreographer((int64_t)value);
 }
 
-}
\ No newline at end of file
+}
@@ -6,12 +6,16 @@
 #define RENDERINGX_VSYNC_HPP
 
 #include <sys/types.h>
+#include <atomic>
+#include <cassert>
 #include <queue>
 #include <list>
 #include <deque>
 #include <TimeHelper.hpp>
 #include <ATraceCompbat.hpp>
 #include <jni.h>
+#include <memory>
+#include "VSYNCSource.h"
 
 
 // Helper to obtain the current VSYNC position (e.g. which scan line is currently read out)
@@ -164,6 +168,18 @@ private:
     static bool isInRange(CLOCK::duration value,CLOCK::duration min,CLOCK::duration max){
         return value>=min && value<=max;
     }
+    // Optional native source of VSYNC events (see VSYNCSource.h)
+    // Declared last, such that it is destroyed (and its thread stopped) before any other member
+    std::unique_ptr<VSYNCSource> vsyncSource;
+public:
+    // Replaces (and stops) the current VSYNC source, if any. The new source is not started yet
+    void setVSYNCSource(std::unique_ptr<VSYNCSource> source){
+        vsyncSource=std::move(source);
+    }
+    // nullptr if VSYNC events are delivered via setVSYNCSentByChoreographer() from java
+    VSYNCSource* getVSYNCSource(){
+        return vsyncSource.get();
+    }
 };
 using CLOCK=VSYNC::CLOCK;
 
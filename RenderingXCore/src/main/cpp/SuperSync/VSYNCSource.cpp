@@ -0,0 +1,195 @@
+#include "VSYNCSource.h"
+#include "VSYNC.h"
+#include "ThreadPlacement.h"
+#include <AndroidLogger.hpp>
+#include <fstream>
+#include <random>
+#ifdef __ANDROID__
+#include <android/looper.h>
+#include <dlfcn.h>
+#endif
+
+VSYNCSource::~VSYNCSource() {
+    stop();
+}
+
+bool VSYNCSource::start() {
+    if(running)return true;
+    if(!canStart())return false;
+    running=true;
+    thread=std::thread([this](){
+        ThreadPlacement::placeCurrentThread(ThreadPlacement::ThreadRole::VSYNC);
+        loop();
+    });
+    return true;
+}
+
+void VSYNCSource::stop() {
+    if(!running)return;
+    running=false;
+    wakeUp();
+    if(thread.joinable()){
+        thread.join();
+    }
+}
+
+#ifdef __ANDROID__
+// AChoreographer_postFrameCallback and AChoreographer_postFrameCallback64 are only available on api>=24 / api>=29
+// but our minSdkVersion is lower. Load them at runtime
+namespace ChoreographerFunctions{
+    typedef void (*AChoreographer_frameCallback)(long frameTimeNanos, void* data);
+    typedef void (*AChoreographer_frameCallback64)(int64_t frameTimeNanos, void* data);
+    typedef void* (*PFN_AChoreographer_getInstance)();
+    typedef void (*PFN_AChoreographer_postFrameCallback)(void* choreographer,AChoreographer_frameCallback callback, void* data);
+    typedef void (*PFN_AChoreographer_postFrameCallback64)(void* choreographer,AChoreographer_frameCallback64 callback, void* data);
+    static PFN_AChoreographer_getInstance getInstance=nullptr;
+    static PFN_AChoreographer_postFrameCallback postFrameCallback=nullptr;
+    static PFN_AChoreographer_postFrameCallback64 postFrameCallback64=nullptr;
+    static bool load(){
+        static bool loaded=false;
+        if(loaded)return getInstance!=nullptr;
+        loaded=true;
+        void* lib=dlopen("libandroid.so",RTLD_NOW | RTLD_LOCAL);
+        if(lib==nullptr){
+            MLOGE<<"Cannot open libandroid.so";
+            return false;
+        }
+        getInstance=reinterpret_cast<PFN_AChoreographer_getInstance>(dlsym(lib,"AChoreographer_getInstance"));
+        postFrameCallback=reinterpret_cast<PFN_AChoreographer_postFrameCallback>(dlsym(lib,"AChoreographer_postFrameCallback"));
+        postFrameCallback64=reinterpret_cast<PFN_AChoreographer_postFrameCallback64>(dlsym(lib,"AChoreographer_postFrameCallback64"));
+        if(getInstance==nullptr || (postFrameCallback==nullptr && postFrameCallback64==nullptr)){
+            MLOGD<<"AChoreographer not available";
+            getInstance=nullptr;
+            return false;
+        }
+        return true;
+    }
+}
+
+ChoreographerVSYNCSource::ChoreographerVSYNCSource(VSYNC &vsync,std::chrono::nanoseconds appVsyncOffset):
+VSYNCSource(vsync),appVsyncOffset(appVsyncOffset){}
+
+bool ChoreographerVSYNCSource::canStart() {
+    return ChoreographerFunctions::load();
+}
+
+void ChoreographerVSYNCSource::loop() {
+    ALooper* alooper=ALooper_prepare(0);
+    ALooper_acquire(alooper);
+    looper=alooper;
+    postFrameCallback();
+    while (running){
+        // returns after each frame callback, or when woken up by stop()
+        ALooper_pollOnce(-1, nullptr, nullptr, nullptr);
+    }
+    looper=nullptr;
+    ALooper_release(alooper);
+}
+
+void ChoreographerVSYNCSource::wakeUp() {
+    void* alooper=looper;
+    if(alooper!=nullptr){
+        ALooper_wake(static_cast<ALooper*>(alooper));
+    }
+}
+
+void ChoreographerVSYNCSource::postFrameCallback() {
+    // AChoreographer_getInstance returns the choreographer of the calling (looper) thread
+    void* choreographer=ChoreographerFunctions::getInstance();
+    // the 64 bit variant is preferred, since long is only 32 bit on armeabi-v7a
+    if(ChoreographerFunctions::postFrameCallback64!=nullptr){
+        ChoreographerFunctions::postFrameCallback64(choreographer,frameCallback64,this);
+    }else{
+        ChoreographerFunctions::postFrameCallback(choreographer,frameCallback,this);
+    }
+}
+
+void ChoreographerVSYNCSource::frameCallback64(int64_t frameTimeNanos, void *data) {
+    static_cast<ChoreographerVSYNCSource*>(data)->onFrame(frameTimeNanos);
+}
+
+void ChoreographerVSYNCSource::frameCallback(long frameTimeNanos, void *data) {
+    static_cast<ChoreographerVSYNCSource*>(data)->onFrame(frameTimeNanos);
+}
+
+void ChoreographerVSYNCSource::onFrame(int64_t frameTimeNanos) {
+    // Same correction as in VSYNC.java: remove the app vsync offset and add 1ms
+    // ( SurfaceFlinger adds an additional 1ms to allow for processing time and differences between the ideal and actual refresh rate )
+    const auto vsyncTimestamp=std::chrono::nanoseconds(frameTimeNanos)-appVsyncOffset+std::chrono::milliseconds(1);
+    vsync.setVSYNCSentByChoreographer(VSYNC::CLOCK::time_point(vsyncTimestamp));
+    if(running){
+        postFrameCallback();
+    }
+}
+#endif
+
+SyntheticVSYNCSource::SyntheticVSYNCSource(VSYNC &vsync,std::chrono::nanoseconds period,std::chrono::nanoseconds maxJitter):
+VSYNCSource(vsync),period(period),maxJitter(maxJitter){}
+
+void SyntheticVSYNCSource::loop() {
+    std::mt19937 generator(std::random_device{}());
+    std::uniform_int_distribution<int64_t> jitterDistribution(0,maxJitter.count());
+    auto nextVSYNC=VSYNC::CLOCK::now();
+    while (running){
+        nextVSYNC+=period;
+        const auto reportedVSYNC=nextVSYNC+std::chrono::nanoseconds(jitterDistribution(generator));
+        // The VSYNC class only accepts timestamps from the past
+        std::this_thread::sleep_until(reportedVSYNC);
+        vsync.setVSYNCSentByChoreographer(reportedVSYNC);
+    }
+}
+
+ReplayVSYNCSource::ReplayVSYNCSource(VSYNC &vsync,const std::string &fileName,const bool loopReplay):
+VSYNCSource(vsync),timestamps(readTimestamps(fileName)),loopReplay(loopReplay){}
+
+std::vector<int64_t> ReplayVSYNCSource::readTimestamps(const std::string &fileName) {
+    std::vector<int64_t> ret;
+    std::ifstream file(fileName);
+    if(!file.is_open()){
+        MLOGE<<"Cannot open VSYNC replay file "<<fileName;
+        return ret;
+    }
+    std::string line;
+    while(std::getline(file,line)){
+        if(line.empty() || line[0]=='#')continue;
+        int64_t timestamp;
+        try{
+            timestamp=std::stoll(line);
+        }catch (const std::exception&){
+            MLOGE<<"Skipping malformed VSYNC replay line "<<line;
+            continue;
+        }
+        if(!ret.empty() && timestamp<=ret.back()){
+            MLOGE<<"VSYNC replay timestamps have to be strictly increasing "<<timestamp;
+            continue;
+        }
+        ret.push_back(timestamp);
+    }
+    return ret;
+}
+
+bool ReplayVSYNCSource::canStart() {
+    if(timestamps.size()<2){
+        MLOGE<<"Not enough VSYNC timestamps to replay";
+        return false;
+    }
+    return true;
+}
+
+void ReplayVSYNCSource::loop() {
+    const auto start=VSYNC::CLOCK::now();
+    // Duration of one pass, including the gap to the first VSYNC of the next pass
+    const auto lastDelta=timestamps[timestamps.size()-1]-timestamps[timestamps.size()-2];
+    const auto passDuration=std::chrono::nanoseconds(timestamps.back()-timestamps.front()+lastDelta);
+    std::chrono::nanoseconds passOffset(0);
+    while (running){
+        for(const auto timestamp:timestamps){
+            if(!running)return;
+            const auto reportedVSYNC=start+passOffset+std::chrono::nanoseconds(timestamp-timestamps.front());
+            std::this_thread::sleep_until(reportedVSYNC);
+            vsync.setVSYNCSentByChoreographer(reportedVSYNC);
+        }
+        if(!loopReplay)break;
+        passOffset+=passDuration;
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef RENDERINGX_VSYNCSOURCE_H
+#define RENDERINGX_VSYNCSOURCE_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+class VSYNC;
+
+// A VSYNC source runs on its own thread and reports VSYNC timestamps to a VSYNC instance
+// ( via VSYNC::setVSYNCSentByChoreographer() ).
+// On android the Choreographer source replaces the round trip over java (one JNI call per frame, subject to GC pauses),
+// while the synthetic and replay sources allow running the SuperSync stack without a display (e.g. on Linux)
+class VSYNCSource{
+public:
+    explicit VSYNCSource(VSYNC& vsync):vsync(vsync){}
+    // Derived classes have to call stop() in their destructor,
+    // else loop() might still run while the derived part is already destroyed
+    virtual ~VSYNCSource();
+    // Start / stop delivering VSYNC events. Can be called multiple times (e.g. on resume / pause)
+    // @return false if the source could not be started
+    bool start();
+    void stop();
+    bool isRunning()const{
+        return running;
+    }
+protected:
+    VSYNC& vsync;
+    // true until stop() was called
+    std::atomic<bool> running{false};
+    // Runs on the VSYNC source thread until running becomes false
+    virtual void loop()=0;
+    // Called in stop() (from the thread calling stop) before joining the VSYNC source thread
+    virtual void wakeUp(){}
+    // @return false if the source is not supported
+    virtual bool canStart(){return true;}
+private:
+    std::thread thread;
+};
+
+#ifdef __ANDROID__
+// Uses the NDK AChoreographer on a dedicated ALooper thread.
+// AChoreographer is only available on api>=24 and loaded at runtime, on older devices start() returns false
+class ChoreographerVSYNCSource: public VSYNCSource{
+public:
+    // @param appVsyncOffset: Display.getAppVsyncOffsetNanos(), the choreographer timestamps are shifted by this value
+    ChoreographerVSYNCSource(VSYNC& vsync,std::chrono::nanoseconds appVsyncOffset);
+    ~ChoreographerVSYNCSource()override{
+        stop();
+    }
+protected:
+    void loop()override;
+    void wakeUp()override;
+    bool canStart()override;
+private:
+    const std::chrono::nanoseconds appVsyncOffset;
+    // The looper of the VSYNC source thread, valid while the thread is running
+    std::atomic<void*> looper{nullptr};
+    static void frameCallback64(int64_t frameTimeNanos,void* data);
+    static void frameCallback(long frameTimeNanos,void* data);
+    void onFrame(int64_t frameTimeNanos);
+    void postFrameCallback();
+};
+#endif
+
+// Generates VSYNC events with a fixed period using the high resolution steady clock.
+// Optionally adds a random jitter to each event, which is similar to what the android choreographer delivers
+class SyntheticVSYNCSource: public VSYNCSource{
+public:
+    SyntheticVSYNCSource(VSYNC& vsync,std::chrono::nanoseconds period=std::chrono::nanoseconds(16666666),
+            std::chrono::nanoseconds maxJitter=std::chrono::nanoseconds(0));
+    ~SyntheticVSYNCSource()override{
+        stop();
+    }
+protected:
+    void loop()override;
+private:
+    const std::chrono::nanoseconds period;
+    const std::chrono::nanoseconds maxJitter;
+};
+
+// Replays VSYNC timestamps recorded earlier (e.g. on a real device).
+// The file contains one timestamp in nanoseconds per line, lines starting with '#' and malformed lines are ignored.
+// The first timestamp is mapped to the time start() is called, then the original deltas are reproduced.
+class ReplayVSYNCSource: public VSYNCSource{
+public:
+    // @param loopReplay: start again at the beginning when the end of the file is reached
+    ReplayVSYNCSource(VSYNC& vsync,const std::string& fileName,bool loopReplay=true);
+    ~ReplayVSYNCSource()override{
+        stop();
+    }
+    static std::vector<int64_t> readTimestamps(const std::string& fileName);
+protected:
+    void loop()override;
+    bool canStart()override;
+private:
+    const std::vector<int64_t> timestamps;
+    const bool loopReplay;
+};
+
+#endif //RENDERINGX_VSYNCSOURCE_H
@@ -0,0 +1,128 @@
+#include "SecondaryRenderScheduler.h"
+#include <AndroidLogger.hpp>
+#include <GLInstrumentation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+SecondaryRenderScheduler::SecondaryRenderScheduler(std::string tag):TAG(std::move(tag)){}
+
+SecondaryRenderScheduler::ProducerId SecondaryRenderScheduler::addProducer(const ProducerConfig &config,RenderFunction render) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    const ProducerId id=(ProducerId)producers.size();
+    Producer producer;
+    producer.config=config;
+    producer.render=std::move(render);
+    producers.push_back(std::move(producer));
+    priorityOrder.push_back(id);
+    std::stable_sort(priorityOrder.begin(),priorityOrder.end(),[this](ProducerId a,ProducerId b){
+        return producers[a].config.priority>producers[b].config.priority;
+    });
+    dueProducers.reserve(producers.size());
+    return id;
+}
+
+void SecondaryRenderScheduler::markDirty(const ProducerId producer) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        producers.at(producer).dirty=true;
+    }
+    mCondition.notify_one();
+}
+
+void SecondaryRenderScheduler::setVsyncModel(CLOCK::time_point vsync,CLOCK::duration refreshPeriod1) {
+    if(refreshPeriod1<=CLOCK::duration::zero())return;
+    std::lock_guard<std::mutex> lock(mMutex);
+    // Keep the VSYNC indices of the producers valid: convert them to the time of the last render with the old model,
+    // then to an index with the new one (the refresh period might have changed, too)
+    for(auto& producer:producers){
+        if(producer.lastRenderVsyncIdx==NEVER_RENDERED)continue;
+        const CLOCK::time_point lastRender=vsyncBase+producer.lastRenderVsyncIdx*refreshPeriod;
+        producer.lastRenderVsyncIdx=vsyncIndex(lastRender,vsync,refreshPeriod1);
+    }
+    vsyncBase=vsync;
+    refreshPeriod=refreshPeriod1;
+}
+
+void SecondaryRenderScheduler::setMaxRendersPerVsync(const int maxRenders) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    maxRendersPerVsync=std::max(1,maxRenders);
+}
+
+int SecondaryRenderScheduler::doWork(const CLOCK::duration maxWait) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    const auto now=CLOCK::now();
+    const int64_t currentVsyncIdx=vsyncIndex(now,vsyncBase,refreshPeriod);
+    CLOCK::time_point wakeUp=now+maxWait;
+    dueProducers.clear();
+    for(const ProducerId id:priorityOrder){
+        Producer& producer=producers[id];
+        if(!producer.dirty && !producer.config.continuous)continue;
+        const int64_t dueVsyncIdx=producer.lastRenderVsyncIdx+vsyncDivider(producer.config.maxFps,refreshPeriod);
+        if(dueVsyncIdx<=currentVsyncIdx){
+            if((int)dueProducers.size()<maxRendersPerVsync){
+                dueProducers.push_back(id);
+                producer.dirty=false;
+                producer.lastRenderVsyncIdx=currentVsyncIdx;
+            }else{
+                // Deferred to the next VSYNC
+                wakeUp=std::min(wakeUp,vsyncBase+(currentVsyncIdx+1)*refreshPeriod);
+            }
+        }else{
+            wakeUp=std::min(wakeUp,vsyncBase+dueVsyncIdx*refreshPeriod);
+        }
+    }
+    if(dueProducers.empty()){
+        // Nothing to do, the GPU stays idle. Woken up early by markDirty()
+        mCondition.wait_until(lock,wakeUp);
+        lock.unlock();
+        nWakeUps++;
+        printLogIfNeeded();
+        return 0;
+    }
+    lock.unlock();
+    // Producers are never removed, rendering without holding the lock is safe
+    for(const ProducerId id:dueProducers){
+        producers[id].render();
+        // Each rendered producer frame is one frame of the OpenGL counters of this thread
+        GLInstrumentation::endFrame();
+        producers[id].nRendered++;
+    }
+    nVsyncsWithWork++;
+    printLogIfNeeded();
+    return (int)dueProducers.size();
+}
+
+int64_t SecondaryRenderScheduler::vsyncIndex(CLOCK::time_point time,CLOCK::time_point vsync,CLOCK::duration refreshPeriod) {
+    const auto delta=time-vsync;
+    int64_t idx=delta/refreshPeriod;
+    // round towards negative infinity
+    if(delta.count()<0 && idx*refreshPeriod!=delta)idx--;
+    return idx;
+}
+
+int64_t SecondaryRenderScheduler::vsyncDivider(float maxFps,CLOCK::duration refreshPeriod) {
+    if(maxFps<=0)return 1;
+    const double refreshPeriodS=std::chrono::duration<double>(refreshPeriod).count();
+    // Tolerance such that e.g. 60fps on a 59.9Hz display still renders with every VSYNC
+    const double divider=std::ceil(1.0/(maxFps*refreshPeriodS)-0.05);
+    return std::max((int64_t)1,(int64_t)divider);
+}
+
+void SecondaryRenderScheduler::printLogIfNeeded() {
+    const auto now=CLOCK::now();
+    if(now-lastLog<std::chrono::seconds(5))return;
+    const double elapsedS=std::chrono::duration<double>(now-lastLog).count();
+    lastLog=now;
+    std::stringstream ss;
+    ss<<"Render fps";
+    std::lock_guard<std::mutex> lock(mMutex);
+    for(auto& producer:producers){
+        ss<<" "<<producer.config.name<<":"<<(producer.nRendered/elapsedS);
+        producer.nRendered=0;
+    }
+    ss<<" | VSYNCs with work "<<nVsyncsWithWork<<" idle wake ups "<<nWakeUps;
+    nVsyncsWithWork=0;
+    nWakeUps=0;
+    MLOGD2(TAG.c_str())<<ss.str();
+}
@@ -0,0 +1,79 @@
+#ifndef RENDERINGX_SECONDARYRENDERSCHEDULER_H
+#define RENDERINGX_SECONDARYRENDERSCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Decides when the producers on the secondary (shared) OpenGL context (e.g. UI layers rendered into a VrRenderBuffer3)
+// render a new frame. Instead of re-rendering as fast as the thread loops, a producer only renders once it was marked dirty,
+// and not more often than its max frame rate. Renders are aligned to the display VSYNC, such that a new frame is ready
+// right at the beginning of a display refresh. With an idle UI nothing is rendered at all.
+// Call doWork() in a loop on the secondary context thread (onSecondaryContextDoWork).
+class SecondaryRenderScheduler{
+public:
+    using CLOCK=std::chrono::steady_clock;
+    // Renders one frame of the producer, e.g. VrRenderBuffer3::bind() -> draw -> unbindAndSwap()
+    using RenderFunction=std::function<void()>;
+    struct ProducerConfig{
+        std::string name;
+        // Producers with higher priority render first
+        int priority=0;
+        // The producer renders at most once every ceil(displayRefreshRate/maxFps) display refreshes
+        float maxFps=60;
+        // Render continuously (at maxFps), e.g. for animated content. Otherwise, only after markDirty()
+        bool continuous=false;
+    };
+    using ProducerId=int;
+    explicit SecondaryRenderScheduler(std::string tag="SecondaryRenderScheduler");
+    // Call before doWork() is called for the first time. New producers start dirty
+    ProducerId addProducer(const ProducerConfig& config,RenderFunction render);
+    // Can be called from any thread
+    void markDirty(ProducerId producer);
+    // Update the display VSYNC model. Can be called from any thread
+    // @param vsync: any (recent) VSYNC timestamp. @param refreshPeriod: time between two VSYNCs
+    void setVsyncModel(CLOCK::time_point vsync,CLOCK::duration refreshPeriod);
+    // Renders all producers that are due in priority order (at most maxRendersPerVsync, the others are due again with the next VSYNC),
+    // then waits until the next producer is due, one is marked dirty or maxWait elapsed.
+    // @return the n of rendered producers
+    int doWork(CLOCK::duration maxWait=std::chrono::milliseconds(100));
+    // Limits the GPU work done on the secondary context per display refresh
+    void setMaxRendersPerVsync(int maxRenders);
+    // Pure timing logic, exposed for testing with synthetic values
+    // Index of the VSYNC interval the time point lies in
+    static int64_t vsyncIndex(CLOCK::time_point time,CLOCK::time_point vsync,CLOCK::duration refreshPeriod);
+    // N of VSYNC intervals between two renders of a producer with the given max fps
+    static int64_t vsyncDivider(float maxFps,CLOCK::duration refreshPeriod);
+private:
+    const std::string TAG;
+    static constexpr int64_t NEVER_RENDERED=INT64_MIN/2;
+    struct Producer{
+        ProducerConfig config;
+        RenderFunction render;
+        bool dirty=true;
+        // VSYNC index of the last render, 'very old' if never rendered
+        int64_t lastRenderVsyncIdx=NEVER_RENDERED;
+        int nRendered=0;
+    };
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    // indexed by ProducerId
+    std::vector<Producer> producers;
+    // ProducerIds sorted by priority (highest first)
+    std::vector<ProducerId> priorityOrder;
+    CLOCK::time_point vsyncBase=CLOCK::now();
+    CLOCK::duration refreshPeriod=std::chrono::nanoseconds(16666666);
+    int maxRendersPerVsync=2;
+    // Only accessed by the secondary context thread
+    std::vector<ProducerId> dueProducers;
+    CLOCK::time_point lastLog=CLOCK::now();
+    int nVsyncsWithWork=0;
+    int nWakeUps=0;
+    void printLogIfNeeded();
+};
+
+#endif //RENDERINGX_SECONDARYRENDERSCHEDULER_H
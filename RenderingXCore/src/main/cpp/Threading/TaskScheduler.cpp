@@ -0,0 +1,219 @@
+#include "TaskScheduler.h"
+#include <ThreadPlacement.h>
+#include <GLWorkQueue.hpp>
+#include <AndroidLogger.hpp>
+#include <algorithm>
+#include <sstream>
+
+// Set for the worker threads only
+static thread_local const TaskScheduler* tlsScheduler=nullptr;
+static thread_local int tlsWorkerIdx=-1;
+
+TaskScheduler::Config TaskScheduler::getDefaultConfig() {
+    const auto& topology=ThreadPlacement::getTopology();
+    Config config;
+    if(topology.isHeterogeneous()){
+        // Leave the big cores to the render threads
+        config.cores=topology.littleCores();
+        config.nWorkers=(int)config.cores.size();
+    }
+    return config;
+}
+
+TaskScheduler::TaskScheduler(const Config& config) {
+    int nWorkers=config.nWorkers;
+    if(nWorkers<0){
+        nWorkers=config.cores.empty() ? (int)std::thread::hardware_concurrency()-1 : (int)config.cores.size();
+    }
+    nWorkers=std::max(1,nWorkers);
+    // All workers have to exist before the first one starts stealing
+    for(int i=0;i<nWorkers;i++){
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for(int i=0;i<nWorkers;i++){
+        workers[i]->thread=std::thread(&TaskScheduler::workerLoop,this,i,config);
+    }
+    std::stringstream ss;
+    ss<<"TaskScheduler: "<<nWorkers<<" workers, nice "<<config.nice<<" cores";
+    for(const int core:config.cores)ss<<" "<<core;
+    MLOGD<<ss.str();
+}
+
+TaskScheduler::~TaskScheduler() {
+    // Drain instead of dropping the queued tasks, else wait() or a thenOnGLThread() continuation would never complete
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stop=true;
+    }
+    sleepCondition.notify_all();
+    for(auto& worker:workers){
+        worker->thread.join();
+    }
+}
+
+TaskScheduler::TaskHandle TaskScheduler::submit(std::function<void()> work,const std::vector<TaskHandle>& dependencies) {
+    auto task=std::make_shared<Task>();
+    task->work=std::move(work);
+    for(const auto& dependency:dependencies){
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if(!dependency->finished){
+            dependency->dependents.push_back(task);
+            task->nPendingDependencies++;
+        }
+    }
+    if(--task->nPendingDependencies==0){
+        schedule(task);
+    }
+    return task;
+}
+
+void TaskScheduler::wait(const TaskHandle& task) {
+    const int workerIdx=currentWorkerIdx();
+    while(!task->isFinished()){
+        auto other=findTask(workerIdx);
+        if(other){
+            execute(other);
+            continue;
+        }
+        // The task is running on another thread. Nothing notifies waiters, so poll with a short timeout
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait_for(lock,std::chrono::microseconds(100));
+    }
+}
+
+void TaskScheduler::parallelFor(size_t begin,size_t end,size_t grainSize,const std::function<void(size_t,size_t)>& body) {
+    if(end<=begin)return;
+    grainSize=std::max((size_t)1,grainSize);
+    const size_t nChunks=(end-begin+grainSize-1)/grainSize;
+    std::vector<TaskHandle> tasks;
+    tasks.reserve(nChunks-1);
+    for(size_t i=1;i<nChunks;i++){
+        const size_t chunkBegin=begin+i*grainSize;
+        const size_t chunkEnd=std::min(end,chunkBegin+grainSize);
+        tasks.push_back(submit([&body,chunkBegin,chunkEnd](){
+            body(chunkBegin,chunkEnd);
+        }));
+    }
+    // The first chunk runs on the calling thread
+    body(begin,std::min(end,begin+grainSize));
+    for(const auto& task:tasks){
+        wait(task);
+    }
+}
+
+void TaskScheduler::parallelFor(size_t n,const std::function<void(size_t,size_t)>& body) {
+    const size_t nChunks=(workers.size()+1)*4;
+    parallelFor(0,n,(n+nChunks-1)/nChunks,body);
+}
+
+TaskScheduler::TaskHandle TaskScheduler::thenOnGLThread(const TaskHandle& task,GLWorkQueue& glWorkQueue,std::function<void()> continuation) {
+    return submit([&glWorkQueue,continuation=std::move(continuation)](){
+        glWorkQueue.post(continuation);
+    },{task});
+}
+
+TaskScheduler::Stats TaskScheduler::getStats() const {
+    return {nTasksExecuted.load(),nTasksStolen.load()};
+}
+
+std::string TaskScheduler::getStatsReadable() const {
+    std::stringstream ss;
+    ss<<"TaskScheduler: workers "<<workers.size()<<" executed "<<nTasksExecuted<<" stolen "<<nTasksStolen;
+    return ss.str();
+}
+
+TaskScheduler &TaskScheduler::instance() {
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+void TaskScheduler::workerLoop(const int workerIdx,const Config& config) {
+    tlsScheduler=this;
+    tlsWorkerIdx=workerIdx;
+    ThreadPlacement::PlacementPolicy policy;
+    policy.cores=config.cores;
+    policy.nice=config.nice;
+    ThreadPlacement::applyToCurrentThread(policy,false);
+    while(true){
+        auto task=findTask(workerIdx);
+        if(task){
+            execute(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        // When stopping, keep going until all queued tasks are done. A task that is still running on another worker
+        // might make its dependents ready, but then that worker executes them itself
+        if(stop && nQueuedTasks==0)break;
+        sleepCondition.wait(lock,[this](){return stop || nQueuedTasks>0;});
+    }
+}
+
+void TaskScheduler::schedule(TaskHandle task) {
+    int workerIdx=currentWorkerIdx();
+    if(workerIdx<0){
+        workerIdx=(int)(nextWorker++ % workers.size());
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers[workerIdx]->mutex);
+        workers[workerIdx]->deque.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        nQueuedTasks++;
+    }
+    sleepCondition.notify_one();
+}
+
+TaskScheduler::TaskHandle TaskScheduler::findTask(const int workerIdx) {
+    if(workerIdx>=0){
+        Worker& own=*workers[workerIdx];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.deque.empty()){
+            auto task=std::move(own.deque.back());
+            own.deque.pop_back();
+            nQueuedTasks--;
+            return task;
+        }
+    }
+    const size_t nWorkers=workers.size();
+    const size_t start=workerIdx>=0 ? (size_t)workerIdx+1 : 0;
+    for(size_t i=0;i<nWorkers;i++){
+        const size_t victimIdx=(start+i)%nWorkers;
+        if((int)victimIdx==workerIdx)continue;
+        Worker& victim=*workers[victimIdx];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.deque.empty()){
+            auto task=std::move(victim.deque.front());
+            victim.deque.pop_front();
+            nQueuedTasks--;
+            nTasksStolen++;
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void TaskScheduler::execute(const TaskHandle& task) {
+    try{
+        task->work();
+    }catch(const std::exception& e){
+        MLOGE<<"TaskScheduler: task threw "<<e.what();
+    }
+    task->work=nullptr;
+    std::vector<TaskHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->finished=true;
+        std::swap(dependents,task->dependents);
+    }
+    nTasksExecuted++;
+    for(auto& dependent:dependents){
+        if(--dependent->nPendingDependencies==0){
+            schedule(std::move(dependent));
+        }
+    }
+}
+
+int TaskScheduler::currentWorkerIdx() const {
+    return tlsScheduler==this ? tlsWorkerIdx : -1;
+}
@@ -0,0 +1,105 @@
+#ifndef RENDERINGX_TASKSCHEDULER_H
+#define RENDERINGX_TASKSCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class GLWorkQueue;
+
+// Small work-stealing thread pool for CPU work like mesh generation or distortion fitting.
+// Each worker has its own deque. It pushes and pops at the back (good cache locality for tasks spawned by
+// tasks), idle workers steal from the front of the other deques.
+// By default the workers run on the little cores (if the CPU is heterogeneous) with a positive nice value,
+// such that the render threads placed by ThreadPlacement are never starved.
+class TaskScheduler{
+public:
+    struct Config{
+        // n of worker threads. -1 == one per core in 'cores' (or per core minus one if 'cores' is empty)
+        int nWorkers=-1;
+        // Workers are only allowed to run on these cores. Empty == no restriction
+        std::vector<int> cores;
+        // Applied to each worker thread, see ThreadPlacement::PlacementPolicy
+        int nice=10;
+    };
+    // Little cores on heterogeneous CPUs, all cores otherwise
+    static Config getDefaultConfig();
+    explicit TaskScheduler(const Config& config=getDefaultConfig());
+    // Executes all submitted tasks (including the ones that become ready meanwhile), then joins the workers.
+    // Do not submit new tasks from other threads while destroying
+    ~TaskScheduler();
+    TaskScheduler(const TaskScheduler&)=delete;
+    class Task;
+    using TaskHandle=std::shared_ptr<Task>;
+    // Can be called from any thread (including workers). The task starts once all dependencies are finished
+    TaskHandle submit(std::function<void()> work,const std::vector<TaskHandle>& dependencies={});
+    // Blocks until the task is finished. The calling thread executes other tasks while waiting
+    void wait(const TaskHandle& task);
+    // Split [begin,end) into chunks of grainSize and call body(chunkBegin,chunkEnd) for each in parallel
+    // Blocks until all chunks are done, the calling thread helps
+    void parallelFor(size_t begin,size_t end,size_t grainSize,const std::function<void(size_t,size_t)>& body);
+    // Same as above for [0,n), with a grain size that gives each worker (and the calling thread) about 4 chunks.
+    // Matches the ParallelFor parameter of the geometry builders (e.g. UvSphere::ParallelFor)
+    void parallelFor(size_t n,const std::function<void(size_t,size_t)>& body);
+    // Post continuation into the GL work queue once task finished.
+    // Use this to upload the result of a task (e.g. a mesh) without blocking the OpenGL thread.
+    // Returns the task that posts the continuation, wait for it before destroying the GL work queue
+    TaskHandle thenOnGLThread(const TaskHandle& task,GLWorkQueue& glWorkQueue,std::function<void()> continuation);
+    int getNWorkers()const{
+        return (int)workers.size();
+    }
+    struct Stats{
+        uint64_t nTasksExecuted;
+        uint64_t nTasksStolen;
+    };
+    Stats getStats()const;
+    std::string getStatsReadable()const;
+    // Owned by the library, created with getDefaultConfig() on first use
+    static TaskScheduler& instance();
+public:
+    class Task{
+    public:
+        bool isFinished()const{
+            return finished.load();
+        }
+    private:
+        friend class TaskScheduler;
+        std::function<void()> work;
+        // +1 until submit() registered all dependencies
+        std::atomic<int> nPendingDependencies{1};
+        std::mutex mutex;
+        std::vector<TaskHandle> dependents;
+        std::atomic<bool> finished{false};
+    };
+private:
+    struct Worker{
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<TaskHandle> deque;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    // Tasks made ready by threads that are not workers are distributed round robin
+    std::atomic<size_t> nextWorker{0};
+    std::atomic<bool> stop{false};
+    // Ready but not yet started tasks, used to put idle workers to sleep
+    std::atomic<int> nQueuedTasks{0};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<uint64_t> nTasksExecuted{0};
+    std::atomic<uint64_t> nTasksStolen{0};
+    void workerLoop(int workerIdx,const Config& config);
+    void schedule(TaskHandle task);
+    // Pop from the own deque (if called by a worker), steal from the others otherwise
+    TaskHandle findTask(int workerIdx);
+    void execute(const TaskHandle& task);
+    // Index of the calling worker, -1 if the calling thread is not a worker of this scheduler
+    int currentWorkerIdx()const;
+};
+
+#endif //RENDERINGX_TASKSCHEDULER_H
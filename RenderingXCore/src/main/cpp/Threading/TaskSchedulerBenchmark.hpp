@@ -0,0 +1,42 @@
+#ifndef RENDERINGX_TASKSCHEDULERBENCHMARK_HPP
+#define RENDERINGX_TASKSCHEDULERBENCHMARK_HPP
+
+#include "TaskScheduler.h"
+#include <UvSphere.hpp>
+#include <chrono>
+#include <sstream>
+#include <string>
+
+// Measures how the TaskScheduler scales with the n of workers, using the generation of a dense 360° video sphere.
+// Not called by the library itself, run it manually (e.g. from a test activity) on the device of interest,
+// or on the host with the TaskSchedulerBenchmark executable of src/test/cpp.
+// Placement is not restricted, such that the n of workers and not the cluster size is measured
+namespace TaskSchedulerBenchmark{
+    static std::string runScaling(const int maxWorkers=8,const int nIterations=10){
+        constexpr int LATITUDES=360;
+        constexpr int LONGITUDES=720;
+        std::stringstream ss;
+        ss<<"TaskScheduler scaling (UvSphere "<<LATITUDES<<"x"<<LONGITUDES<<")";
+        double timeOneWorkerMs=0;
+        for(int nWorkers=1;nWorkers<=maxWorkers;nWorkers++){
+            TaskScheduler::Config config;
+            config.nWorkers=nWorkers;
+            config.nice=0;
+            TaskScheduler scheduler(config);
+            const UvSphere::ParallelFor parallelFor=[&scheduler](size_t n,const std::function<void(size_t,size_t)>& body){
+                scheduler.parallelFor(0,n,4,body);
+            };
+            const auto start=std::chrono::steady_clock::now();
+            for(int i=0;i<nIterations;i++){
+                const auto sphere=UvSphere::createUvSphere(1.0f,LATITUDES,LONGITUDES,180,360,
+                        UvSphere::MEDIA_EQUIRECT_MONOSCOPIC,UvSphere::ROTATE_0,parallelFor);
+            }
+            const double timeMs=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-start).count()/nIterations;
+            if(nWorkers==1)timeOneWorkerMs=timeMs;
+            ss<<"\n"<<nWorkers<<" workers: "<<timeMs<<"ms speedup "<<(timeOneWorkerMs/timeMs);
+        }
+        return ss.str();
+    }
+}
+
+#endif //RENDERINGX_TASKSCHEDULERBENCHMARK_HPP
@@ -0,0 +1,67 @@
+#ifndef RENDERINGX_DURATIONHISTOGRAM_HPP
+#define RENDERINGX_DURATIONHISTOGRAM_HPP
+
+#include <array>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include "TimeHelper.hpp"
+
+// Histogram of durations with fixed bucket width
+// Unlike the AvgCalculator, it also shows the distribution (e.g. the 99th percentile of the GPU time is more
+// interesting for front buffer rendering than the average).
+// Does not allocate, so it can be used in the render loop
+template<size_t N_BUCKETS=40>
+class DurationHistogram{
+public:
+    using DURATION=std::chrono::nanoseconds;
+    explicit DurationHistogram(DURATION bucketWidth=std::chrono::microseconds(500)):BUCKET_WIDTH(bucketWidth){}
+    void add(const DURATION duration){
+        const auto idx=duration.count()<0 ? 0 : duration/BUCKET_WIDTH;
+        if(idx>=(long)N_BUCKETS){
+            nOverflow++;
+        }else{
+            buckets[idx]++;
+        }
+        nSamples++;
+        if(duration>max)max=duration;
+    }
+    template<class Rep,class Period>
+    void add(const std::chrono::duration<Rep,Period> duration){
+        add(std::chrono::duration_cast<DURATION>(duration));
+    }
+    // Returns the upper bound of the bucket that contains the given percentile (0..100)
+    DURATION getPercentile(const double percentile)const{
+        if(nSamples==0)return DURATION(0);
+        const auto target=(uint64_t)(nSamples*percentile/100.0);
+        uint64_t count=0;
+        for(size_t i=0;i<N_BUCKETS;i++){
+            count+=buckets[i];
+            if(count>target)return BUCKET_WIDTH*(i+1);
+        }
+        return max;
+    }
+    uint64_t getNSamples()const{
+        return nSamples;
+    }
+    void reset(){
+        buckets={};
+        nOverflow=0;
+        nSamples=0;
+        max=DURATION(0);
+    }
+    std::string getPercentilesReadable()const{
+        std::stringstream ss;
+        ss<<"p50:"<<MyTimeHelper::R(getPercentile(50))<<" p90:"<<MyTimeHelper::R(getPercentile(90))
+        <<" p99:"<<MyTimeHelper::R(getPercentile(99))<<" max:"<<MyTimeHelper::R(max);
+        return ss.str();
+    }
+private:
+    const DURATION BUCKET_WIDTH;
+    std::array<uint64_t,N_BUCKETS> buckets={};
+    uint64_t nOverflow=0;
+    uint64_t nSamples=0;
+    DURATION max=DURATION(0);
+};
+
+#endif //RENDERINGX_DURATIONHISTOGRAM_HPP
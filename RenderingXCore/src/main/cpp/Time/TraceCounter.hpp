@@ -0,0 +1,46 @@
+#ifndef RENDERINGX_TRACECOUNTER_HPP
+#define RENDERINGX_TRACECOUNTER_HPP
+
+#include <cstdint>
+#ifdef __ANDROID__
+#include <dlfcn.h>
+#endif
+
+// Writes a named counter into the systrace / perfetto trace (shows up as a track next to the ATrace sections)
+// ATrace_setCounter is only available on api>=29 but our minSdkVersion is lower, so it is loaded at runtime.
+// On older devices and on Linux the counters are silently dropped
+namespace TraceCounter{
+    typedef void (*PFN_ATrace_setCounter)(const char* counterName, int64_t counterValue);
+    typedef bool (*PFN_ATrace_isEnabled)();
+    struct Functions{
+        PFN_ATrace_setCounter setCounter=nullptr;
+        PFN_ATrace_isEnabled isEnabled=nullptr;
+    };
+    static const Functions& getFunctions(){
+        static const Functions functions=[](){
+            Functions ret;
+#ifdef __ANDROID__
+            void* lib=dlopen("libandroid.so",RTLD_NOW | RTLD_LOCAL);
+            if(lib!=nullptr){
+                ret.setCounter=reinterpret_cast<PFN_ATrace_setCounter>(dlsym(lib,"ATrace_setCounter"));
+                ret.isEnabled=reinterpret_cast<PFN_ATrace_isEnabled>(dlsym(lib,"ATrace_isEnabled"));
+            }
+#endif
+            return ret;
+        }();
+        return functions;
+    }
+    // true if a trace is currently recorded, use this to skip expensive work for the counter values
+    static bool isEnabled(){
+        const auto& functions=getFunctions();
+        return functions.setCounter!=nullptr && functions.isEnabled!=nullptr && functions.isEnabled();
+    }
+    static void set(const char* counterName,const int64_t value){
+        const auto& functions=getFunctions();
+        if(functions.setCounter!=nullptr){
+            functions.setCounter(counterName,value);
+        }
+    }
+}
+
+#endif //RENDERINGX_TRACECOUNTER_HPP
@@ -18,13 +18,17 @@ public class VSYNC implements LifecycleObserver, Choreographer.FrameCallback{
     private static final String TAG="VSYNC";
     private native long nativeConstruct();
     private native void nativeSetVSYNCSentByChoreographer(long nativeInstance,long newVSYNC);
-    //private native void nativePause(long nativeInstance);
-    //private native void nativeResume(long nativeInstance);
+    // Returns false if the native choreographer is not available (api<24)
+    private native boolean nativeResume(long nativeInstance,long appVsyncOffsetNS);
+    private native void nativePause(long nativeInstance);
     private native void nativeDelete(long p);
 
     private final long nativeInstance;
 
     private final long choreographerVsyncOffsetNS;
+    // If true, the VSYNC events are obtained by the native choreographer on its own thread
+    // and there is no JNI call per frame
+    private boolean usesNativeChoreographer=false;
 
     public VSYNC(final AppCompatActivity parent){
         final Display d=((WindowManager) Objects.requireNonNull(parent.getSystemService(Context.WINDOW_SERVICE))).getDefaultDisplay();
@@ -65,14 +69,19 @@ public class VSYNC implements LifecycleObserver, Choreographer.FrameCallback{
 
     @OnLifecycleEvent(Lifecycle.Event.ON_RESUME)
     private void onResume(){
-        Choreographer.getInstance().postFrameCallback(this);
-        //nativeResume(nativeInstance);
+        usesNativeChoreographer=nativeResume(nativeInstance,choreographerVsyncOffsetNS);
+        if(!usesNativeChoreographer){
+            Choreographer.getInstance().postFrameCallback(this);
+        }
     }
 
     @OnLifecycleEvent(Lifecycle.Event.ON_PAUSE)
     private void onPause(){
-        Choreographer.getInstance().removeFrameCallback(this);
-        //nativePause(nativeInstance);
+        if(usesNativeChoreographer){
+            nativePause(nativeInstance);
+        }else{
+            Choreographer.getInstance().removeFrameCallback(this);
+        }
     }
 
     @Override
@@ -52,4 +52,20 @@ public class Extensions {
 
     // Calls native code since doing so is only possible in c/c++ code
     public static native void nativeSetThreadAffinity(final int cpuCore);
+
+    // Roles for nativePlaceCurrentThread, same order as ThreadPlacement::ThreadRole in cpp
+    public static final int THREAD_ROLE_FBR_RENDER=0;
+    public static final int THREAD_ROLE_VSYNC=1;
+    public static final int THREAD_ROLE_SECONDARY_UI=2;
+    public static final int THREAD_ROLE_DECODER=3;
+    // Pins the calling thread to cores matching the role (big / little cluster, discovered from sysfs)
+    // and elevates its priority if permitted
+    public static native void nativePlaceCurrentThread(final int threadRole);
+
+    // Enables the persistent cache for linked OpenGL programs. Call before the OpenGL programs are created,
+    // but after a native library that links GLPrograms was loaded (e.g. in the constructor of the renderer)
+    public static void enableProgramBinaryCache(final Context c){
+        nativeSetProgramBinaryCacheDirectory(c.getCacheDir().getAbsolutePath()+"/gl_programs");
+    }
+    public static native void nativeSetProgramBinaryCacheDirectory(final String directory);
 }
@@ -7,6 +7,8 @@ import android.opengl.EGLDisplay;
 import android.opengl.EGLSurface;
 import android.util.Log;
 
+import constantin.renderingx.core.deviceinfo.Extensions;
+
 import static android.opengl.EGL14.EGL_DEFAULT_DISPLAY;
 import static android.opengl.EGL14.EGL_HEIGHT;
 import static android.opengl.EGL14.EGL_NONE;
@@ -106,6 +108,7 @@ public class GLContextSurfaceLess {
         @Override
         public void run() {
             Thread.currentThread().setName("SecondRenderer");
+            Extensions.nativePlaceCurrentThread(Extensions.THREAD_ROLE_SECONDARY_UI);
             Helper.eglMakeCurrentSafe(eglDisplay,eglSurface,eglContext);
             mISecondarySharedContext.onSecondaryContextCreated();
             while(!Thread.currentThread().isInterrupted()){
@@ -0,0 +1,72 @@
+#include "TestHelper.hpp"
+#include <AllocationCounter.h>
+#include <array>
+#include <thread>
+#include <vector>
+
+// Calls the replaceable operator new directly, new-expressions may be optimized out
+static void allocate(){
+    void* ptr=::operator new(sizeof(int));
+    ::operator delete(ptr);
+}
+
+static void testCountsAllocations(){
+    const AllocationCounter::Scope scope;
+    allocate();
+    allocate();
+    EXPECT_EQ(2,scope.getNAllocations());
+}
+
+// What the render loop does after warm-up (re-using its storage) must not be counted
+static void testNoAllocationsInSteadyState(){
+    std::vector<int> values;
+    values.reserve(64);
+    std::array<int,8> fixed{};
+    const AllocationCounter::Scope scope;
+    for(int frame=0;frame<100;frame++){
+        values.clear();
+        for(int i=0;i<64;i++)values.push_back(i);
+        fixed[frame%fixed.size()]=values.back();
+    }
+    EXPECT_EQ(0,scope.getNAllocations());
+}
+
+// Allocations inside an Exclude (e.g. logging) are not counted by the enclosing scope, also if nested
+static void testExclude(){
+    const AllocationCounter::Scope scope;
+    allocate();
+    {
+        const AllocationCounter::Exclude outer;
+        allocate();
+        {
+            const AllocationCounter::Exclude inner;
+            allocate();
+        }
+        allocate();
+    }
+    EXPECT_EQ(1,scope.getNAllocations());
+}
+
+// Allocations of other threads are not counted
+static void testCountsPerThread(){
+    const AllocationCounter::Scope scope;
+    std::thread otherThread;
+    // Creating the thread allocates on this thread, only count what happens while it runs
+    const uint64_t nBefore=AllocationCounter::getNAllocationsCurrentThread();
+    otherThread=std::thread([](){
+        for(int i=0;i<10;i++){
+            allocate();
+        }
+    });
+    otherThread.join();
+    EXPECT_TRUE(AllocationCounter::getNAllocationsCurrentThread()-nBefore<10);
+}
+
+int main(){
+    EXPECT_TRUE(AllocationCounter::isEnabled());
+    testCountsAllocations();
+    testNoAllocationsInSteadyState();
+    testExclude();
+    testCountsPerThread();
+    return TestHelper::finish("AllocationCounterTest");
+}
@@ -0,0 +1,105 @@
+#include "TestHelper.hpp"
+#include "SurfacelessEGLContext.hpp"
+#include <EGLImageExchange.hpp>
+#include <atomic>
+#include <thread>
+
+// Round trip through a EGLImageSwapchain between two contexts that do not share a share group, on a mesa surfaceless display.
+// The producer thread clears each frame to a known color, the consumer (main thread) reads the imported texture back.
+// GLState is per thread, so each context gets its own thread like in the app (secondary context / compositor)
+
+static constexpr int W=64;
+static constexpr int H=64;
+static constexpr int N_FRAMES=20;
+
+// Spins until the condition is true, false after 5 seconds
+template<class Condition>
+static bool waitUntil(const Condition& condition){
+    const auto deadline=std::chrono::steady_clock::now()+std::chrono::seconds(5);
+    while(!condition()){
+        if(std::chrono::steady_clock::now()>deadline)return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+// Red channel of the center pixel of the texture, read back on the current context
+static int readRed(const GLuint texture){
+    GLuint framebuffer;
+    glGenFramebuffers(1,&framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER,framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,texture,0);
+    std::array<uint8_t,4> pixel{};
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER)==GL_FRAMEBUFFER_COMPLETE){
+        glReadPixels(W/2,H/2,1,1,GL_RGBA,GL_UNSIGNED_BYTE,pixel.data());
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+    glDeleteFramebuffers(1,&framebuffer);
+    return pixel[0];
+}
+
+int main(){
+    SurfacelessEGLContext consumerContext;
+    SurfacelessEGLContext producerContext;
+    if(!consumerContext.makeCurrent()){
+        std::cout<<"EGLImageSwapchainTest skipped\n";
+        return SurfacelessEGLContext::SKIPPED;
+    }
+    Extensions::initializeGL();
+    if(!EGLImageExchange::isSupported(EGLImageExchange::Backend::SHARED_TEXTURE)){
+        std::cout<<"EGLImageSwapchainTest skipped, no EGL_KHR_gl_texture_2D_image\n";
+        return SurfacelessEGLContext::SKIPPED;
+    }
+    EGLImageSwapchain swapchain;
+    // Frame n is cleared to red==n. Until the last frames, the producer waits for the consumer to take each frame
+    std::atomic<int> nConsumedFrames{0};
+    std::atomic<bool> producerDone{false};
+    std::atomic<bool> consumerDeleted{false};
+    std::thread producer([&]{
+        producerContext.makeCurrent();
+        EXPECT_TRUE(swapchain.initializeProducerGL(W,H,EGLImageExchange::Backend::SHARED_TEXTURE));
+        const auto renderFrame=[&](const int frame){
+            swapchain.bind();
+            glClearColor(frame/255.0f,0.0f,0.0f,1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            swapchain.unbindAndSwap();
+        };
+        for(int frame=1;frame<=N_FRAMES;frame++){
+            if(!waitUntil([&]{return nConsumedFrames==frame-1;}))break;
+            renderFrame(frame);
+        }
+        // Two frames before the consumer looks again, the first one is dropped
+        waitUntil([&]{return nConsumedFrames==N_FRAMES;});
+        renderFrame(N_FRAMES+1);
+        renderFrame(N_FRAMES+2);
+        producerDone=true;
+        waitUntil([&]{return consumerDeleted.load();});
+        swapchain.deleteProducerGL();
+        producerContext.releaseCurrent();
+    });
+    FramebufferTexture::TimingInformation timing{};
+    for(int frame=1;frame<=N_FRAMES;frame++){
+        EXPECT_TRUE(waitUntil([&]{return swapchain.isNewFrameAvailable();}));
+        bool isNewFrame=false;
+        const GLuint texture=swapchain.getLatestRenderedTexture(isNewFrame,timing);
+        EXPECT_TRUE(isNewFrame);
+        EXPECT_TRUE(texture!=0);
+        EXPECT_EQ(frame,readRed(texture));
+        // Without a new frame the texture of the current one is returned again
+        bool isNewFrame2=false;
+        EXPECT_EQ(texture,swapchain.getLatestRenderedTexture(isNewFrame2,timing));
+        EXPECT_TRUE(!isNewFrame2);
+        nConsumedFrames=frame;
+    }
+    EXPECT_TRUE(waitUntil([&]{return producerDone.load();}));
+    bool isNewFrame=false;
+    const GLuint texture=swapchain.getLatestRenderedTexture(isNewFrame,timing);
+    EXPECT_TRUE(isNewFrame);
+    EXPECT_EQ(N_FRAMES+2,readRed(texture));
+    EXPECT_TRUE(!swapchain.isNewFrameAvailable());
+    EXPECT_EQ(GL_NO_ERROR,(int)glGetError());
+    swapchain.deleteConsumerGL();
+    consumerDeleted=true;
+    producer.join();
+    return TestHelper::finish("EGLImageSwapchainTest");
+}
@@ -0,0 +1,173 @@
+#include "TestHelper.hpp"
+#include "MockFrameTimestampsBackend.hpp"
+#include <FramePacer.h>
+#include <FrameTimestampsTracker.h>
+#include <vector>
+
+using namespace std::chrono_literals;
+using CLOCK=std::chrono::steady_clock;
+
+class RecordingListener: public FrameTimestampsTracker::Listener{
+public:
+    void onFrameTimestamps(const FrameTimestampsTracker::SubmittedFrame& frame,const FrameTimestamps::FrameTimestamps& timestamps)override{
+        frames.push_back(frame);
+    }
+    std::vector<FrameTimestampsTracker::SubmittedFrame> frames;
+    std::vector<EGLuint64KHR> frameIds()const{
+        std::vector<EGLuint64KHR> ret;
+        for(const auto& frame:frames)ret.push_back(frame.frameId);
+        return ret;
+    }
+};
+
+struct TrackerWithMock{
+    MockFrameTimestampsBackend* backend=new MockFrameTimestampsBackend();
+    FrameTimestampsTracker tracker{std::unique_ptr<FrameTimestampsBackend>(backend),"Test"};
+    RecordingListener listener;
+    TrackerWithMock(){
+        tracker.setListener(&listener);
+    }
+};
+
+// Frames are reported in order, as soon as all their timestamps are available
+static void testFramesReportedInOrder(){
+    TrackerWithMock t;
+    const auto startTime=CLOCK::now();
+    const auto targetPresentTime=startTime+20ms;
+    t.tracker.onFrameSubmitted(startTime,targetPresentTime);
+    t.tracker.onFrameSubmitted();
+    t.tracker.onFrameSubmitted();
+    t.tracker.poll();
+    EXPECT_TRUE(t.listener.frames.empty());
+    t.backend->setPresented(1,2ms,5ms,6ms,16ms);
+    t.backend->setPresented(2,2ms,5ms,6ms,16ms);
+    t.tracker.poll();
+    EXPECT_EQ((std::vector<EGLuint64KHR>{1,2}),t.listener.frameIds());
+    EXPECT_TRUE(t.listener.frames[0].startTime==startTime);
+    EXPECT_TRUE(t.listener.frames[0].targetPresentTime==targetPresentTime);
+    EXPECT_TRUE(t.listener.frames[1].targetPresentTime==CLOCK::time_point{});
+    t.backend->setPresented(3,2ms,5ms,6ms,16ms);
+    t.tracker.poll();
+    EXPECT_EQ((std::vector<EGLuint64KHR>{1,2,3}),t.listener.frameIds());
+    // Nothing pending anymore
+    const int nQueries=t.backend->nQueries;
+    t.tracker.poll();
+    EXPECT_EQ(nQueries,t.backend->nQueries);
+}
+
+// A pending frame blocks all following frames, even if their timestamps are available already
+static void testPendingFrameBlocksFollowingFrames(){
+    TrackerWithMock t;
+    t.tracker.onFrameSubmitted();
+    t.tracker.onFrameSubmitted();
+    t.backend->setPresented(2,2ms,5ms,6ms,16ms);
+    t.tracker.poll();
+    EXPECT_TRUE(t.listener.frames.empty());
+    t.backend->setPresented(1,2ms,5ms,6ms,16ms);
+    t.tracker.poll();
+    EXPECT_EQ((std::vector<EGLuint64KHR>{1,2}),t.listener.frameIds());
+}
+
+static void testStageDurations(){
+    TrackerWithMock t;
+    for(EGLuint64KHR i=1;i<=10;i++){
+        t.tracker.onFrameSubmitted();
+        t.backend->setPresented(i,4ms,8ms,10ms,25ms);
+    }
+    t.tracker.poll();
+    const auto stats=t.tracker.getStats();
+    EXPECT_EQ(10,stats.stages[FrameTimestampsTracker::TOTAL].nSamples);
+    // Each histogram bucket is 0.5ms wide
+    const auto total=stats.stages[FrameTimestampsTracker::TOTAL].p50;
+    EXPECT_TRUE(total>=24ms && total<=26ms);
+    const auto latch=stats.stages[FrameTimestampsTracker::LATCH].p50;
+    EXPECT_TRUE(latch>=3ms && latch<=5ms);
+    EXPECT_EQ(0,stats.nFramesNotPresented);
+    EXPECT_EQ(0,stats.nFramesLost);
+    t.tracker.resetStats();
+    EXPECT_EQ(0,t.tracker.getStats().stages[FrameTimestampsTracker::TOTAL].nSamples);
+}
+
+static void testDroppedAndLostFrames(){
+    TrackerWithMock t;
+    t.tracker.onFrameSubmitted();
+    t.tracker.onFrameSubmitted();
+    t.tracker.onFrameSubmitted();
+    t.backend->setDropped(1,3ms);
+    t.backend->lostFrames.insert(2);
+    t.backend->setPresented(3,2ms,5ms,6ms,16ms);
+    t.tracker.poll();
+    // The dropped frame is reported, the lost one not
+    EXPECT_EQ((std::vector<EGLuint64KHR>{1,3}),t.listener.frameIds());
+    const auto stats=t.tracker.getStats();
+    EXPECT_EQ(1,stats.nFramesNotPresented);
+    EXPECT_EQ(1,stats.nFramesLost);
+    EXPECT_EQ(1,stats.stages[FrameTimestampsTracker::TOTAL].nSamples);
+    EXPECT_EQ(2,stats.stages[FrameTimestampsTracker::RENDERING_COMPLETE].nSamples);
+}
+
+// Frames that are still pending after 16 newer frames were submitted are given up
+static void testTooManyPendingFrames(){
+    TrackerWithMock t;
+    for(int i=0;i<20;i++){
+        t.tracker.onFrameSubmitted();
+    }
+    EXPECT_EQ(4,t.tracker.getStats().nFramesLost);
+    for(EGLuint64KHR i=1;i<=20;i++){
+        t.backend->setPresented(i,2ms,5ms,6ms,16ms);
+    }
+    t.tracker.poll();
+    EXPECT_EQ(16,t.listener.frames.size());
+    EXPECT_EQ(5,t.listener.frames.front().frameId);
+}
+
+static void testBackendNotAvailable(){
+    TrackerWithMock t;
+    t.backend->available=false;
+    t.tracker.onFrameSubmitted();
+    t.tracker.poll();
+    EXPECT_EQ(0,t.backend->nQueries);
+    EXPECT_TRUE(t.listener.frames.empty());
+}
+
+// Without EGL_ANDROID_presentation_time (not available on the host) frames are not paced,
+// but the FramePacer still feeds its tracker. Unpaced frames do not change the pacing controller
+static void testFramePacerFeedsTracker(){
+    auto* backend=new MockFrameTimestampsBackend();
+    FramePacer framePacer("Test",std::unique_ptr<FrameTimestampsBackend>(backend));
+    framePacer.beginFrame();
+    framePacer.endFrame();
+    framePacer.beginFrame();
+    framePacer.endFrame();
+    backend->setPresented(1,2ms,5ms,6ms,16ms);
+    backend->setPresented(2,2ms,5ms,6ms,40ms);
+    framePacer.beginFrame();
+    EXPECT_EQ(2,framePacer.getFrameTimestampsTracker().getStats().stages[FrameTimestampsTracker::TOTAL].nSamples);
+    EXPECT_EQ(0,framePacer.getController().nPresentedOnTime);
+    EXPECT_EQ(0,framePacer.getController().nPresentedLate);
+}
+
+static void testFramePacingControllerSafetyMargin(){
+    FramePacingController controller;
+    const auto margin=controller.getSafetyMargin();
+    const auto target=CLOCK::now();
+    controller.onFramePresented(target,target+16ms);
+    EXPECT_EQ(1,controller.nPresentedLate);
+    EXPECT_TRUE(controller.getSafetyMargin()==margin+FramePacingController::MARGIN_INCREASE);
+    for(int i=0;i<FramePacingController::N_ON_TIME_BEFORE_DECREASE;i++){
+        controller.onFramePresented(target,target);
+    }
+    EXPECT_TRUE(controller.getSafetyMargin()==margin+FramePacingController::MARGIN_INCREASE-FramePacingController::MARGIN_DECREASE);
+}
+
+int main(){
+    testFramesReportedInOrder();
+    testPendingFrameBlocksFollowingFrames();
+    testStageDurations();
+    testDroppedAndLostFrames();
+    testTooManyPendingFrames();
+    testBackendNotAvailable();
+    testFramePacerFeedsTracker();
+    testFramePacingControllerSafetyMargin();
+    return TestHelper::finish("FrameTimestampsTrackerTest");
+}
@@ -0,0 +1,19 @@
+#include "SurfacelessEGLContext.hpp"
+#include <Extensions.h>
+#include <GLBufferBenchmark.hpp>
+#include <cstdlib>
+#include <iostream>
+
+// Host executable for GLBufferBenchmark::runDynamicUploads() on a mesa surfaceless context, not a test (the result depends on the driver)
+// Usage: GLBufferBenchmark [nUploads]
+int main(int argc,char* argv[]){
+    SurfacelessEGLContext context;
+    if(!context.makeCurrent()){
+        std::cout<<"GLBufferBenchmark needs the mesa surfaceless platform\n";
+        return SurfacelessEGLContext::SKIPPED;
+    }
+    Extensions::initializeGL();
+    const int nUploads=argc>1 ? std::atoi(argv[1]) : 1000;
+    std::cout<<GLBufferBenchmark::runDynamicUploads(nUploads)<<"\n";
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include "TestHelper.hpp"
+#include <MeshOptimizer.hpp>
+#include <vector>
+
+struct Vertex{
+    float x,y,z;
+};
+
+// A strip over the quads of one row, from x=0 to x=nQuads
+static void appendRow(std::vector<Vertex>& strip,const int nQuads,const float y){
+    for(int i=0;i<=nQuads;i++){
+        strip.push_back({(float)i,y,0});
+        strip.push_back({(float)i,y+1,0});
+    }
+}
+
+// Two rows joined like the geometry builders do (e.g. UvSphere), by copying the last and the next vertex instead of repeating
+// their index. The join is only degenerate once the identical vertices are merged
+static void testRemovesDegenerateTrianglesAfterDeduplication(){
+    std::vector<Vertex> strip;
+    appendRow(strip,2,0);
+    strip.push_back(strip.back());
+    strip.push_back({0,1,0});
+    appendRow(strip,2,1);
+    const AMeshData<Vertex,GLuint> mesh(strip,GL_TRIANGLE_STRIP);
+    MeshOptimizer::Report report;
+    const auto optimized=MeshOptimizer::optimize(mesh,&report);
+    EXPECT_TRUE(report.optimized);
+    EXPECT_EQ(GL_TRIANGLES,(int)optimized.mode);
+    EXPECT_EQ((std::size_t)9,optimized.vertices.size());
+    const auto& indices=*optimized.indices;
+    // 2 rows of 2 quads
+    EXPECT_EQ((std::size_t)8*3,indices.size());
+    for(std::size_t i=0;i+2<indices.size();i+=3){
+        EXPECT_TRUE(indices[i]!=indices[i+1] && indices[i+1]!=indices[i+2] && indices[i]!=indices[i+2]);
+    }
+}
+
+int main(){
+    testRemovesDegenerateTrianglesAfterDeduplication();
+    return TestHelper::finish("MeshOptimizerTest");
+}
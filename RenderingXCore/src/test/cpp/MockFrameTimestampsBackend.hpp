@@ -0,0 +1,69 @@
+#ifndef RENDERINGX_MOCKFRAMETIMESTAMPSBACKEND_HPP
+#define RENDERINGX_MOCKFRAMETIMESTAMPSBACKEND_HPP
+
+#include <FrameTimestampsTracker.h>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <set>
+
+// FrameTimestampsBackend without EGL. Frame ids start at 1, the timestamps of each frame are pending
+// until the test sets them with setPresented() / setDropped()
+class MockFrameTimestampsBackend: public FrameTimestampsBackend{
+public:
+    using CLOCK=std::chrono::steady_clock;
+    std::optional<EGLuint64KHR> getNextFrameId()override{
+        if(!available)return std::nullopt;
+        submitTimes[nextFrameId]=CLOCK::now();
+        return nextFrameId++;
+    }
+    bool getTimestamps(EGLuint64KHR frameId,FrameTimestamps::FrameTimestamps& timestamps)override{
+        nQueries++;
+        if(lostFrames.count(frameId)>0)return false;
+        const auto it=frames.find(frameId);
+        timestamps=it==frames.end() ? allPending() : it->second;
+        return true;
+    }
+    // The frame was rendered, latched, composited and presented this long after it was submitted
+    void setPresented(const EGLuint64KHR frameId,const std::chrono::nanoseconds renderingComplete,const std::chrono::nanoseconds latch,
+            const std::chrono::nanoseconds compositionStart,const std::chrono::nanoseconds displayPresent){
+        auto timestamps=allPending();
+        timestamps.RENDERING_COMPLETE_TIME_ANDROID=toNs(frameId,renderingComplete);
+        timestamps.COMPOSITION_LATCH_TIME_ANDROID=toNs(frameId,latch);
+        timestamps.FIRST_COMPOSITION_START_TIME_ANDROID=toNs(frameId,compositionStart);
+        timestamps.LAST_COMPOSITION_START_TIME_ANDROID=toNs(frameId,compositionStart);
+        timestamps.DISPLAY_PRESENT_TIME_ANDROID=toNs(frameId,displayPresent);
+        frames[frameId]=timestamps;
+    }
+    // The frame was rendered, but replaced by a newer one before it was latched
+    void setDropped(const EGLuint64KHR frameId,const std::chrono::nanoseconds renderingComplete){
+        auto timestamps=allPending();
+        timestamps.RENDERING_COMPLETE_TIME_ANDROID=toNs(frameId,renderingComplete);
+        timestamps.COMPOSITION_LATCH_TIME_ANDROID=EGL_TIMESTAMP_INVALID_ANDROID;
+        timestamps.FIRST_COMPOSITION_START_TIME_ANDROID=EGL_TIMESTAMP_INVALID_ANDROID;
+        timestamps.LAST_COMPOSITION_START_TIME_ANDROID=EGL_TIMESTAMP_INVALID_ANDROID;
+        timestamps.DISPLAY_PRESENT_TIME_ANDROID=EGL_TIMESTAMP_INVALID_ANDROID;
+        frames[frameId]=timestamps;
+    }
+    // eglGetFrameTimestampsANDROID fails for these frames (e.g. too old)
+    std::set<EGLuint64KHR> lostFrames;
+    bool available=true;
+    int nQueries=0;
+private:
+    EGLuint64KHR nextFrameId=1;
+    std::map<EGLuint64KHR,CLOCK::time_point> submitTimes;
+    std::map<EGLuint64KHR,FrameTimestamps::FrameTimestamps> frames;
+    EGLnsecsANDROID toNs(const EGLuint64KHR frameId,const std::chrono::nanoseconds afterSubmit){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(submitTimes[frameId].time_since_epoch()+afterSubmit).count();
+    }
+    static FrameTimestamps::FrameTimestamps allPending(){
+        std::array<EGLnsecsANDROID,sizeof(FrameTimestamps::FrameTimestamps)/sizeof(EGLnsecsANDROID)> values{};
+        values.fill(EGL_TIMESTAMP_PENDING_ANDROID);
+        FrameTimestamps::FrameTimestamps timestamps{};
+        std::memcpy(&timestamps,values.data(),sizeof(timestamps));
+        return timestamps;
+    }
+};
+
+#endif //RENDERINGX_MOCKFRAMETIMESTAMPSBACKEND_HPP
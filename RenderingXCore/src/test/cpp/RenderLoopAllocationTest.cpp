@@ -0,0 +1,89 @@
+#include "TestHelper.hpp"
+#include "SurfacelessEGLContext.hpp"
+#include <AllocationCounter.h>
+#include <VrCompositorRenderer.h>
+#include <GLProgramVC.h>
+#include <GLProgramTexture.h>
+#include <GLProgramLine.h>
+#include <GLStreamingBuffer.hpp>
+#include <ColoredGeometry.hpp>
+#include <TexturedGeometry.hpp>
+
+// Renders the compositor layers and the GLProgram* draw calls on a mesa surfaceless context and checks that
+// once warmed up, a frame does not allocate (what FBRManager asserts on the device with RENDERINGX_COUNT_ALLOCATIONS)
+
+// Cardboard viewer v2 on a 1920x1080 screen
+static MVrHeadsetParams cardboardV2(){
+    return {0.1104f,0.0622f,0.039f,0.064f,0,0.035f,{50.0f,50.0f,50.0f,50.0f},{0.34f,0.55f},1920,1080};
+}
+
+static constexpr int N_WARM_UP_FRAMES=10;
+static constexpr int N_FRAMES=100;
+
+int main(){
+    SurfacelessEGLContext context(1920,1080);
+    if(!context.makeCurrent()){
+        std::cout<<"RenderLoopAllocationTest skipped\n";
+        return SurfacelessEGLContext::SKIPPED;
+    }
+    EXPECT_TRUE(AllocationCounter::isEnabled());
+    Extensions::initializeGL();
+    VrCompositorRenderer renderer(cardboardV2(),nullptr,true,false);
+    renderer.initializeGL();
+    // One producer for all layers. A new frame each frame, such that the compositor also takes the new frame path
+    VrRenderBuffer2 canvas;
+    canvas.initializeGL();
+    canvas.setSize(640,360);
+    renderer.addLayer2DCanvas(-3,2.0f,2.0f*9.0f/16.0f,&canvas,VrCompositorRenderer::NONE);
+    renderer.addLayer2DCanvas(-3,1.0f,1.0f*9.0f/16.0f,&canvas,VrCompositorRenderer::FULL);
+    renderer.addLayerSphere360(10.0f,UvSphere::MEDIA_EQUIRECT_MONOSCOPIC,&canvas);
+    const GLProgramVC glProgramVC;
+    const GLProgramTexture glProgramTexture;
+    const GLProgramLine glProgramLine;
+    const ColoredGLMeshBuffer coloredMesh(ColoredGeometry::makeTessellatedColoredRect(10,{0,0,-2},{1,1},TrueColor2::GREEN));
+    const TexturedGLMeshBuffer texturedMesh(TexturedGeometry::makeTesselatedVideoCanvas(10,{0,0,-2},{1,1},0.0f,1.0f));
+    GLStreamingBuffer streamingBuffer;
+    streamingBuffer.initializeGL();
+    const glm::mat4 viewM=glm::lookAt(glm::vec3(0,0,0),glm::vec3(0,0,-1),glm::vec3(0,1,0));
+    const glm::mat4 projM=glm::perspective(glm::radians(90.0f),16.0f/9.0f,0.1f,100.0f);
+
+    const auto renderFrame=[&](const int frame){
+        canvas.bind();
+        glClearColor(frame%2==0 ? 1.0f : 0.0f,0.0f,0.0f,1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        canvas.unbindAndSwap();
+        renderer.updateLatestHeadSpaceFromStartSpaceRotation();
+        glClearColor(0.0f,0.0f,0.0f,0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        renderer.drawLayers(GVR_LEFT_EYE);
+        renderer.drawLayers(GVR_RIGHT_EYE);
+        // What an application draws in addition to the compositor layers
+        streamingBuffer.beginFrame();
+        const auto line=GLProgramLine::writeLine(streamingBuffer,{-1.0f,0.0f},{1.0f,0.1f*(frame%10)},0.1f);
+        streamingBuffer.commit();
+        glViewport(0,0,1920,1080);
+        glProgramVC.drawX(viewM,projM,coloredMesh);
+        glProgramTexture.drawX(canvas.getLatestRenderedTexture(),viewM,projM,texturedMesh);
+        if(line.isValid()){
+            glProgramLine.beforeDraw(line);
+            glProgramLine.setOtherUniforms();
+            glProgramLine.draw(viewM,projM,0,line.count);
+            glProgramLine.afterDraw();
+        }
+        glFinish();
+    };
+    for(int frame=0;frame<N_WARM_UP_FRAMES;frame++){
+        renderFrame(frame);
+    }
+    uint64_t nAllocations=0;
+    for(int frame=0;frame<N_FRAMES;frame++){
+        const AllocationCounter::Scope scope;
+        renderFrame(frame);
+        nAllocations+=scope.getNAllocations();
+        // Like the FBRManager, the periodic report is done outside of the counted frame
+        renderer.printLogIfNeeded();
+    }
+    EXPECT_EQ((uint64_t)0,nAllocations);
+    EXPECT_EQ(GL_NO_ERROR,(int)glGetError());
+    return TestHelper::finish("RenderLoopAllocationTest");
+}
@@ -0,0 +1,79 @@
+#ifndef RENDERINGX_SURFACELESSEGLCONTEXT_HPP
+#define RENDERINGX_SURFACELESSEGLCONTEXT_HPP
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <iostream>
+
+// OpenGL ES 3 context with a pbuffer surface on the mesa surfaceless platform (e.g. llvmpipe),
+// for the host tests that need OpenGL but no window system.
+// If the platform is not available isValid() returns false and the test should exit with SKIPPED
+class SurfacelessEGLContext{
+public:
+    // ctest reports a test that exits with this code as skipped, see SKIP_RETURN_CODE in CMakeLists.txt
+    static constexpr int SKIPPED=77;
+    // The display is initialized once and never terminated, such that multiple contexts (also on multiple threads) can use it
+    static EGLDisplay getDisplay(){
+        static const EGLDisplay display=initializeDisplay();
+        return display;
+    }
+    explicit SurfacelessEGLContext(const int width=64,const int height=64){
+        display=getDisplay();
+        if(display==EGL_NO_DISPLAY)return;
+        const EGLint configAttributes[]={EGL_RENDERABLE_TYPE,EGL_OPENGL_ES2_BIT,EGL_SURFACE_TYPE,EGL_PBUFFER_BIT,
+                                         EGL_RED_SIZE,8,EGL_GREEN_SIZE,8,EGL_BLUE_SIZE,8,EGL_ALPHA_SIZE,8,EGL_NONE};
+        EGLConfig config;
+        EGLint nConfigs=0;
+        if(!eglChooseConfig(display,configAttributes,&config,1,&nConfigs) || nConfigs<1){
+            std::cerr<<"No pbuffer config\n";
+            return;
+        }
+        const EGLint contextAttributes[]={EGL_CONTEXT_CLIENT_VERSION,3,EGL_NONE};
+        context=eglCreateContext(display,config,EGL_NO_CONTEXT,contextAttributes);
+        const EGLint surfaceAttributes[]={EGL_WIDTH,width,EGL_HEIGHT,height,EGL_NONE};
+        surface=eglCreatePbufferSurface(display,config,surfaceAttributes);
+        if(context==EGL_NO_CONTEXT || surface==EGL_NO_SURFACE){
+            std::cerr<<"Cannot create context "<<std::hex<<eglGetError()<<"\n";
+        }
+    }
+    ~SurfacelessEGLContext(){
+        if(display==EGL_NO_DISPLAY)return;
+        if(eglGetCurrentContext()==context){
+            eglMakeCurrent(display,EGL_NO_SURFACE,EGL_NO_SURFACE,EGL_NO_CONTEXT);
+        }
+        if(surface!=EGL_NO_SURFACE)eglDestroySurface(display,surface);
+        if(context!=EGL_NO_CONTEXT)eglDestroyContext(display,context);
+    }
+    SurfacelessEGLContext(const SurfacelessEGLContext&)=delete;
+    SurfacelessEGLContext& operator=(const SurfacelessEGLContext&)=delete;
+    bool isValid()const{
+        return context!=EGL_NO_CONTEXT && surface!=EGL_NO_SURFACE;
+    }
+    // Binds the context to the calling thread
+    bool makeCurrent()const{
+        return isValid() && eglMakeCurrent(display,surface,surface,context)==EGL_TRUE;
+    }
+    void releaseCurrent()const{
+        eglMakeCurrent(display,EGL_NO_SURFACE,EGL_NO_SURFACE,EGL_NO_CONTEXT);
+    }
+private:
+    EGLDisplay display=EGL_NO_DISPLAY;
+    EGLContext context=EGL_NO_CONTEXT;
+    EGLSurface surface=EGL_NO_SURFACE;
+    static EGLDisplay initializeDisplay(){
+        const auto eglGetPlatformDisplayEXT_=(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if(eglGetPlatformDisplayEXT_==nullptr){
+            std::cerr<<"eglGetPlatformDisplayEXT not available\n";
+            return EGL_NO_DISPLAY;
+        }
+        const EGLDisplay display=eglGetPlatformDisplayEXT_(EGL_PLATFORM_SURFACELESS_MESA,EGL_DEFAULT_DISPLAY,nullptr);
+        if(display==EGL_NO_DISPLAY || !eglInitialize(display,nullptr,nullptr)){
+            std::cerr<<"Mesa surfaceless platform not available\n";
+            return EGL_NO_DISPLAY;
+        }
+        eglBindAPI(EGL_OPENGL_ES_API);
+        return display;
+    }
+};
+
+#endif //RENDERINGX_SURFACELESSEGLCONTEXT_HPP
@@ -0,0 +1,12 @@
+#include <TaskSchedulerBenchmark.hpp>
+#include <cstdlib>
+#include <iostream>
+
+// Host executable for TaskSchedulerBenchmark::runScaling(), not a test (the result depends on the machine)
+// Usage: TaskSchedulerBenchmark [maxWorkers] [nIterations]
+int main(int argc,char* argv[]){
+    const int maxWorkers=argc>1 ? std::atoi(argv[1]) : 8;
+    const int nIterations=argc>2 ? std::atoi(argv[2]) : 10;
+    std::cout<<TaskSchedulerBenchmark::runScaling(maxWorkers,nIterations)<<"\n";
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "TestHelper.hpp"
+#include <TaskScheduler.h>
+#include <GLWorkQueue.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static TaskScheduler::Config config(const int nWorkers){
+    TaskScheduler::Config config;
+    config.nWorkers=nWorkers;
+    config.nice=0;
+    return config;
+}
+
+// Each index is visited exactly once, also when the range is not a multiple of the grain size
+static void testParallelFor(){
+    TaskScheduler scheduler(config(3));
+    std::vector<std::atomic<int>> visited(1001);
+    scheduler.parallelFor(0,visited.size(),64,[&visited](size_t begin,size_t end){
+        for(size_t i=begin;i<end;i++)visited[i]++;
+    });
+    int nWrong=0;
+    for(const auto& v:visited)if(v!=1)nWrong++;
+    EXPECT_EQ(0,nWrong);
+}
+
+static void testDependencies(){
+    TaskScheduler scheduler(config(2));
+    std::atomic<int> order{0};
+    int firstOrder=-1,secondOrder=-1;
+    auto first=scheduler.submit([&](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        firstOrder=order++;
+    });
+    auto second=scheduler.submit([&](){secondOrder=order++;},{first});
+    scheduler.wait(second);
+    EXPECT_EQ(0,firstOrder);
+    EXPECT_EQ(1,secondOrder);
+}
+
+// Destroying the scheduler executes the queued tasks (and the ones that become ready meanwhile) instead of dropping them
+static void testDestructorDrains(){
+    std::atomic<int> nExecuted{0};
+    GLWorkQueue glWorkQueue;
+    {
+        TaskScheduler scheduler(config(1));
+        // Keeps the only worker busy such that the tasks below are still queued when the destructor runs
+        auto blocker=scheduler.submit([](){
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        });
+        std::vector<TaskScheduler::TaskHandle> tasks;
+        for(int i=0;i<10;i++){
+            tasks.push_back(scheduler.submit([&nExecuted](){nExecuted++;},{blocker}));
+        }
+        scheduler.thenOnGLThread(tasks.back(),glWorkQueue,[&nExecuted](){nExecuted++;});
+    }
+    EXPECT_EQ(10,nExecuted.load());
+    // The continuation was posted, it runs on the OpenGL thread
+    EXPECT_EQ(1,glWorkQueue.drainAll());
+    EXPECT_EQ(11,nExecuted.load());
+}
+
+int main(){
+    testParallelFor();
+    testDependencies();
+    testDestructorDrains();
+    return TestHelper::finish("TaskSchedulerTest");
+}
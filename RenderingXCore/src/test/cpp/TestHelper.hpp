@@ -0,0 +1,53 @@
+#ifndef RENDERINGX_TESTHELPER_HPP
+#define RENDERINGX_TESTHELPER_HPP
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Minimal test helper for the host tests (no test framework is available in the android build).
+// Unlike assert() the checks are not compiled out in release builds and a failing check does not stop the test
+namespace TestHelper{
+    inline int nFailures=0;
+    template<class T>
+    std::string toString(const T& value){
+        std::stringstream ss;
+        ss<<value;
+        return ss.str();
+    }
+    template<class T>
+    std::string toString(const std::vector<T>& values){
+        std::stringstream ss;
+        ss<<"{";
+        for(size_t i=0;i<values.size();i++){
+            ss<<(i==0 ? "" : ",")<<values[i];
+        }
+        ss<<"}";
+        return ss.str();
+    }
+    // Returns the exit code of the test executable
+    inline int finish(const char* testName){
+        if(nFailures==0){
+            std::cout<<testName<<" passed\n";
+            return 0;
+        }
+        std::cout<<testName<<" failed ("<<nFailures<<" checks)\n";
+        return 1;
+    }
+}
+
+#define EXPECT_TRUE(condition) do{ \
+    if(!(condition)){ \
+        TestHelper::nFailures++; \
+        std::cout<<__FILE__<<":"<<__LINE__<<" expected "<<#condition<<"\n"; \
+    } }while(false)
+
+#define EXPECT_EQ(expected,actual) do{ \
+    if(!((expected)==(actual))){ \
+        TestHelper::nFailures++; \
+        std::cout<<__FILE__<<":"<<__LINE__<<" expected "<<#actual<<" == "<<TestHelper::toString(expected) \
+        <<" but was "<<TestHelper::toString(actual)<<"\n"; \
+    } }while(false)
+
+#endif //RENDERINGX_TESTHELPER_HPP
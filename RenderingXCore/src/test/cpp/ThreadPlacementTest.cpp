@@ -0,0 +1,113 @@
+#include "TestHelper.hpp"
+#include <ThreadPlacement.h>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+namespace fs=std::filesystem;
+
+// Builds a fake /sys/devices/system/cpu tree in a temporary directory, removed when destroyed
+class FakeSysfs{
+public:
+    FakeSysfs(){
+        char tmpl[]="/tmp/rx_sysfs_XXXXXX";
+        root=mkdtemp(tmpl);
+    }
+    ~FakeSysfs(){
+        fs::remove_all(root);
+    }
+    void write(const std::string& relativePath,const std::string& content)const{
+        const fs::path path=fs::path(root)/relativePath;
+        fs::create_directories(path.parent_path());
+        std::ofstream(path)<<content<<"\n";
+    }
+    void addCore(const int id,const int64_t maxFreqKHz,const std::string& relatedCPUs="")const{
+        const std::string dir="cpu"+std::to_string(id);
+        write(dir+"/cpufreq/cpuinfo_max_freq",std::to_string(maxFreqKHz));
+        if(!relatedCPUs.empty()){
+            write(dir+"/cpufreq/related_cpus",relatedCPUs);
+        }
+    }
+    std::string root;
+};
+
+static void testParseCPUList(){
+    EXPECT_EQ((std::vector<int>{0,1,2,3,6}),CPUTopology::parseCPUList("0-3,6"));
+    EXPECT_EQ((std::vector<int>{1,2,3}),CPUTopology::parseCPUList("3,1-2,2"));
+    EXPECT_EQ(std::vector<int>{},CPUTopology::parseCPUList(""));
+    // Invalid ranges are skipped
+    EXPECT_EQ((std::vector<int>{4}),CPUTopology::parseCPUList("x,4"));
+}
+
+// 4 little and 4 big cores, with cpufreq/related_cpus (most devices)
+static void testBigLittle(){
+    FakeSysfs sysfs;
+    sysfs.write("possible","0-7");
+    for(int i=0;i<4;i++)sysfs.addCore(i,1804800,"0-3");
+    for(int i=4;i<8;i++)sysfs.addCore(i,2419200,"4-7");
+    const auto topology=CPUTopology::discover(sysfs.root);
+    EXPECT_EQ(8,topology.cores.size());
+    EXPECT_EQ(2,topology.clusters.size());
+    EXPECT_TRUE(topology.isHeterogeneous());
+    EXPECT_EQ((std::vector<int>{0,1,2,3}),topology.littleCores());
+    EXPECT_EQ((std::vector<int>{4,5,6,7}),topology.bigCores());
+    EXPECT_EQ(2419200,topology.cores[5].maxFreqKHz);
+    EXPECT_EQ(1,topology.cores[5].cluster);
+}
+
+// Big cores with the lower cpu ids, and a prime core (DynamIQ 1+3+4). Without the possible file the cpuN directories are used
+static void testPrimeClusterWithoutPossible(){
+    FakeSysfs sysfs;
+    for(int i=0;i<3;i++)sysfs.addCore(i,2420000,"0-2");
+    for(int i=3;i<7;i++)sysfs.addCore(i,1780000,"3-6");
+    sysfs.addCore(7,2840000,"7");
+    const auto topology=CPUTopology::discover(sysfs.root);
+    EXPECT_EQ(3,topology.clusters.size());
+    EXPECT_EQ((std::vector<int>{3,4,5,6}),topology.littleCores());
+    EXPECT_EQ((std::vector<int>{0,1,2}),topology.clusters[1]);
+    EXPECT_EQ((std::vector<int>{7}),topology.bigCores());
+}
+
+// cpu_capacity is preferred over the max frequency. Without related_cpus the cores are grouped by the topology cluster_id
+static void testCapacityAndClusterId(){
+    FakeSysfs sysfs;
+    sysfs.write("possible","0-3");
+    for(int i=0;i<4;i++){
+        const bool big=i>=2;
+        sysfs.addCore(i,2000000);
+        sysfs.write("cpu"+std::to_string(i)+"/cpu_capacity",big ? "1024" : "446");
+        sysfs.write("cpu"+std::to_string(i)+"/topology/cluster_id",big ? "1" : "0");
+    }
+    const auto topology=CPUTopology::discover(sysfs.root);
+    EXPECT_EQ(2,topology.clusters.size());
+    EXPECT_EQ((std::vector<int>{0,1}),topology.littleCores());
+    EXPECT_EQ((std::vector<int>{2,3}),topology.bigCores());
+    EXPECT_EQ(1024,topology.cores[3].capacity);
+}
+
+// All cores are the same
+static void testHomogeneous(){
+    FakeSysfs sysfs;
+    sysfs.write("possible","0-3");
+    for(int i=0;i<4;i++)sysfs.addCore(i,1500000,"0-3");
+    const auto topology=CPUTopology::discover(sysfs.root);
+    EXPECT_EQ(1,topology.clusters.size());
+    EXPECT_TRUE(!topology.isHeterogeneous());
+}
+
+// Unreadable sysfs falls back to a single cluster with all cores of this machine
+static void testMissingSysfs(){
+    const auto topology=CPUTopology::discover("/nonexistent/rx_sysfs");
+    EXPECT_EQ(1,topology.clusters.size());
+    EXPECT_TRUE(!topology.cores.empty());
+}
+
+int main(){
+    testParseCPUList();
+    testBigLittle();
+    testPrimeClusterWithoutPossible();
+    testCapacityAndClusterId();
+    testHomogeneous();
+    testMissingSysfs();
+    return TestHelper::finish("ThreadPlacementTest");
+}
@@ -0,0 +1,91 @@
+#include "TestHelper.hpp"
+#include <VSYNC.h>
+#include <VSYNCSource.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+static constexpr auto PERIOD=16666666ns;
+
+// VSYNC events are counted from the first one, which is delivered about one period after start.
+// Allows some deviation for a loaded host
+static void expectCountMatchesElapsed(const VSYNC& vsync,const CLOCK::time_point firstVSYNC){
+    const auto now=CLOCK::now();
+    const auto latest=vsync.getLatestVSYNC();
+    EXPECT_TRUE(latest.base<=now);
+    EXPECT_TRUE(now-latest.base<vsync.getDisplayRefreshTime());
+    const int expected=(int)((now-firstVSYNC)/PERIOD);
+    EXPECT_TRUE(std::abs(latest.count-expected)<=2);
+    const float position=vsync.getVsyncRasterizerPositionNormalized();
+    EXPECT_TRUE(position>=0.0f && position<1.0f);
+}
+
+static void testSyntheticSource(){
+    VSYNC vsync;
+    vsync.setVSYNCSource(std::make_unique<SyntheticVSYNCSource>(vsync,PERIOD,500us));
+    VSYNCSource* source=vsync.getVSYNCSource();
+    const auto start=CLOCK::now();
+    EXPECT_TRUE(source->start());
+    EXPECT_TRUE(source->isRunning());
+    std::this_thread::sleep_for(200ms);
+    source->stop();
+    EXPECT_TRUE(!source->isRunning());
+    expectCountMatchesElapsed(vsync,start+PERIOD);
+}
+
+// Writes a replay file with a comment, a malformed and a not increasing line
+static std::string writeReplayFile(){
+    char fileName[]="/tmp/rx_vsync_replay_XXXXXX";
+    close(mkstemp(fileName));
+    std::ofstream file(fileName);
+    file<<"# recorded on a 60Hz display\n";
+    file<<"1000000000\n";
+    file<<"1016666666\n";
+    file<<"not a timestamp\n";
+    file<<"1033333333\n";
+    file<<"1033333333\n";
+    file<<"1049999999\n";
+    file<<"1066666666\n";
+    return fileName;
+}
+
+static void testReadTimestamps(){
+    const std::string fileName=writeReplayFile();
+    EXPECT_EQ((std::vector<int64_t>{1000000000,1016666666,1033333333,1049999999,1066666666}),ReplayVSYNCSource::readTimestamps(fileName));
+    std::remove(fileName.c_str());
+    EXPECT_EQ(std::vector<int64_t>{},ReplayVSYNCSource::readTimestamps("/tmp/rx_vsync_replay_does_not_exist"));
+}
+
+static void testReplaySource(){
+    const std::string fileName=writeReplayFile();
+    VSYNC vsync;
+    vsync.setVSYNCSource(std::make_unique<ReplayVSYNCSource>(vsync,fileName,false));
+    std::remove(fileName.c_str());
+    VSYNCSource* source=vsync.getVSYNCSource();
+    // The first timestamp is reported right away
+    const auto start=CLOCK::now();
+    EXPECT_TRUE(source->start());
+    // One pass takes 4 periods
+    std::this_thread::sleep_for(150ms);
+    source->stop();
+    expectCountMatchesElapsed(vsync,start);
+}
+
+static void testReplaySourceWithoutTimestamps(){
+    VSYNC vsync;
+    ReplayVSYNCSource source(vsync,"/tmp/rx_vsync_replay_does_not_exist");
+    EXPECT_TRUE(!source.start());
+    EXPECT_TRUE(!source.isRunning());
+}
+
+int main(){
+    testSyntheticSource();
+    testReadTimestamps();
+    testReplaySource();
+    testReplaySourceWithoutTimestamps();
+    return TestHelper::finish("VSYNCSourceTest");
+}
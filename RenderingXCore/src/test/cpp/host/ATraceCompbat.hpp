@@ -0,0 +1,8 @@
+#ifndef RENDERINGX_TEST_ATRACECOMPBAT_HPP
+#define RENDERINGX_TEST_ATRACECOMPBAT_HPP
+
+// Host replacement for ATraceCompbat.hpp from LiveVideo10ms/Shared, there is no systrace on the host
+static void ATrace_beginSection(const char* sectionName){}
+static void ATrace_endSection(){}
+
+#endif //RENDERINGX_TEST_ATRACECOMPBAT_HPP
@@ -0,0 +1,40 @@
+#ifndef RENDERINGX_TEST_ANDROIDLOGGER_HPP
+#define RENDERINGX_TEST_ANDROIDLOGGER_HPP
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Same values as android/log.h
+enum android_LogPriority{
+    ANDROID_LOG_DEBUG=3,
+    ANDROID_LOG_INFO=4,
+    ANDROID_LOG_WARN=5,
+    ANDROID_LOG_ERROR=6
+};
+
+// Host replacement for AndroidLogger.hpp from LiveVideo10ms/Shared: same macros, but writes to stderr
+class AndroidLogger{
+public:
+    AndroidLogger(const android_LogPriority priority,std::string tag):priority(priority),tag(std::move(tag)){}
+    ~AndroidLogger(){
+        static constexpr const char* PRIORITY_NAMES[]={"","","","D","I","W","E"};
+        std::cerr<<PRIORITY_NAMES[priority]<<"/"<<tag<<": "<<stream.str()<<"\n";
+    }
+    template<class T>
+    AndroidLogger& operator<<(const T& t){
+        stream<<t;
+        return *this;
+    }
+private:
+    const android_LogPriority priority;
+    const std::string tag;
+    std::stringstream stream;
+};
+
+#define MLOGD AndroidLogger(ANDROID_LOG_DEBUG,"NoTag")
+#define MLOGE AndroidLogger(ANDROID_LOG_ERROR,"NoTag")
+#define MLOGD2(tag) AndroidLogger(ANDROID_LOG_DEBUG,tag)
+#define MLOGE2(tag) AndroidLogger(ANDROID_LOG_ERROR,tag)
+
+#endif //RENDERINGX_TEST_ANDROIDLOGGER_HPP
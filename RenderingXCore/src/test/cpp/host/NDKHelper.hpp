@@ -0,0 +1,13 @@
+#ifndef RENDERINGX_TEST_NDKHELPER_HPP
+#define RENDERINGX_TEST_NDKHELPER_HPP
+
+#include <jni.h>
+#include <GLES2/gl2.h>
+
+// Host replacement for NDKHelper.hpp from LiveVideo10ms/Shared. There are no android assets on the host,
+// the functions that load them are never called in the tests
+namespace NDKHelper{
+    static void LoadPngFromAssetManager2(JNIEnv* env,jobject androidContext,GLenum target,const char* name){}
+}
+
+#endif //RENDERINGX_TEST_NDKHELPER_HPP
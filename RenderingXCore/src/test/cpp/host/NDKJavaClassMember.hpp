@@ -0,0 +1,22 @@
+#ifndef RENDERINGX_TEST_NDKJAVACLASSMEMBER_HPP
+#define RENDERINGX_TEST_NDKJAVACLASSMEMBER_HPP
+
+#include <jni.h>
+#include <array>
+
+// Host replacement for NDKJavaClassMember.hpp from LiveVideo10ms/Shared. There is no java on the host,
+// the tests construct the native classes with the values directly (e.g. VrCompositorRenderer with MVrHeadsetParams)
+class ClassMemberFromJava{
+public:
+    ClassMemberFromJava(JNIEnv* env,jobject instance){}
+    template<class T>
+    T get(const char* name){
+        return T{};
+    }
+    template<std::size_t N>
+    std::array<float,N> getFloatArrayFixed(const char* name){
+        return {};
+    }
+};
+
+#endif //RENDERINGX_TEST_NDKJAVACLASSMEMBER_HPP
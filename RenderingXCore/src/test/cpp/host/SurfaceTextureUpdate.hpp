@@ -0,0 +1,16 @@
+#ifndef RENDERINGX_TEST_SURFACETEXTUREUPDATE_HPP
+#define RENDERINGX_TEST_SURFACETEXTUREUPDATE_HPP
+
+#include <jni.h>
+#include <GLES2/gl2.h>
+
+// Host replacement for SurfaceTextureUpdate.hpp from LiveVideo10ms/Shared. There is no android SurfaceTexture on the host,
+// only the type is needed for the content providers of the compositor
+class SurfaceTextureUpdate{
+public:
+    GLuint getTextureId()const{
+        return 0;
+    }
+};
+
+#endif //RENDERINGX_TEST_SURFACETEXTUREUPDATE_HPP
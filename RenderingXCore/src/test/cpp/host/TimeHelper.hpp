@@ -0,0 +1,66 @@
+#ifndef RENDERINGX_TEST_TIMEHELPER_HPP
+#define RENDERINGX_TEST_TIMEHELPER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include "AndroidLogger.hpp"
+
+// Host replacement for the parts of TimeHelper.hpp from LiveVideo10ms/Shared that are used by the tested code
+using CLOCK=std::chrono::steady_clock;
+
+namespace MyTimeHelper{
+    static std::string ReadableNS(const int64_t ns){
+        std::stringstream ss;
+        ss<<((double)ns/1000.0/1000.0)<<"ms";
+        return ss.str();
+    }
+    template<class Rep,class Period>
+    static std::string R(const std::chrono::duration<Rep,Period> duration){
+        return ReadableNS(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    }
+}
+
+// Average of durations
+class AvgCalculator{
+public:
+    void add(const std::chrono::nanoseconds sample){
+        sum+=sample;
+        nSamples++;
+    }
+    int64_t getNSamples()const{
+        return nSamples;
+    }
+    std::chrono::nanoseconds getAvg()const{
+        return nSamples==0 ? std::chrono::nanoseconds(0) : sum/nSamples;
+    }
+    std::string getAvgReadable()const{
+        return MyTimeHelper::R(getAvg());
+    }
+    void reset(){
+        sum=std::chrono::nanoseconds(0);
+        nSamples=0;
+    }
+private:
+    std::chrono::nanoseconds sum{0};
+    int64_t nSamples=0;
+};
+
+// Average of the time between start() and stop()
+class Chronometer:public AvgCalculator{
+public:
+    Chronometer()=default;
+    explicit Chronometer(std::string name):name(std::move(name)){}
+    void start(){
+        startTime=CLOCK::now();
+    }
+    void stop(){
+        add(CLOCK::now()-startTime);
+    }
+private:
+    std::string name;
+    CLOCK::time_point startTime;
+};
+
+#endif //RENDERINGX_TEST_TIMEHELPER_HPP
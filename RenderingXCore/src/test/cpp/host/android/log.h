@@ -0,0 +1,7 @@
+#ifndef RENDERINGX_TEST_ANDROID_LOG_H
+#define RENDERINGX_TEST_ANDROID_LOG_H
+
+// Host replacement for the android log header, the priorities are defined by the host AndroidLogger.hpp
+#include <AndroidLogger.hpp>
+
+#endif //RENDERINGX_TEST_ANDROID_LOG_H
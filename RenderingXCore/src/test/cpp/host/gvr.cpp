@@ -0,0 +1,12 @@
+#include <vr/gvr/capi/include/gvr.h>
+#include <chrono>
+
+// Host replacement for the functions of libgvr.so that are referenced by the tested code.
+// The tests run without gvr (gvr_api is nullptr), there is no head tracking on the host
+gvr_clock_time_point gvr_get_time_point_now(){
+    return {std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()};
+}
+
+gvr_mat4f gvr_get_head_space_from_start_space_rotation(const gvr_context* gvr,const gvr_clock_time_point time){
+    return {{{1,0,0,0},{0,1,0,0},{0,0,1,0},{0,0,0,1}}};
+}
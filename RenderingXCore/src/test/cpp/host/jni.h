@@ -0,0 +1,38 @@
+#ifndef RENDERINGX_TEST_JNI_H
+#define RENDERINGX_TEST_JNI_H
+
+#include <cstdint>
+
+// Only the JNI types used in the signatures of the native methods, such that the files that also contain them build on the host.
+// The native methods are never called in the tests
+typedef void* jobject;
+typedef jobject jclass;
+typedef jobject jstring;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef uint8_t jboolean;
+typedef struct _jmethodID* jmethodID;
+
+// The JNIEnv functions used by the native methods and inline helpers that read from java (e.g. createFromJava2()).
+// They are never called in the tests either
+struct JNIEnv{
+    jclass FindClass(const char* name){
+        return nullptr;
+    }
+    jmethodID GetMethodID(jclass clazz,const char* name,const char* signature){
+        return nullptr;
+    }
+    template<class... Args>
+    jobject NewObject(jclass clazz,jmethodID methodID,Args... args){
+        return nullptr;
+    }
+    const char* GetStringUTFChars(jstring string,jboolean* isCopy){
+        return "";
+    }
+    void ReleaseStringUTFChars(jstring string,const char* utf){}
+};
+
+#define JNIEXPORT
+#define JNICALL
+
+#endif //RENDERINGX_TEST_JNI_H
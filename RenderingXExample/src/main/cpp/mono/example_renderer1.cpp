@@ -6,6 +6,7 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include <jni.h>
+#include <array>
 #include <glm/glm.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -19,6 +20,8 @@
 #include <TexturedGeometry.hpp>
 #include <TextAssetsHelper.hpp>
 #include <GLBuffer.hpp>
+#include <GLStreamingBuffer.hpp>
+#include <GLState.hpp>
 #include <GLProgramLine.h>
 #include <GLProgramTexture.h>
 #include <TimeHelper.hpp>
@@ -65,12 +68,10 @@ GLPTextureProj* glProgramTextureProj;
 ColoredGLMeshBuffer mMeshColoredGeometry;
 //holds textured vertices
 TexturedGLMeshBuffer mMeshTexturedGeometry;
-//holds text vertices
-GLBuffer<GLProgramText::Character> glBufferText;
+//holds text and smooth line vertices, written each frame like dynamic content (e.g. an OSD) would be
+GLStreamingBuffer glStreamingBuffer;
 //holds icon vertices (also interpreted as text)
 GLBuffer<GLProgramText::Character> glBufferIcons;
-//holds smooth line vertices
-GLBuffer<GLProgramLine::Vertex> glBufferLine;
 const glm::mat4 DEFAULT_MODEL_MATRIX=glm::scale(glm::mat4(1.0f), glm::vec3(1.0,1.0,1.0));
 glm::mat4 modelM;
 
@@ -126,30 +127,11 @@ static void onSurfaceCreated(JNIEnv* env,jobject context){
         GLProgramLine::convertLineToRenderingData({-lineLength/2,yOffset,0},{lineLength/2,yOffset,0},strokeWidth,lines.data(),i*GLProgramLine::VERTICES_PER_LINE,
                 baseColor,outlineColor);
     }*/
-    std::vector<GLProgramLine::Vertex> lines;
-    const float lineLength=4;
-    float yOffset=TEXT_Y_OFFSET;
-    for(int i=0;i<10;i++){
-        auto tmp=GLProgramLine::makeHorizontalLine({-lineLength/2.0f,yOffset},lineLength,0.5f,TrueColor2::WHITE,TrueColor2::BLUE);
-        lines.insert(lines.end(),tmp.begin(),tmp.end());
-        yOffset+=1.5f;
-    }
-    glBufferLine.uploadGL(lines);
-
-    //some smooth characters
-    std::vector<GLProgramText::Character> charactersAsVertices(EXAMPLE_TEXT_LENGTH*EXAMPLE_TEXT_N_LINES);
-    yOffset=TEXT_Y_OFFSET;
-    float textHeight=0.5f;
-    for(int i=0;i<EXAMPLE_TEXT_N_LINES;i++){
-        float textLength=GLProgramText::getStringLength({EXAMPLE_TEXT},textHeight);
-        GLProgramText::convertStringToRenderingData(-textLength/2.0f, yOffset, textHeight, {EXAMPLE_TEXT}, TrueColor2::YELLOW, charactersAsVertices.data(), i * EXAMPLE_TEXT_LENGTH);
-        yOffset+=textHeight;
-        textHeight+=0.3;
-    }
-    glBufferText.uploadGL(charactersAsVertices);
+    //the smooth lines and characters are written into the streaming buffer in onDrawFrame()
+    glStreamingBuffer.initializeGL();
     //some icons
     std::vector<GLProgramText::Character> iconsAsVertices(N_ICONS);
-    yOffset=TEXT_Y_OFFSET;
+    float yOffset=TEXT_Y_OFFSET;
     for(int i=0;i<N_ICONS;i++){
         const float textHeight=0.8F;
         GLProgramText::convertStringToRenderingData(0, yOffset, textHeight, {(wchar_t)GLProgramText::ICONS_OFFSET+i},
@@ -242,16 +224,33 @@ static void onDrawFrame(){
     //
     updateCamera();
     if(currentRenderingMode==5){
-        glEnable(GL_DEPTH_TEST);
+        // Through GLState, else its cache would be stale after switching back to text
+        GLState::enable(GL_DEPTH_TEST);
     }else{
         GLProgramText::setupDepthTestAndBlending();
     }
     //Drawing with the OpenGL Programs is easy - call beforeDraw() with the right OpenGL Buffer and then draw until done
     if(currentRenderingMode==0){ //Smooth text
-        glProgramText->beforeDraw(glBufferText.getGLBufferId());
-        glProgramText->updateOutline(TrueColor2::RED, seekBarValue1 / 100.0f);
-        glProgramText->setOtherUniforms(seekBarValue2/100.0f,seekBarValue3/100.0f);
-        glProgramText->draw(projection*eyeView,0,glBufferText.getCount()*GLProgramText::INDICES_PER_CHARACTER);
+        //some smooth characters, written straight into the streaming buffer
+        std::array<GLStreamingBuffer::Allocation<GLProgramText::Character>,EXAMPLE_TEXT_N_LINES> textLines;
+        glStreamingBuffer.beginFrame();
+        float yOffset=TEXT_Y_OFFSET;
+        float textHeight=0.5f;
+        for(int i=0;i<EXAMPLE_TEXT_N_LINES;i++){
+            const float textLength=GLProgramText::getStringLength({EXAMPLE_TEXT},textHeight);
+            textLines[i]=GLProgramText::writeString(glStreamingBuffer,-textLength/2.0f,yOffset,textHeight,{EXAMPLE_TEXT},TrueColor2::YELLOW);
+            yOffset+=textHeight;
+            textHeight+=0.3;
+        }
+        glStreamingBuffer.commit();
+        for(const auto& textLine:textLines){
+            // Did not fit, the streaming buffer grows with the next frame
+            if(!textLine.isValid())continue;
+            glProgramText->beforeDraw(textLine);
+            glProgramText->updateOutline(TrueColor2::RED, seekBarValue1 / 100.0f);
+            glProgramText->setOtherUniforms(seekBarValue2/100.0f,seekBarValue3/100.0f);
+            glProgramText->draw(projection*eyeView,0,textLine.count*GLProgramText::INDICES_PER_CHARACTER);
+        }
         glProgramText->afterDraw();
     } else if(currentRenderingMode==1){
         glProgramText->beforeDraw(glBufferIcons.getGLBufferId());
@@ -260,9 +259,23 @@ static void onDrawFrame(){
         glProgramText->draw(projection*eyeView,0,glBufferIcons.getCount()*GLProgramText::INDICES_PER_CHARACTER);
         glProgramText->afterDraw();
     }else if(currentRenderingMode==2){
-        glProgramLine->beforeDraw(glBufferLine.getGLBufferId());
-        glProgramLine->setOtherUniforms(seekBarValue1/100.0F,seekBarValue2/100.0F,seekBarValue3/100.0F);
-        glProgramLine->draw(eyeView,projection,0,glBufferLine.getCount());
+        //some smooth lines (same as GLProgramLine::makeHorizontalLine()), written straight into the streaming buffer
+        std::array<GLStreamingBuffer::Allocation<GLProgramLine::Vertex>,10> lines;
+        glStreamingBuffer.beginFrame();
+        const float lineLength=4;
+        const float lineHeight=0.5f;
+        float yOffset=TEXT_Y_OFFSET+lineHeight/2.0f;
+        for(auto& line:lines){
+            line=GLProgramLine::writeLine(glStreamingBuffer,{-lineLength/2.0f,yOffset},{lineLength/2.0f,yOffset},lineHeight,TrueColor2::WHITE,TrueColor2::BLUE);
+            yOffset+=1.5f;
+        }
+        glStreamingBuffer.commit();
+        for(const auto& line:lines){
+            if(!line.isValid())continue;
+            glProgramLine->beforeDraw(line);
+            glProgramLine->setOtherUniforms(seekBarValue1/100.0F,seekBarValue2/100.0F,seekBarValue3/100.0F);
+            glProgramLine->draw(eyeView,projection,0,(int)line.count);
+        }
         glProgramLine->afterDraw();
     }else if(currentRenderingMode==3){
         glProgramVC->drawX(eyeView, projection, mMeshColoredGeometry);
@@ -279,6 +292,7 @@ static void onDrawFrame(){
         glProgramTextureProj->afterDraw();*/
     }
     GLHelper::checkGlError("example_renderer::onDrawFrame");
+    GLInstrumentation::endFrame();
     cpuFrameTime.stop();
     cpuFrameTime.printInIntervalls(std::chrono::seconds(5));
     fpsCalculator.tick();
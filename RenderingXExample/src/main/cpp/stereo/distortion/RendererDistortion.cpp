@@ -93,6 +93,9 @@ void RendererDistortion::onDrawFrame() {
         for(int eye=0;eye<2;eye++){
             drawEyeVDDC(static_cast<gvr::Eye>(eye));
         }
+        // Both eyes are submitted, posted uploads do not delay them anymore
+        vrCompositorRenderer.executeGLWork();
+        vrCompositorRenderer.printLogIfNeeded();
     }
     GLHelper::checkGlError("RendererDistortion::onDrawFrame");
 }
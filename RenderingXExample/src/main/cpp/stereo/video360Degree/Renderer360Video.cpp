@@ -11,6 +11,7 @@
 #include <Sphere/UvSphere.hpp>
 #include <CardboardViewportOcclusion.hpp>
 #include <Sphere/SphereBuilder.hpp>
+#include <TaskScheduler.h>
 
 Renderer360Video::Renderer360Video(JNIEnv *env, jobject androidContext, gvr_context *gvr_context,const int vSPHERE_MODE):
         vrSettings(env,androidContext),
@@ -20,8 +21,19 @@ Renderer360Video::Renderer360Video(JNIEnv *env, jobject androidContext, gvr_cont
         vrCompositorRenderer(env, androidContext, gvr_api_.get(),
                              vrSettings.isVR_DISTORTION_CORRECTION_ENABLED(), vrSettings.VR_ENABLE_DEBUG),
         mFPSCalculator("OpenGL FPS", std::chrono::seconds(2)){
+    SecondaryRenderScheduler::ProducerConfig osdConfig;
+    osdConfig.name="OSD";
+    osdConfig.priority=1;
+    osdConfig.maxFps=30;
+    osdProducer=secondaryRenderScheduler.addProducer(osdConfig,[this](){
+        renderOsd();
+    });
 }
 
+Renderer360Video::~Renderer360Video() {
+    // The posted upload itself is dropped together with the GLWorkQueue
+    if(sphereTask)TaskScheduler::instance().wait(sphereTask);
+}
 
 void Renderer360Video::onSurfaceCreated(JNIEnv *env, jobject context,jobject surfaceTextureHolder) {
     Extensions::initializeGL();
@@ -34,20 +46,46 @@ void Renderer360Video::onSurfaceCreated(JNIEnv *env, jobject context,jobject sur
     GLProgramTexture::loadTexture(mTexture360Image,env,context,"360DegreeImages/gvr_testroom_mono.png");
     GLProgramTexture::loadTexture(mTexture360ImageInsta360,env,context,"360DegreeImages/insta_360_equirectangular.png");*/
     vrCompositorRenderer.removeLayers();
-    if(M_SPHERE_MODE==SPHERE_MODE_EQUIRECTANGULAR_TEST){
-        vrCompositorRenderer.addLayerSphere360(10.0f,UvSphere::MEDIA_EQUIRECT_MONOSCOPIC,&surfaceTextureUpdate);
-    }else{
-        auto sphere=DualFisheyeSphere::createSphereGL(2560, 1280);
-        vrCompositorRenderer.addLayer(sphere,&surfaceTextureUpdate, VrCompositorRenderer::HEAD_TRACKING::FULL);
-    }
-    const float uiElementWidth=2.0;
-    vrCompositorRenderer.addLayer2DCanvas(-3, uiElementWidth,uiElementWidth*1080.0f/2160.0f,&vrRenderBuffer2, VrCompositorRenderer::FULL);
+    // Generating the sphere takes some time, do it on the TaskScheduler and upload it via the GLWorkQueue,
+    // such that the first frames are not delayed
+    auto& scheduler=TaskScheduler::instance();
+    const SPHERE_MODE sphereMode=M_SPHERE_MODE;
+    auto sphere=std::make_shared<TexturedStereoMeshData>();
+    const auto createSphere=scheduler.submit([sphere,sphereMode](){
+        if(sphereMode==SPHERE_MODE_EQUIRECTANGULAR_TEST){
+            *sphere=SphereBuilder::createSphereEquirectangularMonoscopic(10.0f,72,36);
+        }else{
+            *sphere=TexturedStereoVertexHelper::convert(DualFisheyeSphere::createSphereGL(2560, 1280));
+        }
+    });
+    // The OSD layer is added after the sphere, such that it is drawn on top of it
+    const int generation=++layerGeneration;
+    sphereTask=scheduler.thenOnGLThread(createSphere,vrCompositorRenderer.getGLWorkQueue(),[this,sphere,generation](){
+        // The surface was re-created in the meantime
+        if(generation!=layerGeneration)return;
+        vrCompositorRenderer.addLayer(*sphere,&surfaceTextureUpdate, VrCompositorRenderer::HEAD_TRACKING::FULL);
+        const float uiElementWidth=2.0;
+        vrCompositorRenderer.addLayer2DCanvas(-3, uiElementWidth,uiElementWidth*1080.0f/2160.0f,&osdSwapchain, VrCompositorRenderer::FULL);
+    });
     // add a static layer to test the pre-distort feature
     //vrCompositorRenderer.addLayer2DCanvas(-3,0.2f,0.2f,mSomethingTexture,false,VrCompositorRenderer::NONE);
 }
 
 void Renderer360Video::onDrawFrame(JNIEnv* env) {
+    // Posted uploads (e.g. the sphere mesh) are done in the time the frame pacer would sleep anyways
+    vrCompositorRenderer.executeGLWork();
+    // Start the frame as late as possible, such that the video frame and head pose are as recent as possible
+    framePacer.beginFrame();
     mFPSCalculator.tick();
+    const auto& pacingController=framePacer.getController();
+    if(pacingController.getLastCompositeDeadline()!=std::chrono::steady_clock::time_point{}){
+        secondaryRenderScheduler.setVsyncModel(pacingController.getLastCompositeDeadline(),pacingController.getCompositeInterval());
+    }
+    const auto now=std::chrono::steady_clock::now();
+    if(now-lastOsdChange>std::chrono::seconds(1)){
+        lastOsdChange=now;
+        secondaryRenderScheduler.markDirty(osdProducer);
+    }
     /*const auto timeP=std::chrono::steady_clock::now()+std::chrono::seconds(1);
     if(const auto delay=surfaceTextureUpdate.waitUntilFrameAvailable(env,timeP)){
         videoFrameWaitTime.add(*delay);
@@ -58,7 +96,6 @@ void Renderer360Video::onDrawFrame(JNIEnv* env) {
     }*/
 
     surfaceTextureUpdate.updateAndCheck(env);
-    MLOGD<<"FPS: "<<mFPSCalculator.getCurrentFPS();
 
     //Update the head position (rotation) then leave it untouched during the frame
     vrCompositorRenderer.updateLatestHeadSpaceFromStartSpaceRotation();
@@ -71,25 +108,31 @@ void Renderer360Video::onDrawFrame(JNIEnv* env) {
     for(int eye=0;eye<2;eye++){
         vrCompositorRenderer.drawLayers(static_cast<gvr::Eye>(eye));
     }
-    Extensions::eglPresentationTimeANDROID(eglGetCurrentDisplay(),eglGetCurrentSurface(EGL_DRAW),std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    // Also submits the frame to the FrameTimestampsTracker of the pacer, which logs the presentation latency
+    framePacer.endFrame();
+    vrCompositorRenderer.printLogIfNeeded();
     GLHelper::checkGlError("Renderer360Video::onDrawFrame");
     //eglSwapBuffers(eglGetCurrentDisplay(),eglGetCurrentSurface(EGL_DRAW));
 }
 
 void Renderer360Video::onSecondaryContextCreated(JNIEnv* env,jobject context) {
-    vrRenderBuffer2.initializeGL();
-    vrRenderBuffer2.setSize(1280,720);
+    // The secondary context might be created before the surface of the main context
+    Extensions::initializeGL();
+    osdSwapchainInitialized=osdSwapchain.initializeProducerGL(1280,720);
 }
 
 void Renderer360Video::onSecondaryContextDoWork(JNIEnv *env) {
-    //MLOGD<<"Do work";
-    vrRenderBuffer2.bind();
+    // Blocks until the OSD has to be rendered (or 100ms passed, such that the java thread can be interrupted)
+    secondaryRenderScheduler.doWork();
+}
+
+void Renderer360Video::renderOsd() {
+    if(!osdSwapchainInitialized)return;
+    osdSwapchain.bind();
     GLHelper::updateSetClearColor(clearColorIndex);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-    vrRenderBuffer2.unbindAndSwap();
-    //MLOGD<<"Do work";
+    glClear(GL_COLOR_BUFFER_BIT);
+    osdSwapchain.unbindAndSwap();
     mFPSCalculatorRenderbuffer.tick();
-    MLOGD<<"OSD FPS: "<<mFPSCalculatorRenderbuffer.getCurrentFPS();
 }
 
 
@@ -32,8 +32,12 @@
 #include <VrRenderBuffer.hpp>
 #include <VrRenderBuffer2.hpp>
 #include <VrRenderBuffer3.hpp>
+#include <EGLImageExchange.hpp>
 #include <SurfaceTextureUpdate.hpp>
 #include <VRSettings.h>
+#include <FramePacer.h>
+#include <SecondaryRenderScheduler.h>
+#include <TaskScheduler.h>
 
 // Example that renders 360° video with the Vr compositor renderer using VDDC
 class Renderer360Video{
@@ -42,6 +46,8 @@ public:
     const SPHERE_MODE M_SPHERE_MODE;
 public:
     Renderer360Video(JNIEnv* env, jobject androidContext, gvr_context *gvr_context,const int SPHERE_MODE=0);
+    // Waits until the sphere mesh was posted into the GLWorkQueue
+    ~Renderer360Video();
     void onSurfaceCreated(JNIEnv* env,jobject context,jobject surfaceTextureHolder);
     void onDrawFrame(JNIEnv* env);
     void onSecondaryContextCreated(JNIEnv* env,jobject context);
@@ -50,11 +56,25 @@ private:
     const VRSettings vrSettings;
     std::unique_ptr<gvr::GvrApi> gvr_api_;
     FPSCalculator mFPSCalculator;
-    FPSCalculator mFPSCalculatorRenderbuffer;
+    FPSCalculator mFPSCalculatorRenderbuffer{"OSD FPS",std::chrono::seconds(2)};
     int clearColorIndex=0;
-    VrRenderBuffer2 vrRenderBuffer2;
+    // The OSD is rendered on the secondary context. It is not in the share group of the main context,
+    // the frames are exchanged as EGLImages
+    EGLImageSwapchain osdSwapchain{"Renderer360Video::OSD"};
+    // Only accessed on the secondary context
+    bool osdSwapchainInitialized=false;
     VrRenderBuffer2 vrRenderBufferExampleUi{"ExampleTexture/ui.png"};
     SurfaceTextureUpdate surfaceTextureUpdate;
+    FramePacer framePacer{"Renderer360Video"};
+    // The OSD is only re-rendered when it changed (here: once per second)
+    SecondaryRenderScheduler secondaryRenderScheduler{"Renderer360Video::SecondaryContext"};
+    SecondaryRenderScheduler::ProducerId osdProducer;
+    std::chrono::steady_clock::time_point lastOsdChange{};
+    void renderOsd();
+    // Creates the sphere mesh and posts the upload into the GLWorkQueue
+    TaskScheduler::TaskHandle sphereTask;
+    // Increased with each onSurfaceCreated(), an upload posted for an older surface is dropped
+    int layerGeneration=0;
 public:
     VrCompositorRenderer vrCompositorRenderer;
     AvgCalculator videoFrameWaitTime;
@@ -24,11 +24,48 @@
 #include "FPSCalculator.hpp"
 #include "RendererSuperSync.h"
 
+// Context.getFilesDir().getAbsolutePath()
+static std::string getFilesDir(JNIEnv* env,jobject androidContext){
+    jclass jcContext=env->GetObjectClass(androidContext);
+    jobject jFile=env->CallObjectMethod(androidContext,env->GetMethodID(jcContext,"getFilesDir","()Ljava/io/File;"));
+    jclass jcFile=env->GetObjectClass(jFile);
+    auto jPath=(jstring)env->CallObjectMethod(jFile,env->GetMethodID(jcFile,"getAbsolutePath","()Ljava/lang/String;"));
+    const char* path=env->GetStringUTFChars(jPath,nullptr);
+    std::string ret(path);
+    env->ReleaseStringUTFChars(jPath,path);
+    return ret;
+}
+
 RendererSuperSync::RendererSuperSync(JNIEnv *env, jobject androidContext, gvr_context *gvr_context,jlong vsync):
+        mFrameTimingTelemetry(getFilesDir(env,androidContext)+"/supersync_trace.json",FrameTimingTelemetry::OutputFormat::CHROME_TRACE),
         mSurfaceTextureUpdate(env),
         gvr_api_(gvr::GvrApi::WrapNonOwned(gvr_context))
         ,vrCompositorRenderer(env,androidContext,gvr_api_.get(),true,false,false),
-        mFBRManager(VSYNC::native(vsync),true){
+        mFBRManager(VSYNC::native(vsync),false){
+    // The timing of each eye is written to the trace file (open it in chrome://tracing) and its percentiles are logged
+    mFBRManager.setTelemetry(&mFrameTimingTelemetry);
+    mFBRManager.setMinEyeBudget(MIN_EYE_BUDGET);
+    mFBRManager.setRenderNewEyeCallback([this](JNIEnv* env,VrCompositorRenderer& renderer,const EyeDeadline& deadline){
+        return renderNewEye(renderer,deadline);
+    });
+}
+
+EyeRenderMode RendererSuperSync::renderNewEye(VrCompositorRenderer& renderer,const EyeDeadline& deadline) {
+    // Rendering anything now would only produce tearing, the front buffer still holds the last frame of this eye
+    if(deadline.remainingBudget<MIN_DEGRADED_EYE_BUDGET){
+        return EyeRenderMode::SKIPPED;
+    }
+    // The background alternates between black and yellow to make tearing observable. Clearing the whole eye with a mesh
+    // is the most expensive part of the eye, leave it out when running late
+    if(deadline.remainingBudget<MIN_FULL_EYE_BUDGET){
+        renderer.drawLayers(deadline.isLeftEye ? GVR_LEFT_EYE : GVR_RIGHT_EYE);
+        return EyeRenderMode::DEGRADED;
+    }
+    const int eyeIdx=deadline.isLeftEye ? 0 : 1;
+    clearBlack[eyeIdx]=!clearBlack[eyeIdx];
+    renderer.clearViewportUsingRenderedMesh(clearBlack[eyeIdx]);
+    renderer.drawLayers(deadline.isLeftEye ? GVR_LEFT_EYE : GVR_RIGHT_EYE);
+    return EyeRenderMode::FULL;
 }
 
 void RendererSuperSync::onSurfaceCreated(JNIEnv *env, jobject androidContext,jobject surfaceTextureHolder,int width, int height) {
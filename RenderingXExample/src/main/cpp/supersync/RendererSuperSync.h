@@ -25,6 +25,10 @@
 #include <FPSCalculator.hpp>
 #include <VrCompositorRenderer.h>
 #include <SurfaceTextureUpdate.hpp>
+#include <FrameTimingTelemetry.h>
+#include <FBRManager.h>
+#include <array>
+#include <chrono>
 
 #include "vr/gvr/capi/include/gvr.h"
 #include "vr/gvr/capi/include/gvr_types.h"
@@ -50,6 +54,15 @@ public:
     void enterSuperSyncLoop(JNIEnv * env, jobject obj);
     void onSurfaceCreated(JNIEnv * env,jobject obj,jobject surfaceTextureHolder,int width, int height);
 private:
+    // Deadline aware eye rendering, see FBRManager::setRenderNewEyeCallback()
+    EyeRenderMode renderNewEye(VrCompositorRenderer& renderer,const EyeDeadline& deadline);
+    // Less budget than MIN_EYE_BUDGET: The FBRManager skips the eye without calling renderNewEye()
+    static constexpr auto MIN_EYE_BUDGET=std::chrono::milliseconds(1);
+    static constexpr auto MIN_DEGRADED_EYE_BUDGET=std::chrono::milliseconds(2);
+    static constexpr auto MIN_FULL_EYE_BUDGET=std::chrono::milliseconds(5);
+    std::array<bool,2> clearBlack{};
+    // Declared before mFBRManager such that it outlives the FBRManager that pushes into it
+    FrameTimingTelemetry mFrameTimingTelemetry;
     FBRManager mFBRManager;
     std::unique_ptr<gvr::GvrApi> gvr_api_;
     SurfaceTextureUpdate mSurfaceTextureUpdate;
@@ -8,6 +8,7 @@ import com.dinuscxj.gesture.MultiTouchGestureDetector;
 import javax.microedition.khronos.egl.EGLConfig;
 import javax.microedition.khronos.opengles.GL10;
 
+import constantin.renderingx.core.deviceinfo.Extensions;
 import constantin.renderingx.core.xglview.XGLSurfaceView;
 
 
@@ -32,6 +33,8 @@ public class GLRExample implements XGLSurfaceView.LegacyRenderer, MultiTouchGest
 
     GLRExample(final Context context){
         mContext=context;
+        // Before any OpenGL program is created, such that they are linked from the cache on the next start
+        Extensions.enableProgramBinaryCache(context);
         mMultiTouchGestureDetector=new MultiTouchGestureDetector(mContext,this);
     }
 
@@ -6,6 +6,7 @@ import android.content.Context;
 import com.google.vr.ndk.base.GvrApi;
 
 import constantin.renderingx.core.MVrHeadsetParams;
+import constantin.renderingx.core.deviceinfo.Extensions;
 import constantin.renderingx.core.xglview.XGLSurfaceView;
 
 
@@ -25,6 +26,8 @@ public class RendererDistortion implements XGLSurfaceView.FullscreenRenderer {
 
     public RendererDistortion(final Context context, final GvrApi gvrApi){
         mContext=context;
+        // Before any OpenGL program is created, such that they are linked from the cache on the next start
+        Extensions.enableProgramBinaryCache(context);
         nativeRenderer=nativeConstruct(context, gvrApi.getNativeGvrContext());
     }
 
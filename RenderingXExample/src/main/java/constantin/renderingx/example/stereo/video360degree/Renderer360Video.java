@@ -7,6 +7,7 @@ import androidx.appcompat.app.AppCompatActivity;
 
 import com.google.vr.ndk.base.GvrApi;
 
+import constantin.renderingx.core.deviceinfo.Extensions;
 import constantin.renderingx.core.xglview.GLContextSurfaceLess;
 import constantin.renderingx.core.xglview.SurfaceTextureHolder;
 import constantin.renderingx.core.xglview.XGLSurfaceView;
@@ -30,6 +31,8 @@ public class Renderer360Video implements XGLSurfaceView.FullscreenRendererWithSu
     @SuppressLint("ApplySharedPref")
     public Renderer360Video(final AppCompatActivity context,final GvrApi gvrApi, int SPHERE_MODE){
         mContext=context;
+        // Before any OpenGL program is created, such that they are linked from the cache on the next start
+        Extensions.enableProgramBinaryCache(context);
         nativeRenderer=nativeConstruct(context, gvrApi.getNativeGvrContext(),SPHERE_MODE);
     }
 
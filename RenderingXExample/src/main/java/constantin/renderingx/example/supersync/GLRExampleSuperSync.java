@@ -7,6 +7,7 @@ import androidx.appcompat.app.AppCompatActivity;
 import com.google.vr.ndk.base.GvrApi;
 
 import constantin.renderingx.core.VSYNC;
+import constantin.renderingx.core.deviceinfo.Extensions;
 import constantin.renderingx.core.xglview.SurfaceTextureHolder;
 import constantin.renderingx.core.xglview.XGLSurfaceView;
 
@@ -26,6 +27,8 @@ public class GLRExampleSuperSync implements XGLSurfaceView.FullscreenRendererWit
 
     public GLRExampleSuperSync(final Context context, GvrApi gvrApi){
         mContext=context;
+        // Before any OpenGL program is created, such that they are linked from the cache on the next start
+        Extensions.enableProgramBinaryCache(context);
         final VSYNC vsync = new VSYNC((AppCompatActivity) context);
         nativeGLRSuperSync=nativeConstruct(context,gvrApi.getNativeGvrContext(), vsync.getNativeInstance());
     }